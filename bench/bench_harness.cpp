@@ -0,0 +1,191 @@
+#include "bench_harness.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "cpu_backend.hpp"
+#include "json_writer.hpp"
+
+namespace snow
+{
+namespace bench
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double time_iterations(const std::function<void()>& iteration, std::size_t count)
+    {
+        const Clock::time_point start = Clock::now();
+        for (std::size_t k = 0; k < count; ++k) iteration();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+double median(std::vector<double> values)
+{
+    if (values.empty()) return 0.0;
+    const std::size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(middle), values.end());
+    const double upper = values[middle];
+    if (values.size() % 2 == 1) return upper;
+    const double lower = *std::max_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(middle));
+    return 0.5 * (lower + upper);
+}
+
+double median_absolute_deviation(const std::vector<double>& values, double center)
+{
+    std::vector<double> deviations;
+    deviations.reserve(values.size());
+    for (const double value : values) deviations.push_back(std::fabs(value - center));
+    return median(std::move(deviations));
+}
+
+BenchResult run_benchmark(const std::string& group,
+                          const std::string& name,
+                          double items_per_iteration,
+                          double bytes_per_iteration,
+                          const BenchOptions& options,
+                          const std::function<void()>& iteration)
+{
+    BenchResult result;
+    result.group = group;
+    result.name = name;
+    result.items_per_iteration = items_per_iteration;
+    result.bytes_per_iteration = bytes_per_iteration;
+
+    // double the batch until one sample is long enough for the clock (the first call also warms up)
+    std::size_t count = 1;
+    while (time_iterations(iteration, count) < options.min_sample_seconds && count < (std::size_t{ 1 } << 24)) count *= 2;
+    result.iterations_per_sample = count;
+
+    for (int sample = 0; sample < options.warmup_samples; ++sample) time_iterations(iteration, count);
+    for (int sample = 0; sample < std::max(options.repetitions, 1); ++sample)
+    {
+        result.samples.push_back(time_iterations(iteration, count) / static_cast<double>(count));
+    }
+
+    result.median_seconds = median(result.samples);
+    result.mad_seconds = median_absolute_deviation(result.samples, result.median_seconds);
+    result.min_seconds = *std::min_element(result.samples.begin(), result.samples.end());
+    return result;
+}
+
+bool pin_to_cpu(int cpu, int* pinned_out)
+{
+#if defined(__linux__)
+    if (cpu < 0) cpu = sched_getcpu();
+    if (cpu < 0)
+    {
+        std::cerr << "[bench] cannot tell which CPU this thread runs on; not pinning\n";
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    {
+        std::cerr << "[bench] cannot pin to CPU " << cpu << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (pinned_out) *pinned_out = cpu;
+    return true;
+#else
+    (void)cpu;
+    (void)pinned_out;
+    std::cerr << "[bench] thread pinning is only implemented on Linux\n";
+    return false;
+#endif
+}
+
+bool write_results_json(const std::string& path, const std::vector<BenchResult>& results, int pinned_cpu,
+                        const BenchOptions& options)
+{
+    JsonFileWriter json;
+    if (!json.open(path)) return false;
+
+    json.begin_object();
+    json.key("schema");
+    json.value(1);
+    json.key("context");
+    json.begin_object();
+#if defined(__clang__)
+    json.key("compiler");
+    json.value(std::string("clang ") + __clang_version__);
+#elif defined(__GNUC__)
+    json.key("compiler");
+    json.value(std::string("gcc ") + __VERSION__);
+#elif defined(_MSC_VER)
+    json.key("compiler");
+    json.value(std::string("msvc ") + std::to_string(_MSC_VER));
+#endif
+#ifdef NDEBUG
+    json.key("assertions");
+    json.value(false);
+#else
+    json.key("assertions");
+    json.value(true);
+#endif
+    json.key("simd");
+    json.value(cpu::simd_available());
+    json.key("cuda");
+    json.value(SNOWSIM_HAS_CUDA != 0);
+    json.key("hardware_threads");
+    json.value(static_cast<std::size_t>(std::thread::hardware_concurrency()));
+    json.key("pinned_cpu");
+    json.value(pinned_cpu);
+    json.key("warmup_samples");
+    json.value(options.warmup_samples);
+    json.key("repetitions");
+    json.value(options.repetitions);
+    json.end_object();
+
+    json.key("benchmarks");
+    json.begin_array();
+    for (const BenchResult& result : results)
+    {
+        json.begin_object();
+        json.key("group");
+        json.value(result.group);
+        json.key("name");
+        json.value(result.name);
+        json.key("iterations_per_sample");
+        json.value(result.iterations_per_sample);
+        json.key("median_seconds");
+        json.value(result.median_seconds);
+        json.key("mad_seconds");
+        json.value(result.mad_seconds);
+        json.key("min_seconds");
+        json.value(result.min_seconds);
+        json.key("items_per_iteration");
+        json.value(result.items_per_iteration);
+        json.key("items_per_second");
+        json.value(result.items_per_second());
+        json.key("bytes_per_iteration");
+        json.value(result.bytes_per_iteration);
+        json.key("bytes_per_second");
+        json.value(result.bytes_per_second());
+        json.key("samples");
+        json.begin_array();
+        for (const double sample : result.samples) json.value(sample);
+        json.end_array();
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+    return json.close();
+}
+
+} // namespace bench
+} // namespace snow
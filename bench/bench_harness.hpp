@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace snow
+{
+namespace bench
+{
+
+struct BenchOptions
+{
+    int warmup_samples = 2;             // timed like the others, then thrown away
+    int repetitions = 15;               // samples kept for the statistics
+    double min_sample_seconds = 2.0e-3; // iterations per sample grow until one sample takes this long
+};
+
+// One benchmark's samples (seconds per iteration) and their robust statistics.
+struct BenchResult
+{
+    std::string name;
+    std::string group;
+    double items_per_iteration = 0.0;  // cells, column cells, ... for the throughput
+    double bytes_per_iteration = 0.0;  // memory (or file) traffic per iteration; 0 if it does not apply
+    std::size_t iterations_per_sample = 1;
+    std::vector<double> samples;
+    double median_seconds = 0.0;
+    double mad_seconds = 0.0;          // median absolute deviation from the median
+    double min_seconds = 0.0;
+
+    double items_per_second() const { return median_seconds > 0.0 ? items_per_iteration / median_seconds : 0.0; }
+    double bytes_per_second() const { return median_seconds > 0.0 ? bytes_per_iteration / median_seconds : 0.0; }
+};
+
+double median(std::vector<double> values);
+double median_absolute_deviation(const std::vector<double>& values, double center);
+
+// Times iteration: calibrates the iterations per sample, runs the warm-up samples, then the repetitions.
+BenchResult run_benchmark(const std::string& group,
+                          const std::string& name,
+                          double items_per_iteration,
+                          double bytes_per_iteration,
+                          const BenchOptions& options,
+                          const std::function<void()>& iteration);
+
+// Pins the calling thread to one CPU (Linux). Threads it starts afterwards inherit the pin, so start
+// worker pools first. cpu < 0 picks the CPU the thread is running on; false (with a message) on failure.
+bool pin_to_cpu(int cpu, int* pinned_out = nullptr);
+
+// Writes results as one JSON document: a context object and one entry per benchmark.
+bool write_results_json(const std::string& path, const std::vector<BenchResult>& results, int pinned_cpu,
+                        const BenchOptions& options);
+
+} // namespace bench
+} // namespace snow
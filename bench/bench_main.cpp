@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "backend_registry.hpp"
+#include "bench_harness.hpp"
+#include "cpu_backend.hpp"
+#include "my_helper.hpp"
+#include "simulation.hpp"
+#include "types.hpp"
+
+// Microbenchmarks of the step kernels and the I/O around them; results go to a JSON file so throughput
+// can be compared across releases.
+namespace
+{
+    struct GridSize
+    {
+        const char* tier; // where the kernel's working set fits
+        std::size_t nx;
+        std::size_t ny;
+    };
+
+    // 13-21 bytes per cell: about 20 KB, 170 KB, 2.7 MB and 44 MB at the stored-speed kernel's 21.
+    const GridSize grid_sizes[] = { { "l1", 32, 32 }, { "l2", 128, 64 }, { "llc", 512, 256 }, { "dram", 2048, 1024 } };
+
+    // The default config's physics on an nx x ny grid of 10 m cells over a parabolic valley, with snow
+    // already in the air. Speeds are stored fields, as under a terrain-following wind.
+    void make_grid(std::size_t nx, std::size_t ny, snow::Params& params, snow::Fields& fields)
+    {
+        params = snow::Params{};
+        params.wind_speed = 1.7f;
+        params.settling_speed = 0.52f;
+        params.precipitation_rate = 0.1f;
+        params.ground_height = 30.0f;
+        params.settaled_snow_density = 200000.0f;
+        params.erosion_threshold_friction_velocity = 0.2f;
+        params.erosion_rate_coefficient = 120.0f;
+        params.surface_roughness_length = 0.0001f;
+        params.dx = 10.0f;
+        params.dy = 10.0f;
+        params.nx = nx;
+        params.ny = ny;
+        params.Lx = params.dx * static_cast<float>(nx);
+        params.Ly = params.dy * static_cast<float>(ny);
+        params.time_step_duration = 0.1f;
+        params.total_sim_time = 60.0f;
+        params.total_time_steps = 600;
+        params.steps_per_frame = 60;
+
+        fields = snow::Fields{};
+        fields.air_mask = snow::air_mask_parabolic(params, 0.1f * params.Ly, 0.5f * params.Ly);
+        fields.snow_density = snow::Field2D<float>(nx, ny, 0.05f);
+        fields.next_snow_density = snow::Field2D<float>::uniform(nx, ny, 0.0f);
+        fields.snow_transport_speed_x = snow::Field2D<float>(nx + 1, ny, params.wind_speed);
+        fields.snow_transport_speed_y = snow::Field2D<float>(nx, ny + 1, -params.settling_speed);
+        fields.snow_accumulation_mass = snow::Field1D<float>(nx);
+        fields.snow_accumulation_density = snow::Field1D<float>::uniform(nx, params.settaled_snow_density);
+        fields.precipitation_source = snow::Field1D<float>::uniform(nx, params.precipitation_rate);
+        fields.windborn_horizontal_source_left = snow::Field1D<float>::uniform(ny, 0.05f * params.wind_speed);
+        fields.windborn_horizontal_source_right = snow::Field1D<float>::uniform(ny, 0.0f);
+    }
+
+    double file_bytes(const std::string& path)
+    {
+        std::error_code error;
+        const std::uintmax_t size = std::filesystem::file_size(path, error);
+        return error ? 0.0 : static_cast<double>(size);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace snow;
+    using namespace snow::bench;
+
+    // usage: snow_sim_bench [--output results.json] [--filter text] [--repetitions n] [--cpu n] [--no-pin] [--quick]
+    std::string output_path = "snow_sim_bench.json";
+    std::string filter;
+    BenchOptions options;
+    int pin_cpu = -1;
+    bool pin = true;
+    bool quick = false;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const std::string option = argv[arg];
+        if (option == "--output" && arg + 1 < argc)
+        {
+            output_path = argv[++arg];
+        }
+        else if (option == "--filter" && arg + 1 < argc)
+        {
+            filter = argv[++arg];
+        }
+        else if (option == "--repetitions" && arg + 1 < argc)
+        {
+            options.repetitions = std::max(1, std::atoi(argv[++arg]));
+        }
+        else if (option == "--cpu" && arg + 1 < argc)
+        {
+            pin_cpu = std::atoi(argv[++arg]);
+        }
+        else if (option == "--no-pin")
+        {
+            pin = false;
+        }
+        else if (option == "--quick")
+        {
+            quick = true; // smoke run: fewer samples, shorter ones, no DRAM-sized grid
+        }
+        else
+        {
+            std::cerr << "[bench] unknown option " << option << "\n";
+            return 1;
+        }
+    }
+    if (quick)
+    {
+        options.warmup_samples = 1;
+        options.repetitions = std::min(options.repetitions, 3);
+        options.min_sample_seconds = 2.0e-4;
+    }
+
+    const auto selected = [&](const std::string& name) { return filter.empty() || name.find(filter) != std::string::npos; };
+    std::vector<BenchResult> results;
+    const auto report = [&](BenchResult result)
+    {
+        std::cerr << "[bench] " << result.group << "/" << result.name << ": " << result.median_seconds * 1.0e6 << " us +- "
+                  << result.mad_seconds * 1.0e6 << " (" << result.items_per_second() / 1.0e6 << " M items/s";
+        if (result.bytes_per_iteration > 0.0) std::cerr << ", " << result.bytes_per_second() / 1.0e9 << " GB/s";
+        std::cerr << ")\n";
+        results.push_back(std::move(result));
+    };
+
+    // backends (and their worker threads) first: threads started after pinning would share the one CPU
+    struct NamedBackend
+    {
+        std::string name;
+        std::unique_ptr<Simulation> sim;
+    };
+    std::vector<NamedBackend> step_backends;
+    for (const BackendInfo& backend : backends())
+    {
+        step_backends.push_back({ backend.name, backend.create(BackendOptions{}) });
+    }
+
+    int pinned_cpu = -1;
+    if (pin) pin_to_cpu(pin_cpu, &pinned_cpu);
+
+    // Simulation::step per backend and grid tier; bytes are the kernel's compulsory traffic
+    for (const GridSize& size : grid_sizes)
+    {
+        if (quick && std::string(size.tier) == "dram") continue;
+        for (NamedBackend& backend : step_backends)
+        {
+            const std::string name = backend.name + "/" + size.tier + "_" + std::to_string(size.nx) + "x" + std::to_string(size.ny);
+            if (!selected("step/" + name)) continue;
+            Params params{};
+            Fields fields;
+            make_grid(size.nx, size.ny, params, fields);
+            const double cells = static_cast<double>(size.nx * size.ny);
+            report(run_benchmark("step", name, cells, cells * cpu::kernel_bytes_per_cell(fields), options,
+                                 [&] { backend.sim->step(fields, params); }));
+        }
+    }
+
+    // boundary source column, as tall as the DRAM-tier grid
+    if (selected("snow_source/step_snow_source_1024"))
+    {
+        Field1D<float> column(1024, 0.05f);
+        report(run_benchmark("snow_source", "step_snow_source_1024", 1024.0, 2.0 * 1024.0 * sizeof(float), options,
+                             [&] { column = step_snow_source(column, 0.52f, 0.1f, 10.0f, 0.1f); }));
+    }
+
+    // terrain generators on the LLC-tier grid (bytes: the mask written)
+    {
+        Params params{};
+        Fields fields;
+        make_grid(512, 256, params, fields);
+        const double cells = static_cast<double>(params.nx * params.ny);
+        if (selected("air_mask/flat_512x256"))
+        {
+            report(run_benchmark("air_mask", "flat_512x256", cells, cells, options,
+                                 [&] { fields.air_mask = air_mask_flat(params, 0.2f * params.Ly); }));
+        }
+        if (selected("air_mask/slope_up_512x256"))
+        {
+            report(run_benchmark("air_mask", "slope_up_512x256", cells, cells, options,
+                                 [&] { fields.air_mask = air_mask_slope_up(params, 0.1f * params.Ly, 0.3f * params.Ly); }));
+        }
+        if (selected("air_mask/parabolic_512x256"))
+        {
+            report(run_benchmark("air_mask", "parabolic_512x256", cells, cells, options,
+                                 [&] { fields.air_mask = air_mask_parabolic(params, 0.1f * params.Ly, 0.5f * params.Ly); }));
+        }
+    }
+
+    // dump the LLC-tier state, then load that dump back (bytes: the file written or read)
+    {
+        Params params{};
+        Fields fields;
+        make_grid(512, 256, params, fields);
+        const double cells = static_cast<double>(params.nx * params.ny);
+        StateDumpOptions dump_options;
+        dump_options.path = (std::filesystem::temp_directory_path() / "snow_sim_bench_state.json").string();
+        if (!dump_simulation_state_to_json(params, fields, dump_options))
+        {
+            std::cerr << "[bench] cannot write " << dump_options.path << "\n";
+            return 1;
+        }
+        const double dump_bytes = file_bytes(dump_options.path);
+
+        if (selected("io/dump_512x256"))
+        {
+            report(run_benchmark("io", "dump_512x256", cells, dump_bytes, options,
+                                 [&] { dump_simulation_state_to_json(params, fields, dump_options); }));
+        }
+        if (selected("io/config_load_512x256"))
+        {
+            Params loaded_params{};
+            Fields loaded_fields;
+            report(run_benchmark("io", "config_load_512x256", cells, dump_bytes, options,
+                                 [&] { load_simulation_config(dump_options.path, loaded_params, loaded_fields); }));
+        }
+        std::error_code error;
+        std::filesystem::remove(dump_options.path, error);
+    }
+
+    if (!write_results_json(output_path, results, pinned_cpu, options))
+    {
+        std::cerr << "[bench] failed writing " << output_path << "\n";
+        return 1;
+    }
+    std::cerr << "[bench] wrote " << results.size() << " results to " << output_path << "\n";
+    return 0;
+}
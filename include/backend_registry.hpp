@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "simulation.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+// What a backend does differently, for listings and for reading calibration results.
+struct BackendCapabilities
+{
+    bool simd = false;     // vectorized kernel
+    bool threaded = false; // honours BackendOptions::threads
+    bool gpu = false;      // steps on a device
+};
+
+struct BackendOptions
+{
+    unsigned threads = 0; // threaded backends: workers per step (0 = hardware concurrency)
+};
+
+struct BackendInfo
+{
+    std::string name;
+    std::string description;
+    BackendCapabilities capabilities;
+    std::function<std::unique_ptr<Simulation>(const BackendOptions&)> create;
+};
+
+// Every selectable backend in registration order. Built in: "cpu" (scalar, one thread), "cpu-simd"
+// (SSE2 kernel, one thread; SSE2 builds only), "cpu-threaded" (row bands on BackendOptions::threads
+// workers, SSE2 kernel where available) and "cuda" (CUDA builds only).
+const std::vector<BackendInfo>& backends();
+
+// Adds a backend after the built-in ones. Fails with a warning on an empty or taken name, the reserved
+// name "auto", or a missing factory. Not thread safe: register before any lookup.
+bool register_backend(BackendInfo backend);
+
+// nullptr when no backend has that name.
+const BackendInfo* find_backend(const std::string& name);
+
+// "cuda" in CUDA builds, "cpu-threaded" otherwise.
+std::string default_backend_name();
+
+struct BackendTiming
+{
+    std::string name;
+    double seconds_per_step = 0.0;
+};
+
+// Times calibration_steps steps of every backend on a copy of fields (after one untimed warm-up step)
+// and returns the fastest one's name. timings_out, when given, gets every backend's time in
+// registration order. The caller's fields are not touched.
+std::string calibrate_backends(const Params& params,
+                               const Fields& fields,
+                               const BackendOptions& options,
+                               int calibration_steps = 8,
+                               std::vector<BackendTiming>* timings_out = nullptr);
+
+// Creates the named backend; "auto" calibrates on params/fields first. chosen_name_out gets the name of
+// the backend actually created. Returns nullptr with a "[backend] ..." message for an unknown name.
+std::unique_ptr<Simulation> make_backend(const std::string& name,
+                                         const Params& params,
+                                         const Fields& fields,
+                                         const BackendOptions& options,
+                                         std::string* chosen_name_out = nullptr);
+
+} // namespace snow
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "equilibrium_monitor.hpp"
+#include "snow_source_boundary.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+// Hash of the params a checkpoint depends on: grid, time step and physics, as loaded from the config.
+// total_sim_time and the viz settings are left out so a restarted run may be extended or re-styled.
+std::uint64_t params_hash(const Params& params);
+
+// Checkpoint file layout (native endianness):
+//   header:  char magic[8] = "SNOWCKP1", uint32 version, uint32 reserved, uint64 payload_bytes
+//   payload: step, params hash, the forcing-driven params (wind/settling/precipitation), every Fields
+//            member except next_snow_density and air_mask_dirty, each boundary source's State and the
+//            equilibrium monitor's State. A field is its size, a uniform flag and value, then its array
+//            (empty for a uniform field). Arrays are a uint64 count followed by raw elements, starting on
+//            64-byte boundaries. The file is zero-padded to a 4 KiB multiple.
+//
+// Writes one checkpoint file per call. The whole image is assembled in a reusable 4 KiB-aligned buffer
+// (plain memcpy per array) and written with a single call, opened with O_DIRECT on Linux when the
+// filesystem supports it, so the cost is the copy plus the disk. The image goes to "<path>.tmp" and is
+// renamed over path once complete, so a crash mid-write keeps the previous checkpoint.
+class CheckpointWriter
+{
+public:
+    CheckpointWriter();
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // step: completed steps; hash: params_hash of the config the run started from.
+    bool write(const std::string& path,
+               long long step,
+               std::uint64_t hash,
+               const Params& params,
+               const Fields& fields,
+               const std::vector<SnowSourceBoundary>& sources,
+               const EquilibriumMonitor& monitor);
+
+    std::size_t last_bytes() const { return last_bytes_; }       // file size of the last checkpoint
+    double last_seconds() const { return last_seconds_; }        // wall time of the last write()
+
+private:
+    struct AlignedFree
+    {
+        void operator()(unsigned char* buffer) const;
+    };
+
+    std::unique_ptr<unsigned char, AlignedFree> buffer_;
+    std::size_t capacity_ = 0;
+    std::size_t last_bytes_ = 0;
+    double last_seconds_ = 0.0;
+};
+
+// Restores a checkpoint into state built from the same config: fields are replaced, the forcing-driven
+// params and every source/monitor state are overwritten, and step_out receives the completed step count.
+// Fails (leaving a warning on stderr) when the file is damaged, the params hash differs from
+// expected_hash, or the grid / boundary sources do not match.
+bool read_checkpoint(const std::string& path,
+                     std::uint64_t expected_hash,
+                     long long& step_out,
+                     Params& params,
+                     Fields& fields,
+                     std::vector<SnowSourceBoundary>& sources,
+                     EquilibriumMonitor& monitor);
+
+} // namespace snow
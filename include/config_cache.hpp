@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "types.hpp"
+
+namespace snow
+{
+
+// Bumped whenever Params, RunConfig, Fields or the loader's defaults change shape or meaning, so entries
+// written by an older build stop matching.
+constexpr std::uint32_t config_cache_schema_version = 4;
+
+// <temp directory>/snowsim_config_cache
+std::string default_config_cache_directory();
+
+// Entry path for a config: "<cache_directory>/<16 hex digits>.snowcache", the digits a hash of the schema
+// version, the config's absolute path and its bytes. Empty when the config cannot be read.
+std::string config_cache_path(const std::string& config_path, const std::string& cache_directory);
+
+// load_simulation_config through a cache of loaded results. An entry is a field file (field_file.hpp)
+// holding every materialized Fields array plus a "cache_meta" byte array with the resolved Params, the
+// RunConfig, the content hash of every file the config referenced (field containers, DEMs) and the
+// value of each uniform field, which comes back uniform. On a hit the entry is mapped and copied out,
+// skipping the JSON parse and the air_mask generation; the surface indices are recomputed from the
+// mask. A missing, stale (schema, referenced file changed) or damaged entry is a miss: the config is
+// loaded normally and the entry (re)written through a temporary file and a rename. hit_out, when given,
+// says which path was taken. Failing to write the entry only warns.
+bool load_simulation_config_cached(const std::string& config_path,
+                                   const std::string& cache_directory,
+                                   Params& params_out,
+                                   Fields& fields_out,
+                                   RunConfig& run_out,
+                                   bool* hit_out = nullptr);
+
+} // namespace snow
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "simulation.hpp" // ensures Simulation base is defined
 
 namespace snow
@@ -7,11 +12,73 @@ namespace snow
     namespace cpu
     {
 
+        // Non-owning inputs and outputs of one advection step. Each member may view a whole Fields
+        // member, a window of a larger grid or an external buffer; the kernel only relies on the
+        // staggering (speed_x is (nx+1) x ny, speed_y is nx x (ny+1) for an nx x ny density view).
+        // Sources that are empty views contribute nothing; a speed view that is empty means every face
+        // of that direction moves at uniform_speed_x / uniform_speed_y (constant wind, no speed loads).
+        struct StepViews
+        {
+            Field2DView<const std::uint8_t> air_mask;
+            Field2DView<const float> snow_density;
+            Field2DView<float> next_snow_density;
+            Field2DView<const float> snow_transport_speed_x;
+            Field2DView<const float> snow_transport_speed_y;
+            float uniform_speed_x = 0.0f;
+            float uniform_speed_y = 0.0f;
+            Field1DView<const float> windborn_horizontal_source_left;
+            Field1DView<const float> windborn_horizontal_source_right;
+            Field1DView<const float> precipitation_source;
+            Field1DView<const float> snow_accumulation_mass; // settled mass available to erosion
+            Field1DView<float> column_deposit;               // out: net mass settled per column this step (g), nx entries
+        };
+
+        // Views of every Fields member the kernel touches. column_deposit is left for the caller. Uniform
+        // fields stay symbolic (uniform speeds, stride-0 sources) except next_snow_density, which is written.
+        StepViews make_step_views(Fields& fields);
+
+        // Memory traffic of one advect_snow pass per cell when no grid row stays in cache: snow_density
+        // read, next_snow_density written (plus its write-allocate read), air_mask, and each speed field
+        // that is not uniform. Per-column sources and deposits are left out.
+        double kernel_bytes_per_cell(const Fields& fields);
+
+        // True when this build has the SSE2 kernel; otherwise simd requests run the scalar kernel.
+        bool simd_available();
+
+        // Advects snow_density into next_snow_density for one time step and accumulates the mass
+        // exchanged with the snowpack into column_deposit. Does not swap buffers or touch the terrain.
+        // simd: interior air cells go four at a time through SSE2, with the same results as the scalar kernel.
+        void advect_snow(const StepViews& views, const Params& params, bool simd = false);
+
+        // advect_snow for rows [j_begin, j_end) only. Fluxes still read the rows just outside the band,
+        // so disjoint bands can run concurrently as long as each has its own column_deposit.
+        void advect_snow_rows(const StepViews& views, const Params& params, std::size_t j_begin, std::size_t j_end,
+                              bool simd = false);
+
         class CPUSimulation : public Simulation
         {
         public:
+            // threads: row bands advected concurrently per step (0 = hardware concurrency). Workers are
+            // started once and reused by every step; 1 runs everything on the caller's thread. Bands sum
+            // their deposits in band order, so results match the single-threaded step except for rounding
+            // in columns with more than one surface cell. simd picks the SSE2 kernel where it is available.
+            explicit CPUSimulation(unsigned threads = 1, bool simd = false);
+            ~CPUSimulation() override;
+
             void step(Fields& fields, const Params& params) override;
+            std::vector<int> step_thread_ids() const override; // the workers
+
+            unsigned threads() const { return threads_; }
+            bool simd() const { return simd_; }
+
+        private:
+            struct Workers;
+
+            unsigned threads_;
+            bool simd_;
+            std::unique_ptr<Workers> workers_;             // null when single threaded
+            std::vector<std::vector<float>> band_deposit_; // column_deposit per band, reused between steps
         };
 
     } // namespace cpu
-} // namespace snow
\ No newline at end of file
+} // namespace snow
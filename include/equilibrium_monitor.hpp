@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+
+#include "types.hpp"
+
+namespace snow
+{
+
+// Watches a run for drift equilibrium so the main loop can stop before total_time_steps.
+// Every equilibrium_sample_interval steps it compares snow_density with the previous sample and the
+// per-column deposition rate into snow_accumulation_mass with the previous window. Equilibrium is
+// reached once both the max relative density change and the max relative deposition-rate change stay
+// within equilibrium_tolerance for equilibrium_stable_samples consecutive samples.
+// Cost is one pass over the grid per sample, nothing on the other steps.
+class EquilibriumMonitor
+{
+public:
+    // Sampling history, for checkpoint/restart.
+    struct State
+    {
+        Field2D<float> density_sample;
+        Field1D<float> accumulation_sample;
+        Field1D<float> deposition_rate;
+        long long last_sample_step = -1;
+        std::size_t samples_taken = 0;
+        std::size_t stable_samples = 0;
+        long long equilibrium_step = -1;
+        float density_change = 0.0f;
+        float deposition_change = 0.0f;
+        float total_deposition_rate = 0.0f;
+    };
+
+    explicit EquilibriumMonitor(const Params& params);
+
+    // Call after every completed step; steps_done counts completed steps since the start of the run.
+    // Returns true once equilibrium has been reached (and keeps returning true).
+    bool observe(const Fields& fields, long long steps_done);
+
+    // Adds each column's last-window deposition rate times remaining_time to snow_accumulation_mass
+    // and lets the terrain follow, standing in for the steps that are skipped.
+    void extrapolate_accumulation(Fields& fields, const Params& params, float remaining_time) const;
+
+    bool enabled() const { return tolerance_ > 0.0f && sample_interval_ > 0; }
+    bool reached() const { return equilibrium_step_ >= 0; }
+    long long equilibrium_step() const { return equilibrium_step_; }
+
+    // values from the most recent sample
+    float density_change() const { return density_change_; }   // max |dc| / max |c| over the window
+    float deposition_change() const { return deposition_change_; } // max |dr| / max |r| between windows
+    float deposition_rate() const { return total_deposition_rate_; } // g/s into the whole snowpack
+
+    State state() const;
+    void restore(const State& state);
+
+private:
+    float tolerance_;
+    std::size_t sample_interval_;
+    std::size_t stable_samples_required_;
+    float time_step_duration_;
+
+    Field2D<float> density_sample_;      // snow_density at the previous sample
+    Field1D<float> accumulation_sample_; // snow_accumulation_mass at the previous sample
+    Field1D<float> deposition_rate_;     // per-column g/s over the last window
+    long long last_sample_step_ = -1;
+    std::size_t samples_taken_ = 0;
+    std::size_t stable_samples_ = 0;
+    long long equilibrium_step_ = -1;
+
+    float density_change_ = 0.0f;
+    float deposition_change_ = 0.0f;
+    float total_deposition_rate_ = 0.0f;
+};
+
+} // namespace snow
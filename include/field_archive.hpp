@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "snapshot_codec.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+struct ArchiveOptions
+{
+    std::size_t tile_nx = 64;     // cells per tile along x
+    std::size_t tile_ny = 64;     // cells per tile along y
+    std::size_t time_block = 16;  // frames per chunk
+    float error_bound = 0.0f;     // per-chunk codec bound; 0 = lossless
+};
+
+// Chunked archive of one 2D field over time (native endianness; chunk frames as in snapshot_codec.hpp):
+//   char magic[8] = "SNOWARC1"
+//   chunks:  one per (time block, tile), blocks in time order and tiles row-major within a block. A
+//            chunk is the block's frames of that tile as snapshot codec frames: a keyframe, then deltas.
+//   footer:  frame table (int64 step, double time per frame), then the chunk index (uint64 offset,
+//            uint64 bytes per chunk, in chunk order so chunk (b, tj, ti) is entry (b * tiles_y + tj) * tiles_x + ti)
+//   trailer: char magic[8] = "SNOWARCI", uint64 nx, ny, tile_nx, tile_ny, time_block, frame_count,
+//            footer_offset (64 bytes, at the very end of the file)
+// The last block may hold fewer than time_block frames, and edge tiles may be narrower than tile_nx / tile_ny.
+class ArchiveWriter
+{
+public:
+    bool open(const std::string& path, std::size_t nx, std::size_t ny, ArchiveOptions options = {});
+
+    // Adds the field after 'step' steps. A block of frames is buffered and written out as its chunks
+    // once full, so memory stays at time_block frames.
+    bool append(long long step, double time, Field2DView<const float> field);
+    bool append(long long step, double time, const Field2D<float>& field);
+
+    // Writes the partial last block and the footer.
+    bool close();
+
+    const CodecStats& stats() const { return stats_; }
+
+private:
+    bool flush_block();
+
+    std::ofstream stream_;
+    std::string path_;
+    std::size_t nx_ = 0;
+    std::size_t ny_ = 0;
+    ArchiveOptions options_;
+    std::vector<float> block_; // buffered frames of the current block, nx * ny each
+    std::size_t block_frames_ = 0;
+    std::vector<std::int64_t> steps_;
+    std::vector<double> times_;
+    std::vector<std::uint64_t> index_; // offset, bytes per chunk
+    std::uint64_t offset_ = 0;
+    std::vector<float> tile_;
+    std::vector<std::uint8_t> chunk_;
+    CodecStats stats_;
+};
+
+// Frames of a box over a time window, as returned by ArchiveReader::read.
+struct ArchiveRegion
+{
+    std::size_t x_min = 0; // grid coordinates of the region's cell (0, 0)
+    std::size_t y_min = 0;
+    std::vector<long long> steps;
+    std::vector<double> times;
+    std::vector<Field2D<float>> frames; // one per step, each the box only
+};
+
+class ArchiveReader
+{
+public:
+    // Maps the archive and validates the trailer and chunk index against the file size.
+    bool open(const std::string& path);
+    void close();
+
+    std::size_t nx() const { return nx_; }
+    std::size_t ny() const { return ny_; }
+    std::size_t frame_count() const { return frame_count_; }
+    long long frame_step(std::size_t frame) const;
+    double frame_time(std::size_t frame) const;
+
+    // Frames with t_min <= time <= t_max, cut to the cell box [x_min, x_max] x [y_min, y_max]. Bounds are
+    // reordered and clamped to the grid as in print_field_subregion. Only the chunks overlapping the window
+    // and box are decoded, so only their pages of the mapping are read.
+    bool read(double t_min, double t_max,
+              std::ptrdiff_t x_min, std::ptrdiff_t x_max,
+              std::ptrdiff_t y_min, std::ptrdiff_t y_max,
+              ArchiveRegion& region);
+
+    std::size_t last_chunks_read() const { return last_chunks_read_; }
+
+private:
+    MappedFile file_;
+    std::string path_;
+    std::size_t nx_ = 0;
+    std::size_t ny_ = 0;
+    std::size_t tile_nx_ = 0;
+    std::size_t tile_ny_ = 0;
+    std::size_t time_block_ = 0;
+    std::size_t frame_count_ = 0;
+    std::size_t tiles_x_ = 0;
+    std::size_t tiles_y_ = 0;
+    const unsigned char* frame_table_ = nullptr;
+    const unsigned char* index_ = nullptr;
+    std::size_t last_chunks_read_ = 0;
+};
+
+} // namespace snow
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+// Element type of an array stored in a field file.
+enum class FieldDType : std::uint32_t
+{
+    f32 = 1, // float (speeds, densities)
+    u8 = 2   // std::uint8_t (air_mask)
+};
+
+// Binary field container layout (native endianness, everything 64-byte aligned):
+//   header:  char magic[8] = "SNOWFLD1", uint32 version, uint32 entry_count, 48 reserved bytes
+//   entries: entry_count x 128 bytes: char name[64] (NUL padded), uint32 dtype, uint32 reserved,
+//            uint64 nx, uint64 ny, uint64 pitch (elements per row), uint64 offset (bytes from file start),
+//            24 reserved bytes
+//   arrays:  row-major, ny rows of pitch elements each; only the first nx of a row are meaningful.
+//            Rows are padded so every row starts on a 64-byte boundary.
+// A 1D field is stored as a single row (ny = 1).
+struct FieldFileEntry
+{
+    std::string name;
+    FieldDType dtype = FieldDType::f32;
+    std::size_t nx = 0;
+    std::size_t ny = 0;
+    std::size_t pitch = 0;  // elements between the starts of consecutive rows
+    std::size_t offset = 0; // byte offset of row 0 in the file
+};
+
+// One array to be written by write_field_file: ny rows of nx elements, pitch elements apart. A uniform
+// source's data is the single element every cell takes (a uniform Field1D / Field2D), written out in full.
+struct FieldFileSource
+{
+    std::string name;
+    FieldDType dtype = FieldDType::f32;
+    std::size_t nx = 0;
+    std::size_t ny = 0;
+    std::size_t pitch = 0;
+    const void* data = nullptr;
+    bool uniform = false;
+};
+
+FieldFileSource field_file_source(const std::string& name, Field2DView<const float> field);
+FieldFileSource field_file_source(const std::string& name, Field2DView<const std::uint8_t> field);
+FieldFileSource field_file_source(const std::string& name, const Field2D<float>& field);
+FieldFileSource field_file_source(const std::string& name, const Field2D<std::uint8_t>& field);
+FieldFileSource field_file_source(const std::string& name, const Field1D<float>& field);
+
+// Writes the sources into one container at path. Names must be unique and shorter than 64 bytes.
+bool write_field_file(const std::string& path, const std::vector<FieldFileSource>& sources);
+
+// Writes air_mask, snow_density, both transport speeds and the 1D fields of a Fields under their
+// Fields member names, so a config can reference the file for any of them.
+bool write_fields_file(const std::string& path, const Fields& fields);
+
+// A field container mapped read-only into memory (see MappedFile). view() hands out Field2DViews
+// straight into the mapping (pitch = the stored row pitch), so opening costs the header parse and
+// nothing per element. Views stay valid until close() or destruction.
+class MappedFieldFile
+{
+public:
+    MappedFieldFile() = default;
+    ~MappedFieldFile();
+
+    MappedFieldFile(const MappedFieldFile&) = delete;
+    MappedFieldFile& operator=(const MappedFieldFile&) = delete;
+
+    // Maps the file and validates the header and every entry against the file size.
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return base_ != nullptr; }
+    const std::vector<FieldFileEntry>& entries() const { return entries_; }
+    const FieldFileEntry* find(const std::string& name) const;
+
+    // Zero-copy view of a named array; empty when the name is unknown or the dtype does not match T.
+    template <typename T>
+    Field2DView<const T> view(const std::string& name) const;
+
+private:
+    MappedFile file_;
+    const unsigned char* base_ = nullptr;
+    std::size_t size_ = 0;
+    std::vector<FieldFileEntry> entries_;
+};
+
+// Copies a view into an owning field (rows are unpadded on the way in). The 1D overload takes row 0.
+void copy_mapped_field(const Field2DView<const float>& view, Field2D<float>& field);
+void copy_mapped_field(const Field2DView<const std::uint8_t>& view, Field2D<std::uint8_t>& field);
+void copy_mapped_field(const Field2DView<const float>& view, Field1D<float>& field);
+
+} // namespace snow
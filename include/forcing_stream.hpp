@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+namespace snow
+{
+
+// One timestamped weather record. precipitation_profile is either empty or holds one rate per column.
+struct ForcingRecord
+{
+    double time = 0.0;              // s since the start of the run
+    float precipitation_rate = 0.0f; // g/m^2/s
+    float wind_speed = 0.0f;         // m/s
+    float settling_speed = 0.0f;     // m/s
+    std::vector<float> precipitation_profile; // g/m^2/s per column (optional)
+};
+
+// Binary forcing series layout (native endianness):
+//   header: char magic[8] = "SNOWFRC1", uint32 version, uint32 profile_cells, uint64 record_count
+//   record: float64 time, float32 precipitation_rate, float32 wind_speed, float32 settling_speed,
+//           float32 precipitation_profile[profile_cells]
+// Records are sorted by time.
+bool write_forcing_binary(const std::string& path, const std::vector<ForcingRecord>& records);
+
+// Converts "time,precipitation_rate,wind_speed,settling_speed[,p_0,...,p_nx-1]" rows (optional header line)
+// into the binary layout, one line at a time so memory does not grow with the series length.
+// Writes "<binary_path>.tmp" and renames it over binary_path only once every row converted.
+bool convert_forcing_csv_to_binary(const std::string& csv_path, const std::string& binary_path);
+
+// Streams a binary forcing series. A background thread reads records ahead into a bounded queue, so
+// memory stays at prefetch_records records however long the series is. sample() interpolates linearly
+// between the two records around the requested time and only waits when the reader has fallen behind.
+class ForcingStream
+{
+public:
+    ForcingStream() = default;
+    ~ForcingStream();
+
+    ForcingStream(const ForcingStream&) = delete;
+    ForcingStream& operator=(const ForcingStream&) = delete;
+
+    // Opens a .bin series, or converts a .csv to "<path>.bin" and opens that. The conversion is reused
+    // until the CSV is modified after it. Starts the reader thread.
+    bool open(const std::string& path, std::size_t prefetch_records = 64);
+    void close();
+
+    // Forcing at time t (s). Times must not decrease between calls; before the first record and after the
+    // last one the nearest record is held. Returns false when no series is open.
+    bool sample(double t, ForcingRecord& out);
+
+    bool is_open() const { return reader_.joinable(); }
+    std::uint32_t profile_cells() const { return profile_cells_; }
+    std::uint64_t record_count() const { return record_count_; }
+    double stall_seconds() const { return stall_seconds_; } // time sample() spent waiting on the reader
+
+private:
+    void reader_loop();
+    bool next_record(ForcingRecord& out); // consumer side: pops the next record, false at the end of the series
+
+    std::ifstream file_;
+    std::uint32_t profile_cells_ = 0;
+    std::uint64_t record_count_ = 0;
+    std::size_t capacity_ = 0;
+
+    std::thread reader_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<ForcingRecord> queue_;
+    bool reader_done_ = false;
+    bool stop_ = false;
+
+    // consumer-side bracket around the current time
+    ForcingRecord before_;
+    ForcingRecord after_;
+    bool has_before_ = false;
+    bool has_after_ = false;
+    double stall_seconds_ = 0.0;
+};
+
+// Forcing sets each transport speed to one value, so it only drives speed fields that are constant
+// already (uniform, or every cell equal); false with a warning when either one varies across the grid.
+bool forcing_fits_speed_fields(const Fields& fields);
+
+// Writes a forcing sample into params and fields. Velocity fields are refilled uniformly only when the
+// value changed (check forcing_fits_speed_fields first); a warning is printed when the new speeds cross
+// the CFL limit. precipitation_source takes the profile when present, else the uniform rate, unless
+// feed_top_row is false (a top boundary column owns precipitation_source).
+void apply_forcing(const ForcingRecord& forcing, Params& params, Fields& fields, bool feed_top_row);
+
+} // namespace snow
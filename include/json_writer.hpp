@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace snow
+{
+
+// Streaming JSON writer into a buffered file. Nothing is kept but the buffer and the nesting state, so
+// writing a document costs O(buffer) memory however large its arrays are. Floats are formatted with
+// std::to_chars (shortest text that reads back to the same float); non-finite values become null as in
+// nlohmann::json. Objects are indented two spaces per level and number arrays are written on one line.
+//
+// The caller is responsible for well-formedness (key() before every value inside an object, matching
+// begin/end calls).
+class JsonFileWriter
+{
+public:
+    explicit JsonFileWriter(std::size_t buffer_bytes = 1 << 16);
+    ~JsonFileWriter();
+
+    JsonFileWriter(const JsonFileWriter&) = delete;
+    JsonFileWriter& operator=(const JsonFileWriter&) = delete;
+
+    bool open(const std::string& path);
+    // Flushes and closes; false if any write failed.
+    bool close();
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+    void key(const std::string& name);
+
+    void value(float number);
+    void value(double number);
+    void value(long long number);
+    void value(std::size_t number);
+    void value(int number) { value(static_cast<long long>(number)); }
+    void value(bool flag);
+    void value(const std::string& text);
+
+    // A whole array of numbers, one line.
+    void array(const float* values, std::size_t count);
+    void array(const std::uint8_t* values, std::size_t count);
+
+    bool ok() const { return ok_; }
+
+private:
+    void before_value();
+    void newline();
+    void put(char c);
+    void put(const char* text, std::size_t length);
+    void put_string(const std::string& text);
+    void flush();
+
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffer_;
+    std::size_t used_ = 0;
+    bool ok_ = true;
+
+    struct Scope
+    {
+        bool object;
+        bool empty;
+    };
+    std::vector<Scope> scopes_;
+    bool after_key_ = false;
+};
+
+} // namespace snow
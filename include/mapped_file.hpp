@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace snow
+{
+
+// A whole file mapped read-only into memory (mmap / MapViewOfFile). Opening costs a system call and
+// nothing per byte; pages are faulted in only as they are read. data() stays valid until close() or
+// destruction.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Fails (with a warning on stderr) when the file is missing, empty or cannot be mapped.
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return base_ != nullptr; }
+    const unsigned char* data() const { return base_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const unsigned char* base_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace snow
@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <string>
+#include <vector>
 
 #include "types.hpp"
 
@@ -11,12 +12,35 @@ namespace snow
 Field2D<uint8_t> air_mask_flat(const Params& params, float distince_from_bottom);
 Field2D<uint8_t> air_mask_slope_up(const Params& params, float distince_from_bottom, float distince_from_top);
 Field2D<uint8_t> air_mask_parabolic(const Params& params, float distince_from_bottom, float distince_from_top);
+
+// Returns, per column, the index of the lowest air cell (ny when the column is solid ground).
+// Assumes ground is contiguous from the bottom of each column (no caves).
+Field1D<std::size_t> compute_ground_surface_index(const Field2D<uint8_t>& air_mask);
+
+// Converts snow_accumulation_mass into a per-column depth and flips air_mask cells to ground (or
+// back to air) when that depth crosses a cell boundary. Only cells that change are written; each
+// one is added to fields.air_mask_dirty and ground_surface_index is moved to match.
+void update_ground_from_accumulation(Fields& fields, const Params& params);
+
+// Surface bookkeeping for a state read back from a config: air_mask already has the settled snow as
+// ground (a dump is taken mid-run), so ground_surface_index is read off the mask and
+// terrain_surface_index lies the floor(depth / dy) snow cells below it, clamped at 0. Also fills
+// snow_accumulation_depth from snow_accumulation_mass.
+void derive_surface_indices(Fields& fields, const Params& params);
+
 void print_field_subregion(const Field2D<float>& field,
                            std::ptrdiff_t x_min,
                            std::ptrdiff_t x_max,
                            std::ptrdiff_t y_min,
                            std::ptrdiff_t y_max);
 
+// Same for any view (a subregion, halo strip or mapped array); coordinates are relative to the view.
+void print_field_subregion(Field2DView<const float> field,
+                           std::ptrdiff_t x_min,
+                           std::ptrdiff_t x_max,
+                           std::ptrdiff_t y_min,
+                           std::ptrdiff_t y_max);
+
 // Advances a one-dimensional snow column by a single time step so that the
 // left-boundary source matches the settling/precipitation behaviour used by the
 // main simulation loop.
@@ -31,6 +55,27 @@ bool load_simulation_config(const std::string& config_path,
                             Params& params_out,
                             Fields& fields_out);
 
+// Same as above, and also fills run_out from the optional "run" object (defaults when absent).
+bool load_simulation_config(const std::string& config_path,
+                            Params& params_out,
+                            Fields& fields_out,
+                            RunConfig& run_out);
+
+// Where dump_simulation_state_to_json writes and which Fields members it includes.
+struct StateDumpOptions
+{
+    std::string path = "resources/configs/example1.json";
+    std::vector<std::string> fields; // Fields member names; empty = every field except next_snow_density
+};
+
+// Streams params and the selected fields as a config that load_simulation_config reads back. Values
+// go straight from the fields into a buffered file (shortest round-trip float text), so the dump
+// needs no copy of the state; uniform fields are written as { "uniform": value }. Fails on an
+// unknown field name or a write error.
+bool dump_simulation_state_to_json(const Params& params,
+                                   const Fields& fields,
+                                   const StateDumpOptions& options = {});
+
 // Writes the provided params/fields to resources/configs/example1.json for quick inspection.
 void dump_simulation_state_to_example_json(const Params& params,
                                            const Fields& fields);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "simulation.hpp"
+
+namespace snow
+{
+
+// Counter totals, already scaled up for any time the kernel multiplexed them off the PMU.
+struct PerfCounts
+{
+    bool hardware = false;           // cycles/instructions were counted
+    bool cache = false;              // last-level cache references/misses were counted
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t llc_references = 0;
+    std::uint64_t llc_misses = 0;
+    std::uint64_t task_clock_ns = 0; // CPU time of every counted thread (software counter)
+    bool multiplexed = false;        // some counter ran for only part of the time it was enabled
+};
+
+// Linux perf_event_open counters for the calling thread and the step threads passed to open(), such as
+// cpu-threaded's workers (Simulation::step_thread_ids), in user space only. Nothing is inherited, so
+// threads started later (the run loop's snapshot writer and forcing reader) are never counted. Counting
+// is off until start(), so the counters can wrap exactly the calls to be measured. Where perf events are
+// missing or not permitted, open() returns false and error() says why; hardware counters can be missing
+// while task clock still works.
+class PerfCounterGroup
+{
+public:
+    PerfCounterGroup() = default;
+    ~PerfCounterGroup();
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    // Counts the calling thread and other_threads (OS thread ids). True if at least the task clock opened
+    // on every one of them; error() still explains missing hardware counters.
+    bool open(const std::vector<int>& other_threads = {});
+    bool is_open() const { return !threads_.empty(); }
+    const std::string& error() const { return error_; }
+
+    void start();
+    void stop();
+    PerfCounts read() const; // summed over the counted threads
+
+private:
+    // one thread's counters
+    struct ThreadCounters
+    {
+        int cycles_fd = -1; // group leader of the hardware counters
+        int instructions_fd = -1;
+        int llc_references_fd = -1;
+        int llc_misses_fd = -1;
+        int task_clock_fd = -1;
+    };
+
+    bool open_thread(int thread_id);
+    void close();
+
+    std::vector<ThreadCounters> threads_;
+    std::string error_;
+};
+
+// Ratios derived from a counted run of steps over cells cells, step_seconds of wall time.
+struct PerfMetrics
+{
+    double ipc = 0.0;
+    double llc_miss_rate = 0.0;            // misses per LLC reference
+    double busy_threads = 0.0;             // task clock over wall time
+    double kernel_bytes_per_second = 0.0;  // kernel_bytes_per_cell per cell update
+    double llc_bytes_per_second = 0.0;     // one cache line per LLC miss
+    double llc_bytes_per_cell = 0.0;
+};
+
+PerfMetrics derive_perf_metrics(const PerfCounts& counts, double cell_updates, double step_seconds, double kernel_bytes_per_cell);
+
+// "[perf] ..." lines: raw counts, IPC, miss rate, busy threads, and bandwidth, both achieved at the
+// kernel's bytes per cell and measured from LLC misses.
+void print_perf_report(std::ostream& out, const PerfCounts& counts, double cell_updates, double step_seconds,
+                       double kernel_bytes_per_cell);
+
+// Wraps a backend so that counters run around each of its steps, and nothing else.
+class PerfCountedSimulation : public Simulation
+{
+public:
+    PerfCountedSimulation(std::unique_ptr<Simulation> inner, PerfCounterGroup& counters) :
+        inner_(std::move(inner)),
+        counters_(counters)
+    {}
+
+    void step(Fields& fields, const Params& params) override
+    {
+        counters_.start();
+        inner_->step(fields, params);
+        counters_.stop();
+    }
+
+    std::vector<int> step_thread_ids() const override { return inner_->step_thread_ids(); }
+
+private:
+    std::unique_ptr<Simulation> inner_;
+    PerfCounterGroup& counters_;
+};
+
+} // namespace snow
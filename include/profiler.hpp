@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <string>
+
+#include "trace.hpp"
+
+// SNOWSIM_PROFILE=1 (CMake option SNOWSIM_ENABLE_PROFILING) turns SNOW_PROFILE_SCOPE into a timer;
+// otherwise it expands to nothing and the hot path carries no instrumentation at all.
+#ifndef SNOWSIM_PROFILE
+#define SNOWSIM_PROFILE 0
+#endif
+
+namespace snow
+{
+namespace profile
+{
+
+// Timed phases. Scopes nest, so a phase's time includes the phases inside it (step holds advect, ...).
+enum class Phase : std::uint8_t
+{
+    step,             // Simulation::step as the run loop calls it
+    advect,           // advect_snow over every band: flux evaluation and the density update, fused per cell
+    advect_band,      // one row band of advect, on whichever thread ran it
+    deposit,          // band deposits summed into snow_accumulation_mass
+    swap,             // snow_density / next_snow_density swap
+    ground_update,    // update_ground_from_accumulation
+    forcing,          // forcing sample + apply_forcing
+    boundary,         // the boundary source loop in the run loop
+    snow_source,      // SnowSourceBoundary::advance (the step_snow_source column update)
+    equilibrium,      // EquilibriumMonitor::observe
+    checkpoint,       // CheckpointWriter::write
+    snapshot,         // snapshot collect + mark
+    hooks,            // before_step / output hooks (preview frame publishing, progress lines)
+    render,           // viz::render_frame on the render thread
+    present,          // viz::end_frame: buffer swap, waits for vsync
+    config_load,      // config (or config cache) load at startup
+    field_print,      // print_field_subregion debug output
+    dump,             // final state dump
+    snapshot_write,   // one snapshot serialized and written, on the snapshot writer thread
+    forcing_read,     // one forcing record read, on the forcing reader thread
+    forcing_wait,     // the run loop waiting on the forcing reader
+    count
+};
+
+const char* phase_name(Phase phase);
+
+// Durations bucketed on a log scale, four buckets per power of two (under 19% apart), so a p99 needs
+// no stored samples.
+constexpr std::size_t histogram_buckets = 256;
+
+struct PhaseCounters
+{
+    std::uint64_t calls = 0;
+    std::uint64_t total_ns = 0;
+    std::uint64_t max_ns = 0;
+    std::array<std::uint32_t, histogram_buckets> histogram{};
+};
+
+// One thread's counters. Only the owning thread writes them; there is no lock on the hot path.
+struct ThreadCounters
+{
+    std::array<PhaseCounters, static_cast<std::size_t>(Phase::count)> phases{};
+};
+
+// The calling thread's counters, registered (under a lock) the first time the thread records anything.
+ThreadCounters& thread_counters();
+
+std::size_t histogram_bucket(std::uint64_t ns);
+
+inline void record(Phase phase, std::uint64_t ns)
+{
+    PhaseCounters& counters = thread_counters().phases[static_cast<std::size_t>(phase)];
+    ++counters.calls;
+    counters.total_ns += ns;
+    if (ns > counters.max_ns) counters.max_ns = ns;
+    ++counters.histogram[histogram_bucket(ns)];
+}
+
+// Records the time from construction to destruction under phase (steady_clock), and as a trace event
+// while a trace is on (trace.hpp).
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Phase phase) :
+        phase_(phase),
+        start_(std::chrono::steady_clock::now())
+    {}
+
+    ~ScopedTimer()
+    {
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        record(phase_, ns);
+        if (tracing())
+        {
+            trace_event(phase_, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start_.time_since_epoch()).count()), ns);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Every thread's counters added up. Read it while the timed threads are idle (e.g. after the run).
+struct PhaseSummary
+{
+    std::uint64_t calls = 0;
+    double total_seconds = 0.0;
+    double mean_seconds = 0.0;
+    double p99_seconds = 0.0; // upper edge of the bucket holding the 99th percentile
+    double max_seconds = 0.0;
+};
+
+PhaseSummary summarize(Phase phase);
+
+// Zeroes every thread's counters.
+void reset();
+
+// Zeroes only the given phases, e.g. the ones a warm-up ran through, and keeps the rest.
+void reset(std::initializer_list<Phase> phases);
+
+// "[profile] ..." table of calls, total, mean, p99 and max per recorded phase, then cell updates per
+// second over the step phase for a grid of cells cells. Prints one "disabled" line in builds without
+// SNOWSIM_PROFILE.
+void print_report(std::ostream& out, std::size_t cells);
+
+} // namespace profile
+} // namespace snow
+
+#define SNOW_PROFILE_CONCAT_INNER(a, b) a##b
+#define SNOW_PROFILE_CONCAT(a, b) SNOW_PROFILE_CONCAT_INNER(a, b)
+
+#if SNOWSIM_PROFILE
+#define SNOW_PROFILE_SCOPE(phase) \
+    const ::snow::profile::ScopedTimer SNOW_PROFILE_CONCAT(snow_profile_scope_, __LINE__)(::snow::profile::Phase::phase)
+#define SNOW_PROFILE_THREAD(name) ::snow::profile::name_thread(name)
+#else
+#define SNOW_PROFILE_SCOPE(phase) static_cast<void>(0)
+#define SNOW_PROFILE_THREAD(name) static_cast<void>(0)
+#endif
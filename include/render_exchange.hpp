@@ -0,0 +1,44 @@
+#pragma once
+
+#include "triple_buffer.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+// What a preview frame draws: the params at that step and the Fields members the renderer reads
+// (snow_density, air_mask with the air_mask_dirty region to re-upload, both transport speeds).
+struct RenderFrame
+{
+    long long step = -1; // -1 until the first frame arrives
+    Params params{};
+    Fields fields;
+};
+
+// Hands simulation state from the simulation thread to the render thread through a TripleBuffer, so
+// neither waits for the other: the simulation publishes whenever it likes, the renderer draws the
+// newest frame at display rate and skips the rest.
+class RenderExchange
+{
+public:
+    // Simulation thread. Copies the rendered members into the next frame and publishes it. The frame's
+    // air_mask_dirty covers every mask change since whichever frame the renderer may still be showing,
+    // skipped frames included (a slight over-estimate at worst); fields.air_mask_dirty is cleared.
+    void publish(long long step, const Params& params, Fields& fields);
+
+    // Render thread. The newest published frame, or the one returned last time when nothing newer
+    // arrived (fresh_out says which). Stays valid and unchanged until the next call; the renderer may
+    // clear its air_mask_dirty once uploaded.
+    RenderFrame& latest(bool* fresh_out = nullptr);
+
+    long long published() const { return published_; } // simulation thread
+
+private:
+    TripleBuffer<RenderFrame> buffer_;
+    DirtyRegion previous_delta_;  // mask changes published with the previous frame
+    DirtyRegion previous_dirty_;  // the previous frame's air_mask_dirty
+    bool previous_unread_ = false; // the previous publish displaced a frame the renderer never took
+    long long published_ = 0;
+};
+
+} // namespace snow
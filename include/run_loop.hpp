@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+#include "simulation.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+// Optional caller code run inside run_simulation; empty hooks are skipped.
+struct RunHooks
+{
+    // once, after forcing, the restart and the boundary columns are set up, before the first step
+    std::function<void(const Params&, Fields&)> started;
+    // before step t; returning false ends the run there (e.g. the preview window was closed)
+    std::function<bool(long long step, const Params&, Fields&)> before_step;
+    // after every output_interval_steps-th completed step, once that step's checkpoint and snapshot are out
+    std::function<void(long long step, const Params&, const Fields&)> output;
+    long long output_interval_steps = 0; // 0 = output never runs
+};
+
+// Where a run's wall time went, filled by run_simulation.
+struct RunTimings
+{
+    long long start_step = 0;      // 0, or the step the restart checkpoint held
+    long long steps = 0;           // steps this run took
+    std::size_t cells = 0;         // nx * ny
+    double setup_seconds = 0.0;    // forcing, restart, snapshot writers
+    double step_seconds = 0.0;     // Simulation::step
+    double boundary_seconds = 0.0; // forcing samples, boundary columns, equilibrium checks
+    double output_seconds = 0.0;   // hooks, checkpoints, snapshots, the final dump
+    double total_seconds = 0.0;
+    bool stopped_early = false;    // equilibrium or before_step ended the run before total_time_steps
+};
+
+// The simulation loop shared by the headless runner and the preview app. Starts at step 0, or at the
+// step of restart_path's checkpoint when one is given, and steps to params.total_time_steps with what
+// run_config asks for: weather forcing, checkpoints, snapshots and the final state dump. Boundary
+// source columns and the equilibrium monitor are set up from params. Progress goes to std::cout as
+// "[module] ..." lines. Fails with a message when the forcing series or the restart cannot be read.
+bool run_simulation(Simulation& sim,
+                    Params& params,
+                    Fields& fields,
+                    const RunConfig& run_config,
+                    const std::string& restart_path,
+                    const RunHooks& hooks,
+                    RunTimings& timings);
+
+// "[timing] ..." lines: steps per second, cell updates per second and the split of the wall time.
+void print_run_timings(std::ostream& out, const RunTimings& timings);
+
+} // namespace snow
@@ -10,6 +10,9 @@ namespace snow
     {
     public:
         virtual void step(Fields& fields, const Params& params) = 0;
+        // OS ids of the threads a step runs on besides the caller's (a backend's workers), for per-thread
+        // tools such as PerfCounterGroup; empty when the caller's thread does all the work.
+        virtual std::vector<int> step_thread_ids() const { return {}; }
         virtual ~Simulation() = default;
     };
 
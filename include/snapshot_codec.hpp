@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "snapshot_writer.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+struct FieldCodecOptions
+{
+    float error_bound = 0.0f;            // max |decoded - original| per value; 0 = lossless
+    std::size_t keyframe_interval = 64;  // frames between self-contained keyframes (0 = only the first)
+};
+
+struct CodecStats
+{
+    std::size_t frames = 0;
+    std::size_t raw_bytes = 0;     // 4 bytes per encoded value
+    std::size_t encoded_bytes = 0; // frame headers included
+    double encode_seconds = 0.0;
+
+    double ratio() const { return encoded_bytes > 0 ? static_cast<double>(raw_bytes) / encoded_bytes : 0.0; }
+    double encode_mb_per_second() const { return encode_seconds > 0.0 ? raw_bytes / encode_seconds / 1.0e6 : 0.0; }
+};
+
+// Frame layout (little endian):
+//   header:  char magic[4] = "SNZ1", uint8 flags (1 = keyframe, 2 = quantized), uint8 reserved[3],
+//            uint32 nx, uint32 ny, float quantization step, uint32 payload_bytes
+//   payload: RLE of the byte-shuffled residuals
+//
+// Each value becomes a 32-bit residual against the same cell of the previous frame (zero for keyframes):
+// lossless frames XOR the float bits, so slowly changing cells leave only low mantissa bits set; quantized
+// frames store round(v / step) with step = 2 * error_bound and take the zigzagged integer difference, so
+// cells that moved less than the bound cost nothing. The residuals are split into four byte planes and
+// every plane is run-length coded, which collapses the mostly zero high planes.
+const std::size_t field_frame_header_bytes = 24;
+
+// Full frame size from its header, or 0 if the header is not a frame header.
+std::size_t field_frame_bytes(const std::uint8_t* header);
+
+// Grid size from a frame header, read without decoding; false if the header is not a frame header.
+bool field_frame_shape(const std::uint8_t* header, std::size_t& nx, std::size_t& ny);
+
+// Encodes successive frames of one field. Keeps the previous frame as the predictor, so one encoder
+// per field and a matching FieldDecoder reading the frames in the same order.
+class FieldEncoder
+{
+public:
+    explicit FieldEncoder(FieldCodecOptions options = {});
+
+    // Appends one frame for an nx x ny row-major grid (ny = 1 for 1D fields) to out.
+    void encode(const float* values, std::size_t nx, std::size_t ny, std::vector<std::uint8_t>& out);
+    void encode(const Field2D<float>& field, std::vector<std::uint8_t>& out);
+    void encode(const Field1D<float>& field, std::vector<std::uint8_t>& out);
+
+    const CodecStats& stats() const { return stats_; }
+
+private:
+    FieldCodecOptions options_;
+    std::vector<std::uint32_t> previous_; // float bits or quantized integers of the last frame
+    bool has_previous_ = false;
+    bool previous_quantized_ = false;
+    float previous_step_ = 0.0f;
+    std::size_t frames_since_keyframe_ = 0;
+    std::vector<std::uint32_t> next_;
+    std::vector<std::uint8_t> planes_;
+    CodecStats stats_;
+};
+
+class FieldDecoder
+{
+public:
+    // Decodes the frame in data[0, size). Fails (with a warning on stderr) on a damaged frame or a delta
+    // frame that does not follow a frame of the same shape and mode.
+    bool decode(const std::uint8_t* data, std::size_t size, Field2D<float>& field);
+    bool decode(const std::uint8_t* data, std::size_t size, Field1D<float>& field);
+
+private:
+    bool decode_values(const std::uint8_t* data, std::size_t size, std::size_t& nx, std::size_t& ny);
+
+    std::vector<std::uint32_t> previous_;
+    bool has_previous_ = false;
+    bool previous_quantized_ = false;
+    float previous_step_ = 0.0f;
+    std::vector<std::uint8_t> planes_;
+    std::vector<float> values_;
+};
+
+// Time series of compressed snapshots in one file:
+//   char magic[8] = "SNOWSNZ1", then per snapshot: int64 step, double time, and the snow_density,
+//   snow_accumulation_mass and snow_accumulation_depth frames.
+class SnapshotStreamWriter
+{
+public:
+    bool open(const std::string& path, FieldCodecOptions options = {});
+    bool write(const Snapshot& snapshot);
+    bool close();
+
+    // totals over the three fields
+    CodecStats stats() const;
+
+private:
+    std::ofstream stream_;
+    FieldEncoder density_;
+    FieldEncoder mass_;
+    FieldEncoder depth_;
+    std::vector<std::uint8_t> buffer_;
+};
+
+class SnapshotStreamReader
+{
+public:
+    bool open(const std::string& path);
+
+    // Reads the next snapshot; false at the end of the file or on damage (with a warning on stderr).
+    bool next(Snapshot& snapshot);
+
+private:
+    bool read_frame();
+
+    std::ifstream stream_;
+    std::string path_;
+    std::size_t size_ = 0; // file size, so a damaged frame length is caught before it is allocated
+    FieldDecoder density_;
+    FieldDecoder mass_;
+    FieldDecoder depth_;
+    std::vector<std::uint8_t> frame_;
+};
+
+} // namespace snow
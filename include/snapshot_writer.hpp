@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+namespace snow
+{
+
+// State of the run after 'step' completed steps, as handed to the writer thread.
+struct Snapshot
+{
+    long long step = 0;
+    double time = 0.0; // s
+    Field2D<float> snow_density;
+    Field1D<float> snow_accumulation_mass;
+    Field1D<float> snow_accumulation_depth;
+};
+
+// Background output pipeline for periodic snapshots.
+//
+// The hot loop never deep-copies the density grid. After a step, next_snow_density holds the previous
+// state untouched (the step swapped it out), so a snapshot marked after step k is collected after step
+// k+1 by swapping next_snow_density with a recycled buffer of the same size. The O(nx) column fields
+// are copied at mark time. Snapshots wait in a bounded queue for the writer thread, which serializes
+// them through the sink; when every buffer is queued or being written, collect() blocks until the disk
+// catches up and the wait is reported as stall time.
+class SnapshotWriter
+{
+public:
+    // Serializes and writes one snapshot; runs on the writer thread. Returns false on failure.
+    using Sink = std::function<bool(const Snapshot&)>;
+
+    SnapshotWriter() = default;
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // queue_depth: snapshots that may wait for the disk before the loop is held back (at least 1).
+    bool start(Sink sink, std::size_t queue_depth = 2);
+
+    // Writes out a pending snapshot (copying the density if no step followed its mark), drains the
+    // queue and joins the writer thread.
+    void finish(const Fields& fields);
+
+    // Call right after the step whose state should be written.
+    void mark(long long step, double time, const Fields& fields);
+
+    // Call right after every step: if a snapshot is marked, takes its density out of
+    // fields.next_snow_density (replacing it with a free buffer) and queues it.
+    void collect(Fields& fields);
+
+    bool is_running() const { return thread_.joinable(); }
+    bool has_pending() const { return pending_; }
+    double stall_seconds() const { return stall_seconds_; } // time collect() waited for a free buffer
+    std::size_t written() const;
+    std::size_t failed() const;
+
+private:
+    void writer_loop();
+    void enqueue(Snapshot&& snapshot);
+
+    Sink sink_;
+    std::size_t buffer_count_ = 0; // density buffers in circulation (queued, being written, or free)
+    std::size_t max_buffers_ = 0;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;
+    std::condition_variable freed_;
+    std::deque<Snapshot> queue_;
+    std::vector<Field2D<float>> free_buffers_;
+    bool stopping_ = false;
+    std::size_t written_ = 0;
+    std::size_t failed_ = 0;
+
+    // marked, waiting for the next step to free its density (hot thread only)
+    bool pending_ = false;
+    Snapshot pending_snapshot_;
+    double stall_seconds_ = 0.0;
+};
+
+// Sink that writes each snapshot as a field container "<directory>/snapshot_<step>.snowfld".
+SnapshotWriter::Sink field_file_snapshot_sink(const std::string& directory);
+
+} // namespace snow
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+
+#include "types.hpp"
+
+namespace snow
+{
+
+// Edge of the domain that a boundary source column feeds.
+enum class BoundarySide
+{
+    left,  // ghost column beyond x = 0, feeds windborn_horizontal_source_left
+    right, // ghost column beyond x = nx, feeds windborn_horizontal_source_right
+    top    // ghost column stacked above y = ny, feeds precipitation_source
+};
+
+// Advances a snow column of 'cells' cells by one time step from column_in into column_out.
+// Performs no validation: callers check dy, dt, precipitation and CFL before calling.
+// Shared by step_snow_source and SnowSourceBoundary so both evolve identically.
+void advance_snow_column(const float* column_in,
+                         float* column_out,
+                         std::size_t cells,
+                         float settling_speed,
+                         float precipitation_rate,
+                         float dy,
+                         float dt);
+
+// A one-dimensional snow column outside the domain that settles under precipitation and feeds one
+// boundary of the main grid. Inputs are validated once at construction; each advance() then steps
+// in place by ping-ponging between two owned buffers, so stepping never allocates.
+// With constant settling and precipitation the column relaxes to a steady profile; once the largest
+// per-cell change stays within snow_source_steady_tolerance (relative to the column maximum) for
+// snow_source_steady_steps consecutive steps the column freezes and advance() becomes a no-op.
+class SnowSourceBoundary
+{
+public:
+    // Everything that changes after construction, for checkpoint/restart.
+    struct State
+    {
+        float settling_speed = 0.0f;
+        float precipitation_rate = 0.0f;
+        float wind_speed = 0.0f;
+        bool cfl_clamp_reported = false;
+        std::size_t quiet_steps = 0;
+        long long steps_taken = 0;
+        long long frozen_step = -1;
+        Field1D<float> columns[2];
+        std::size_t current = 0;
+    };
+
+    // cells: column height in cells (ny for left/right so rows line up with the grid).
+    SnowSourceBoundary(BoundarySide side, const Params& params, std::size_t cells);
+
+    // Advances the column by one time step. Does nothing when construction failed validation or the
+    // column has frozen at its steady state.
+    void advance();
+
+    // Updates the weather driving the column (time-varying forcing). A change unfreezes a steady column.
+    // Settling speeds beyond the CFL limit are clamped to dy/dt instead of disabling the source.
+    void set_forcing(float settling_speed, float precipitation_rate, float wind_speed);
+
+    // Writes the inflow rate implied by the current column straight into the matching Fields source.
+    // Left/right columns only feed air cells while the wind blows into the domain; top feeds every column.
+    void apply(Fields& fields) const;
+
+    bool is_valid() const { return valid_; }
+    bool is_frozen() const { return frozen_step_ >= 0; }
+    // number of advance() calls after which the column froze, -1 while it is still evolving.
+    long long frozen_step() const { return frozen_step_; }
+    BoundarySide side() const { return side_; }
+    const Field1D<float>& column() const { return columns_[current_]; }
+
+    State state() const;
+    // Restores a state taken from a source built with the same side and cell count; false otherwise.
+    bool restore(const State& state);
+
+private:
+    BoundarySide side_;
+    float settling_speed_;
+    float precipitation_rate_;
+    float wind_speed_;
+    float dx_;
+    float dy_;
+    float dt_;
+    bool valid_ = false;
+
+    float steady_tolerance_;          // relative max change treated as "not changing" (0 disables freezing)
+    std::size_t steady_steps_;        // consecutive quiet steps required before freezing
+    bool cfl_clamp_reported_ = false;
+    std::size_t quiet_steps_ = 0;     // current run of quiet steps
+    long long steps_taken_ = 0;
+    long long frozen_step_ = -1;
+
+    Field1D<float> columns_[2]; // ping-pong buffers; columns_[current_] holds the latest state
+    std::size_t current_ = 0;
+};
+
+} // namespace snow
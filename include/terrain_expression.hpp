@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "terrain_import.hpp"
+#include "types.hpp"
+
+namespace snow
+{
+
+// Ground line of the slice as an expression of x (m from the domain's left edge), built from primitives
+// and combinators and evaluated once per column centre x_i = (i + 0.5) * dx:
+//
+//   Terrain ground = Terrain::flat(2.0f).plus(Terrain::gaussian(60.0f, 15.0f, 8.0f)).min(Terrain::flat(20.0f));
+//   Field1D<float> surface = ground.surface(params);
+//   fill_air_mask(surface, params, fields.air_mask);
+//
+// Terrains are cheap immutable handles; combining them shares the operands.
+class Terrain
+{
+public:
+    Terrain(); // flat at 0 m
+
+    static Terrain flat(float height);
+    // Straight line through (x0, height_at_x0) rising 'gradient' m per m.
+    static Terrain slope(float x0, float height_at_x0, float gradient);
+    // vertex_height + curvature * (x - vertex_x)^2
+    static Terrain parabola(float vertex_x, float vertex_height, float curvature);
+    // peak_height * exp(-(x - center_x)^2 / (2 width^2)), a hill (or, negative, a hollow) on 0 m
+    static Terrain gaussian(float center_x, float peak_height, float width);
+    // An imported transect (see terrain_import.hpp) starting x_offset m in, resampled to the columns and
+    // shifted so its lowest column is at 0 m.
+    static Terrain profile(const TerrainProfile& profile, float x_offset = 0.0f);
+
+    Terrain min(const Terrain& other) const;  // lower of the two
+    Terrain max(const Terrain& other) const;  // higher of the two
+    Terrain plus(const Terrain& other) const; // heights added, e.g. hills on a slope
+    Terrain offset(float height) const;       // raised by height
+
+    // Ground height at every column centre, unclamped (heights.size() == params.nx afterwards).
+    void evaluate(const Params& params, std::vector<float>& heights) const;
+
+    // Ground height per column clamped to [0, Ly]: the 1D surface the mask and surface index come from.
+    Field1D<float> surface(const Params& params) const;
+
+    // surface() rasterized into a new mask.
+    Field2D<uint8_t> air_mask(const Params& params) const;
+
+    struct Node;
+
+private:
+    explicit Terrain(std::shared_ptr<const Node> node);
+
+    std::shared_ptr<const Node> node_;
+};
+
+// Fills air_mask (resized to nx x ny if needed, otherwise reused) with ground (0) wherever a cell centre
+// (j + 0.5) * dy is at or below the column's surface height and air (1) elsewhere. Rows are written in
+// storage order, 16 cells per SSE2 compare where available; threads > 1 splits the rows into bands.
+void fill_air_mask(const Field1D<float>& surface, const Params& params, Field2D<uint8_t>& air_mask, unsigned threads = 1);
+
+// Lowest air cell per column for a surface (ny when the column is solid): the same values
+// compute_ground_surface_index gives for the mask fill_air_mask makes, without reading the mask.
+Field1D<std::size_t> surface_index(const Field1D<float>& surface, const Params& params);
+
+} // namespace snow
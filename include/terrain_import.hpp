@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+namespace snow
+{
+
+// How a DEM becomes the ground line of the x-y slice: one DEM row (the transect, counted from the top
+// of the file as stored) is sampled along x.
+struct TerrainImportOptions
+{
+    std::ptrdiff_t row = -1;     // transect row; -1 = the middle row
+    float x_offset = 0.0f;       // m along the transect where the domain's left edge sits
+    float cell_size = 0.0f;      // m between DEM samples; 0 = the ESRI header's cellsize (required for PGM)
+    float height_scale = 1.0f;   // PGM only: m per grey level
+    unsigned threads = 0;        // rasterization threads; 0 = std::thread::hardware_concurrency()
+};
+
+// Elevations along the transect, one per DEM sample, cell_size apart (sample k centred at (k + 0.5) * cell_size).
+struct TerrainProfile
+{
+    std::vector<float> heights; // m
+    float cell_size = 0.0f;     // m
+};
+
+// Reads the transect row of a DEM: binary or plain PGM (P5 / P2, 8 or 16 bit) or an ESRI ASCII grid,
+// told apart by the first bytes. The file is streamed: rows above the transect are skipped (seeked past
+// for binary PGM) and reading stops after it, so memory stays at one row. ESRI NODATA samples take the
+// nearest valid sample's value. Fails with a "[terrain] ..." message on a malformed file.
+bool read_dem_transect(const std::string& path, const TerrainImportOptions& options, TerrainProfile& profile);
+
+// Transect elevation per grid column: averaged over each column's footprint when dx spans several
+// samples, linearly interpolated at the column centre otherwise, and clamped to the ends.
+std::vector<float> sample_ground_profile(const TerrainProfile& profile, const Params& params, float x_offset);
+
+// sample_ground_profile shifted so the lowest column sits at params.ground_height, then clamped to
+// [0, Ly] (Terrain::profile(profile, x_offset).offset(ground_height).surface(params)).
+std::vector<float> resample_ground_profile(const TerrainProfile& profile, const Params& params, float x_offset);
+
+// air_mask with ground (0) wherever a cell centre is at or below the column's ground height, through
+// fill_air_mask with threads bands of rows (0 = hardware concurrency).
+Field2D<uint8_t> rasterize_ground_profile(const std::vector<float>& ground_height, const Params& params, unsigned threads = 0);
+
+// read_dem_transect + resample_ground_profile + rasterize_ground_profile, filled into air_mask in place.
+bool air_mask_from_dem(const std::string& path, const Params& params, const TerrainImportOptions& options, Field2D<uint8_t>& air_mask);
+
+} // namespace snow
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace snow
+{
+namespace profile
+{
+
+enum class Phase : std::uint8_t; // profiler.hpp
+
+// Timeline recorder behind the profiler's scopes. While a trace is on, every SNOW_PROFILE_SCOPE also
+// lands as one event in its thread's ring buffer. Only the owning thread writes its ring, so recording
+// takes no lock. A full ring overwrites its oldest events, so a long run keeps its most recent part.
+// stop_trace() writes everything as Chrome Trace Event JSON for chrome://tracing or Perfetto.
+struct TraceEvent
+{
+    std::uint64_t begin_ns = 0; // steady_clock, since its epoch
+    std::uint64_t duration_ns = 0;
+    Phase phase{};
+};
+
+constexpr std::size_t default_trace_events_per_thread = std::size_t{ 1 } << 18;
+
+namespace detail
+{
+    extern std::atomic<bool> tracing;
+}
+
+inline bool tracing()
+{
+    return detail::tracing.load(std::memory_order_relaxed);
+}
+
+// Starts recording into rings of events_per_thread events; the file is written by stop_trace().
+// False if a trace is already on or events_per_thread is 0.
+bool start_trace(const std::string& path, std::size_t events_per_thread = default_trace_events_per_thread);
+
+// Appends one event to the calling thread's ring; the ring is registered (under a lock) on first use.
+void trace_event(Phase phase, std::uint64_t begin_ns, std::uint64_t duration_ns);
+
+// Names the calling thread in the trace ("simulation", "cpu worker 2", ...).
+void name_thread(const std::string& name);
+
+// Ends the trace and writes it. Call it once the traced threads are idle (after the run). Prints a
+// "[trace] ..." line with the event and drop counts; false if no trace was on or the write failed.
+bool stop_trace();
+
+// Writes the trace, if one is on, when it goes out of scope, so that every way out of main (early
+// error returns included) leaves a file behind. stop() does it early and reports whether it worked.
+class TraceGuard
+{
+public:
+    TraceGuard() = default;
+    ~TraceGuard() { stop(); }
+
+    TraceGuard(const TraceGuard&) = delete;
+    TraceGuard& operator=(const TraceGuard&) = delete;
+
+    // True if no trace was on or it was written.
+    bool stop() { return !tracing() || stop_trace(); }
+};
+
+} // namespace profile
+} // namespace snow
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace snow
+{
+
+// Single-producer / single-consumer exchange of the latest value without locks or waiting. The producer
+// fills back() and publish()es it; the consumer calls update() and reads front(). Three slots mean
+// neither side ever touches the slot the other is using: publish swaps back with the shared middle
+// slot, update swaps front with it when it holds something newer. Frames the consumer is too slow for
+// are overwritten, never queued.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // producer side: the slot to fill next
+    T& back() { return slots_[back_]; }
+
+    // Hands back() to the consumer. Returns true when the value it displaces was never read; back()
+    // then holds that unread value, for producers that need to carry something over from it.
+    bool publish()
+    {
+        const unsigned previous = middle_.exchange(back_ | fresh_bit, std::memory_order_acq_rel);
+        back_ = previous & index_mask;
+        return (previous & fresh_bit) != 0;
+    }
+
+    // Consumer side: moves the newest published value to front(). False (front() unchanged) when
+    // nothing was published since the last update.
+    bool update()
+    {
+        if ((middle_.load(std::memory_order_acquire) & fresh_bit) == 0) return false;
+        const unsigned previous = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & index_mask;
+        return true;
+    }
+
+    // consumer side: the value from the last successful update (a default T before the first)
+    T& front() { return slots_[front_]; }
+
+private:
+    static constexpr unsigned index_mask = 3u;
+    static constexpr unsigned fresh_bit = 4u;
+
+    std::array<T, 3> slots_{};
+    unsigned back_ = 0;              // producer only
+    unsigned front_ = 1;             // consumer only
+    std::atomic<unsigned> middle_{ 2 }; // shared slot index plus fresh_bit when it holds an unread value
+};
+
+} // namespace snow
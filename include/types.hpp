@@ -1,8 +1,12 @@
 // Basic types used across the simulation
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include <initializer_list>
 #include <glm/glm/glm.hpp>
@@ -18,6 +22,11 @@ namespace snow
         float ground_height;        // m above y=0
         float settaled_snow_density; // g/m^2
 
+        // saltation / wind erosion of the snowpack (erosion is off when the coefficient is 0)
+        float erosion_threshold_friction_velocity; // m/s, friction velocity needed to lift settled snow
+        float erosion_rate_coefficient;            // g*s^2/m^4, scales u* * (u*^2 - u*t^2) into a mass flux
+        float surface_roughness_length;            // m, snow surface roughness for the log wind profile
+
         float Lx; // physical width in meters (x direction)
         float Ly; // physical height in meters (y direction)        
         float dx; // cell size in x (meters/cell)
@@ -29,6 +38,16 @@ namespace snow
         float total_sim_time;     // in sec
         float time_step_duration; // in sec
 
+        std::size_t top_inflow_cells; // cells in the source column above the domain (0 = precipitation_rate feeds the top row directly)
+        float snow_source_steady_tolerance;   // relative per-step change below which a boundary column counts as steady (0 = never freeze)
+        std::size_t snow_source_steady_steps; // consecutive steady steps before a boundary column freezes
+
+        // whole-domain equilibrium monitor (off when the tolerance is 0)
+        float equilibrium_tolerance;             // max relative change of density / deposition rate treated as stationary
+        std::size_t equilibrium_sample_interval; // steps between samples
+        std::size_t equilibrium_stable_samples;  // consecutive stationary samples before the run ends
+        bool equilibrium_extrapolate;            // on equilibrium, extend accumulation linearly to total_sim_time
+
         int total_time_steps; // number of steps
 
         int steps_per_frame;
@@ -47,6 +66,142 @@ namespace snow
         float arrow_min_length;    // minimum arrow length as percentage of cell width in viz
     };
 
+    // Host-side run configuration (file paths, streaming options) read from the optional "run" object of a
+    // config. Kept out of Params so Params stays trivially copyable for device kernels.
+    struct RunConfig
+    {
+        std::string forcing_path;                  // weather forcing series (.bin, or .csv converted once); empty = constant params
+        std::size_t forcing_prefetch_records = 64; // records the forcing reader thread keeps ahead of the simulation
+        std::string checkpoint_path;               // checkpoint file, rewritten in place; empty = no checkpoints
+        std::size_t checkpoint_interval_steps = 0; // steps between checkpoints (0 = off)
+        std::string snapshot_directory;            // periodic snapshot output directory; empty = no snapshots
+        std::size_t snapshot_interval_steps = 0;   // steps between snapshots (0 = off)
+        std::size_t snapshot_queue_depth = 2;      // snapshots that may wait for the disk before the loop stalls
+        std::string snapshot_format = "fields";    // "fields": one field file per snapshot, "compressed": one delta-coded series,
+                                                   // "archive": density chunked by (time block, tile) for region queries
+        float snapshot_error_bound = 0.0f;         // compressed / archive: max absolute error per value (0 = lossless)
+        std::size_t snapshot_tile = 64;            // archive: tile edge in cells
+        std::size_t snapshot_time_block = 16;      // archive: snapshots per chunk
+        std::string dump_path;                     // final state written as a loadable config; empty = no dump
+        std::vector<std::string> dump_fields;      // Fields members in the dump; empty = all but next_snow_density
+        std::vector<std::string> input_files;      // set by the loader: absolute paths of the field files / DEM the config read
+        std::string backend;                       // params.backend: registered backend name or "auto"; empty = the runner's default
+    };
+
+    // Field1DView: non-owning window onto nx elements spaced 'stride' apart (stride 1 for a Field1D,
+    // the row pitch for a column of a 2D grid). T may be const for a read-only view.
+    template <typename T>
+    struct Field1DView
+    {
+        T* data{};
+        std::size_t nx{};
+        std::size_t stride{1};
+
+        Field1DView() = default;
+
+        Field1DView(T* data_, std::size_t nx_, std::size_t stride_ = 1) :
+            data(data_),
+            nx(nx_),
+            stride(stride_)
+        {}
+
+        // a mutable view converts to a read-only one
+        template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+        Field1DView(const Field1DView<U>& other) :
+            data(other.data),
+            nx(other.nx),
+            stride(other.stride)
+        {}
+
+        inline T& operator()(std::size_t i) const
+        {
+            return data[i * stride];
+        }
+
+        inline bool in_bounds(std::size_t i) const
+        {
+            return i < nx;
+        }
+
+        inline bool empty() const
+        {
+            return data == nullptr || nx == 0;
+        }
+    };
+
+    // Field2DView: non-owning row-major window onto a 2D grid, same (i, j) convention as Field2D.
+    // Element (i, j) lives at data[j * pitch + i]; data points at the view's own (0, 0) and pitch is the
+    // element distance between consecutive rows of the underlying buffer. A view of a whole Field2D has
+    // pitch == nx; subview() offsets data and keeps the parent pitch, so subregions, halo strips and
+    // external buffers (e.g. a mapped field file) are addressed without copying.
+    template <typename T>
+    struct Field2DView
+    {
+        T* data{};
+        std::size_t nx{};
+        std::size_t ny{};
+        std::size_t pitch{};
+
+        Field2DView() = default;
+
+        Field2DView(T* data_, std::size_t nx_, std::size_t ny_, std::size_t pitch_) :
+            data(data_),
+            nx(nx_),
+            ny(ny_),
+            pitch(pitch_)
+        {}
+
+        // a mutable view converts to a read-only one
+        template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+        Field2DView(const Field2DView<U>& other) :
+            data(other.data),
+            nx(other.nx),
+            ny(other.ny),
+            pitch(other.pitch)
+        {}
+
+        inline std::size_t idx(std::size_t i, std::size_t j) const
+        {
+            return j * pitch + i;
+        }
+
+        inline T& operator()(std::size_t i, std::size_t j) const
+        {
+            return data[idx(i, j)];
+        }
+
+        inline T* row(std::size_t j) const
+        {
+            return data + j * pitch;
+        }
+
+        inline bool in_bounds(std::size_t i, std::size_t j) const
+        {
+            return i < nx && j < ny;
+        }
+
+        inline bool empty() const
+        {
+            return data == nullptr || nx == 0 || ny == 0;
+        }
+
+        // Window of x_count x y_count cells starting at (x_offset, y_offset). Precondition: it fits in this view.
+        inline Field2DView subview(std::size_t x_offset, std::size_t y_offset, std::size_t x_count, std::size_t y_count) const
+        {
+            return Field2DView(data + idx(x_offset, y_offset), x_count, y_count, pitch);
+        }
+
+        inline Field1DView<T> row_view(std::size_t j) const
+        {
+            return Field1DView<T>(row(j), nx, 1);
+        }
+
+        inline Field1DView<T> column_view(std::size_t i) const
+        {
+            return Field1DView<T>(data + i, ny, pitch);
+        }
+    };
+
     template <typename T>
     struct Field1D
     {
@@ -74,6 +229,44 @@ namespace snow
             data(values)
         {}
 
+        // Uniform (symbolic) field: every element reads as *uniform_value while data stays empty, so a
+        // constant field costs no memory until something writes single elements. Element access through
+        // operator() and data requires a materialized field; value() reads either form.
+        std::optional<T> uniform_value;
+
+        static Field1D uniform(std::size_t nx_, const T& value)
+        {
+            Field1D field;
+            field.nx = nx_;
+            field.uniform_value = value;
+            return field;
+        }
+
+        inline bool is_uniform() const
+        {
+            return uniform_value.has_value();
+        }
+
+        // Writes the uniform value out into data; no-op for a materialized field.
+        inline void materialize()
+        {
+            if (!uniform_value) return;
+            data.assign(nx, *uniform_value);
+            uniform_value.reset();
+        }
+
+        inline T value(std::size_t i) const
+        {
+            return uniform_value ? *uniform_value : data[i];
+        }
+
+        // Sets every element: a uniform field only takes the new value, a materialized one is overwritten.
+        inline void fill(const T& value)
+        {
+            if (uniform_value) uniform_value = value;
+            else std::fill(data.begin(), data.end(), value);
+        }
+
         // Element access (mutable)
         inline T& operator()(std::size_t i)
         {
@@ -86,11 +279,12 @@ namespace snow
             return data[i];
         }
 
-        // Resize the field to nx_ and fill all entries with 'init'.
+        // Resize the field to nx_ and fill all entries with 'init' (materialized).
         inline void resize(std::size_t nx_, const T& init = T{})
         {
             nx = nx_;
             data.assign(nx, init);
+            uniform_value.reset();
         }
 
         // helper to check if i is inbounds
@@ -98,6 +292,20 @@ namespace snow
         {
             return i < nx;
         }
+
+        // Non-owning views of the whole field; invalidated by resize() and materialize(). A mutable view
+        // materializes a uniform field first; a read-only view of one has stride 0 onto the value.
+        inline Field1DView<T> view()
+        {
+            materialize();
+            return Field1DView<T>(data.data(), nx, 1);
+        }
+
+        inline Field1DView<const T> view() const
+        {
+            if (uniform_value) return Field1DView<const T>(&*uniform_value, nx, 0);
+            return Field1DView<const T>(data.data(), nx, 1);
+        }
     };
 
     // Field2D: simple 2D array wrapper with flat (row-major) storage.
@@ -124,6 +332,41 @@ namespace snow
             data(nx_ * ny_, uniform_field_value) 
         {}
 
+        // Uniform (symbolic) field, as for Field1D: every cell reads as *uniform_value, data stays empty.
+        std::optional<T> uniform_value;
+
+        static Field2D uniform(std::size_t nx_, std::size_t ny_, const T& value)
+        {
+            Field2D field;
+            field.nx = nx_;
+            field.ny = ny_;
+            field.uniform_value = value;
+            return field;
+        }
+
+        inline bool is_uniform() const
+        {
+            return uniform_value.has_value();
+        }
+
+        inline void materialize()
+        {
+            if (!uniform_value) return;
+            data.assign(nx * ny, *uniform_value);
+            uniform_value.reset();
+        }
+
+        inline T value(std::size_t i, std::size_t j) const
+        {
+            return uniform_value ? *uniform_value : data[idx(i, j)];
+        }
+
+        inline void fill(const T& value)
+        {
+            if (uniform_value) uniform_value = value;
+            else std::fill(data.begin(), data.end(), value);
+        }
+
         // Convert (i, j) to flat index into 'data'.
         // Precondition: 0 <= i < nx and 0 <= j < ny.
         inline std::size_t idx(std::size_t i, std::size_t j) const
@@ -143,12 +386,13 @@ namespace snow
             return data[idx(i, j)];
         }
 
-        // Resize the field to nx_*ny_ and fill all entries with 'init'.
+        // Resize the field to nx_*ny_ and fill all entries with 'init' (materialized).
         inline void resize(std::size_t nx_, std::size_t ny_, const T& init = T{})
         {
             nx = nx_;
             ny = ny_;
             data.assign(nx * ny, init);
+            uniform_value.reset();
         }
 
         // Bounds check helper for debug/asserts or conditional access.
@@ -156,6 +400,67 @@ namespace snow
         {
             return i < nx && j < ny;
         }
+
+        // Non-owning views of the whole field (pitch = nx); invalidated by resize() and materialize(). A
+        // mutable view materializes a uniform field first; a read-only view of one is empty, so readers
+        // that may meet a uniform field check is_uniform() (see cpu::make_step_views).
+        inline Field2DView<T> view()
+        {
+            materialize();
+            return Field2DView<T>(data.data(), nx, ny, nx);
+        }
+
+        inline Field2DView<const T> view() const
+        {
+            if (uniform_value) return Field2DView<const T>();
+            return Field2DView<const T>(data.data(), nx, ny, nx);
+        }
+    };
+
+    // DirtyRegion: inclusive cell rectangle touched since the last consumer reset.
+    // Producers (e.g. the terrain update) grow it with include(); consumers (e.g. the viz mask upload)
+    // read the bounds, upload just that rectangle and call clear().
+    struct DirtyRegion
+    {
+        std::size_t x_min{};
+        std::size_t x_max{};
+        std::size_t y_min{};
+        std::size_t y_max{};
+        bool dirty{false};
+
+        // Grow the rectangle so it covers cell (i, j).
+        inline void include(std::size_t i, std::size_t j)
+        {
+            if (!dirty)
+            {
+                x_min = x_max = i;
+                y_min = y_max = j;
+                dirty = true;
+                return;
+            }
+            if (i < x_min) x_min = i;
+            if (i > x_max) x_max = i;
+            if (j < y_min) y_min = j;
+            if (j > y_max) y_max = j;
+        }
+
+        // Grow the rectangle so it covers another region too.
+        inline void include(const DirtyRegion& other)
+        {
+            if (other.empty()) return;
+            include(other.x_min, other.y_min);
+            include(other.x_max, other.y_max);
+        }
+
+        inline void clear()
+        {
+            dirty = false;
+        }
+
+        inline bool empty() const
+        {
+            return !dirty;
+        }
     };
 
     // TODO: Revisit decision to make sim 2d. unit withs might make conversions easier and logic more clear. 
@@ -163,6 +468,8 @@ namespace snow
     //wind speeds are shifted left and down respectivly such that the edges suroudning snow_density(x,y)
     //will be at wind_speed_x(x,y) [left],wind_speed_x(x+1,y) [right],wind_speed_y(x,y) [bottom], wind_speed_y(x,y+1) [top].
     //wind is positive when blowing to the right and up.
+    //the loader leaves members the config does not set as uniform fields (Field2D::uniform) where a constant
+    //is the default: next_snow_density, both speeds, snow_accumulation_density and the three sources.
     struct Fields
     {
         Field2D<std::uint8_t> air_mask;     // 1 = air, 0 = land
@@ -172,6 +479,10 @@ namespace snow
         Field2D<float> snow_transport_speed_y;        // wind y-component                      m/s
         Field1D<float> snow_accumulation_mass;   // accumulated snow mass on ground       g
         Field1D<float> snow_accumulation_density;   // on ground                     g/m^2
+        Field1D<float> snow_accumulation_depth;     // settled snow depth on ground          m
+        Field1D<std::size_t> terrain_surface_index; // lowest air cell above bare terrain, per column (ny = solid)
+        Field1D<std::size_t> ground_surface_index;  // lowest air cell above terrain + settled snow, per column
+        DirtyRegion air_mask_dirty;                 // air_mask cells flipped since the viz last uploaded the mask
         Field1D<float> precipitation_source;  // rate of precipitation                 g/m^2/s
         Field1D<float> windborn_horizontal_source_left;// rate at which snow flows in from x=0  g/m^2/s
         Field1D<float> windborn_horizontal_source_right;// rate at which snow flows in from x=nx  g/m^2/s
@@ -0,0 +1,150 @@
+#include "backend_registry.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+#include "cpu_backend.hpp"
+#include "cuda_backend.hpp"
+#include "profiler.hpp"
+
+namespace snow
+{
+
+namespace
+{
+    std::vector<BackendInfo> built_in_backends()
+    {
+        std::vector<BackendInfo> list;
+        list.push_back({ "cpu", "scalar kernel on the calling thread", BackendCapabilities{},
+                         [](const BackendOptions&) { return std::make_unique<cpu::CPUSimulation>(1, false); } });
+        if (cpu::simd_available())
+        {
+            BackendCapabilities simd;
+            simd.simd = true;
+            list.push_back({ "cpu-simd", "SSE2 kernel on the calling thread", simd,
+                             [](const BackendOptions&) { return std::make_unique<cpu::CPUSimulation>(1, true); } });
+        }
+        BackendCapabilities threaded;
+        threaded.simd = cpu::simd_available();
+        threaded.threaded = true;
+        list.push_back({ "cpu-threaded", threaded.simd ? "SSE2 kernel on row bands across worker threads" : "scalar kernel on row bands across worker threads",
+                         threaded,
+                         [](const BackendOptions& options) { return std::make_unique<cpu::CPUSimulation>(options.threads, true); } });
+#if SNOWSIM_HAS_CUDA
+        BackendCapabilities gpu;
+        gpu.gpu = true;
+        list.push_back({ "cuda", "CUDA kernel on the default device", gpu,
+                         [](const BackendOptions&) { return std::make_unique<cuda::CUDASimulation>(); } });
+#endif
+        return list;
+    }
+
+    std::vector<BackendInfo>& registry()
+    {
+        static std::vector<BackendInfo> list = built_in_backends();
+        return list;
+    }
+}
+
+const std::vector<BackendInfo>& backends()
+{
+    return registry();
+}
+
+bool register_backend(BackendInfo backend)
+{
+    if (backend.name.empty() || backend.name == "auto" || !backend.create)
+    {
+        std::cerr << "Warning: backend \"" << backend.name << "\" needs a name other than \"auto\" and a factory\n";
+        return false;
+    }
+    if (find_backend(backend.name))
+    {
+        std::cerr << "Warning: backend \"" << backend.name << "\" is already registered\n";
+        return false;
+    }
+    registry().push_back(std::move(backend));
+    return true;
+}
+
+const BackendInfo* find_backend(const std::string& name)
+{
+    for (const BackendInfo& backend : registry())
+    {
+        if (backend.name == name) return &backend;
+    }
+    return nullptr;
+}
+
+std::string default_backend_name()
+{
+    return SNOWSIM_HAS_CUDA ? "cuda" : "cpu-threaded";
+}
+
+std::string calibrate_backends(const Params& params,
+                               const Fields& fields,
+                               const BackendOptions& options,
+                               int calibration_steps,
+                               std::vector<BackendTiming>* timings_out)
+{
+    calibration_steps = std::max(calibration_steps, 1);
+    std::string fastest;
+    double fastest_seconds = 0.0;
+    if (timings_out) timings_out->clear();
+    for (const BackendInfo& backend : registry())
+    {
+        std::unique_ptr<Simulation> sim = backend.create(options);
+        Fields scratch = fields;
+        sim->step(scratch, params); // warm-up: first-step allocations, worker start, device upload
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < calibration_steps; ++step) sim->step(scratch, params);
+        const double seconds_per_step = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / calibration_steps;
+
+        if (timings_out) timings_out->push_back({ backend.name, seconds_per_step });
+        if (fastest.empty() || seconds_per_step < fastest_seconds)
+        {
+            fastest = backend.name;
+            fastest_seconds = seconds_per_step;
+        }
+    }
+    return fastest;
+}
+
+std::unique_ptr<Simulation> make_backend(const std::string& name,
+                                         const Params& params,
+                                         const Fields& fields,
+                                         const BackendOptions& options,
+                                         std::string* chosen_name_out)
+{
+    std::string chosen = name;
+    if (name == "auto")
+    {
+        std::vector<BackendTiming> timings;
+        chosen = calibrate_backends(params, fields, options, 8, &timings);
+        std::cout << "[backend] auto calibration on " << params.nx << "x" << params.ny << ":";
+        for (const BackendTiming& timing : timings)
+        {
+            std::cout << " " << timing.name << " " << timing.seconds_per_step * 1.0e3 << " ms/step";
+        }
+        std::cout << ", picked " << chosen << "\n";
+        // the calibration steps are not part of the run; phases timed before it (config_load) are
+        profile::reset({ profile::Phase::step, profile::Phase::advect, profile::Phase::advect_band, profile::Phase::deposit,
+                         profile::Phase::swap, profile::Phase::ground_update });
+    }
+
+    const BackendInfo* backend = find_backend(chosen);
+    if (!backend)
+    {
+        std::cerr << "[backend] unknown backend \"" << name << "\", available:";
+        for (const BackendInfo& known : registry()) std::cerr << " " << known.name;
+        std::cerr << " auto\n";
+        return nullptr;
+    }
+    if (chosen_name_out) *chosen_name_out = chosen;
+    return backend->create(options);
+}
+
+} // namespace snow
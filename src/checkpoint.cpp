@@ -0,0 +1,519 @@
+#include "checkpoint.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <type_traits>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace snow
+{
+
+namespace
+{
+    const char checkpoint_magic[8] = { 'S', 'N', 'O', 'W', 'C', 'K', 'P', '1' };
+    const std::uint32_t checkpoint_version = 2;
+    const std::size_t checkpoint_block = 4096; // O_DIRECT buffer/offset/length alignment
+    const std::size_t checkpoint_array_alignment = 64;
+    const std::size_t checkpoint_max_sources = 16;
+
+    struct CheckpointHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+        std::uint64_t payload_bytes;
+    };
+
+    std::size_t round_up(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Everything in the payload, gathered so one visit function describes the layout for sizing,
+    // writing and reading alike.
+    struct CheckpointBody
+    {
+        std::uint64_t step = 0;
+        std::uint64_t params_hash = 0;
+        float wind_speed = 0.0f;
+        float settling_speed = 0.0f;
+        float precipitation_rate = 0.0f;
+        Fields* fields = nullptr;
+        std::vector<std::uint32_t> source_sides;
+        std::vector<SnowSourceBoundary::State> sources;
+        EquilibriumMonitor::State monitor;
+    };
+
+    // Counts payload bytes.
+    class SizeArchive
+    {
+    public:
+        static constexpr bool reading = false;
+
+        template <typename T>
+        void value(T&) { offset_ += sizeof(stored_t<T>); }
+
+        template <typename T>
+        void array(std::vector<T>& values)
+        {
+            offset_ += sizeof(std::uint64_t);
+            offset_ = round_up(offset_, checkpoint_array_alignment) + values.size() * sizeof(T);
+        }
+
+        bool ok() const { return true; }
+        std::size_t size() const { return offset_; }
+
+        // size_t and bool are stored as fixed-width integers
+        template <typename T>
+        using stored_t = std::conditional_t<std::is_same<T, std::size_t>::value, std::uint64_t,
+                         std::conditional_t<std::is_same<T, bool>::value, std::uint8_t, T>>;
+
+    private:
+        std::size_t offset_ = 0;
+    };
+
+    // Copies the payload into a buffer sized by SizeArchive.
+    class WriteArchive
+    {
+    public:
+        static constexpr bool reading = false;
+
+        explicit WriteArchive(unsigned char* buffer) : buffer_(buffer) {}
+
+        template <typename T>
+        void value(T& value)
+        {
+            const SizeArchive::stored_t<T> stored = static_cast<SizeArchive::stored_t<T>>(value);
+            std::memcpy(buffer_ + offset_, &stored, sizeof(stored));
+            offset_ += sizeof(stored);
+        }
+
+        template <typename T>
+        void array(std::vector<T>& values)
+        {
+            std::size_t count = values.size();
+            value(count);
+            offset_ = round_up(offset_, checkpoint_array_alignment);
+            if (!values.empty()) std::memcpy(buffer_ + offset_, values.data(), values.size() * sizeof(T));
+            offset_ += values.size() * sizeof(T);
+        }
+
+        bool ok() const { return true; }
+
+    private:
+        unsigned char* buffer_;
+        std::size_t offset_ = 0;
+    };
+
+    // Reads the payload back, failing instead of running past its end.
+    class ReadArchive
+    {
+    public:
+        static constexpr bool reading = true;
+
+        ReadArchive(const unsigned char* buffer, std::size_t size) : buffer_(buffer), size_(size) {}
+
+        template <typename T>
+        void value(T& value)
+        {
+            SizeArchive::stored_t<T> stored{};
+            if (!take(&stored, sizeof(stored))) return;
+            value = static_cast<T>(stored);
+        }
+
+        template <typename T>
+        void array(std::vector<T>& values)
+        {
+            std::size_t count = 0;
+            value(count);
+            offset_ = round_up(offset_, checkpoint_array_alignment);
+            if (!ok_ || offset_ > size_ || count > (size_ - offset_) / sizeof(T))
+            {
+                ok_ = false;
+                return;
+            }
+            values.resize(count);
+            take(values.data(), count * sizeof(T));
+        }
+
+        bool ok() const { return ok_; }
+
+    private:
+        bool take(void* out, std::size_t bytes)
+        {
+            if (!ok_ || offset_ > size_ || bytes > size_ - offset_)
+            {
+                ok_ = false;
+                return false;
+            }
+            if (bytes > 0) std::memcpy(out, buffer_ + offset_, bytes);
+            offset_ += bytes;
+            return true;
+        }
+
+        const unsigned char* buffer_;
+        std::size_t size_;
+        std::size_t offset_ = 0;
+        bool ok_ = true;
+    };
+
+    // uniform flag and value, then data (empty for a uniform field)
+    template <typename Archive, typename Field>
+    void visit_uniform(Archive& archive, Field& field)
+    {
+        bool uniform = field.is_uniform();
+        auto value = field.uniform_value.value_or(typename decltype(field.data)::value_type{});
+        archive.value(uniform);
+        archive.value(value);
+        if (Archive::reading)
+        {
+            if (uniform) field.uniform_value = value;
+            else field.uniform_value.reset();
+        }
+    }
+
+    template <typename Archive, typename T>
+    void visit_field(Archive& archive, Field2D<T>& field)
+    {
+        archive.value(field.nx);
+        archive.value(field.ny);
+        visit_uniform(archive, field);
+        archive.array(field.data);
+    }
+
+    template <typename Archive, typename T>
+    void visit_field(Archive& archive, Field1D<T>& field)
+    {
+        archive.value(field.nx);
+        visit_uniform(archive, field);
+        archive.array(field.data);
+    }
+
+    template <typename Archive>
+    void visit_checkpoint(Archive& archive, CheckpointBody& body)
+    {
+        archive.value(body.step);
+        archive.value(body.params_hash);
+        archive.value(body.wind_speed);
+        archive.value(body.settling_speed);
+        archive.value(body.precipitation_rate);
+
+        Fields& fields = *body.fields;
+        visit_field(archive, fields.air_mask);
+        visit_field(archive, fields.snow_density);
+        visit_field(archive, fields.snow_transport_speed_x);
+        visit_field(archive, fields.snow_transport_speed_y);
+        visit_field(archive, fields.snow_accumulation_mass);
+        visit_field(archive, fields.snow_accumulation_density);
+        visit_field(archive, fields.snow_accumulation_depth);
+        visit_field(archive, fields.terrain_surface_index);
+        visit_field(archive, fields.ground_surface_index);
+        visit_field(archive, fields.precipitation_source);
+        visit_field(archive, fields.windborn_horizontal_source_left);
+        visit_field(archive, fields.windborn_horizontal_source_right);
+
+        std::size_t source_count = body.sources.size();
+        archive.value(source_count);
+        if (Archive::reading)
+        {
+            if (!archive.ok() || source_count > checkpoint_max_sources) return;
+            body.source_sides.resize(source_count);
+            body.sources.resize(source_count);
+        }
+        for (std::size_t k = 0; k < source_count; ++k)
+        {
+            SnowSourceBoundary::State& source = body.sources[k];
+            archive.value(body.source_sides[k]);
+            archive.value(source.settling_speed);
+            archive.value(source.precipitation_rate);
+            archive.value(source.wind_speed);
+            archive.value(source.cfl_clamp_reported);
+            archive.value(source.quiet_steps);
+            archive.value(source.steps_taken);
+            archive.value(source.frozen_step);
+            archive.value(source.current);
+            visit_field(archive, source.columns[0]);
+            visit_field(archive, source.columns[1]);
+        }
+
+        EquilibriumMonitor::State& monitor = body.monitor;
+        visit_field(archive, monitor.density_sample);
+        visit_field(archive, monitor.accumulation_sample);
+        visit_field(archive, monitor.deposition_rate);
+        archive.value(monitor.last_sample_step);
+        archive.value(monitor.samples_taken);
+        archive.value(monitor.stable_samples);
+        archive.value(monitor.equilibrium_step);
+        archive.value(monitor.density_change);
+        archive.value(monitor.deposition_change);
+        archive.value(monitor.total_deposition_rate);
+    }
+
+    template <typename T>
+    bool has_shape(const Field2D<T>& field, std::size_t nx, std::size_t ny)
+    {
+        return field.nx == nx && field.ny == ny && (field.is_uniform() ? field.data.empty() : field.data.size() == nx * ny);
+    }
+
+    template <typename T>
+    bool has_shape(const Field1D<T>& field, std::size_t nx)
+    {
+        return field.nx == nx && (field.is_uniform() ? field.data.empty() : field.data.size() == nx);
+    }
+
+    bool write_image(const std::string& path, const unsigned char* image, std::size_t bytes)
+    {
+#ifdef __linux__
+        // O_DIRECT skips the page cache; filesystems without it (tmpfs) get a plain buffered write.
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        if (fd < 0 && errno == EINVAL) fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+
+        std::size_t written = 0;
+        while (written < bytes)
+        {
+            const ssize_t result = ::write(fd, image + written, bytes - written);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+        const bool synced = ::fdatasync(fd) == 0;
+        return ::close(fd) == 0 && synced;
+#else
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(image), static_cast<std::streamsize>(bytes));
+        stream.flush();
+        return static_cast<bool>(stream);
+#endif
+    }
+}
+
+std::uint64_t params_hash(const Params& params)
+{
+    // FNV-1a over each member's bytes, listed explicitly so struct padding never enters the hash.
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto mix = [&hash](const auto& value)
+    {
+        unsigned char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        for (const unsigned char byte : bytes)
+        {
+            hash ^= byte;
+            hash *= 1099511628211ull;
+        }
+    };
+
+    mix(params.wind_speed);
+    mix(params.settling_speed);
+    mix(params.precipitation_rate);
+    mix(params.ground_height);
+    mix(params.settaled_snow_density);
+    mix(params.erosion_threshold_friction_velocity);
+    mix(params.erosion_rate_coefficient);
+    mix(params.surface_roughness_length);
+    mix(params.Lx);
+    mix(params.Ly);
+    mix(params.dx);
+    mix(params.dy);
+    mix(static_cast<std::uint64_t>(params.nx));
+    mix(static_cast<std::uint64_t>(params.ny));
+    mix(params.time_step_duration);
+    mix(static_cast<std::uint64_t>(params.top_inflow_cells));
+    mix(params.snow_source_steady_tolerance);
+    mix(static_cast<std::uint64_t>(params.snow_source_steady_steps));
+    mix(params.equilibrium_tolerance);
+    mix(static_cast<std::uint64_t>(params.equilibrium_sample_interval));
+    mix(static_cast<std::uint64_t>(params.equilibrium_stable_samples));
+    mix(static_cast<std::uint8_t>(params.equilibrium_extrapolate));
+    return hash;
+}
+
+void CheckpointWriter::AlignedFree::operator()(unsigned char* buffer) const
+{
+    ::operator delete(buffer, std::align_val_t(checkpoint_block));
+}
+
+CheckpointWriter::CheckpointWriter() = default;
+
+CheckpointWriter::~CheckpointWriter() = default;
+
+bool CheckpointWriter::write(const std::string& path,
+                             long long step,
+                             std::uint64_t hash,
+                             const Params& params,
+                             const Fields& fields,
+                             const std::vector<SnowSourceBoundary>& sources,
+                             const EquilibriumMonitor& monitor)
+{
+    const auto write_start = std::chrono::steady_clock::now();
+
+    CheckpointBody body;
+    body.step = static_cast<std::uint64_t>(step);
+    body.params_hash = hash;
+    body.wind_speed = params.wind_speed;
+    body.settling_speed = params.settling_speed;
+    body.precipitation_rate = params.precipitation_rate;
+    body.fields = const_cast<Fields*>(&fields); // the size and write archives only read through it
+    for (const SnowSourceBoundary& source : sources)
+    {
+        body.source_sides.push_back(static_cast<std::uint32_t>(source.side()));
+        body.sources.push_back(source.state());
+    }
+    body.monitor = monitor.state();
+
+    SizeArchive sizer;
+    visit_checkpoint(sizer, body);
+    const std::size_t payload_offset = round_up(sizeof(CheckpointHeader), checkpoint_array_alignment);
+    const std::size_t image_bytes = round_up(payload_offset + sizer.size(), checkpoint_block);
+
+    if (image_bytes > capacity_)
+    {
+        buffer_.reset(static_cast<unsigned char*>(::operator new(image_bytes, std::align_val_t(checkpoint_block))));
+        capacity_ = image_bytes;
+    }
+    unsigned char* image = buffer_.get();
+    std::memset(image, 0, payload_offset);
+    std::memset(image + payload_offset + sizer.size(), 0, image_bytes - payload_offset - sizer.size());
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, checkpoint_magic, sizeof(checkpoint_magic));
+    header.version = checkpoint_version;
+    header.payload_bytes = sizer.size();
+    std::memcpy(image, &header, sizeof(header));
+
+    WriteArchive writer(image + payload_offset);
+    visit_checkpoint(writer, body);
+
+    const std::string temp_path = path + ".tmp";
+    if (!write_image(temp_path, image, image_bytes))
+    {
+        std::cerr << "[checkpoint] cannot write " << temp_path << "\n";
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error)
+    {
+        std::cerr << "[checkpoint] cannot replace " << path << ": " << error.message() << "\n";
+        return false;
+    }
+
+    last_bytes_ = image_bytes;
+    last_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count();
+    return true;
+}
+
+bool read_checkpoint(const std::string& path,
+                     std::uint64_t expected_hash,
+                     long long& step_out,
+                     Params& params,
+                     Fields& fields,
+                     std::vector<SnowSourceBoundary>& sources,
+                     EquilibriumMonitor& monitor)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+    {
+        std::cerr << "[checkpoint] cannot open " << path << "\n";
+        return false;
+    }
+    const std::vector<unsigned char> image((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    CheckpointHeader header{};
+    const std::size_t payload_offset = round_up(sizeof(CheckpointHeader), checkpoint_array_alignment);
+    if (image.size() >= sizeof(header)) std::memcpy(&header, image.data(), sizeof(header));
+    if (image.size() < payload_offset || std::memcmp(header.magic, checkpoint_magic, sizeof(checkpoint_magic)) != 0
+        || header.version != checkpoint_version || header.payload_bytes > image.size() - payload_offset)
+    {
+        std::cerr << "[checkpoint] " << path << " is not a version " << checkpoint_version << " checkpoint\n";
+        return false;
+    }
+
+    // read into a scratch Fields so a bad file leaves the caller's state untouched.
+    Fields restored;
+    CheckpointBody body;
+    body.fields = &restored;
+    ReadArchive reader(image.data() + payload_offset, static_cast<std::size_t>(header.payload_bytes));
+    visit_checkpoint(reader, body);
+    if (!reader.ok())
+    {
+        std::cerr << "[checkpoint] " << path << " is truncated\n";
+        return false;
+    }
+    if (body.params_hash != expected_hash)
+    {
+        std::cerr << "[checkpoint] " << path << " was written with different params; refusing to restart from it\n";
+        return false;
+    }
+
+    const std::size_t nx = params.nx;
+    const std::size_t ny = params.ny;
+    const bool shapes_ok = has_shape(restored.air_mask, nx, ny)
+        && has_shape(restored.snow_density, nx, ny)
+        && has_shape(restored.snow_transport_speed_x, nx + 1, ny)
+        && has_shape(restored.snow_transport_speed_y, nx, ny + 1)
+        && has_shape(restored.snow_accumulation_mass, nx)
+        && has_shape(restored.snow_accumulation_density, nx)
+        && (has_shape(restored.snow_accumulation_depth, nx) || has_shape(restored.snow_accumulation_depth, 0)) // the ground update
+        && (has_shape(restored.terrain_surface_index, nx) || has_shape(restored.terrain_surface_index, 0))       // sizes these lazily
+        && (has_shape(restored.ground_surface_index, nx) || has_shape(restored.ground_surface_index, 0))
+        && has_shape(restored.precipitation_source, nx)
+        && has_shape(restored.windborn_horizontal_source_left, ny)
+        && has_shape(restored.windborn_horizontal_source_right, ny);
+    if (!shapes_ok)
+    {
+        std::cerr << "[checkpoint] " << path << " does not match the " << nx << "x" << ny << " grid\n";
+        return false;
+    }
+
+    if (body.sources.size() != sources.size())
+    {
+        std::cerr << "[checkpoint] " << path << " has " << body.sources.size() << " boundary sources, run has " << sources.size() << "\n";
+        return false;
+    }
+    for (std::size_t k = 0; k < sources.size(); ++k)
+    {
+        if (body.source_sides[k] != static_cast<std::uint32_t>(sources[k].side()))
+        {
+            std::cerr << "[checkpoint] " << path << ": boundary source " << k << " is on a different side\n";
+            return false;
+        }
+    }
+    std::vector<SnowSourceBoundary> restored_sources = sources;
+    for (std::size_t k = 0; k < sources.size(); ++k)
+    {
+        if (!restored_sources[k].restore(body.sources[k]))
+        {
+            std::cerr << "[checkpoint] " << path << ": boundary source " << k << " has a different column height\n";
+            return false;
+        }
+    }
+
+    restored.next_snow_density = Field2D<float>::uniform(nx, ny, 0.0f);
+    restored.air_mask_dirty.clear();
+    fields = std::move(restored);
+    sources = std::move(restored_sources);
+    monitor.restore(body.monitor);
+    params.wind_speed = body.wind_speed;
+    params.settling_speed = body.settling_speed;
+    params.precipitation_rate = body.precipitation_rate;
+    step_out = static_cast<long long>(body.step);
+    return true;
+}
+
+} // namespace snow
@@ -0,0 +1,207 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "backend_registry.hpp"
+#include "config_cache.hpp"
+#include "cpu_backend.hpp"
+#include "my_helper.hpp"
+#include "perf_counters.hpp"
+#include "profiler.hpp"
+#include "run_loop.hpp"
+#include "simulation.hpp"
+#include "types.hpp"
+
+// Headless runner: the same run loop as snow_sim_app without OpenGL/GLFW, for batch and cluster runs.
+namespace
+{
+    // non-negative integer option value; false (with a message) for anything else
+    bool parse_count(const std::string& option, const char* text, long long& value)
+    {
+        char* end = nullptr;
+        value = std::strtoll(text, &end, 10);
+        if (end == text || *end != '\0' || value < 0)
+        {
+            std::cerr << "[cli] " << option << " needs a non-negative integer, got " << text << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // airborne plus settled snow, g
+    double total_snow_mass(const snow::Params& params, const snow::Fields& fields)
+    {
+        double airborne = 0.0;
+        for (const float density : fields.snow_density.data) airborne += density;
+        double settled = 0.0;
+        for (std::size_t i = 0; i < fields.snow_accumulation_mass.nx; ++i) settled += fields.snow_accumulation_mass.value(i);
+        return airborne * params.dx * params.dy + settled;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace snow;
+
+    // usage: snow_sim_cli [config.json] [--backend name|auto] [--threads n] [--report-every steps]
+    //                     [--restart checkpoint] [--no-cache] [--cache-dir directory] [--list-backends]
+    //                     [--trace trace.json] [--perf-counters]
+    std::string config_path = "resources/configs/default.json";
+    std::string restart_path;
+    std::string trace_path;
+    std::string cache_directory = default_config_cache_directory();
+    std::string backend; // empty: params.backend, then default_backend_name()
+    long long threads = 0;
+    long long report_every = 0;
+    bool use_cache = true;
+    bool perf_counters_on = false;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const std::string option = argv[arg];
+        if (option == "--restart" && arg + 1 < argc)
+        {
+            restart_path = argv[++arg];
+        }
+        else if (option == "--backend" && arg + 1 < argc)
+        {
+            backend = argv[++arg];
+        }
+        else if (option == "--threads" && arg + 1 < argc)
+        {
+            if (!parse_count(option, argv[++arg], threads)) return 1;
+        }
+        else if (option == "--report-every" && arg + 1 < argc)
+        {
+            if (!parse_count(option, argv[++arg], report_every)) return 1;
+        }
+        else if (option == "--trace" && arg + 1 < argc)
+        {
+            trace_path = argv[++arg];
+        }
+        else if (option == "--list-backends")
+        {
+            for (const BackendInfo& info : backends())
+            {
+                std::cout << info.name << (info.capabilities.simd ? " [simd]" : "") << (info.capabilities.threaded ? " [threaded]" : "")
+                          << (info.capabilities.gpu ? " [gpu]" : "") << ": " << info.description << "\n";
+            }
+            std::cout << "auto: times a few steps of each on the loaded grid and runs the fastest\n";
+            return 0;
+        }
+        else if (option == "--perf-counters")
+        {
+            perf_counters_on = true;
+        }
+        else if (option == "--no-cache")
+        {
+            use_cache = false;
+        }
+        else if (option == "--cache-dir" && arg + 1 < argc)
+        {
+            cache_directory = argv[++arg];
+        }
+        else if (option.rfind("--", 0) == 0)
+        {
+            std::cerr << "[cli] unknown option " << option << "\n";
+            return 1;
+        }
+        else
+        {
+            config_path = option;
+        }
+    }
+
+    profile::TraceGuard trace_guard; // declared before the backend, so its workers are gone when it writes
+    if (!trace_path.empty())
+    {
+        if (!SNOWSIM_PROFILE)
+        {
+            std::cerr << "[trace] --trace needs a build configured with -DSNOWSIM_ENABLE_PROFILING=ON; not tracing\n";
+        }
+        else if (!profile::start_trace(trace_path))
+        {
+            return 1;
+        }
+    }
+    SNOW_PROFILE_THREAD("main");
+
+    const auto load_start = std::chrono::steady_clock::now();
+    Params params{};
+    Fields fields;
+    RunConfig run_config;
+    bool cache_hit = false;
+    bool loaded = false;
+    {
+        SNOW_PROFILE_SCOPE(config_load);
+        loaded = use_cache ? load_simulation_config_cached(config_path, cache_directory, params, fields, run_config, &cache_hit)
+                           : load_simulation_config(config_path, params, fields, run_config);
+    }
+    if (!loaded)
+    {
+        std::cerr << "[config] params and fields failed to load from file\n";
+        return 1;
+    }
+    const double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+    if (use_cache)
+    {
+        std::cout << "[config_cache] " << (cache_hit ? "hit: " : "miss, cached as ")
+                  << config_cache_path(config_path, cache_directory) << "\n";
+    }
+    std::cout << "[config] grid " << params.nx << "x" << params.ny << ", " << params.total_time_steps << " steps, loaded in "
+              << load_seconds << " s\n";
+    if (params.viz_on)
+    {
+        std::cout << "[cli] viz_on is ignored by the headless runner\n";
+    }
+
+    if (backend.empty()) backend = run_config.backend.empty() ? default_backend_name() : run_config.backend;
+    BackendOptions backend_options;
+    backend_options.threads = static_cast<unsigned>(threads);
+    std::string backend_name;
+    std::unique_ptr<Simulation> sim = make_backend(backend, params, fields, backend_options, &backend_name);
+    if (!sim)
+    {
+        return 1;
+    }
+    std::cout << "[backend] " << backend_name << "\n";
+
+    // this thread and the backend's workers only: the run loop's I/O threads are not counted
+    PerfCounterGroup perf_counters;
+    const bool counting = perf_counters_on && perf_counters.open(sim->step_thread_ids());
+    if (perf_counters_on && !perf_counters.error().empty())
+    {
+        std::cerr << "[perf] " << (counting ? "hardware counters unavailable: " : "counters unavailable: ") << perf_counters.error() << "\n";
+    }
+    if (counting) sim = std::make_unique<PerfCountedSimulation>(std::move(sim), perf_counters);
+
+    RunHooks hooks;
+    hooks.output_interval_steps = report_every;
+    hooks.output = [](long long step, const Params& run_params, const Fields& run_fields)
+    {
+        std::cout << "[progress] step " << step << "/" << run_params.total_time_steps << " (t="
+                  << static_cast<float>(step) * run_params.time_step_duration << " s), snow mass "
+                  << total_snow_mass(run_params, run_fields) << " g\n";
+    };
+
+    RunTimings timings;
+    if (!run_simulation(*sim, params, fields, run_config, restart_path, hooks, timings))
+    {
+        return 1;
+    }
+
+    print_run_timings(std::cout, timings);
+    if (SNOWSIM_PROFILE) profile::print_report(std::cout, timings.cells);
+    if (counting)
+    {
+        print_perf_report(std::cout, perf_counters.read(), static_cast<double>(timings.steps) * static_cast<double>(timings.cells),
+                          timings.step_seconds, cpu::kernel_bytes_per_cell(fields));
+    }
+    if (!trace_guard.stop())
+    {
+        return 1;
+    }
+    return 0;
+}
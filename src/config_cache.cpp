@@ -0,0 +1,518 @@
+#include "config_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "field_file.hpp"
+#include "my_helper.hpp"
+
+namespace snow
+{
+
+namespace
+{
+    const char config_cache_meta_name[] = "cache_meta";
+
+    // FNV-1a, as params_hash uses, continued from hash.
+    std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t k = 0; k < size; ++k)
+        {
+            hash ^= bytes[k];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    bool hash_file(const std::string& path, std::uint64_t& hash)
+    {
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream) return false;
+        std::vector<char> buffer(std::size_t{ 1 } << 16);
+        while (stream)
+        {
+            stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            hash = hash_bytes(buffer.data(), static_cast<std::size_t>(stream.gcount()), hash);
+        }
+        return stream.eof();
+    }
+
+    std::string absolute_path(const std::string& path)
+    {
+        std::error_code error;
+        const std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        return error ? path : absolute.lexically_normal().string();
+    }
+
+    // Cache key of a config: schema version, absolute path (relative references resolve against its
+    // directory) and bytes.
+    bool config_key(const std::string& config_path, std::uint64_t& key)
+    {
+        key = hash_bytes(&config_cache_schema_version, sizeof(config_cache_schema_version));
+        const std::string absolute = absolute_path(config_path);
+        key = hash_bytes(absolute.data(), absolute.size(), key);
+        return hash_file(config_path, key);
+    }
+
+    // cache_meta payload (native endianness): size_t as uint64, bool as uint8, strings as a uint32
+    // length and the bytes, string lists as a uint64 count and the strings.
+    class MetaWriter
+    {
+    public:
+        template <typename T>
+        void value(const T& value)
+        {
+            static_assert(std::is_arithmetic<T>::value, "meta values are numbers");
+            if constexpr (std::is_same<T, std::size_t>::value) put(static_cast<std::uint64_t>(value));
+            else if constexpr (std::is_same<T, bool>::value) put(static_cast<std::uint8_t>(value ? 1 : 0));
+            else put(value);
+        }
+
+        void value(const std::string& text)
+        {
+            put(static_cast<std::uint32_t>(text.size()));
+            bytes_.insert(bytes_.end(), text.begin(), text.end());
+        }
+
+        void value(const std::vector<std::string>& texts)
+        {
+            put(static_cast<std::uint64_t>(texts.size()));
+            for (const std::string& text : texts) value(text);
+        }
+
+        const std::vector<std::uint8_t>& bytes() const { return bytes_; }
+
+    private:
+        template <typename T>
+        void put(T value)
+        {
+            const std::size_t offset = bytes_.size();
+            bytes_.resize(offset + sizeof(T));
+            std::memcpy(bytes_.data() + offset, &value, sizeof(T));
+        }
+
+        std::vector<std::uint8_t> bytes_;
+    };
+
+    class MetaReader
+    {
+    public:
+        MetaReader(const std::uint8_t* data, std::size_t size) :
+            data_(data),
+            size_(size)
+        {}
+
+        template <typename T>
+        void value(T& value)
+        {
+            static_assert(std::is_arithmetic<T>::value, "meta values are numbers");
+            if constexpr (std::is_same<T, std::size_t>::value)
+            {
+                std::uint64_t stored = 0;
+                get(stored);
+                value = static_cast<std::size_t>(stored);
+            }
+            else if constexpr (std::is_same<T, bool>::value)
+            {
+                std::uint8_t stored = 0;
+                get(stored);
+                value = stored != 0;
+            }
+            else get(value);
+        }
+
+        void value(std::string& text)
+        {
+            std::uint32_t length = 0;
+            get(length);
+            if (!ok_ || length > size_ - offset_)
+            {
+                ok_ = false;
+                return;
+            }
+            text.assign(reinterpret_cast<const char*>(data_ + offset_), length);
+            offset_ += length;
+        }
+
+        void value(std::vector<std::string>& texts)
+        {
+            std::uint64_t count = 0;
+            get(count);
+            // every string takes at least its length word
+            if (!ok_ || count > (size_ - offset_) / sizeof(std::uint32_t))
+            {
+                ok_ = false;
+                return;
+            }
+            texts.assign(static_cast<std::size_t>(count), std::string());
+            for (std::string& text : texts) value(text);
+        }
+
+        bool ok() const { return ok_; }
+        bool at_end() const { return offset_ == size_; }
+
+    private:
+        template <typename T>
+        void get(T& value)
+        {
+            if (!ok_ || sizeof(T) > size_ - offset_)
+            {
+                ok_ = false;
+                return;
+            }
+            std::memcpy(&value, data_ + offset_, sizeof(T));
+            offset_ += sizeof(T);
+        }
+
+        const std::uint8_t* data_;
+        std::size_t size_;
+        std::size_t offset_ = 0;
+        bool ok_ = true;
+    };
+
+    // Every Params member, in declaration order. P is Params for reading and const Params for writing.
+    template <typename Archive, typename P>
+    void serialize_params(Archive& archive, P& params)
+    {
+        archive.value(params.wind_speed);
+        archive.value(params.settling_speed);
+        archive.value(params.precipitation_rate);
+        archive.value(params.ground_height);
+        archive.value(params.settaled_snow_density);
+        archive.value(params.erosion_threshold_friction_velocity);
+        archive.value(params.erosion_rate_coefficient);
+        archive.value(params.surface_roughness_length);
+        archive.value(params.Lx);
+        archive.value(params.Ly);
+        archive.value(params.dx);
+        archive.value(params.dy);
+        archive.value(params.nx);
+        archive.value(params.ny);
+        archive.value(params.total_sim_time);
+        archive.value(params.time_step_duration);
+        archive.value(params.top_inflow_cells);
+        archive.value(params.snow_source_steady_tolerance);
+        archive.value(params.snow_source_steady_steps);
+        archive.value(params.equilibrium_tolerance);
+        archive.value(params.equilibrium_sample_interval);
+        archive.value(params.equilibrium_stable_samples);
+        archive.value(params.equilibrium_extrapolate);
+        archive.value(params.total_time_steps);
+        archive.value(params.steps_per_frame);
+        archive.value(params.viz_on);
+        archive.value(params.light_direction.x);
+        archive.value(params.light_direction.y);
+        archive.value(params.light_direction.z);
+        archive.value(params.light_color.x);
+        archive.value(params.light_color.y);
+        archive.value(params.light_color.z);
+        archive.value(params.object_color.x);
+        archive.value(params.object_color.y);
+        archive.value(params.object_color.z);
+        archive.value(params.arrow_plane_z);
+        archive.value(params.arrow_density_max);
+        archive.value(params.arrow_reference_wind);
+        archive.value(params.arrow_min_length);
+    }
+
+    template <typename Archive, typename R>
+    void serialize_run_config(Archive& archive, R& run)
+    {
+        archive.value(run.forcing_path);
+        archive.value(run.forcing_prefetch_records);
+        archive.value(run.checkpoint_path);
+        archive.value(run.checkpoint_interval_steps);
+        archive.value(run.snapshot_directory);
+        archive.value(run.snapshot_interval_steps);
+        archive.value(run.snapshot_queue_depth);
+        archive.value(run.snapshot_format);
+        archive.value(run.snapshot_error_bound);
+        archive.value(run.snapshot_tile);
+        archive.value(run.snapshot_time_block);
+        archive.value(run.dump_path);
+        archive.value(run.dump_fields);
+        archive.value(run.input_files);
+        archive.value(run.backend);
+    }
+
+    // Entry name and shape (from params) of every stored Fields array.
+    struct CachedArray
+    {
+        const char* name;
+        std::size_t nx;
+        std::size_t ny; // 0 = 1D
+    };
+
+    std::vector<CachedArray> cached_arrays(const Params& params)
+    {
+        const std::size_t nx = params.nx;
+        const std::size_t ny = params.ny;
+        return {
+            { "air_mask", nx, ny },
+            { "snow_density", nx, ny },
+            { "next_snow_density", nx, ny },
+            { "snow_transport_speed_x", nx + 1, ny },
+            { "snow_transport_speed_y", nx, ny + 1 },
+            { "snow_accumulation_mass", nx, 0 },
+            { "snow_accumulation_density", nx, 0 },
+            { "precipitation_source", nx, 0 },
+            { "windborn_horizontal_source_left", ny, 0 },
+            { "windborn_horizontal_source_right", ny, 0 },
+        };
+    }
+
+    bool is_mask(const CachedArray& array)
+    {
+        return std::strcmp(array.name, "air_mask") == 0;
+    }
+
+    // The float Fields member behind a cached array name (air_mask is handled separately).
+    template <typename F>
+    auto& float_member(F& fields, const std::string& name)
+    {
+        if (name == "snow_density") return fields.snow_density;
+        if (name == "next_snow_density") return fields.next_snow_density;
+        if (name == "snow_transport_speed_x") return fields.snow_transport_speed_x;
+        return fields.snow_transport_speed_y;
+    }
+
+    template <typename F>
+    auto& float_member_1d(F& fields, const std::string& name)
+    {
+        if (name == "snow_accumulation_mass") return fields.snow_accumulation_mass;
+        if (name == "snow_accumulation_density") return fields.snow_accumulation_density;
+        if (name == "precipitation_source") return fields.precipitation_source;
+        if (name == "windborn_horizontal_source_left") return fields.windborn_horizontal_source_left;
+        return fields.windborn_horizontal_source_right;
+    }
+
+    // Reads an entry into the outputs; false (outputs untouched) when it is unusable.
+    bool read_entry(const std::string& path, std::uint64_t key, Params& params_out, Fields& fields_out, RunConfig& run_out)
+    {
+        MappedFieldFile file;
+        if (!file.open(path)) return false;
+
+        const Field2DView<const std::uint8_t> meta = file.view<std::uint8_t>(config_cache_meta_name);
+        if (meta.empty() || meta.ny != 1)
+        {
+            std::cerr << "[config_cache] " << path << " has no cache_meta array\n";
+            return false;
+        }
+
+        MetaReader reader(meta.row(0), meta.nx);
+        std::uint32_t schema = 0;
+        std::uint64_t stored_key = 0;
+        reader.value(schema);
+        reader.value(stored_key);
+        if (!reader.ok() || schema != config_cache_schema_version || stored_key != key)
+        {
+            std::cerr << "[config_cache] " << path << " was written for another schema or config\n";
+            return false;
+        }
+
+        Params params{};
+        RunConfig run;
+        std::vector<std::uint64_t> input_hashes;
+        serialize_params(reader, params);
+        serialize_run_config(reader, run);
+        input_hashes.resize(run.input_files.size());
+        for (std::uint64_t& hash : input_hashes) reader.value(hash);
+        const std::vector<CachedArray> arrays = cached_arrays(params);
+        std::vector<std::optional<float>> uniform_values(arrays.size());
+        for (std::size_t k = 0; k < arrays.size(); ++k)
+        {
+            if (is_mask(arrays[k])) continue;
+            bool uniform = false;
+            float value = 0.0f;
+            reader.value(uniform);
+            reader.value(value);
+            if (uniform) uniform_values[k] = value;
+        }
+        // surface bookkeeping as the loader left it (the mask alone cannot tell terrain from settled snow)
+        Field1D<std::size_t> terrain_surface_index(params.nx);
+        Field1D<std::size_t> ground_surface_index(params.nx);
+        for (std::size_t& row : terrain_surface_index.data) reader.value(row);
+        for (std::size_t& row : ground_surface_index.data) reader.value(row);
+        const auto above_grid = [&params](std::size_t row) { return row > params.ny; };
+        if (!reader.ok() || !reader.at_end()
+            || std::any_of(terrain_surface_index.data.begin(), terrain_surface_index.data.end(), above_grid)
+            || std::any_of(ground_surface_index.data.begin(), ground_surface_index.data.end(), above_grid))
+        {
+            std::cerr << "[config_cache] " << path << " has a damaged cache_meta array\n";
+            return false;
+        }
+
+        for (std::size_t k = 0; k < run.input_files.size(); ++k)
+        {
+            std::uint64_t hash = 14695981039346656037ull;
+            if (!hash_file(run.input_files[k], hash) || hash != input_hashes[k])
+            {
+                std::cerr << "[config_cache] " << run.input_files[k] << " changed since " << path << " was written\n";
+                return false;
+            }
+        }
+
+        Fields fields;
+        for (std::size_t k = 0; k < arrays.size(); ++k)
+        {
+            const CachedArray& array = arrays[k];
+            if (uniform_values[k])
+            {
+                if (array.ny == 0) float_member_1d(fields, array.name) = Field1D<float>::uniform(array.nx, *uniform_values[k]);
+                else float_member(fields, array.name) = Field2D<float>::uniform(array.nx, array.ny, *uniform_values[k]);
+                continue;
+            }
+            const std::size_t rows = array.ny == 0 ? 1 : array.ny;
+            const FieldFileEntry* entry = file.find(array.name);
+            if (entry == nullptr || entry->nx != array.nx || entry->ny != rows
+                || entry->dtype != (is_mask(array) ? FieldDType::u8 : FieldDType::f32))
+            {
+                std::cerr << "[config_cache] " << path << ": array '" << array.name << "' is missing or has the wrong shape\n";
+                return false;
+            }
+            if (is_mask(array)) copy_mapped_field(file.view<std::uint8_t>(array.name), fields.air_mask);
+            else if (array.ny == 0) copy_mapped_field(file.view<float>(array.name), float_member_1d(fields, array.name));
+            else copy_mapped_field(file.view<float>(array.name), float_member(fields, array.name));
+        }
+
+        derive_surface_indices(fields, params); // snow_accumulation_depth, as the loader leaves it
+        fields.terrain_surface_index = std::move(terrain_surface_index);
+        fields.ground_surface_index = std::move(ground_surface_index);
+        fields.air_mask_dirty.clear();
+
+        params_out = params;
+        fields_out = std::move(fields);
+        run_out = std::move(run);
+        return true;
+    }
+
+    bool write_entry(const std::string& path, std::uint64_t key, const Params& params, const Fields& fields, const RunConfig& run)
+    {
+        MetaWriter writer;
+        writer.value(config_cache_schema_version);
+        writer.value(key);
+        serialize_params(writer, params);
+        serialize_run_config(writer, run);
+        for (const std::string& input : run.input_files)
+        {
+            std::uint64_t hash = 14695981039346656037ull;
+            if (!hash_file(input, hash))
+            {
+                std::cerr << "[config_cache] cannot read " << input << "\n";
+                return false;
+            }
+            writer.value(hash);
+        }
+
+        // uniform fields go into the meta as their value, the rest as arrays
+        std::vector<FieldFileSource> sources;
+        for (const CachedArray& array : cached_arrays(params))
+        {
+            if (is_mask(array))
+            {
+                sources.push_back(field_file_source(array.name, fields.air_mask));
+                continue;
+            }
+            const std::optional<float>& uniform_value = array.ny == 0 ? float_member_1d(fields, array.name).uniform_value
+                                                                      : float_member(fields, array.name).uniform_value;
+            writer.value(uniform_value.has_value());
+            writer.value(uniform_value.value_or(0.0f));
+            if (uniform_value) continue;
+            if (array.ny == 0) sources.push_back(field_file_source(array.name, float_member_1d(fields, array.name)));
+            else sources.push_back(field_file_source(array.name, float_member(fields, array.name)));
+        }
+        for (const std::size_t row : fields.terrain_surface_index.data) writer.value(row);
+        for (const std::size_t row : fields.ground_surface_index.data) writer.value(row);
+        FieldFileSource meta;
+        meta.name = config_cache_meta_name;
+        meta.dtype = FieldDType::u8;
+        meta.nx = writer.bytes().size();
+        meta.ny = 1;
+        meta.pitch = meta.nx;
+        meta.data = writer.bytes().data();
+        sources.push_back(meta);
+
+        // concurrent runs of one config may race to write the entry; each writes its own file and the
+        // last rename wins
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+        const std::string temporary = path + ".tmp" + std::to_string(std::random_device{}());
+        if (!write_field_file(temporary, sources)) return false;
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            std::cerr << "[config_cache] cannot rename " << temporary << " to " << path << ": " << error.message() << "\n";
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+        return true;
+    }
+
+    std::string entry_path(const std::string& cache_directory, std::uint64_t key)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string name(16, '0');
+        for (int k = 15; k >= 0; --k, key >>= 4) name[k] = digits[key & 0xf];
+        return (std::filesystem::path(cache_directory) / (name + ".snowcache")).string();
+    }
+}
+
+std::string default_config_cache_directory()
+{
+    std::error_code error;
+    const std::filesystem::path temporary = std::filesystem::temp_directory_path(error);
+    return ((error ? std::filesystem::path(".") : temporary) / "snowsim_config_cache").string();
+}
+
+std::string config_cache_path(const std::string& config_path, const std::string& cache_directory)
+{
+    std::uint64_t key = 0;
+    if (!config_key(config_path, key)) return {};
+    return entry_path(cache_directory, key);
+}
+
+bool load_simulation_config_cached(const std::string& config_path,
+                                   const std::string& cache_directory,
+                                   Params& params_out,
+                                   Fields& fields_out,
+                                   RunConfig& run_out,
+                                   bool* hit_out)
+{
+    if (hit_out) *hit_out = false;
+
+    std::uint64_t key = 0;
+    if (!config_key(config_path, key))
+    {
+        return false;
+    }
+    const std::string path = entry_path(cache_directory, key);
+
+    std::error_code error;
+    if (std::filesystem::exists(path, error) && read_entry(path, key, params_out, fields_out, run_out))
+    {
+        if (hit_out) *hit_out = true;
+        return true;
+    }
+
+    if (!load_simulation_config(config_path, params_out, fields_out, run_out))
+    {
+        return false;
+    }
+    if (!write_entry(path, key, params_out, fields_out, run_out))
+    {
+        std::cerr << "[config_cache] could not write " << path << "; continuing without a cache entry\n";
+    }
+    return true;
+}
+
+} // namespace snow
@@ -1,8 +1,27 @@
 ﻿#include "cpu_backend.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SNOW_CPU_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "my_helper.hpp"
+#include "profiler.hpp"
+
 namespace snow
 {
     namespace cpu
@@ -13,12 +32,13 @@ namespace snow
             // Upwind snow mass flux across vertical face (face_i, j).
             // face_i: column index of the face (0..nx), j: row index (0..ny-1).
             // Returns g/(m*s) using the donor air cell; zero for ground or domain edges.
-            inline float face_flux_x(const Fields& fields, std::size_t face_i, std::size_t j)
+            template <typename SpeedX>
+            inline float face_flux_x(const StepViews& fields, const SpeedX& speed_x, std::size_t face_i, std::size_t j)
             {
                 // TODO: pull out threshold flux and put it in params so it can be consistant between face_flux_x and face_flux_y
                 const float threshold_flux = 1e-5f;
 
-                const float velocity = fields.snow_transport_speed_x(face_i, j);
+                const float velocity = speed_x(face_i, j);
                 if (velocity == 0.0f) return 0.0f; //no wind, return 0
 
                 // source cell aligns with the upwind tile; mark out-of-domain with nx sentinel.
@@ -38,11 +58,12 @@ namespace snow
             // Upwind snow mass flux across horizontal face (i, face_j).
             // i: column index of the face (0..nx-1), face_j: row index (0..ny).
             // Returns g/(m*s) using the donor air cell; zero for ground or domain edges.
-            inline float face_flux_y(const Fields& fields, std::size_t i, std::size_t face_j)
+            template <typename SpeedY>
+            inline float face_flux_y(const StepViews& fields, const SpeedY& speed_y, std::size_t i, std::size_t face_j)
             {
                 const float threshold_flux = 1e-5f; // TODO: share with face_flux_x via params.
 
-                const float velocity = fields.snow_transport_speed_y(i, face_j);
+                const float velocity = speed_y(i, face_j);
                 if (velocity == 0.0f) return 0.0f; // no vertical wind, return 0
 
                 // source cell aligns with the upwind tile; mark out-of-domain with ny sentinel.
@@ -57,90 +78,414 @@ namespace snow
                 const float clamped_face_flux = (std::fabs(face_flux) > threshold_flux) ? face_flux : 0.0f;
 
                 return clamped_face_flux;
-            }        
-        } // namespace
+            }
 
-        void CPUSimulation::step(Fields& fields, const Params& params)
-        {
-            const float dt = params.time_step_duration;
-            const float dx = params.dx;
-            const float dy = params.dy;
+            // Stands in for a speed view when the whole field moves at one speed, so the constant-wind
+            // kernel reads no speed memory at all.
+            struct UniformSpeed
+            {
+                float speed;
 
-            if (fields.next_snow_density.nx != fields.snow_density.nx || fields.next_snow_density.ny != fields.snow_density.ny) //checks if sim sizes don't match. this should alwasy be flase.
+                inline float operator()(std::size_t, std::size_t) const
+                {
+                    return speed;
+                }
+            };
+
+#ifdef SNOW_CPU_SSE2
+            inline __m128 load_speed4(const UniformSpeed& speed, std::size_t, std::size_t)
             {
-                fields.next_snow_density.resize(fields.snow_density.nx, fields.snow_density.ny, 0.0f);
+                return _mm_set1_ps(speed.speed);
             }
 
-            std::vector<float> column_deposit(fields.snow_density.nx, 0.0f);
+            inline __m128 load_speed4(const Field2DView<const float>& speed, std::size_t i, std::size_t j)
+            {
+                return _mm_loadu_ps(&speed(i, j));
+            }
 
-            for (std::size_t j = 0; j < fields.snow_density.ny; ++j)
+            // face_flux_x / face_flux_y for four faces whose donors are known to be air cells in the domain:
+            // the upwind density times the velocity, zero below the threshold.
+            inline __m128 upwind_flux4(__m128 velocity, __m128 density_below, __m128 density_above)
             {
-                for (std::size_t i = 0; i < fields.snow_density.nx; ++i)
+                const __m128 threshold_flux = _mm_set1_ps(1e-5f);
+                const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+                const __m128 positive = _mm_cmpgt_ps(velocity, _mm_setzero_ps());
+                const __m128 donor = _mm_or_ps(_mm_and_ps(positive, density_below), _mm_andnot_ps(positive, density_above));
+                const __m128 face_flux = _mm_mul_ps(velocity, donor);
+                return _mm_and_ps(_mm_cmpgt_ps(_mm_and_ps(face_flux, abs_mask), threshold_flux), face_flux);
+            }
+
+            // Cells (i..i+3, j) can take the four-wide path when they, their left/right donors and the cells
+            // above and below are all air: no ground, no surface exchange, no inflow source to special-case.
+            inline bool air_block4(const StepViews& fields, std::size_t i, std::size_t j)
+            {
+                const std::uint8_t* row = fields.air_mask.row(j) + i;
+                const std::uint8_t* below = fields.air_mask.row(j - 1) + i;
+                const std::uint8_t* above = fields.air_mask.row(j + 1) + i;
+                return row[-1] && row[0] && row[1] && row[2] && row[3] && row[4]
+                       && below[0] && below[1] && below[2] && below[3]
+                       && above[0] && above[1] && above[2] && above[3];
+            }
+
+            // The scalar update of four interior air cells, op for op, so both paths round the same way.
+            template <typename SpeedX, typename SpeedY>
+            inline void advect_air_block4(const StepViews& fields, const SpeedX& speed_x, const SpeedY& speed_y,
+                                          float dt_dx, float dt_dy, std::size_t i, std::size_t j)
+            {
+                const __m128 density = _mm_loadu_ps(&fields.snow_density(i, j));
+                const __m128 flux_left = upwind_flux4(load_speed4(speed_x, i, j), _mm_loadu_ps(&fields.snow_density(i - 1, j)), density);
+                const __m128 flux_right = upwind_flux4(load_speed4(speed_x, i + 1, j), density, _mm_loadu_ps(&fields.snow_density(i + 1, j)));
+                const __m128 flux_bottom = upwind_flux4(load_speed4(speed_y, i, j), _mm_loadu_ps(&fields.snow_density(i, j - 1)), density);
+                const __m128 flux_top = upwind_flux4(load_speed4(speed_y, i, j + 1), density, _mm_loadu_ps(&fields.snow_density(i, j + 1)));
+
+                __m128 next = _mm_add_ps(density, _mm_mul_ps(_mm_set1_ps(dt_dx), _mm_sub_ps(flux_left, flux_right)));
+                next = _mm_add_ps(next, _mm_mul_ps(_mm_set1_ps(dt_dy), _mm_sub_ps(flux_bottom, flux_top)));
+                next = _mm_add_ps(next, _mm_setzero_ps()); // the scalar path adds its (zero) inflow sources
+                _mm_storeu_ps(&fields.next_snow_density(i, j), _mm_max_ps(_mm_setzero_ps(), next));
+            }
+#endif
+
+            template <bool Simd, typename SpeedX, typename SpeedY>
+            void advect_snow_with(const StepViews& fields, const SpeedX& speed_x, const SpeedY& speed_y, const Params& params,
+                                  std::size_t j_begin, std::size_t j_end)
+            {
+                const float dt = params.time_step_duration;
+                const float dx = params.dx;
+                const float dy = params.dy;
+                const Field1DView<float>& column_deposit = fields.column_deposit;
+
+                // log-law factor that turns the wind in the lowest air cell into a friction velocity,
+                // evaluated at the cell centre (dy/2) over the snow roughness length. Same for every column.
+                const bool erosion_on = params.erosion_rate_coefficient > 0.0f && params.surface_roughness_length > 0.0f
+                                        && 0.5f * dy > params.surface_roughness_length;
+                const float von_karman = 0.41f;
+                const float friction_factor = erosion_on ? von_karman / std::log(0.5f * dy / params.surface_roughness_length) : 0.0f;
+                const float threshold_sq = params.erosion_threshold_friction_velocity * params.erosion_threshold_friction_velocity;
+
+                for (std::size_t j = j_begin; j < j_end; ++j)
                 {
-                    if (!fields.air_mask(i, j)) // if grid cell is underground, it contains no snow.
+#ifdef SNOW_CPU_SSE2
+                    const bool interior_row = Simd && j > 0 && j + 1 < fields.snow_density.ny;
+#endif
+                    for (std::size_t i = 0; i < fields.snow_density.nx; ++i)
                     {
-                        fields.next_snow_density(i, j) = 0.0f;
-                        continue;
-                    }
+#ifdef SNOW_CPU_SSE2
+                        // four cells at a time away from the domain edges and the ground
+                        if (interior_row && i > 0 && i + 5 <= fields.snow_density.nx && air_block4(fields, i, j))
+                        {
+                            advect_air_block4(fields, speed_x, speed_y, dt / dx, dt / dy, i, j);
+                            i += 3;
+                            continue;
+                        }
+#endif
+                        if (!fields.air_mask(i, j)) // if grid cell is underground, it contains no snow.
+                        {
+                            fields.next_snow_density(i, j) = 0.0f;
+                            continue;
+                        }
 
-                    float density = fields.snow_density(i, j);
+                        float density = fields.snow_density(i, j);
 
-                    float top_sorce = 0;
-                    float right_sorce = 0;
-                    float left_sorce = 0;
-                    if (i == 0 && fields.windborn_horizontal_source_left.in_bounds(j)) //if grid cell is in left most col add snow from wind outside of sim
-                    {
-                        if(fields.snow_transport_speed_x.idx(i,j) > 0) // if snow is advecting in from the left
-                            left_sorce =  fields.windborn_horizontal_source_left(j);
-                    }
+                        float top_sorce = 0;
+                        float right_sorce = 0;
+                        float left_sorce = 0;
+                        if (i == 0 && fields.windborn_horizontal_source_left.in_bounds(j)) //if grid cell is in left most col add snow from wind outside of sim
+                        {
+                            if(speed_x(i,j) > 0.0f) // if snow is advecting in from the left
+                                left_sorce =  fields.windborn_horizontal_source_left(j);
+                        }
 
-                    if (i == fields.snow_density.nx - 1 && fields.windborn_horizontal_source_right.in_bounds(j)) //if grid cell is in right most col add snow from wind outside of sim
-                    {
-                        if(fields.snow_transport_speed_x.idx(i+1,j) > 0) // if snow is advecting in from the right
-                            right_sorce = fields.windborn_horizontal_source_right(j);
-                    }
+                        if (i == fields.snow_density.nx - 1 && fields.windborn_horizontal_source_right.in_bounds(j)) //if grid cell is in right most col add snow from wind outside of sim
+                        {
+                            if(speed_x(i+1,j) < 0.0f) // if snow is advecting in from the right
+                                right_sorce = fields.windborn_horizontal_source_right(j);
+                        }
 
-                    if (j == fields.snow_density.ny - 1 && fields.precipitation_source.in_bounds(i)) //if grid cell is in top row add snow from percipitation
-                    {                        
-                        if(fields.snow_transport_speed_x.idx(i,j+1) > 0) // if snow is advecting down from above
-                            top_sorce = fields.precipitation_source(i);
-                    }
+                        if (j == fields.snow_density.ny - 1 && fields.precipitation_source.in_bounds(i)) //if grid cell is in top row add snow from percipitation
+                        {                        
+                            if(speed_y(i,j+1) < 0.0f) // if snow is advecting down from above
+                                top_sorce = fields.precipitation_source(i);
+                        }
 
-                    //calculate snow flux on each side of the cell, velocity is positive when it is right or up
-                    const float flux_left = face_flux_x(fields, i, j);
-                    const float flux_right = face_flux_x(fields, i + 1, j);
-                    const float flux_bottom = face_flux_y(fields, i, j);
-                    const float flux_top = face_flux_y(fields, i, j + 1);
+                        //calculate snow flux on each side of the cell, velocity is positive when it is right or up
+                        const float flux_left = face_flux_x(fields, speed_x, i, j);
+                        const float flux_right = face_flux_x(fields, speed_x, i + 1, j);
+                        const float flux_bottom = face_flux_y(fields, speed_y, i, j);
+                        const float flux_top = face_flux_y(fields, speed_y, i, j + 1);
 
-                    //if grid cell is just above the ground and there is a negitive flux between the grid cell and the ground cell, deposit some snow onto the ground.
-                    if (flux_bottom < 0.0f)
-                    {
+                        // surface cells (ground directly below) exchange snow with the snowpack: deposition and erosion
+                        // share this branch so the snowpack work is one check per surface cell, O(nx) per step.
                         const bool ground_below = (j == 0) || (!fields.air_mask(i, j - 1));
                         if (ground_below)
                         {
-                            const float deposit_per_area = (-flux_bottom) * dt / dy;
-                            const float deposit_mass = deposit_per_area * dx;
-                            column_deposit[i] += deposit_mass;
+                            //if there is a negitive flux between the grid cell and the ground cell, deposit some snow onto the ground.
+                            if (flux_bottom < 0.0f)
+                            {
+                                const float deposit_per_area = (-flux_bottom) * dt / dy;
+                                const float deposit_mass = deposit_per_area * dx * dy; // density change times cell area, matches what the cell loses
+                                column_deposit(i) += deposit_mass;
+                            }
+
+                            // saltation: wind above the threshold friction velocity lifts settled snow back into this cell.
+                            // flux = C * u* * (u*^2 - u*t^2) per metre of surface, limited by the snow the column holds.
+                            if (erosion_on)
+                            {
+                                const float surface_wind = 0.5f * (speed_x(i, j) + speed_x(i + 1, j));
+                                const float friction_velocity = std::fabs(surface_wind) * friction_factor;
+                                const float excess = friction_velocity * friction_velocity - threshold_sq;
+                                if (excess > 0.0f && fields.snow_accumulation_mass.in_bounds(i))
+                                {
+                                    const float available_mass = fields.snow_accumulation_mass(i) + column_deposit(i);
+                                    const float erosion_flux = params.erosion_rate_coefficient * friction_velocity * excess; // g/(m*s)
+                                    const float eroded_mass = std::min(erosion_flux * dx * dt, std::max(available_mass, 0.0f));
+                                    column_deposit(i) -= eroded_mass;
+                                    density += eroded_mass / (dx * dy);
+                                }
+                            }
                         }
+
+                        density += (dt / dx) * (flux_left - flux_right);
+                        density += (dt / dy) * (flux_bottom - flux_top);
+                        density += dt * (left_sorce + right_sorce + top_sorce);
+
+                        fields.next_snow_density(i, j) = std::max(density, 0.0f);
                     }
+                }
+            }
+        } // namespace
+
+        StepViews make_step_views(Fields& fields)
+        {
+            const Fields& read_only = fields;
+            StepViews views;
+            views.air_mask = read_only.air_mask.view();
+            views.snow_density = read_only.snow_density.view();
+            views.next_snow_density = fields.next_snow_density.view(); // materializes the scratch buffer
+            // uniform speeds stay symbolic: empty views plus the value
+            views.snow_transport_speed_x = read_only.snow_transport_speed_x.view();
+            views.snow_transport_speed_y = read_only.snow_transport_speed_y.view();
+            views.uniform_speed_x = read_only.snow_transport_speed_x.uniform_value.value_or(0.0f);
+            views.uniform_speed_y = read_only.snow_transport_speed_y.uniform_value.value_or(0.0f);
+            // uniform sources give stride-0 views onto their value
+            views.windborn_horizontal_source_left = read_only.windborn_horizontal_source_left.view();
+            views.windborn_horizontal_source_right = read_only.windborn_horizontal_source_right.view();
+            views.precipitation_source = read_only.precipitation_source.view();
+            views.snow_accumulation_mass = read_only.snow_accumulation_mass.view();
+            return views;
+        }
+
+        double kernel_bytes_per_cell(const Fields& fields)
+        {
+            double bytes = 3 * sizeof(float) + sizeof(std::uint8_t);
+            if (!fields.snow_transport_speed_x.is_uniform()) bytes += sizeof(float);
+            if (!fields.snow_transport_speed_y.is_uniform()) bytes += sizeof(float);
+            return bytes;
+        }
+
+        namespace
+        {
+            template <bool Simd>
+            void advect_snow_dispatch(const StepViews& fields, const Params& params, std::size_t j_begin, std::size_t j_end)
+            {
+                const bool uniform_x = fields.snow_transport_speed_x.empty();
+                const bool uniform_y = fields.snow_transport_speed_y.empty();
+                const UniformSpeed speed_x{ fields.uniform_speed_x };
+                const UniformSpeed speed_y{ fields.uniform_speed_y };
+                if (uniform_x && uniform_y) advect_snow_with<Simd>(fields, speed_x, speed_y, params, j_begin, j_end);
+                else if (uniform_x) advect_snow_with<Simd>(fields, speed_x, fields.snow_transport_speed_y, params, j_begin, j_end);
+                else if (uniform_y) advect_snow_with<Simd>(fields, fields.snow_transport_speed_x, speed_y, params, j_begin, j_end);
+                else advect_snow_with<Simd>(fields, fields.snow_transport_speed_x, fields.snow_transport_speed_y, params, j_begin, j_end);
+            }
+        } // namespace
+
+        bool simd_available()
+        {
+#ifdef SNOW_CPU_SSE2
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        void advect_snow(const StepViews& fields, const Params& params, bool simd)
+        {
+            advect_snow_rows(fields, params, 0, fields.snow_density.ny, simd);
+        }
+
+        void advect_snow_rows(const StepViews& fields, const Params& params, std::size_t j_begin, std::size_t j_end, bool simd)
+        {
+            j_end = std::min(j_end, fields.snow_density.ny);
+            if (j_begin >= j_end) return;
+
+            if (simd) advect_snow_dispatch<true>(fields, params, j_begin, j_end);
+            else advect_snow_dispatch<false>(fields, params, j_begin, j_end);
+        }
+
+        // Persistent band workers: run() hands every worker the same job and waits for all of them.
+        // Worker w runs job(w + 1); the caller runs job(0) itself.
+        struct CPUSimulation::Workers
+        {
+            explicit Workers(unsigned count)
+            {
+                threads.reserve(count);
+                for (unsigned w = 0; w < count; ++w)
+                {
+                    threads.emplace_back([this, w]
+                    {
+                        SNOW_PROFILE_THREAD("cpu worker " + std::to_string(w + 1));
+#if defined(__linux__)
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            thread_ids.push_back(static_cast<int>(syscall(SYS_gettid)));
+                        }
+                        started.notify_one();
+#endif
+                        work(w + 1);
+                    });
+                }
+#if defined(__linux__)
+                std::unique_lock<std::mutex> lock(mutex);
+                started.wait(lock, [this] { return thread_ids.size() == threads.size(); });
+#endif
+            }
+
+            ~Workers()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                wake.notify_all();
+                for (std::thread& thread : threads) thread.join();
+            }
+
+            void run(const std::function<void(std::size_t)>& band)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job = &band;
+                    pending = threads.size();
+                    ++generation;
+                }
+                wake.notify_all();
+                band(0);
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this] { return pending == 0; });
+                job = nullptr;
+            }
+
+            void work(std::size_t band_index)
+            {
+                std::uint64_t seen = 0;
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;)
+                {
+                    wake.wait(lock, [&] { return stopping || generation != seen; });
+                    if (stopping) return;
+                    seen = generation;
+                    const std::function<void(std::size_t)>* band = job;
+                    lock.unlock();
+                    (*band)(band_index);
+                    lock.lock();
+                    if (--pending == 0) done.notify_one();
+                }
+            }
+
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable done;
+            const std::function<void(std::size_t)>* job = nullptr;
+            std::uint64_t generation = 0;
+            std::size_t pending = 0;
+            bool stopping = false;
+            std::vector<std::thread> threads;
+            std::condition_variable started;
+            std::vector<int> thread_ids; // OS ids (Linux), filled in before the constructor returns
+        };
+
+        CPUSimulation::CPUSimulation(unsigned threads, bool simd) :
+            threads_(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+            simd_(simd && simd_available())
+        {
+            if (threads_ > 1) workers_ = std::make_unique<Workers>(threads_ - 1);
+        }
 
-                    density += (dt / dx) * (flux_left - flux_right);
-                    density += (dt / dy) * (flux_bottom - flux_top);
-                    density += dt * (left_sorce + right_sorce + top_sorce);
+        CPUSimulation::~CPUSimulation() = default;
+
+        std::vector<int> CPUSimulation::step_thread_ids() const
+        {
+            return workers_ ? workers_->thread_ids : std::vector<int>{};
+        }
+
+        void CPUSimulation::step(Fields& fields, const Params& params)
+        {
+            if (fields.next_snow_density.nx != fields.snow_density.nx || fields.next_snow_density.ny != fields.snow_density.ny //checks if sim sizes don't match. this should alwasy be flase.
+                || fields.next_snow_density.is_uniform()) // first step allocates the scratch buffer
+            {
+                fields.next_snow_density.resize(fields.snow_density.nx, fields.snow_density.ny, 0.0f);
+            }
+            // the step reads snow_density cell by cell and adds into snow_accumulation_mass
+            fields.snow_density.materialize();
+            fields.snow_accumulation_mass.materialize();
 
-                    fields.next_snow_density(i, j) = std::max(density, 0.0f);
+            const std::size_t nx = fields.snow_density.nx;
+            const std::size_t ny = fields.snow_density.ny;
+
+            // small grids are not worth waking the workers
+            const std::size_t min_cells_per_band = std::size_t{ 1 } << 14;
+            const std::size_t bands = std::min({ static_cast<std::size_t>(threads_), std::max<std::size_t>(ny, 1),
+                                                 std::max<std::size_t>(1, nx * ny / min_cells_per_band) });
+            band_deposit_.resize(bands);
+            for (std::vector<float>& deposit : band_deposit_) deposit.assign(nx, 0.0f);
+
+            const StepViews views = make_step_views(fields);
+            {
+                SNOW_PROFILE_SCOPE(advect);
+                if (bands == 1)
+                {
+                    StepViews band_views = views;
+                    band_views.column_deposit = Field1DView<float>(band_deposit_[0].data(), nx);
+                    advect_snow(band_views, params, simd_);
+                }
+                else
+                {
+                    const std::size_t rows_per_band = (ny + bands - 1) / bands;
+                    const std::function<void(std::size_t)> band = [&](std::size_t b)
+                    {
+                        if (b >= bands) return; // more workers than bands this step
+                        SNOW_PROFILE_SCOPE(advect_band);
+                        StepViews band_views = views;
+                        band_views.column_deposit = Field1DView<float>(band_deposit_[b].data(), nx);
+                        advect_snow_rows(band_views, params, b * rows_per_band, (b + 1) * rows_per_band, simd_);
+                    };
+                    workers_->run(band);
                 }
             }
 
-            std::swap(fields.snow_density, fields.next_snow_density);
+            {
+                SNOW_PROFILE_SCOPE(swap);
+                std::swap(fields.snow_density, fields.next_snow_density);
+            }
 
-            for (std::size_t i = 0; i < column_deposit.size(); ++i)
             {
-                if (fields.snow_accumulation_mass.in_bounds(i))
+                SNOW_PROFILE_SCOPE(deposit);
+                std::vector<float>& column_deposit = band_deposit_[0];
+                for (std::size_t b = 1; b < bands; ++b)
                 {
-                    fields.snow_accumulation_mass(i) += column_deposit[i];
+                    for (std::size_t i = 0; i < nx; ++i) column_deposit[i] += band_deposit_[b][i];
+                }
+                for (std::size_t i = 0; i < column_deposit.size(); ++i)
+                {
+                    if (fields.snow_accumulation_mass.in_bounds(i))
+                    {
+                        fields.snow_accumulation_mass(i) += column_deposit[i];
+                    }
                 }
             }
+
+            // settled snow raises the ground; only columns whose depth crossed a cell boundary touch air_mask.
+            SNOW_PROFILE_SCOPE(ground_update);
+            update_ground_from_accumulation(fields, params);
         }
 
     } // namespace cpu
@@ -0,0 +1,132 @@
+#include "equilibrium_monitor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "my_helper.hpp"
+
+namespace snow
+{
+
+EquilibriumMonitor::EquilibriumMonitor(const Params& params) :
+    tolerance_(params.equilibrium_tolerance),
+    sample_interval_(params.equilibrium_sample_interval),
+    stable_samples_required_(std::max<std::size_t>(params.equilibrium_stable_samples, 1)),
+    time_step_duration_(params.time_step_duration)
+{}
+
+bool EquilibriumMonitor::observe(const Fields& fields, long long steps_done)
+{
+    if (!enabled() || time_step_duration_ <= 0.0f) return false;
+    if (reached()) return true;
+    if (steps_done <= 0 || steps_done % static_cast<long long>(sample_interval_) != 0) return false;
+
+    const std::size_t nx = fields.snow_accumulation_mass.nx;
+
+    // first sample (or the grid changed under us): just remember the state.
+    if (samples_taken_ == 0 || density_sample_.data.size() != fields.snow_density.data.size() || accumulation_sample_.nx != nx)
+    {
+        density_sample_ = fields.snow_density;
+        accumulation_sample_ = fields.snow_accumulation_mass;
+        deposition_rate_.resize(nx, 0.0f);
+        last_sample_step_ = steps_done;
+        samples_taken_ = 1;
+        stable_samples_ = 0;
+        return false;
+    }
+
+    const float window_time = static_cast<float>(steps_done - last_sample_step_) * time_step_duration_;
+
+    // density: largest change over the window against the largest density, refreshing the sample in the same pass.
+    float max_density_change = 0.0f;
+    float max_density = 0.0f;
+    for (std::size_t k = 0; k < fields.snow_density.data.size(); ++k)
+    {
+        const float density = fields.snow_density.data[k];
+        max_density_change = std::max(max_density_change, std::fabs(density - density_sample_.data[k]));
+        max_density = std::max(max_density, std::fabs(density));
+        density_sample_.data[k] = density;
+    }
+    density_change_ = (max_density > 0.0f) ? max_density_change / max_density : 0.0f;
+
+    // deposition: per-column rate over this window against the previous window's rate.
+    const bool has_previous_rate = samples_taken_ >= 2;
+    float max_rate_change = 0.0f;
+    float max_rate = 0.0f;
+    total_deposition_rate_ = 0.0f;
+    for (std::size_t i = 0; i < nx; ++i)
+    {
+        const float rate = (fields.snow_accumulation_mass(i) - accumulation_sample_(i)) / window_time;
+        max_rate_change = std::max(max_rate_change, std::fabs(rate - deposition_rate_(i)));
+        max_rate = std::max(max_rate, std::fabs(rate));
+        deposition_rate_(i) = rate;
+        accumulation_sample_(i) = fields.snow_accumulation_mass(i);
+        total_deposition_rate_ += rate;
+    }
+    if (has_previous_rate)
+    {
+        deposition_change_ = (max_rate > 0.0f) ? max_rate_change / max_rate : 0.0f;
+    }
+    else
+    {
+        deposition_change_ = std::numeric_limits<float>::infinity(); // no previous window to compare with yet
+    }
+
+    ++samples_taken_;
+    last_sample_step_ = steps_done;
+
+    const bool stationary = density_change_ <= tolerance_ && deposition_change_ <= tolerance_;
+    stable_samples_ = stationary ? stable_samples_ + 1 : 0;
+    if (stable_samples_ >= stable_samples_required_)
+    {
+        equilibrium_step_ = steps_done;
+        return true;
+    }
+    return false;
+}
+
+void EquilibriumMonitor::extrapolate_accumulation(Fields& fields, const Params& params, float remaining_time) const
+{
+    if (remaining_time <= 0.0f) return;
+
+    for (std::size_t i = 0; i < fields.snow_accumulation_mass.nx && deposition_rate_.in_bounds(i); ++i)
+    {
+        fields.snow_accumulation_mass(i) = std::max(fields.snow_accumulation_mass(i) + deposition_rate_(i) * remaining_time, 0.0f);
+    }
+
+    // the extrapolated snowpack may cross cell boundaries, so bring the ground up to date.
+    update_ground_from_accumulation(fields, params);
+}
+
+EquilibriumMonitor::State EquilibriumMonitor::state() const
+{
+    State state;
+    state.density_sample = density_sample_;
+    state.accumulation_sample = accumulation_sample_;
+    state.deposition_rate = deposition_rate_;
+    state.last_sample_step = last_sample_step_;
+    state.samples_taken = samples_taken_;
+    state.stable_samples = stable_samples_;
+    state.equilibrium_step = equilibrium_step_;
+    state.density_change = density_change_;
+    state.deposition_change = deposition_change_;
+    state.total_deposition_rate = total_deposition_rate_;
+    return state;
+}
+
+void EquilibriumMonitor::restore(const State& state)
+{
+    density_sample_ = state.density_sample;
+    accumulation_sample_ = state.accumulation_sample;
+    deposition_rate_ = state.deposition_rate;
+    last_sample_step_ = state.last_sample_step;
+    samples_taken_ = state.samples_taken;
+    stable_samples_ = state.stable_samples;
+    equilibrium_step_ = state.equilibrium_step;
+    density_change_ = state.density_change;
+    deposition_change_ = state.deposition_change;
+    total_deposition_rate_ = state.total_deposition_rate;
+}
+
+} // namespace snow
@@ -0,0 +1,369 @@
+#include "field_archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace snow
+{
+
+namespace
+{
+    const char archive_magic[8] = { 'S', 'N', 'O', 'W', 'A', 'R', 'C', '1' };
+    const char archive_index_magic[8] = { 'S', 'N', 'O', 'W', 'A', 'R', 'C', 'I' };
+
+    struct ArchiveTrailer
+    {
+        char magic[8];
+        std::uint64_t nx;
+        std::uint64_t ny;
+        std::uint64_t tile_nx;
+        std::uint64_t tile_ny;
+        std::uint64_t time_block;
+        std::uint64_t frame_count;
+        std::uint64_t footer_offset;
+    };
+
+    static_assert(sizeof(ArchiveTrailer) == 64, "archive trailer must stay 64 bytes");
+
+    const std::size_t frame_record_bytes = sizeof(std::int64_t) + sizeof(double);
+    const std::size_t index_record_bytes = 2 * sizeof(std::uint64_t);
+
+    std::size_t div_up(std::size_t value, std::size_t divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+
+    template <typename T>
+    T load(const unsigned char* at)
+    {
+        T value;
+        std::memcpy(&value, at, sizeof(value));
+        return value;
+    }
+}
+
+bool ArchiveWriter::open(const std::string& path, std::size_t nx, std::size_t ny, ArchiveOptions options)
+{
+    if (nx == 0 || ny == 0 || options.tile_nx == 0 || options.tile_ny == 0 || options.time_block == 0)
+    {
+        std::cerr << "[field_archive] grid, tile and time block sizes must be positive\n";
+        return false;
+    }
+    stream_.open(path, std::ios::binary | std::ios::trunc);
+    if (!stream_)
+    {
+        std::cerr << "[field_archive] cannot create " << path << "\n";
+        return false;
+    }
+    path_ = path;
+    nx_ = nx;
+    ny_ = ny;
+    options_ = options;
+    block_.assign(options.time_block * nx * ny, 0.0f);
+    block_frames_ = 0;
+    steps_.clear();
+    times_.clear();
+    index_.clear();
+    stats_ = CodecStats{};
+
+    stream_.write(archive_magic, sizeof(archive_magic));
+    offset_ = sizeof(archive_magic);
+    return static_cast<bool>(stream_);
+}
+
+bool ArchiveWriter::append(long long step, double time, Field2DView<const float> field)
+{
+    if (!stream_.is_open()) return false;
+    if (field.nx != nx_ || field.ny != ny_)
+    {
+        std::cerr << "[field_archive] frame is " << field.nx << " x " << field.ny << ", archive is " << nx_ << " x " << ny_ << "\n";
+        return false;
+    }
+
+    float* frame = block_.data() + block_frames_ * nx_ * ny_;
+    for (std::size_t j = 0; j < ny_; ++j)
+    {
+        std::copy(field.row(j), field.row(j) + nx_, frame + j * nx_);
+    }
+    steps_.push_back(step);
+    times_.push_back(time);
+    ++block_frames_;
+    return block_frames_ < options_.time_block || flush_block();
+}
+
+bool ArchiveWriter::append(long long step, double time, const Field2D<float>& field)
+{
+    return append(step, time, field.view());
+}
+
+bool ArchiveWriter::flush_block()
+{
+    if (block_frames_ == 0) return true;
+
+    FieldCodecOptions codec_options;
+    codec_options.error_bound = options_.error_bound;
+    codec_options.keyframe_interval = 0; // each chunk starts a fresh encoder, so only its first frame is a keyframe
+
+    for (std::size_t tile_y0 = 0; tile_y0 < ny_; tile_y0 += options_.tile_ny)
+    {
+        const std::size_t tile_h = std::min(options_.tile_ny, ny_ - tile_y0);
+        for (std::size_t tile_x0 = 0; tile_x0 < nx_; tile_x0 += options_.tile_nx)
+        {
+            const std::size_t tile_w = std::min(options_.tile_nx, nx_ - tile_x0);
+            FieldEncoder encoder(codec_options);
+            chunk_.clear();
+            tile_.resize(tile_w * tile_h);
+            for (std::size_t f = 0; f < block_frames_; ++f)
+            {
+                const float* frame = block_.data() + f * nx_ * ny_;
+                for (std::size_t j = 0; j < tile_h; ++j)
+                {
+                    const float* row = frame + (tile_y0 + j) * nx_ + tile_x0;
+                    std::copy(row, row + tile_w, tile_.data() + j * tile_w);
+                }
+                encoder.encode(tile_.data(), tile_w, tile_h, chunk_);
+            }
+
+            stream_.write(reinterpret_cast<const char*>(chunk_.data()), static_cast<std::streamsize>(chunk_.size()));
+            index_.push_back(offset_);
+            index_.push_back(chunk_.size());
+            offset_ += chunk_.size();
+
+            stats_.frames += encoder.stats().frames;
+            stats_.raw_bytes += encoder.stats().raw_bytes;
+            stats_.encoded_bytes += encoder.stats().encoded_bytes;
+            stats_.encode_seconds += encoder.stats().encode_seconds;
+        }
+    }
+    block_frames_ = 0;
+    if (!stream_)
+    {
+        std::cerr << "[field_archive] write to " << path_ << " failed\n";
+        return false;
+    }
+    return true;
+}
+
+bool ArchiveWriter::close()
+{
+    if (!stream_.is_open()) return true;
+
+    bool ok = flush_block();
+
+    const std::uint64_t footer_offset = offset_;
+    for (std::size_t k = 0; k < steps_.size(); ++k)
+    {
+        stream_.write(reinterpret_cast<const char*>(&steps_[k]), sizeof(steps_[k]));
+        stream_.write(reinterpret_cast<const char*>(&times_[k]), sizeof(times_[k]));
+    }
+    stream_.write(reinterpret_cast<const char*>(index_.data()), static_cast<std::streamsize>(index_.size() * sizeof(std::uint64_t)));
+
+    ArchiveTrailer trailer;
+    std::memcpy(trailer.magic, archive_index_magic, sizeof(trailer.magic));
+    trailer.nx = nx_;
+    trailer.ny = ny_;
+    trailer.tile_nx = options_.tile_nx;
+    trailer.tile_ny = options_.tile_ny;
+    trailer.time_block = options_.time_block;
+    trailer.frame_count = steps_.size();
+    trailer.footer_offset = footer_offset;
+    stream_.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+
+    stream_.close();
+    ok = ok && !stream_.fail();
+    if (!ok) std::cerr << "[field_archive] failed to finish " << path_ << "\n";
+    block_.clear();
+    block_.shrink_to_fit();
+    return ok;
+}
+
+bool ArchiveReader::open(const std::string& path)
+{
+    close();
+    path_ = path;
+    if (!file_.open(path)) return false;
+
+    const unsigned char* base = file_.data();
+    const std::size_t size = file_.size();
+    if (size < sizeof(archive_magic) + sizeof(ArchiveTrailer) || std::memcmp(base, archive_magic, sizeof(archive_magic)) != 0)
+    {
+        std::cerr << "[field_archive] " << path << " is not a field archive\n";
+        close();
+        return false;
+    }
+
+    ArchiveTrailer trailer;
+    std::memcpy(&trailer, base + size - sizeof(trailer), sizeof(trailer));
+    const bool shape_ok = std::memcmp(trailer.magic, archive_index_magic, sizeof(trailer.magic)) == 0
+                          && trailer.nx > 0 && trailer.ny > 0 && trailer.tile_nx > 0 && trailer.tile_ny > 0 && trailer.time_block > 0
+                          && trailer.footer_offset >= sizeof(archive_magic) && trailer.footer_offset <= size - sizeof(trailer);
+    if (!shape_ok)
+    {
+        std::cerr << "[field_archive] " << path << " has a damaged index\n";
+        close();
+        return false;
+    }
+
+    nx_ = static_cast<std::size_t>(trailer.nx);
+    ny_ = static_cast<std::size_t>(trailer.ny);
+    tile_nx_ = static_cast<std::size_t>(trailer.tile_nx);
+    tile_ny_ = static_cast<std::size_t>(trailer.tile_ny);
+    time_block_ = static_cast<std::size_t>(trailer.time_block);
+    frame_count_ = static_cast<std::size_t>(trailer.frame_count);
+    tiles_x_ = div_up(nx_, tile_nx_);
+    tiles_y_ = div_up(ny_, tile_ny_);
+    const std::size_t footer_offset = static_cast<std::size_t>(trailer.footer_offset);
+    const std::size_t footer_bytes = size - sizeof(trailer) - footer_offset;
+
+    // bound every count by the footer before multiplying, so that damaged counts cannot wrap around to
+    // a product that happens to match the file size.
+    bool counts_ok = tiles_x_ > 0 && tiles_y_ > 0 && frame_count_ <= footer_bytes / frame_record_bytes;
+    std::size_t chunk_count = 0;
+    if (counts_ok && frame_count_ > 0)
+    {
+        const std::size_t index_capacity = (footer_bytes - frame_count_ * frame_record_bytes) / index_record_bytes;
+        const std::size_t time_blocks = div_up(frame_count_, time_block_);
+        counts_ok = tiles_x_ <= index_capacity && tiles_y_ <= index_capacity / tiles_x_
+                    && time_blocks <= index_capacity / (tiles_x_ * tiles_y_);
+        if (counts_ok) chunk_count = time_blocks * tiles_x_ * tiles_y_;
+    }
+    if (!counts_ok || frame_count_ * frame_record_bytes + chunk_count * index_record_bytes != footer_bytes)
+    {
+        std::cerr << "[field_archive] " << path << ": index does not match the file size\n";
+        close();
+        return false;
+    }
+    frame_table_ = base + footer_offset;
+    index_ = frame_table_ + frame_count_ * frame_record_bytes;
+
+    for (std::size_t c = 0; c < chunk_count; ++c)
+    {
+        const std::uint64_t offset = load<std::uint64_t>(index_ + c * index_record_bytes);
+        const std::uint64_t bytes = load<std::uint64_t>(index_ + c * index_record_bytes + sizeof(std::uint64_t));
+        if (offset < sizeof(archive_magic) || offset > footer_offset || bytes > footer_offset - offset)
+        {
+            std::cerr << "[field_archive] " << path << ": chunk " << c << " lies outside the data section\n";
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ArchiveReader::close()
+{
+    file_.close();
+    nx_ = ny_ = 0;
+    frame_count_ = 0;
+    frame_table_ = nullptr;
+    index_ = nullptr;
+}
+
+long long ArchiveReader::frame_step(std::size_t frame) const
+{
+    return static_cast<long long>(load<std::int64_t>(frame_table_ + frame * frame_record_bytes));
+}
+
+double ArchiveReader::frame_time(std::size_t frame) const
+{
+    return load<double>(frame_table_ + frame * frame_record_bytes + sizeof(std::int64_t));
+}
+
+bool ArchiveReader::read(double t_min, double t_max,
+                         std::ptrdiff_t x_min, std::ptrdiff_t x_max,
+                         std::ptrdiff_t y_min, std::ptrdiff_t y_max,
+                         ArchiveRegion& region)
+{
+    region = ArchiveRegion{};
+    last_chunks_read_ = 0;
+    if (!file_.is_open()) return false;
+
+    // same bound handling as print_field_subregion
+    const std::ptrdiff_t max_x_index = static_cast<std::ptrdiff_t>(nx_ - 1);
+    const std::ptrdiff_t max_y_index = static_cast<std::ptrdiff_t>(ny_ - 1);
+    const std::size_t x_lower = static_cast<std::size_t>(std::clamp(std::min(x_min, x_max), std::ptrdiff_t{ 0 }, max_x_index));
+    const std::size_t x_upper = static_cast<std::size_t>(std::clamp(std::max(x_min, x_max), std::ptrdiff_t{ 0 }, max_x_index));
+    const std::size_t y_lower = static_cast<std::size_t>(std::clamp(std::min(y_min, y_max), std::ptrdiff_t{ 0 }, max_y_index));
+    const std::size_t y_upper = static_cast<std::size_t>(std::clamp(std::max(y_min, y_max), std::ptrdiff_t{ 0 }, max_y_index));
+    const std::size_t box_w = x_upper - x_lower + 1;
+    const std::size_t box_h = y_upper - y_lower + 1;
+    region.x_min = x_lower;
+    region.y_min = y_lower;
+
+    // frames are appended in time order
+    std::size_t first = 0;
+    while (first < frame_count_ && frame_time(first) < t_min) ++first;
+    std::size_t last = first;
+    while (last < frame_count_ && frame_time(last) <= t_max) ++last;
+    if (first == last) return true;
+
+    for (std::size_t k = first; k < last; ++k)
+    {
+        region.steps.push_back(frame_step(k));
+        region.times.push_back(frame_time(k));
+        region.frames.emplace_back(box_w, box_h, 0.0f);
+    }
+
+    Field2D<float> tile;
+    for (std::size_t block = first / time_block_; block <= (last - 1) / time_block_; ++block)
+    {
+        const std::size_t block_start = block * time_block_;
+        const std::size_t block_frames = std::min(time_block_, frame_count_ - block_start);
+        // a chunk is delta coded, so it is decoded from its keyframe up to the last wanted frame
+        const std::size_t decode_frames = std::min(block_frames, last - block_start);
+
+        for (std::size_t tj = y_lower / tile_ny_; tj <= y_upper / tile_ny_; ++tj)
+        {
+            for (std::size_t ti = x_lower / tile_nx_; ti <= x_upper / tile_nx_; ++ti)
+            {
+                const std::size_t chunk = (block * tiles_y_ + tj) * tiles_x_ + ti;
+                const std::size_t offset = static_cast<std::size_t>(load<std::uint64_t>(index_ + chunk * index_record_bytes));
+                const std::size_t chunk_end = offset + static_cast<std::size_t>(load<std::uint64_t>(
+                                                           index_ + chunk * index_record_bytes + sizeof(std::uint64_t)));
+                const std::size_t tile_x0 = ti * tile_nx_;
+                const std::size_t tile_y0 = tj * tile_ny_;
+                const std::size_t tile_w = std::min(tile_nx_, nx_ - tile_x0);
+                const std::size_t tile_h = std::min(tile_ny_, ny_ - tile_y0);
+                ++last_chunks_read_;
+
+                FieldDecoder decoder;
+                std::size_t at = offset;
+                for (std::size_t f = 0; f < decode_frames; ++f)
+                {
+                    // frames stay inside their chunk, and the tile size is checked before decode allocates for it
+                    const std::uint8_t* frame = file_.data() + at;
+                    const bool has_header = at + field_frame_header_bytes <= chunk_end;
+                    const std::size_t frame_bytes = has_header ? field_frame_bytes(frame) : 0;
+                    std::size_t frame_nx = 0;
+                    std::size_t frame_ny = 0;
+                    if (frame_bytes == 0 || frame_bytes > chunk_end - at || !field_frame_shape(frame, frame_nx, frame_ny)
+                        || frame_nx != tile_w || frame_ny != tile_h || !decoder.decode(frame, frame_bytes, tile))
+                    {
+                        std::cerr << "[field_archive] " << path_ << ": chunk " << chunk << " is damaged\n";
+                        return false;
+                    }
+                    at += frame_bytes;
+
+                    const std::size_t k = block_start + f;
+                    if (k < first) continue;
+
+                    // overlap of this tile with the box
+                    const std::size_t x0 = std::max(x_lower, tile_x0);
+                    const std::size_t x1 = std::min(x_upper, tile_x0 + tile_w - 1);
+                    const std::size_t y0 = std::max(y_lower, tile_y0);
+                    const std::size_t y1 = std::min(y_upper, tile_y0 + tile_h - 1);
+                    Field2D<float>& out = region.frames[k - first];
+                    for (std::size_t y = y0; y <= y1; ++y)
+                    {
+                        const float* row = tile.data.data() + (y - tile_y0) * tile_w + (x0 - tile_x0);
+                        std::copy(row, row + (x1 - x0 + 1), out.data.data() + (y - y_lower) * box_w + (x0 - x_lower));
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace snow
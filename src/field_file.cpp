@@ -0,0 +1,326 @@
+#include "field_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+namespace snow
+{
+
+namespace
+{
+    const char field_file_magic[8] = { 'S', 'N', 'O', 'W', 'F', 'L', 'D', '1' };
+    const std::uint32_t field_file_version = 1;
+    const std::size_t field_file_alignment = 64;
+
+    struct RawHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entry_count;
+        unsigned char reserved[48];
+    };
+
+    struct RawEntry
+    {
+        char name[64];
+        std::uint32_t dtype;
+        std::uint32_t reserved0;
+        std::uint64_t nx;
+        std::uint64_t ny;
+        std::uint64_t pitch;
+        std::uint64_t offset;
+        unsigned char reserved1[24];
+    };
+
+    static_assert(sizeof(RawHeader) == 64, "field file header must stay 64 bytes");
+    static_assert(sizeof(RawEntry) == 128, "field file entry must stay 128 bytes");
+
+    std::size_t dtype_size(FieldDType dtype)
+    {
+        return dtype == FieldDType::u8 ? sizeof(std::uint8_t) : sizeof(float);
+    }
+
+    bool dtype_known(std::uint32_t dtype)
+    {
+        return dtype == static_cast<std::uint32_t>(FieldDType::f32) || dtype == static_cast<std::uint32_t>(FieldDType::u8);
+    }
+
+    std::size_t align_up(std::size_t value)
+    {
+        return (value + field_file_alignment - 1) / field_file_alignment * field_file_alignment;
+    }
+
+    // pitch * ny elements of element bytes fit in available bytes, without computing the product.
+    bool array_fits(std::size_t pitch, std::size_t ny, std::size_t element, std::size_t available)
+    {
+        if (pitch == 0 || ny == 0) return true;
+        return ny <= available / element / pitch;
+    }
+
+    // Row pitch in elements such that every row starts on an aligned boundary.
+    std::size_t aligned_pitch(std::size_t nx, FieldDType dtype)
+    {
+        const std::size_t element = dtype_size(dtype);
+        return align_up(nx * element) / element;
+    }
+
+    template <typename T>
+    constexpr FieldDType dtype_of();
+
+    template <>
+    constexpr FieldDType dtype_of<float>() { return FieldDType::f32; }
+
+    template <>
+    constexpr FieldDType dtype_of<std::uint8_t>() { return FieldDType::u8; }
+
+    template <typename T, typename Field>
+    void copy_rows(const Field2DView<const T>& view, Field& data_out)
+    {
+        for (std::size_t j = 0; j < view.ny; ++j)
+        {
+            std::memcpy(data_out.data() + j * view.nx, view.row(j), view.nx * sizeof(T));
+        }
+    }
+}
+
+FieldFileSource field_file_source(const std::string& name, Field2DView<const float> field)
+{
+    return FieldFileSource{ name, FieldDType::f32, field.nx, field.ny, field.pitch, field.data };
+}
+
+FieldFileSource field_file_source(const std::string& name, Field2DView<const std::uint8_t> field)
+{
+    return FieldFileSource{ name, FieldDType::u8, field.nx, field.ny, field.pitch, field.data };
+}
+
+FieldFileSource field_file_source(const std::string& name, const Field2D<float>& field)
+{
+    if (field.is_uniform()) return FieldFileSource{ name, FieldDType::f32, field.nx, field.ny, field.nx, &*field.uniform_value, true };
+    return field_file_source(name, field.view());
+}
+
+FieldFileSource field_file_source(const std::string& name, const Field2D<std::uint8_t>& field)
+{
+    if (field.is_uniform()) return FieldFileSource{ name, FieldDType::u8, field.nx, field.ny, field.nx, &*field.uniform_value, true };
+    return field_file_source(name, field.view());
+}
+
+FieldFileSource field_file_source(const std::string& name, const Field1D<float>& field)
+{
+    if (field.is_uniform()) return FieldFileSource{ name, FieldDType::f32, field.nx, 1, field.nx, &*field.uniform_value, true };
+    return FieldFileSource{ name, FieldDType::f32, field.nx, 1, field.nx, field.data.data() };
+}
+
+bool write_field_file(const std::string& path, const std::vector<FieldFileSource>& sources)
+{
+    std::set<std::string> names;
+    for (const FieldFileSource& source : sources)
+    {
+        if (source.name.empty() || source.name.size() >= sizeof(RawEntry::name) || !names.insert(source.name).second)
+        {
+            std::cerr << "[field_file] bad or duplicate array name '" << source.name << "'\n";
+            return false;
+        }
+        if (source.nx * source.ny > 0 && (source.data == nullptr || source.pitch < source.nx)) return false;
+    }
+
+    // lay out the arrays after the entry table, each row padded to the alignment.
+    std::vector<RawEntry> raw_entries(sources.size());
+    std::size_t offset = align_up(sizeof(RawHeader) + sources.size() * sizeof(RawEntry));
+    for (std::size_t k = 0; k < sources.size(); ++k)
+    {
+        const FieldFileSource& source = sources[k];
+        RawEntry& entry = raw_entries[k];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, source.name.data(), source.name.size());
+        entry.dtype = static_cast<std::uint32_t>(source.dtype);
+        entry.nx = source.nx;
+        entry.ny = source.ny;
+        entry.pitch = aligned_pitch(source.nx, source.dtype);
+        entry.offset = offset;
+        offset += static_cast<std::size_t>(entry.pitch * entry.ny) * dtype_size(source.dtype);
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream)
+    {
+        std::cerr << "[field_file] cannot write " << path << "\n";
+        return false;
+    }
+
+    RawHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, field_file_magic, sizeof(field_file_magic));
+    header.version = field_file_version;
+    header.entry_count = static_cast<std::uint32_t>(sources.size());
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!raw_entries.empty())
+    {
+        stream.write(reinterpret_cast<const char*>(raw_entries.data()), static_cast<std::streamsize>(raw_entries.size() * sizeof(RawEntry)));
+    }
+
+    const std::vector<char> padding(field_file_alignment, 0);
+    for (std::size_t k = 0; k < sources.size(); ++k)
+    {
+        const FieldFileSource& source = sources[k];
+        const RawEntry& entry = raw_entries[k];
+        const std::size_t element = dtype_size(source.dtype);
+        const std::size_t row_bytes = source.nx * element;
+        const std::size_t pitch_bytes = static_cast<std::size_t>(entry.pitch) * element;
+
+        const std::streamoff position = stream.tellp();
+        if (position < static_cast<std::streamoff>(entry.offset))
+        {
+            stream.write(padding.data(), static_cast<std::streamsize>(entry.offset - static_cast<std::size_t>(position)));
+        }
+        const char* bytes = static_cast<const char*>(source.data);
+        std::vector<char> uniform_row;
+        if (source.uniform)
+        {
+            // one row of the value, written for every row
+            uniform_row.resize(row_bytes);
+            for (std::size_t i = 0; i < source.nx; ++i) std::memcpy(uniform_row.data() + i * element, bytes, element);
+        }
+        for (std::size_t j = 0; j < source.ny; ++j)
+        {
+            stream.write(source.uniform ? uniform_row.data() : bytes + j * source.pitch * element, static_cast<std::streamsize>(row_bytes));
+            stream.write(padding.data(), static_cast<std::streamsize>(pitch_bytes - row_bytes));
+        }
+    }
+    return static_cast<bool>(stream);
+}
+
+bool write_fields_file(const std::string& path, const Fields& fields)
+{
+    return write_field_file(path, {
+        field_file_source("air_mask", fields.air_mask),
+        field_file_source("snow_density", fields.snow_density),
+        field_file_source("snow_transport_speed_x", fields.snow_transport_speed_x),
+        field_file_source("snow_transport_speed_y", fields.snow_transport_speed_y),
+        field_file_source("snow_accumulation_mass", fields.snow_accumulation_mass),
+        field_file_source("snow_accumulation_density", fields.snow_accumulation_density),
+        field_file_source("precipitation_source", fields.precipitation_source),
+        field_file_source("windborn_horizontal_source_left", fields.windborn_horizontal_source_left),
+        field_file_source("windborn_horizontal_source_right", fields.windborn_horizontal_source_right)
+    });
+}
+
+MappedFieldFile::~MappedFieldFile()
+{
+    close();
+}
+
+bool MappedFieldFile::open(const std::string& path)
+{
+    close();
+
+    if (!file_.open(path)) return false;
+    base_ = file_.data();
+    size_ = file_.size();
+    if (size_ < sizeof(RawHeader))
+    {
+        std::cerr << "[field_file] " << path << " is too small to be a field file\n";
+        close();
+        return false;
+    }
+
+    RawHeader header;
+    std::memcpy(&header, base_, sizeof(header));
+    const std::size_t table_end = sizeof(RawHeader) + static_cast<std::size_t>(header.entry_count) * sizeof(RawEntry);
+    if (std::memcmp(header.magic, field_file_magic, sizeof(field_file_magic)) != 0 || header.version != field_file_version || table_end > size_)
+    {
+        std::cerr << "[field_file] " << path << " is not a version " << field_file_version << " field file\n";
+        close();
+        return false;
+    }
+
+    entries_.reserve(header.entry_count);
+    for (std::uint32_t k = 0; k < header.entry_count; ++k)
+    {
+        RawEntry raw;
+        std::memcpy(&raw, base_ + sizeof(RawHeader) + k * sizeof(RawEntry), sizeof(raw));
+        raw.name[sizeof(raw.name) - 1] = '\0';
+
+        FieldFileEntry entry;
+        entry.name = raw.name;
+        entry.dtype = static_cast<FieldDType>(raw.dtype);
+        entry.nx = static_cast<std::size_t>(raw.nx);
+        entry.ny = static_cast<std::size_t>(raw.ny);
+        entry.pitch = static_cast<std::size_t>(raw.pitch);
+        entry.offset = static_cast<std::size_t>(raw.offset);
+
+        // every array must sit inside the file, after the table and on an element boundary. The offset is
+        // checked before size_ - offset, and pitch * ny * element is compared by division so that damaged
+        // sizes cannot wrap around into a small, accepted value.
+        const bool layout_ok = dtype_known(raw.dtype)
+            && entry.pitch >= entry.nx
+            && entry.offset >= table_end
+            && entry.offset <= size_
+            && entry.offset % dtype_size(entry.dtype) == 0
+            && array_fits(entry.pitch, entry.ny, dtype_size(entry.dtype), size_ - entry.offset);
+        if (!layout_ok)
+        {
+            std::cerr << "[field_file] " << path << ": array '" << entry.name << "' does not fit the file\n";
+            close();
+            return false;
+        }
+        entries_.push_back(std::move(entry));
+    }
+    return true;
+}
+
+void MappedFieldFile::close()
+{
+    file_.close();
+    base_ = nullptr;
+    size_ = 0;
+    entries_.clear();
+}
+
+const FieldFileEntry* MappedFieldFile::find(const std::string& name) const
+{
+    const auto entry = std::find_if(entries_.begin(), entries_.end(), [&name](const FieldFileEntry& e) { return e.name == name; });
+    return entry == entries_.end() ? nullptr : &*entry;
+}
+
+template <typename T>
+Field2DView<const T> MappedFieldFile::view(const std::string& name) const
+{
+    const FieldFileEntry* entry = find(name);
+    if (!entry || entry->dtype != dtype_of<T>()) return Field2DView<const T>{};
+    return Field2DView<const T>(reinterpret_cast<const T*>(base_ + entry->offset), entry->nx, entry->ny, entry->pitch);
+}
+
+template Field2DView<const float> MappedFieldFile::view<float>(const std::string& name) const;
+template Field2DView<const std::uint8_t> MappedFieldFile::view<std::uint8_t>(const std::string& name) const;
+
+void copy_mapped_field(const Field2DView<const float>& view, Field2D<float>& field)
+{
+    field.nx = view.nx;
+    field.ny = view.ny;
+    field.data.resize(view.nx * view.ny);
+    field.uniform_value.reset();
+    copy_rows(view, field.data);
+}
+
+void copy_mapped_field(const Field2DView<const std::uint8_t>& view, Field2D<std::uint8_t>& field)
+{
+    field.nx = view.nx;
+    field.ny = view.ny;
+    field.data.resize(view.nx * view.ny);
+    field.uniform_value.reset();
+    copy_rows(view, field.data);
+}
+
+void copy_mapped_field(const Field2DView<const float>& view, Field1D<float>& field)
+{
+    field.nx = view.nx;
+    field.data.resize(view.nx);
+    field.uniform_value.reset();
+    if (view.ny > 0) std::memcpy(field.data.data(), view.row(0), view.nx * sizeof(float));
+}
+
+} // namespace snow
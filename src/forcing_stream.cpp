@@ -0,0 +1,418 @@
+#include "forcing_stream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+#include "profiler.hpp"
+
+namespace snow
+{
+
+namespace
+{
+    const char forcing_magic[8] = { 'S', 'N', 'O', 'W', 'F', 'R', 'C', '1' };
+    const std::uint32_t forcing_version = 1;
+
+    template <typename T>
+    void write_value(std::ostream& stream, const T& value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool read_value(std::istream& stream, T& value)
+    {
+        return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    void write_header(std::ostream& stream, std::uint32_t profile_cells, std::uint64_t record_count)
+    {
+        stream.write(forcing_magic, sizeof(forcing_magic));
+        write_value(stream, forcing_version);
+        write_value(stream, profile_cells);
+        write_value(stream, record_count);
+    }
+
+    void write_record(std::ostream& stream, const ForcingRecord& record)
+    {
+        write_value(stream, record.time);
+        write_value(stream, record.precipitation_rate);
+        write_value(stream, record.wind_speed);
+        write_value(stream, record.settling_speed);
+        if (!record.precipitation_profile.empty())
+        {
+            stream.write(reinterpret_cast<const char*>(record.precipitation_profile.data()),
+                         static_cast<std::streamsize>(record.precipitation_profile.size() * sizeof(float)));
+        }
+    }
+
+    bool read_record(std::istream& stream, std::uint32_t profile_cells, ForcingRecord& record)
+    {
+        if (!read_value(stream, record.time)) return false;
+        if (!read_value(stream, record.precipitation_rate)) return false;
+        if (!read_value(stream, record.wind_speed)) return false;
+        if (!read_value(stream, record.settling_speed)) return false;
+        record.precipitation_profile.resize(profile_cells);
+        if (profile_cells > 0)
+        {
+            return static_cast<bool>(stream.read(reinterpret_cast<char*>(record.precipitation_profile.data()),
+                                                 static_cast<std::streamsize>(profile_cells * sizeof(float))));
+        }
+        return true;
+    }
+
+    // parses one CSV row into values; false when a cell is not a number.
+    bool parse_csv_row(const std::string& line, std::vector<double>& values)
+    {
+        values.clear();
+        std::stringstream row(line);
+        std::string cell;
+        while (std::getline(row, cell, ','))
+        {
+            char* end = nullptr;
+            const double value = std::strtod(cell.c_str(), &end);
+            if (end == cell.c_str()) return false;
+            values.push_back(value);
+        }
+        return !values.empty();
+    }
+
+    // Writes the CSV rows as a forcing series into binary; false (with a message) on a bad row.
+    bool convert_csv_rows(std::istream& csv, const std::string& csv_path, std::ostream& binary)
+    {
+        // the record count is patched into the header once every row has been written.
+        write_header(binary, 0, 0);
+
+        std::string line;
+        std::vector<double> values;
+        ForcingRecord record;
+        std::uint64_t record_count = 0;
+        std::size_t columns = 0;
+        std::size_t line_number = 0;
+        double last_time = 0.0;
+        while (std::getline(csv, line))
+        {
+            ++line_number;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (!parse_csv_row(line, values))
+            {
+                if (record_count == 0 && line_number == 1) continue; // header line
+                std::cerr << "[forcing] " << csv_path << ":" << line_number << ": non-numeric value\n";
+                return false;
+            }
+            if (columns == 0) columns = values.size();
+            if (values.size() < 4 || values.size() != columns)
+            {
+                std::cerr << "[forcing] " << csv_path << ":" << line_number << ": expected " << std::max<std::size_t>(columns, 4) << " columns\n";
+                return false;
+            }
+            if (record_count > 0 && values[0] < last_time)
+            {
+                std::cerr << "[forcing] " << csv_path << ":" << line_number << ": time goes backwards\n";
+                return false;
+            }
+
+            record.time = values[0];
+            record.precipitation_rate = static_cast<float>(values[1]);
+            record.wind_speed = static_cast<float>(values[2]);
+            record.settling_speed = static_cast<float>(values[3]);
+            record.precipitation_profile.assign(values.begin() + 4, values.end());
+            write_record(binary, record);
+
+            last_time = record.time;
+            ++record_count;
+        }
+
+        binary.seekp(0);
+        write_header(binary, static_cast<std::uint32_t>(columns > 4 ? columns - 4 : 0), record_count);
+        return static_cast<bool>(binary);
+    }
+
+    bool is_constant(const Field2D<float>& field)
+    {
+        if (field.is_uniform() || field.data.empty()) return true;
+        return std::all_of(field.data.begin(), field.data.end(), [&field](float v) { return v == field.data.front(); });
+    }
+
+    // CFL number of a uniform speed across cells of size cell
+    float cfl(float speed, const Params& params, float cell)
+    {
+        return std::fabs(speed) * params.time_step_duration / cell;
+    }
+}
+
+bool write_forcing_binary(const std::string& path, const std::vector<ForcingRecord>& records)
+{
+    const std::uint32_t profile_cells = records.empty() ? 0u : static_cast<std::uint32_t>(records.front().precipitation_profile.size());
+    for (const ForcingRecord& record : records)
+    {
+        if (record.precipitation_profile.size() != profile_cells) return false; // every record needs the same profile width
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) return false;
+
+    write_header(stream, profile_cells, records.size());
+    for (const ForcingRecord& record : records)
+    {
+        write_record(stream, record);
+    }
+    return static_cast<bool>(stream);
+}
+
+bool convert_forcing_csv_to_binary(const std::string& csv_path, const std::string& binary_path)
+{
+    std::ifstream csv(csv_path);
+    if (!csv)
+    {
+        std::cerr << "[forcing] cannot open " << csv_path << "\n";
+        return false;
+    }
+
+    // convert next to the target and rename on success, so a failed or interrupted conversion never
+    // leaves a series that looks valid behind.
+    const std::string temporary_path = binary_path + ".tmp";
+    std::ofstream binary(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!binary)
+    {
+        std::cerr << "[forcing] cannot write " << temporary_path << "\n";
+        return false;
+    }
+    bool converted = convert_csv_rows(csv, csv_path, binary);
+    binary.close();
+    converted = converted && !binary.fail();
+
+    std::error_code error;
+    if (converted) std::filesystem::rename(temporary_path, binary_path, error);
+    if (!converted || error)
+    {
+        if (error) std::cerr << "[forcing] cannot replace " << binary_path << ": " << error.message() << "\n";
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+    return true;
+}
+
+ForcingStream::~ForcingStream()
+{
+    close();
+}
+
+bool ForcingStream::open(const std::string& path, std::size_t prefetch_records)
+{
+    close();
+
+    std::string binary_path = path;
+    const bool is_csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (is_csv)
+    {
+        // convert once; later runs reuse the binary until the CSV is edited (newer than the binary).
+        binary_path = path + ".bin";
+        std::error_code csv_error;
+        std::error_code binary_error;
+        const auto csv_time = std::filesystem::last_write_time(path, csv_error);
+        const auto binary_time = std::filesystem::last_write_time(binary_path, binary_error);
+        const bool stale = binary_error || (!csv_error && csv_time > binary_time);
+        if (stale && !convert_forcing_csv_to_binary(path, binary_path)) return false;
+    }
+
+    file_.open(binary_path, std::ios::binary);
+    if (!file_)
+    {
+        std::cerr << "[forcing] cannot open " << binary_path << "\n";
+        return false;
+    }
+
+    char magic[sizeof(forcing_magic)] = {};
+    std::uint32_t version = 0;
+    file_.read(magic, sizeof(magic));
+    if (!file_ || std::memcmp(magic, forcing_magic, sizeof(magic)) != 0
+        || !read_value(file_, version) || version != forcing_version
+        || !read_value(file_, profile_cells_) || !read_value(file_, record_count_))
+    {
+        std::cerr << "[forcing] " << binary_path << " is not a version " << forcing_version << " forcing series\n";
+        file_.close();
+        return false;
+    }
+
+    capacity_ = std::max<std::size_t>(prefetch_records, 2);
+    queue_.clear();
+    reader_done_ = false;
+    stop_ = false;
+    has_before_ = false;
+    has_after_ = false;
+    stall_seconds_ = 0.0;
+    reader_ = std::thread(&ForcingStream::reader_loop, this);
+    return true;
+}
+
+void ForcingStream::close()
+{
+    if (reader_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        not_full_.notify_all();
+        reader_.join();
+    }
+    if (file_.is_open()) file_.close();
+    queue_.clear();
+}
+
+void ForcingStream::reader_loop()
+{
+    SNOW_PROFILE_THREAD("forcing reader");
+    for (std::uint64_t n = 0; n < record_count_; ++n)
+    {
+        // read outside the lock so the consumer never waits on disk I/O it does not need yet.
+        ForcingRecord record;
+        bool read = false;
+        {
+            SNOW_PROFILE_SCOPE(forcing_read);
+            read = read_record(file_, profile_cells_, record);
+        }
+        if (!read)
+        {
+            std::cerr << "[forcing] series truncated after " << n << " of " << record_count_ << " records\n";
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return stop_ || queue_.size() < capacity_; });
+        if (stop_) return;
+        queue_.push_back(std::move(record));
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    reader_done_ = true;
+    not_empty_.notify_all();
+}
+
+bool ForcingStream::next_record(ForcingRecord& out)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (queue_.empty() && !reader_done_)
+    {
+        SNOW_PROFILE_SCOPE(forcing_wait);
+        const auto wait_start = std::chrono::steady_clock::now();
+        not_empty_.wait(lock, [this] { return !queue_.empty() || reader_done_; });
+        stall_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+    }
+    if (queue_.empty()) return false;
+
+    out = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+}
+
+bool ForcingStream::sample(double t, ForcingRecord& out)
+{
+    if (!is_open()) return false;
+
+    if (!has_after_)
+    {
+        has_after_ = next_record(after_);
+        if (!has_after_) return false; // empty series
+    }
+
+    // slide the bracket forward until after_ is at or beyond t (or the series ends).
+    while (after_.time < t)
+    {
+        ForcingRecord upcoming;
+        if (!next_record(upcoming)) break;
+        std::swap(before_, after_);
+        after_ = std::move(upcoming);
+        has_before_ = true;
+    }
+
+    if (!has_before_ || t >= after_.time || after_.time <= before_.time)
+    {
+        out = after_; // before the first record, past the last one, or exactly on a record
+        out.time = t;
+        return true;
+    }
+    if (t <= before_.time)
+    {
+        out = before_;
+        out.time = t;
+        return true;
+    }
+
+    const float w = static_cast<float>((t - before_.time) / (after_.time - before_.time));
+    const auto lerp = [w](float a, float b) { return a + w * (b - a); };
+    out.time = t;
+    out.precipitation_rate = lerp(before_.precipitation_rate, after_.precipitation_rate);
+    out.wind_speed = lerp(before_.wind_speed, after_.wind_speed);
+    out.settling_speed = lerp(before_.settling_speed, after_.settling_speed);
+    out.precipitation_profile.resize(after_.precipitation_profile.size());
+    for (std::size_t i = 0; i < out.precipitation_profile.size(); ++i)
+    {
+        out.precipitation_profile[i] = lerp(before_.precipitation_profile[i], after_.precipitation_profile[i]);
+    }
+    return true;
+}
+
+bool forcing_fits_speed_fields(const Fields& fields)
+{
+    const auto fits = [](const char* name, const Field2D<float>& speed)
+    {
+        if (is_constant(speed)) return true;
+        std::cerr << "[forcing] " << name << " varies across the grid but forcing would set it to one value; "
+                  << "give it as { \"uniform\": value } or run without forcing\n";
+        return false;
+    };
+    return fits("snow_transport_speed_x", fields.snow_transport_speed_x)
+           && fits("snow_transport_speed_y", fields.snow_transport_speed_y);
+}
+
+void apply_forcing(const ForcingRecord& forcing, Params& params, Fields& fields, bool feed_top_row)
+{
+    // the setup CFL check saw the config speeds only, so warn whenever forcing pushes a speed over the limit
+    const float cfl_x = cfl(forcing.wind_speed, params, params.dx);
+    const float cfl_y = cfl(forcing.settling_speed, params, params.dy);
+    const bool was_exceeded = cfl(params.wind_speed, params, params.dx) > 1.0f || cfl(params.settling_speed, params, params.dy) > 1.0f;
+    if ((cfl_x > 1.0f || cfl_y > 1.0f) && !was_exceeded)
+    {
+        std::cerr << "[forcing] CFL condition exceeded at t=" << forcing.time << " s (CFL_x=" << cfl_x
+                  << ", CFL_y=" << cfl_y << ")\n";
+    }
+
+    if (forcing.wind_speed != params.wind_speed)
+    {
+        fields.snow_transport_speed_x.fill(forcing.wind_speed); // a uniform field stays uniform
+    }
+    if (forcing.settling_speed != params.settling_speed)
+    {
+        fields.snow_transport_speed_y.fill(-forcing.settling_speed);
+    }
+    params.wind_speed = forcing.wind_speed;
+    params.settling_speed = forcing.settling_speed;
+    params.precipitation_rate = std::max(forcing.precipitation_rate, 0.0f);
+
+    if (!feed_top_row) return;
+
+    if (forcing.precipitation_profile.size() == fields.precipitation_source.nx && !forcing.precipitation_profile.empty())
+    {
+        fields.precipitation_source.materialize();
+        std::copy(forcing.precipitation_profile.begin(), forcing.precipitation_profile.end(), fields.precipitation_source.data.begin());
+    }
+    else
+    {
+        fields.precipitation_source.fill(params.precipitation_rate);
+    }
+}
+
+} // namespace snow
@@ -0,0 +1,221 @@
+#include "json_writer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace snow
+{
+
+JsonFileWriter::JsonFileWriter(std::size_t buffer_bytes) :
+    buffer_(std::max<std::size_t>(buffer_bytes, 64))
+{}
+
+JsonFileWriter::~JsonFileWriter()
+{
+    close();
+}
+
+bool JsonFileWriter::open(const std::string& path)
+{
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+    {
+        std::cerr << "[json_writer] cannot create " << path << "\n";
+        return false;
+    }
+    used_ = 0;
+    ok_ = true;
+    scopes_.clear();
+    after_key_ = false;
+    return true;
+}
+
+bool JsonFileWriter::close()
+{
+    if (!file_) return ok_;
+    put('\n');
+    flush();
+    if (std::fclose(file_) != 0) ok_ = false;
+    file_ = nullptr;
+    return ok_;
+}
+
+void JsonFileWriter::flush()
+{
+    if (used_ > 0 && file_ && std::fwrite(buffer_.data(), 1, used_, file_) != used_) ok_ = false;
+    used_ = 0;
+}
+
+void JsonFileWriter::put(char c)
+{
+    if (used_ == buffer_.size()) flush();
+    buffer_[used_++] = c;
+}
+
+void JsonFileWriter::put(const char* text, std::size_t length)
+{
+    if (used_ + length > buffer_.size()) flush();
+    if (length > buffer_.size())
+    {
+        if (file_ && std::fwrite(text, 1, length, file_) != length) ok_ = false;
+        return;
+    }
+    std::memcpy(buffer_.data() + used_, text, length);
+    used_ += length;
+}
+
+void JsonFileWriter::newline()
+{
+    put('\n');
+    for (std::size_t level = 0; level < scopes_.size(); ++level) put("  ", 2);
+}
+
+// Separator and indentation ahead of a value or key in the current scope.
+void JsonFileWriter::before_value()
+{
+    if (after_key_)
+    {
+        after_key_ = false;
+        return;
+    }
+    if (scopes_.empty()) return;
+    Scope& scope = scopes_.back();
+    if (!scope.empty) put(',');
+    scope.empty = false;
+    if (scope.object) newline();
+}
+
+void JsonFileWriter::begin_object()
+{
+    before_value();
+    put('{');
+    scopes_.push_back({ true, true });
+}
+
+void JsonFileWriter::end_object()
+{
+    const bool empty = scopes_.back().empty;
+    scopes_.pop_back();
+    if (!empty) newline();
+    put('}');
+}
+
+void JsonFileWriter::begin_array()
+{
+    before_value();
+    put('[');
+    scopes_.push_back({ false, true });
+}
+
+void JsonFileWriter::end_array()
+{
+    scopes_.pop_back();
+    put(']');
+}
+
+void JsonFileWriter::key(const std::string& name)
+{
+    before_value();
+    put_string(name);
+    put(": ", 2);
+    after_key_ = true;
+}
+
+void JsonFileWriter::value(float number)
+{
+    before_value();
+    if (!std::isfinite(number))
+    {
+        put("null", 4);
+        return;
+    }
+    char text[32];
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text), number);
+    put(text, static_cast<std::size_t>(result.ptr - text));
+}
+
+void JsonFileWriter::value(double number)
+{
+    before_value();
+    if (!std::isfinite(number))
+    {
+        put("null", 4);
+        return;
+    }
+    char text[32];
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text), number);
+    put(text, static_cast<std::size_t>(result.ptr - text));
+}
+
+void JsonFileWriter::value(long long number)
+{
+    before_value();
+    char text[24];
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text), number);
+    put(text, static_cast<std::size_t>(result.ptr - text));
+}
+
+void JsonFileWriter::value(std::size_t number)
+{
+    before_value();
+    char text[24];
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text), number);
+    put(text, static_cast<std::size_t>(result.ptr - text));
+}
+
+void JsonFileWriter::value(bool flag)
+{
+    before_value();
+    if (flag) put("true", 4);
+    else put("false", 5);
+}
+
+void JsonFileWriter::value(const std::string& text)
+{
+    before_value();
+    put_string(text);
+}
+
+void JsonFileWriter::put_string(const std::string& text)
+{
+    put('"');
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            put('\\');
+            put(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(c));
+            put(escape, 6);
+        }
+        else
+        {
+            put(c);
+        }
+    }
+    put('"');
+}
+
+void JsonFileWriter::array(const float* values, std::size_t count)
+{
+    begin_array();
+    for (std::size_t i = 0; i < count; ++i) value(values[i]);
+    end_array();
+}
+
+void JsonFileWriter::array(const std::uint8_t* values, std::size_t count)
+{
+    begin_array();
+    for (std::size_t i = 0; i < count; ++i) value(static_cast<long long>(values[i]));
+    end_array();
+}
+
+} // namespace snow
@@ -1,34 +1,101 @@
-#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <cmath>
 #include <string>
+#include <thread>
 #include <glm/glm/glm.hpp>
 #include "types.hpp"
+#include "backend_registry.hpp"
+#include "config_cache.hpp"
 #include "my_helper.hpp"
+#include "profiler.hpp"
+#include "render_exchange.hpp"
+#include "run_loop.hpp"
 #include "simulation.hpp"
-#include "cpu_backend.hpp"
-// Safe to include: provides CPU fallback when SNOWSIM_HAS_CUDA == 0
-// and CUDA interface when enabled.
-#include "cuda_backend.hpp"
 #include "renderer.hpp"
 
 int main(int argc, char* argv[])
 {
     using namespace snow;
 
+    // usage: snow_sim [config.json] [--backend name|auto] [--restart checkpoint] [--no-cache] [--cache-dir directory]
+    //                 [--trace trace.json]
+    std::string config_path = "resources/configs/default.json";
+    std::string restart_path;
+    std::string trace_path;
+    std::string cache_directory = default_config_cache_directory();
+    std::string backend; // empty: params.backend, then default_backend_name()
+    bool use_cache = true;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const std::string option = argv[arg];
+        if (option == "--restart" && arg + 1 < argc)
+        {
+            restart_path = argv[++arg];
+        }
+        else if (option == "--backend" && arg + 1 < argc)
+        {
+            backend = argv[++arg];
+        }
+        else if (option == "--trace" && arg + 1 < argc)
+        {
+            trace_path = argv[++arg];
+        }
+        else if (option == "--no-cache")
+        {
+            use_cache = false;
+        }
+        else if (option == "--cache-dir" && arg + 1 < argc)
+        {
+            cache_directory = argv[++arg];
+        }
+        else if (option.rfind("--", 0) == 0)
+        {
+            std::cerr << "[config] unknown option " << option << "\n";
+            return 1;
+        }
+        else
+        {
+            config_path = option;
+        }
+    }
+
+    profile::TraceGuard trace_guard; // declared before the backend, so its workers are gone when it writes
+    if (!trace_path.empty())
+    {
+        if (!SNOWSIM_PROFILE)
+        {
+            std::cerr << "[trace] --trace needs a build configured with -DSNOWSIM_ENABLE_PROFILING=ON; not tracing\n";
+        }
+        else if (!profile::start_trace(trace_path))
+        {
+            return 1;
+        }
+    }
+    SNOW_PROFILE_THREAD("main");
+
     Params params{};
     Fields fields;
-    const std::string config_path = (argc > 1) ? argv[1] : std::string("resources/configs/default.json");
-    if (!load_simulation_config(config_path, params, fields))
+    RunConfig run_config;
+    bool cache_hit = false;
+    bool loaded = false;
+    {
+        SNOW_PROFILE_SCOPE(config_load);
+        loaded = use_cache ? load_simulation_config_cached(config_path, cache_directory, params, fields, run_config, &cache_hit)
+                           : load_simulation_config(config_path, params, fields, run_config);
+    }
+    if (!loaded)
     {
         std::cerr << "[config] params and fields failed to load from file\n";
         return 1;
     }
-
-    // setting up sorce left sorce helper variables
-    Field1D<float> left_boundary_column_prev(params.ny, 0.0f);
-    Field1D<float> left_boundary_column_next(params.ny, 0.0f);
-
+    if (use_cache)
+    {
+        std::cout << "[config_cache] " << (cache_hit ? "hit: " : "miss, cached as ")
+                  << config_cache_path(config_path, cache_directory) << "\n";
+    }
+    // the window, the GL context and all drawing stay on this thread; the simulation gets its own.
     bool viz_ready = false;
     if (params.viz_on)
     {
@@ -42,102 +109,104 @@ int main(int argc, char* argv[])
         viz::initialize_arrow_resources(params);
     }
 
-// compile with both backends then choose which one to use at run time
-#if SNOWSIM_HAS_CUDA
-    cuda::CUDASimulation sim; // Uses real CUDA backend
-#else
-    cpu::CPUSimulation sim; // Fallback when CUDA is unavailable
-#endif
-
-    // CFL check: warn if a single step could advect snow beyond immediate neighbours.
-    #pragma region
-    float max_abs_ux = 0.0f;
-    for (const float ux : fields.snow_transport_speed_x.data)
-    {
-        max_abs_ux = std::max(max_abs_ux, std::fabs(ux));
-    }
-    float max_abs_vy = 0.0f;
-    for (const float vy : fields.snow_transport_speed_y.data)
-    {
-        max_abs_vy = std::max(max_abs_vy, std::fabs(vy));
-    }
-    const float cfl_x = max_abs_ux * params.time_step_duration / params.dx;
-    const float cfl_y = max_abs_vy * params.time_step_duration / params.dy;
-    if (cfl_x > 1.0f || cfl_y > 1.0f)
-    {
-        std::cerr << "Warning: CFL condition exceeded (CFL_x=" << cfl_x
-                  << ", CFL_y=" << cfl_y << ")\n";
-    }
-    #pragma endregion
-    
-    // TODO: Refine CFL safety check to capture local variations and per-direction thresholds.
+    // frames go to the render thread through a triple buffer: publishing copies, it never waits on vsync
+    RenderExchange frames;
+    std::atomic<bool> stop_requested{ false };
+    RunHooks hooks;
     // TODO: configure GLAD/OpenGL state for visualization once rendering is implemented 
     // TODO: if you need textures use stb_image.h not SOIL2. I know its what you did in class but its old AF.
-    // sim loop
-    for (int t = 0; t < params.total_time_steps; ++t)
+    hooks.before_step = [&](long long t, const Params& run_params, Fields& run_fields)
     {
         if (viz_ready)
         {
-            viz::poll_events();
-            viz::process_input();
-
-            if(viz::should_close()){
-                break;
+            if (stop_requested.load(std::memory_order_relaxed)){
+                return false; // window closed
             }
 
-            if (t % params.steps_per_frame == 0)
+            if (t % run_params.steps_per_frame == 0)
             {
-                viz::begin_frame();
-                viz::render_frame(params, fields);
-                viz::end_frame();
+                frames.publish(t, run_params, run_fields);
             }
         }
 
         // DEBUG: remove when not needed for debuging
-        if (ceilf(t * params.time_step_duration / 60.0f) != ceilf((t + 1) * params.time_step_duration / 60.0f))    
+        if (ceilf(t * run_params.time_step_duration / 60.0f) != ceilf((t + 1) * run_params.time_step_duration / 60.0f))    
         {
-            std::cout << t*params.time_step_duration/60 << " min into sim\n"; 
-            if (int(ceilf(t * params.time_step_duration / 60.0f)) % 10 == 0)    
+            std::cout << t*run_params.time_step_duration/60 << " min into sim\n"; 
+            if (int(ceilf(t * run_params.time_step_duration / 60.0f)) % 10 == 0)    
             {
-                print_field_subregion(fields.snow_density,0,20,0,20);
+                print_field_subregion(run_fields.snow_density,0,20,0,20);
             }
         }
+        return true;
+    };
+
+    // backends are registered at compile time and picked here, at run time
+    if (backend.empty()) backend = run_config.backend.empty() ? default_backend_name() : run_config.backend;
+    std::string backend_name;
+    const std::unique_ptr<Simulation> sim = make_backend(backend, params, fields, BackendOptions{}, &backend_name);
+    if (!sim)
+    {
+        if (viz_ready) viz::shutdown();
+        return 1;
+    }
+    std::cout << "[backend] " << backend_name << "\n";
 
-        sim.step(fields, params);
-
-        // TODO: revisit boundary source update once dynamic weather arrives—clamp CFL instead of early-return. Requires implementation of snow boundry sorce object first.
-        // incrementing/ramping left boundry sorce
-        left_boundary_column_next = step_snow_source(left_boundary_column_prev,
-                                                     params.settling_speed,
-                                                     params.precipitation_rate,
-                                                     params.dy,
-                                                     params.time_step_duration);
+    RunTimings timings;
+    bool ran = false;
+    if (!viz_ready)
+    {
+        ran = run_simulation(*sim, params, fields, run_config, restart_path, hooks, timings);
+    }
+    else
+    {
+        std::atomic<bool> simulation_done{ false };
+        std::thread simulation_thread([&]
+        {
+            SNOW_PROFILE_THREAD("simulation");
+            ran = run_simulation(*sim, params, fields, run_config, restart_path, hooks, timings);
+            simulation_done.store(true, std::memory_order_release);
+        });
 
-        for (std::size_t j = 0; j < params.ny; ++j)
+        // render loop: draws the newest frame at display rate (end_frame waits for vsync)
+        while (!simulation_done.load(std::memory_order_acquire))
         {
-            // if wind blows left at left boundery in row j, left most cell in row j is under ground, or cell width is 0 (safty check)
-            if (fields.air_mask(0,j) <= 0.0f || params.dx <= 0.0f || !fields.air_mask(0, j)){
-                fields.windborn_horizontal_source_left(j) = 0.0f;
+            viz::poll_events();
+            viz::process_input();
+
+            if(viz::should_close()){
+                stop_requested.store(true, std::memory_order_relaxed);
+                break;
             }
-            else{
-                fields.windborn_horizontal_source_left(j) = params.wind_speed * left_boundary_column_next(j) / params.dx;
+
+            RenderFrame& frame = frames.latest();
+            viz::begin_frame();
+            if (frame.step >= 0)
+            {
+                SNOW_PROFILE_SCOPE(render);
+                viz::render_frame(frame.params, frame.fields);
+                frame.fields.air_mask_dirty.clear(); // this frame's mask changes are on the GPU
+            }
+            {
+                SNOW_PROFILE_SCOPE(present);
+                viz::end_frame();
             }
         }
-        left_boundary_column_prev = left_boundary_column_next;
+        simulation_thread.join();
+        viz::shutdown();
     }
-
-    // std::cout << "accumulated snow" << ":\n";
-    // for (int i = 0; i < params.nx; i++) {
-    //     std::cout << fields.snow_accumulation_mass(i) << "\n";
-    // }
-    // std::cout << "\n";
-
-    if (viz_ready)
+    if (!ran)
     {
-        viz::shutdown();
+        return 1;
     }
 
     std::cout << "Finished simulation steps: grid(" << params.nx << "x" << params.ny << ")\n";
+    print_run_timings(std::cout, timings);
+    if (SNOWSIM_PROFILE) profile::print_report(std::cout, timings.cells);
+    if (!trace_guard.stop())
+    {
+        return 1;
+    }
 
 }
 
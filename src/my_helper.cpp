@@ -3,31 +3,39 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <sstream>
+#include <type_traits>
 #include <utility>
 
+#include "field_file.hpp"
+#include "json_writer.hpp"
 #include "json.hpp"
+#include "profiler.hpp"
+#include "snow_source_boundary.hpp"
+#include "terrain_expression.hpp"
+#include "terrain_import.hpp"
 #include "types.hpp"
 
 namespace snow{
 
+// The generators below are fixed Terrain expressions (terrain_expression.hpp); compose Terrain directly
+// for anything else.
 Field2D<uint8_t> air_mask_flat(const Params& params, float distince_from_bottom){
     //safty checks
     if(distince_from_bottom > params.Ly) distince_from_bottom = params.Ly;
     if(distince_from_bottom < 0) distince_from_bottom = 0;
 
-    Field2D<uint8_t> air_mask = Field2D<uint8_t>(params.nx, params.ny, 1);
+    // rows 0..cells_from_bottom are ground, so the surface sits on top of row cells_from_bottom.
     std::size_t cells_from_bottom = static_cast<std::size_t>(distince_from_bottom / params.dy);
-    for (std::size_t i = 0; i < air_mask.nx; i++){
-        for (std::size_t j = 0; j < air_mask.ny; j++){
-            if(j <= cells_from_bottom) air_mask(i,j) = 0;
-            else continue;
-        }
-    }
-    return air_mask;
+    return Terrain::flat(static_cast<float>(cells_from_bottom + 1) * params.dy).air_mask(params);
 }
 
 Field2D<uint8_t> air_mask_slope_up(const Params& params, float distince_from_bottom_left, float distince_from_top_right)
@@ -39,17 +47,18 @@ Field2D<uint8_t> air_mask_slope_up(const Params& params, float distince_from_bot
     if(distince_from_top_right > params.Ly) distince_from_top_right = params.Ly;
     if(distince_from_top_right < 0) distince_from_top_right = 0;
     
-    Field2D<uint8_t> air_mask = Field2D<uint8_t>(params.nx, params.ny, 1);
-    
     std::size_t cells_from_top = static_cast<std::size_t>(distince_from_top_right / params.dy);
     std::size_t cells_from_bottom = static_cast<std::size_t>(distince_from_bottom_left / params.dy);
     float sloap = static_cast<float>(params.ny-cells_from_bottom-cells_from_top)/ static_cast<float>(params.nx);
-    for (std::size_t i = 0; i < air_mask.nx; i++){
-        for (std::size_t j = 0; j < air_mask.ny; j++){
-            if(static_cast<float>(j) <= static_cast<float>(cells_from_bottom) + sloap * static_cast<float>(i)) air_mask(i,j) = 0;
-            else continue;
-        }
+
+    // column i is ground while row j <= cells_from_bottom + sloap * i. The surface goes on top of the last
+    // such row rather than along the line itself, so rows the line passes exactly through stay ground.
+    Field1D<float> surface(params.nx);
+    for (std::size_t i = 0; i < params.nx; i++){
+        surface(i) = (std::floor(static_cast<float>(cells_from_bottom) + sloap * static_cast<float>(i)) + 1.0f) * params.dy;
     }
+    Field2D<uint8_t> air_mask;
+    fill_air_mask(surface, params, air_mask);
     return air_mask;
 }
 // TODO: change docs to reflect function inputs and outputs
@@ -62,38 +71,134 @@ Field2D<uint8_t> air_mask_parabolic(const Params& params, float distince_from_bo
     if(distince_from_bottom_center < 0) distince_from_bottom_center = 0;
     if(distince_from_top_edge > params.Ly) distince_from_top_edge = params.Ly;
     if(distince_from_top_edge < 0) distince_from_top_edge = 0;
-    if(distince_from_top_edge + distince_from_bottom_center > params.Ly);
-    
-    Field2D<uint8_t> air_mask = Field2D<uint8_t>(params.nx, params.ny, 1);
     
     const float vertex_x = 0.5f * params.Lx;
     const float denom = vertex_x * vertex_x;
     const float a = denom > 0.0f ? (distince_from_top_edge - distince_from_bottom_center) / denom : 0.0f;
+    return Terrain::parabola(vertex_x, distince_from_bottom_center, a).air_mask(params);
+}
 
+Field1D<std::size_t> compute_ground_surface_index(const Field2D<uint8_t>& air_mask)
+{
+    Field1D<std::size_t> surface_index(air_mask.nx, air_mask.ny);
     for (std::size_t i = 0; i < air_mask.nx; ++i)
     {
-        const float x_center = (static_cast<float>(i) + 0.5f) * params.dx;
-        float ground_y = a * (x_center - vertex_x) * (x_center - vertex_x) + distince_from_bottom_center;
+        // walk up from the bottom until the first air cell; only the ground cells are touched.
+        std::size_t j = 0;
+        while (j < air_mask.ny && !air_mask(i, j)) ++j;
+        surface_index(i) = j;
+    }
+    return surface_index;
+}
+
+namespace
+{
+    // Settled snow depth (m) of column i: its mass spread over the column width at the settled density;
+    // 0 when there is no packing density.
+    float settled_snow_depth(const Fields& fields, const Params& params, std::size_t i)
+    {
+        const float settled_density = fields.snow_accumulation_density.in_bounds(i)
+            ? fields.snow_accumulation_density.value(i)
+            : params.settaled_snow_density;
+        if (settled_density <= 0.0f || params.dx <= 0.0f) return 0.0f;
+        return std::max(fields.snow_accumulation_mass.value(i), 0.0f) / (settled_density * params.dx);
+    }
+}
+
+void derive_surface_indices(Fields& fields, const Params& params)
+{
+    const std::size_t nx = fields.air_mask.nx;
+    fields.ground_surface_index = compute_ground_surface_index(fields.air_mask);
+    fields.terrain_surface_index = fields.ground_surface_index;
+    fields.snow_accumulation_depth = Field1D<float>(nx);
+    if (params.dy <= 0.0f) return;
+    for (std::size_t i = 0; i < nx && fields.snow_accumulation_mass.in_bounds(i); ++i)
+    {
+        const float depth = settled_snow_depth(fields, params, i);
+        fields.snow_accumulation_depth(i) = depth;
+        const std::size_t snow_cells = static_cast<std::size_t>(depth / params.dy);
+        fields.terrain_surface_index(i) -= std::min(snow_cells, fields.terrain_surface_index(i));
+    }
+}
+
+void update_ground_from_accumulation(Fields& fields, const Params& params)
+{
+    const std::size_t nx = fields.air_mask.nx;
+    const std::size_t ny = fields.air_mask.ny;
+    if (nx == 0 || ny == 0 || params.dx <= 0.0f || params.dy <= 0.0f) return;
+
+    // surface bookkeeping is built once from the mask the first time it is needed (e.g. hand-built Fields).
+    if (fields.terrain_surface_index.nx != nx)
+    {
+        fields.terrain_surface_index = compute_ground_surface_index(fields.air_mask);
+    }
+    if (fields.ground_surface_index.nx != nx)
+    {
+        fields.ground_surface_index = fields.terrain_surface_index;
+    }
+    if (fields.snow_accumulation_depth.nx != nx)
+    {
+        fields.snow_accumulation_depth.resize(nx, 0.0f);
+    }
+
+    const float cell_area = params.dx * params.dy;
 
-        for (std::size_t j = 0; j < air_mask.ny; ++j)
+    for (std::size_t i = 0; i < nx && fields.snow_accumulation_mass.in_bounds(i); ++i)
+    {
+        const float settled_density = fields.snow_accumulation_density.in_bounds(i)
+            ? fields.snow_accumulation_density.value(i)
+            : params.settaled_snow_density;
+        if (settled_density <= 0.0f) continue; // no packing density, snow cannot build up ground
+
+        const float depth = settled_snow_depth(fields, params, i);
+        fields.snow_accumulation_depth(i) = depth;
+
+        const std::size_t snow_cells = static_cast<std::size_t>(depth / params.dy);
+        const std::size_t target_surface = std::min(fields.terrain_surface_index(i) + snow_cells, ny);
+        std::size_t surface = fields.ground_surface_index(i);
+
+        // depth crossed one or more cell boundaries upward: bury the air cells, keeping their airborne snow.
+        while (surface < target_surface)
         {
-            const float cell_center_y = (static_cast<float>(j) + 0.5f) * params.dy;
-            if (cell_center_y <= ground_y)
+            if (fields.snow_density.in_bounds(i, surface))
             {
-                air_mask(i, j) = 0;
+                fields.snow_accumulation_mass(i) += fields.snow_density(i, surface) * cell_area;
+                fields.snow_density(i, surface) = 0.0f;
             }
+            fields.air_mask(i, surface) = 0;
+            fields.air_mask_dirty.include(i, surface);
+            ++surface;
         }
+
+        // depth dropped below a cell boundary (erosion): expose the buried cells again.
+        while (surface > target_surface)
+        {
+            --surface;
+            fields.air_mask(i, surface) = 1;
+            fields.air_mask_dirty.include(i, surface);
+        }
+
+        fields.ground_surface_index(i) = surface;
     }
-    return air_mask;
 }
 
-// Prints a rectangular slice of a Field2D with consistent formatting for debugging.
 void print_field_subregion(const Field2D<float>& field,
                            std::ptrdiff_t x_min,
                            std::ptrdiff_t x_max,
                            std::ptrdiff_t y_min,
                            std::ptrdiff_t y_max)
 {
+    print_field_subregion(field.view(), x_min, x_max, y_min, y_max);
+}
+
+// Prints a rectangular slice of a field view with consistent formatting for debugging.
+void print_field_subregion(Field2DView<const float> field,
+                           std::ptrdiff_t x_min,
+                           std::ptrdiff_t x_max,
+                           std::ptrdiff_t y_min,
+                           std::ptrdiff_t y_max)
+{
+    SNOW_PROFILE_SCOPE(field_print);
     if (field.nx == 0 || field.ny == 0)
     {
         // Guard against empty fields so downstream code does not attempt to index them.
@@ -208,8 +313,7 @@ void print_field_subregion(const Field2D<float>& field,
     std::cout.flush();
 }
 
-
-// TODO: consider refactoring boundary snow source logic into a SnowSourceBoundary class so validation happens once.
+// Validates its inputs on every call; use SnowSourceBoundary (snow_source_boundary.hpp) in step loops.
 Field1D<float> step_snow_source(const Field1D<float>& column_density,
                                 float settling_speed,
                                 float precipitation_rate,
@@ -249,64 +353,307 @@ Field1D<float> step_snow_source(const Field1D<float>& column_density,
     }
 
     Field1D<float> next_column(column_density.nx, 0.0f);
+    advance_snow_column(column_density.data.data(),
+                        next_column.data.data(),
+                        column_density.nx,
+                        settling_speed,
+                        precipitation_rate,
+                        dy,
+                        dt);
+    return next_column;
+}
+
+namespace
+{
+    // Destination for one fields.<name>.data array while the config is being parsed.
+    struct FieldDataSink
+    {
+        std::vector<float>* values = nullptr;        // float fields
+        std::vector<std::uint8_t>* mask = nullptr;   // air_mask
+        std::size_t count = 0;                       // values streamed so far
+    };
 
-    // Settling drives a constant downward velocity in this one-dimensional column.
-    const float vertical_velocity = -settling_speed;
-    if (vertical_velocity == 0.0f)
+    // SAX handler for load_simulation_config. Everything except fields.<name>.data is collected into a
+    // small DOM as usual; those arrays are written straight into the Field storage registered in sinks,
+    // so a large grid never exists as one nlohmann::json value per cell. When nx/ny precede data in the
+    // file the storage is reserved up front. Any non-numeric array element aborts the parse.
+    class ConfigSaxHandler : public nlohmann::json_sax<nlohmann::json>
     {
-        // Pure precipitation update with no vertical transport.
-        for (std::size_t j = 0; j < column_density.nx; ++j)
+    public:
+        ConfigSaxHandler(nlohmann::json& root, std::map<std::string, FieldDataSink>& sinks) :
+            root_(root), sinks_(sinks)
+        {}
+
+        bool null() override { return !sink_ && store(nullptr); }
+        bool boolean(bool val) override { return !sink_ && store(val); }
+        bool number_integer(number_integer_t val) override { return sink_ ? stream(static_cast<double>(val)) : store(val); }
+        bool number_unsigned(number_unsigned_t val) override { return sink_ ? stream(static_cast<double>(val)) : store(val); }
+        bool number_float(number_float_t val, const string_t&) override { return sink_ ? stream(val) : store(val); }
+        bool string(string_t& val) override { return !sink_ && store(val); }
+        bool binary(binary_t& val) override { return !sink_ && store(nlohmann::json::binary(val)); }
+
+        bool start_object(std::size_t) override
+        {
+            if (sink_) return false;
+            nlohmann::json* object = add(nlohmann::json::object());
+            stack_.push_back(object);
+            keys_.emplace_back();
+            return true;
+        }
+
+        bool key(string_t& val) override
+        {
+            keys_.back() = val;
+            return true;
+        }
+
+        bool end_object() override
+        {
+            stack_.pop_back();
+            keys_.pop_back();
+            return true;
+        }
+
+        bool start_array(std::size_t) override
         {
-            float density = column_density(j);
-            if (j + 1 == column_density.nx)
+            if (sink_) return false; // nested arrays are not field data
+
+            // fields.<name>.data: leave an empty placeholder in the DOM and stream the values instead.
+            if (stack_.size() == 3 && keys_[0] == "fields" && keys_[2] == "data" && stack_[1]->is_object() && stack_[2]->is_object())
             {
-                density += dt * precipitation_rate;
+                const auto sink = sinks_.find(keys_[1]);
+                if (sink != sinks_.end())
+                {
+                    add(nlohmann::json::array());
+                    sink_ = &sink->second;
+                    sink_->count = 0;
+                    return reserve(*stack_.back());
+                }
             }
-            next_column(j) = std::max(density, 0.0f);
+
+            nlohmann::json* array = add(nlohmann::json::array());
+            stack_.push_back(array);
+            keys_.emplace_back();
+            return true;
         }
-        return next_column;
-    }
 
-    // lambda function that Match the face flux behaviour used in the CPU simulation 
-    // so the boundary source evolves in lock-step with interior cells.
-    const float flux_threshold = 1e-5f; // TODO: Share this threshold with other face_flux helpers in cpu_backend.cpp.
-    const auto face_flux = [&](std::size_t face_index) -> float
-    {
-        std::ptrdiff_t donor_index = (vertical_velocity > 0.0f)
-            ? static_cast<std::ptrdiff_t>(face_index) - 1
-            : static_cast<std::ptrdiff_t>(face_index);
+        bool end_array() override
+        {
+            if (sink_)
+            {
+                sink_ = nullptr;
+                return true;
+            }
+            stack_.pop_back();
+            keys_.pop_back();
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override
+        {
+            return false;
+        }
 
-        if (donor_index < 0 ||static_cast<std::size_t>(donor_index) >= column_density.nx){
-            return 0.0f;
+    private:
+        bool store(nlohmann::json&& value)
+        {
+            add(std::move(value));
+            return true;
+        }
+
+        nlohmann::json* add(nlohmann::json&& value)
+        {
+            if (stack_.empty())
+            {
+                root_ = std::move(value);
+                return &root_;
+            }
+            nlohmann::json& parent = *stack_.back();
+            if (parent.is_array())
+            {
+                parent.push_back(std::move(value));
+                return &parent.back();
+            }
+            nlohmann::json& slot = parent[keys_.back()];
+            slot = std::move(value);
+            return &slot;
+        }
+
+        // Sizes the destination from nx (and ny) when they were already read for this field.
+        bool reserve(const nlohmann::json& field_node)
+        {
+            std::size_t expected = 0;
+            if (field_node.contains("nx") && field_node["nx"].is_number_unsigned())
+            {
+                expected = field_node["nx"].get<std::size_t>();
+                if (field_node.contains("ny") && field_node["ny"].is_number_unsigned())
+                {
+                    expected *= field_node["ny"].get<std::size_t>();
+                }
+            }
+            try
+            {
+                if (sink_->values) { sink_->values->clear(); sink_->values->reserve(expected); }
+                if (sink_->mask) { sink_->mask->clear(); sink_->mask->reserve(expected); }
+            }
+            catch (const std::exception&)
+            {
+                return false; // nx*ny beyond what can be allocated
+            }
+            return true;
         }
 
-        const float flux = vertical_velocity * column_density(static_cast<std::size_t>(donor_index));
-        return (std::fabs(flux) > flux_threshold) ? flux : 0.0f;
+        bool stream(double value)
+        {
+            if (sink_->mask)
+            {
+                if (value < 0.0 || value > 255.0) return false;
+                sink_->mask->push_back(static_cast<std::uint8_t>(value));
+            }
+            else
+            {
+                sink_->values->push_back(static_cast<float>(value));
+            }
+            ++sink_->count;
+            return true;
+        }
+
+        nlohmann::json& root_;
+        std::map<std::string, FieldDataSink>& sinks_;
+        std::vector<nlohmann::json*> stack_; // open objects/arrays, innermost last
+        std::vector<std::string> keys_;      // current key of each open object ("" for arrays)
+        FieldDataSink* sink_ = nullptr;      // set while inside a streamed data array
     };
 
-    for (std::size_t j = 0; j < column_density.nx; ++j)
+    // Outcome of matching a streamed field against the grid.
+    enum class StreamedField
     {
-        float density = column_density(j);
+        absent,  // nx is null or no data: the loader generates the default
+        loaded,  // data streamed and sized correctly
+        invalid  // nx/ny or the value count disagree with the grid
+    };
 
-        // Only the top cell receives direct precipitation.
-        if (j + 1 == column_density.nx && precipitation_rate > 0.0f )
+    // A 1D field passes expected_ny = 0 and must not carry ny.
+    StreamedField check_streamed_field(const nlohmann::json& fields_node,
+                                       const char* name,
+                                       const FieldDataSink& sink,
+                                       std::size_t expected_nx,
+                                       std::size_t expected_ny)
+    {
+        if (!fields_node.contains(name)) return StreamedField::absent;
+        const auto& node = fields_node[name];
+        if (!node.is_object()) return StreamedField::invalid;
+        if (sink.count == 0) return StreamedField::absent;
+
+        if (!node.contains("nx") || !node["nx"].is_number_unsigned()) return StreamedField::invalid;
+        const std::size_t nx = node["nx"].get<std::size_t>();
+        std::size_t ny = 0;
+        if (expected_ny > 0)
         {
-            density += dt * precipitation_rate;
+            if (!node.contains("ny") || !node["ny"].is_number_unsigned()) return StreamedField::invalid;
+            ny = node["ny"].get<std::size_t>();
         }
+        if (nx != expected_nx || ny != expected_ny) return StreamedField::invalid;
+        if (sink.count != nx * std::max<std::size_t>(ny, 1)) return StreamedField::invalid;
+        return StreamedField::loaded;
+    }
 
-        const float flux_bottom = face_flux(j);
-        const float flux_top = face_flux(j + 1);
+    // fields.<name> = { "uniform": value } gives every element one value without storing any.
+    StreamedField find_uniform_field(const nlohmann::json& fields_node, const char* name, float& value_out)
+    {
+        if (!fields_node.contains(name)) return StreamedField::absent;
+        const auto& node = fields_node[name];
+        if (!node.is_object() || !node.contains("uniform")) return StreamedField::absent;
+        if (!node["uniform"].is_number()) return StreamedField::invalid;
+        value_out = node["uniform"].get<float>();
+        return StreamedField::loaded;
+    }
 
-        density += dt / dy * (flux_bottom - flux_top);
-        next_column(j) = std::max(density, 0.0f);
+    // fields.<name> = { "nx": nx, "data": [row, ...] } for the surface bookkeeping a dump writes; every
+    // row must be within 0..ny.
+    StreamedField find_surface_index(const nlohmann::json& fields_node,
+                                     const char* name,
+                                     std::size_t expected_nx,
+                                     std::size_t ny,
+                                     Field1D<std::size_t>& index_out)
+    {
+        if (!fields_node.contains(name)) return StreamedField::absent;
+        const auto& node = fields_node[name];
+        if (!node.is_object() || !node.contains("nx") || !node["nx"].is_number_unsigned()
+            || node["nx"].get<std::size_t>() != expected_nx || !node.contains("data") || !node["data"].is_array()
+            || node["data"].size() != expected_nx)
+        {
+            return StreamedField::invalid;
+        }
+        index_out = Field1D<std::size_t>(expected_nx);
+        for (std::size_t i = 0; i < expected_nx; ++i)
+        {
+            const auto& row = node["data"][i];
+            if (!row.is_number_unsigned() || row.get<std::size_t>() > ny) return StreamedField::invalid;
+            index_out(i) = row.get<std::size_t>();
+        }
+        return StreamedField::loaded;
     }
 
-    return next_column;
+    using MappedFiles = std::map<std::string, std::unique_ptr<MappedFieldFile>>;
+
+    // fields.<name>.file names a field container (relative to the config's directory) and optionally
+    // .array the entry inside it (defaults to <name>). Containers are mapped once per load and shared
+    // by every field that references them. 1D fields are stored as one row, so pass expected_ny = 1.
+    template <typename T>
+    StreamedField find_mapped_field(const nlohmann::json& fields_node,
+                                    const char* name,
+                                    const std::filesystem::path& config_dir,
+                                    MappedFiles& files,
+                                    std::size_t expected_nx,
+                                    std::size_t expected_ny,
+                                    Field2DView<const T>& view_out)
+    {
+        if (!fields_node.contains(name)) return StreamedField::absent;
+        const auto& node = fields_node[name];
+        if (!node.is_object() || !node.contains("file")) return StreamedField::absent;
+        if (!node["file"].is_string()) return StreamedField::invalid;
+
+        std::filesystem::path file_path = node["file"].get<std::string>();
+        if (file_path.is_relative()) file_path = config_dir / file_path;
+        std::string array_name = name;
+        if (node.contains("array"))
+        {
+            if (!node["array"].is_string()) return StreamedField::invalid;
+            array_name = node["array"].get<std::string>();
+        }
+
+        std::unique_ptr<MappedFieldFile>& file = files[file_path.string()];
+        if (!file)
+        {
+            file = std::make_unique<MappedFieldFile>();
+            if (!file->open(file_path.string())) return StreamedField::invalid;
+        }
+        if (!file->is_open()) return StreamedField::invalid;
+
+        view_out = file->template view<T>(array_name);
+        if (view_out.empty() || view_out.nx != expected_nx || view_out.ny != expected_ny)
+        {
+            std::cerr << "[field_file] " << file_path.string() << ": no " << expected_nx << "x" << expected_ny
+                      << " array '" << array_name << "' of the right type for " << name << "\n";
+            return StreamedField::invalid;
+        }
+        return StreamedField::loaded;
+    }
 }
 
 bool load_simulation_config(const std::string& config_path,
                             Params& params_out,
                             Fields& fields_out)
+{
+    RunConfig run_config;
+    return load_simulation_config(config_path, params_out, fields_out, run_config);
+}
+
+bool load_simulation_config(const std::string& config_path,
+                            Params& params_out,
+                            Fields& fields_out,
+                            RunConfig& run_out)
 {
     // Attempt to open the requested configuration file; fail fast if the path is invalid.
     std::ifstream config_stream(config_path);
@@ -315,13 +662,23 @@ bool load_simulation_config(const std::string& config_path,
         return false;
     }
 
-    // Streams config file into json parser. If the json is malformed, errors and returns false.
+    // Field storage the parser streams fields.<name>.data into; everything else lands in root.
+    std::map<std::string, FieldDataSink> sinks;
+    sinks["air_mask"].mask = &fields_out.air_mask.data;
+    sinks["snow_density"].values = &fields_out.snow_density.data;
+    sinks["next_snow_density"].values = &fields_out.next_snow_density.data;
+    sinks["snow_transport_speed_x"].values = &fields_out.snow_transport_speed_x.data;
+    sinks["snow_transport_speed_y"].values = &fields_out.snow_transport_speed_y.data;
+    sinks["snow_accumulation_mass"].values = &fields_out.snow_accumulation_mass.data;
+    sinks["snow_accumulation_density"].values = &fields_out.snow_accumulation_density.data;
+    sinks["precipitation_source"].values = &fields_out.precipitation_source.data;
+    sinks["windborn_horizontal_source_left"].values = &fields_out.windborn_horizontal_source_left.data;
+    sinks["windborn_horizontal_source_right"].values = &fields_out.windborn_horizontal_source_right.data;
+
+    // Streams config file through the SAX parser. If the json is malformed (or field data is not numeric), returns false.
     nlohmann::json root;
-    try
-    {
-        config_stream >> root;
-    }
-    catch (const nlohmann::json::parse_error&)
+    ConfigSaxHandler handler(root, sinks);
+    if (!nlohmann::json::sax_parse(config_stream, &handler) || !root.is_object())
     {
         return false;
     }
@@ -333,7 +690,8 @@ bool load_simulation_config(const std::string& config_path,
     }
 
     // populate params object from file. if a param is missing a param return false
-    const auto& params_node = root["params"];
+    // non-const so a missing key reads as null and fails the get<> below instead of asserting
+    auto& params_node = root["params"];
     try
     {
         // Populate every numeric member of Params directly from the JSON object.
@@ -342,6 +700,10 @@ bool load_simulation_config(const std::string& config_path,
         params_out.precipitation_rate = params_node["precipitation_rate"].get<float>();
         params_out.ground_height = params_node["ground_height"].get<float>();
         params_out.settaled_snow_density = params_node["settaled_snow_density"].get<float>();
+        // erosion params are optional so older configs keep loading with erosion switched off.
+        params_out.erosion_threshold_friction_velocity = params_node.value("erosion_threshold_friction_velocity", 0.2f);
+        params_out.erosion_rate_coefficient = params_node.value("erosion_rate_coefficient", 0.0f);
+        params_out.surface_roughness_length = params_node.value("surface_roughness_length", 1e-4f);
         params_out.Lx = params_node["Lx"].get<float>();
         params_out.Ly = params_node["Ly"].get<float>();
         params_out.dx = params_node["dx"].get<float>();
@@ -349,6 +711,13 @@ bool load_simulation_config(const std::string& config_path,
         params_out.total_sim_time = params_node["total_sim_time"].get<float>();
         params_out.time_step_duration = params_node["time_step_duration"].get<float>();
         params_out.steps_per_frame = params_node["steps_per_frame"].get<int>();
+        params_out.top_inflow_cells = params_node.value("top_inflow_cells", static_cast<std::size_t>(0));
+        params_out.snow_source_steady_tolerance = params_node.value("snow_source_steady_tolerance", 1e-6f);
+        params_out.snow_source_steady_steps = params_node.value("snow_source_steady_steps", static_cast<std::size_t>(100));
+        params_out.equilibrium_tolerance = params_node.value("equilibrium_tolerance", 0.0f);
+        params_out.equilibrium_sample_interval = params_node.value("equilibrium_sample_interval", static_cast<std::size_t>(600));
+        params_out.equilibrium_stable_samples = params_node.value("equilibrium_stable_samples", static_cast<std::size_t>(3));
+        params_out.equilibrium_extrapolate = params_node.value("equilibrium_extrapolate", true);
 
         const auto light_direction_array = params_node["light_direction"];
         params_out.light_direction = glm::vec3(light_direction_array[0].get<float>(),
@@ -380,6 +749,62 @@ bool load_simulation_config(const std::string& config_path,
         return false;
     }
 
+    // optional run object: paths and streaming options that do not belong in Params
+    run_out = RunConfig{};
+    if (root.contains("run"))
+    {
+        const auto& run_node = root["run"];
+        if (!run_node.is_object())
+        {
+            return false;
+        }
+        try
+        {
+            run_out.forcing_path = run_node.value("forcing_path", run_out.forcing_path);
+            run_out.forcing_prefetch_records = run_node.value("forcing_prefetch_records", run_out.forcing_prefetch_records);
+            run_out.checkpoint_path = run_node.value("checkpoint_path", run_out.checkpoint_path);
+            run_out.checkpoint_interval_steps = run_node.value("checkpoint_interval_steps", run_out.checkpoint_interval_steps);
+            run_out.snapshot_directory = run_node.value("snapshot_directory", run_out.snapshot_directory);
+            run_out.snapshot_interval_steps = run_node.value("snapshot_interval_steps", run_out.snapshot_interval_steps);
+            run_out.snapshot_queue_depth = run_node.value("snapshot_queue_depth", run_out.snapshot_queue_depth);
+            run_out.snapshot_format = run_node.value("snapshot_format", run_out.snapshot_format);
+            run_out.snapshot_error_bound = run_node.value("snapshot_error_bound", run_out.snapshot_error_bound);
+            run_out.snapshot_tile = run_node.value("snapshot_tile", run_out.snapshot_tile);
+            run_out.snapshot_time_block = run_node.value("snapshot_time_block", run_out.snapshot_time_block);
+            run_out.dump_path = run_node.value("dump_path", run_out.dump_path);
+            run_out.dump_fields = run_node.value("dump_fields", run_out.dump_fields);
+        }
+        catch (const nlohmann::json::type_error&)
+        {
+            return false;
+        }
+        if (run_out.snapshot_format != "fields" && run_out.snapshot_format != "compressed" && run_out.snapshot_format != "archive")
+        {
+            std::cerr << "Warning: run.snapshot_format must be \"fields\", \"compressed\" or \"archive\", got \"" << run_out.snapshot_format << "\"\n";
+            return false;
+        }
+        if (run_out.snapshot_tile == 0 || run_out.snapshot_time_block == 0)
+        {
+            std::cerr << "Warning: run.snapshot_tile and run.snapshot_time_block must be positive\n";
+            return false;
+        }
+        if (!(run_out.snapshot_error_bound >= 0.0f))
+        {
+            std::cerr << "Warning: run.snapshot_error_bound must be >= 0\n";
+            return false;
+        }
+    }
+
+    // the backend is chosen next to the params, but as a string it cannot live in (POD) Params
+    try
+    {
+        run_out.backend = params_node.value("backend", run_out.backend);
+    }
+    catch (const nlohmann::json::type_error&)
+    {
+        return false;
+    }
+
     // checks that json contains a fields onject
     if (!root.contains("fields") || !root["fields"].is_object())
     {
@@ -388,189 +813,321 @@ bool load_simulation_config(const std::string& config_path,
 
     const auto& fields_node = root["fields"];
 
-    // Helper to populate 2D float fields (snow densities, velocity grids, etc.).
-    auto load_field2d = [](const nlohmann::json& node, Field2D<float>& field) -> bool
+    const std::size_t nx = params_out.nx;
+    const std::size_t ny = params_out.ny;
+
+    // Fields referencing a field container are copied out of the mapping; fields with inline data keep
+    // what was streamed; "uniform" ones and most defaults stay uniform (symbolic) until first written;
+    // empty ones get the generated default.
+    const std::filesystem::path config_dir = std::filesystem::path(config_path).parent_path();
+    MappedFiles mapped_files;
+
+    auto finish_field2d = [&](const char* name, auto& field, std::size_t field_nx, std::size_t field_ny, auto make_default) -> bool
     {
-        try
+        using value_type = typename std::decay_t<decltype(field.data)>::value_type;
+        if constexpr (std::is_same<value_type, float>::value)
         {
-            const std::size_t nx = node["nx"].get<std::size_t>();
-            const std::size_t ny = node["ny"].get<std::size_t>();
-            const auto& data = node["data"];
-            if (!data.is_array() || data.size() != nx * ny)
+            float uniform_value = 0.0f;
+            switch (find_uniform_field(fields_node, name, uniform_value))
             {
+            case StreamedField::loaded:
+                field = Field2D<float>::uniform(field_nx, field_ny, uniform_value);
+                return true;
+            case StreamedField::invalid:
                 return false;
+            default:
+                break;
             }
+        }
 
-            field.resize(nx, ny, 0.0f);
-            for (std::size_t idx = 0; idx < data.size(); ++idx)
-            {
-                field.data[idx] = data[idx].get<float>();
-            }
+        Field2DView<const value_type> view;
+        switch (find_mapped_field(fields_node, name, config_dir, mapped_files, field_nx, field_ny, view))
+        {
+        case StreamedField::loaded:
+            copy_mapped_field(view, field);
+            return true;
+        case StreamedField::invalid:
+            return false;
+        default:
+            break;
         }
-        catch (const nlohmann::json::type_error&)
+
+        switch (check_streamed_field(fields_node, name, sinks[name], field_nx, field_ny))
         {
+        case StreamedField::loaded:
+            field.nx = field_nx;
+            field.ny = field_ny;
+            field.uniform_value.reset();
+            return true;
+        case StreamedField::absent:
+            field = make_default();
+            return true;
+        default:
             return false;
         }
-        return true;
     };
 
-    // Helper to populate the uint8_t 2D air-mask.
-    auto load_field2d_u8 = [](const nlohmann::json& node, Field2D<std::uint8_t>& field) -> bool
+    // uniform_default: an absent field is left uniform rather than allocated.
+    auto finish_field1d = [&](const char* name, Field1D<float>& field, std::size_t field_nx, float default_value, bool uniform_default) -> bool
     {
-        try
+        float uniform_value = 0.0f;
+        switch (find_uniform_field(fields_node, name, uniform_value))
         {
-            const std::size_t nx = node["nx"].get<std::size_t>();
-            const std::size_t ny = node["ny"].get<std::size_t>();
-            const auto& data = node["data"];
-            if (!data.is_array() || data.size() != nx * ny)
-            {
-                return false;
-            }
+        case StreamedField::loaded:
+            field = Field1D<float>::uniform(field_nx, uniform_value);
+            return true;
+        case StreamedField::invalid:
+            return false;
+        default:
+            break;
+        }
 
-            field.resize(nx, ny, static_cast<std::uint8_t>(0));
-            for (std::size_t idx = 0; idx < data.size(); ++idx)
-            {
-                field.data[idx] = data[idx].get<std::uint8_t>();
-            }
+        Field2DView<const float> view;
+        switch (find_mapped_field(fields_node, name, config_dir, mapped_files, field_nx, 1, view))
+        {
+        case StreamedField::loaded:
+            copy_mapped_field(view, field);
+            return true;
+        case StreamedField::invalid:
+            return false;
+        default:
+            break;
         }
-        catch (const nlohmann::json::type_error&)
+
+        switch (check_streamed_field(fields_node, name, sinks[name], field_nx, 0))
         {
+        case StreamedField::loaded:
+            field.nx = field_nx;
+            field.uniform_value.reset();
+            return true;
+        case StreamedField::absent:
+            field = uniform_default ? Field1D<float>::uniform(field_nx, default_value) : Field1D<float>(field_nx, default_value);
+            return true;
+        default:
             return false;
         }
-        return true;
     };
 
-    // Helper to populate 1D float fields (boundary sources, accumulation arrays, etc.).
-    auto load_field1d = [](const nlohmann::json& node, Field1D<float>& field) -> bool
+    // air_mask may instead be cut from a DEM: fields.air_mask = { "terrain": path (relative to the config), ... }
+    if (fields_node.contains("air_mask") && fields_node["air_mask"].is_object() && fields_node["air_mask"].contains("terrain"))
     {
+        const auto& terrain_node = fields_node["air_mask"];
+        TerrainImportOptions terrain_options;
+        std::filesystem::path terrain_path;
         try
         {
-            const std::size_t nx = node["nx"].get<std::size_t>();
-            const auto& data = node["data"];
-            if (!data.is_array() || data.size() != nx)
-            {
-                return false;
-            }
-
-            field.resize(nx, 0.0f);
-            for (std::size_t idx = 0; idx < data.size(); ++idx)
-            {
-                field.data[idx] = data[idx].get<float>();
-            }
+            terrain_path = terrain_node["terrain"].get<std::string>();
+            terrain_options.row = terrain_node.value("row", terrain_options.row);
+            terrain_options.x_offset = terrain_node.value("x_offset", terrain_options.x_offset);
+            terrain_options.cell_size = terrain_node.value("cell_size", terrain_options.cell_size);
+            terrain_options.height_scale = terrain_node.value("height_scale", terrain_options.height_scale);
         }
         catch (const nlohmann::json::type_error&)
         {
             return false;
         }
-        return true;
-    };
+        if (terrain_path.is_relative()) terrain_path = config_dir / terrain_path;
+        if (!air_mask_from_dem(terrain_path.string(), params_out, terrain_options, fields_out.air_mask)) return false;
+        run_out.input_files.push_back(std::filesystem::absolute(terrain_path).lexically_normal().string());
+    }
+    else if (!finish_field2d("air_mask", fields_out.air_mask, nx, ny, [&] { return air_mask_flat(params_out, params_out.ground_height); })) return false;
+    if (!finish_field2d("snow_density", fields_out.snow_density, nx, ny, [&] { return Field2D<float>(nx, ny); })) return false;
+    if (!finish_field2d("next_snow_density", fields_out.next_snow_density, nx, ny, [&] { return Field2D<float>::uniform(nx, ny, 0.0f); })) return false;
+    if (!finish_field2d("snow_transport_speed_x", fields_out.snow_transport_speed_x, nx + 1, ny,
+                        [&] { return Field2D<float>::uniform(nx + 1, ny, params_out.wind_speed); })) return false;
+    if (!finish_field2d("snow_transport_speed_y", fields_out.snow_transport_speed_y, nx, ny + 1,
+                        [&] { return Field2D<float>::uniform(nx, ny + 1, -params_out.settling_speed); })) return false;
+    if (!finish_field1d("precipitation_source", fields_out.precipitation_source, nx, params_out.precipitation_rate, true)) return false;
+    if (!finish_field1d("windborn_horizontal_source_left", fields_out.windborn_horizontal_source_left, ny, 0.0f, true)) return false;
+    if (!finish_field1d("windborn_horizontal_source_right", fields_out.windborn_horizontal_source_right, ny, 0.0f, true)) return false;
+    if (!finish_field1d("snow_accumulation_mass", fields_out.snow_accumulation_mass, nx, 0.0f, false)) return false;
+    if (!finish_field1d("snow_accumulation_density", fields_out.snow_accumulation_density, nx, params_out.settaled_snow_density, true)) return false;
+    // the step updates these two in place, so a "uniform" one is written out now
+    fields_out.snow_density.materialize();
+    fields_out.snow_accumulation_mass.materialize();
+
+    for (const auto& mapped : mapped_files)
+    {
+        run_out.input_files.push_back(std::filesystem::absolute(mapped.first).lexically_normal().string());
+    }
 
-    // if (!load_field2d_u8(fields_node["air_mask"], fields_out.air_mask)) return false;
-    // if (!load_field2d(fields_node["snow_density"], fields_out.snow_density)) return false;
-    // if (!load_field2d(fields_node["next_snow_density"], fields_out.next_snow_density)) return false;
-    // if (!load_field2d(fields_node["snow_transport_speed_x"], fields_out.snow_transport_speed_x)) return false;
-    // if (!load_field2d(fields_node["snow_transport_speed_y"], fields_out.snow_transport_speed_y)) return false;
-    // if (!load_field1d(fields_node["snow_accumulation_mass"], fields_out.snow_accumulation_mass)) return false;
-    // if (!load_field1d(fields_node["snow_accumulation_density"], fields_out.snow_accumulation_density)) return false;
-    // if (!load_field1d(fields_node["precipitation_source"], fields_out.precipitation_source)) return false;
-    // if (!load_field1d(fields_node["windborn_horizontal_source_left"], fields_out.windborn_horizontal_source_left)) return false;
-    // if (!load_field1d(fields_node["windborn_horizontal_source_right"], fields_out.windborn_horizontal_source_right)) return false;
-
-    fields_out.air_mask = air_mask_flat(params_out, params_out.ground_height);
-    fields_out.snow_density = Field2D<float>(params_out.nx, params_out.ny);
-    fields_out.next_snow_density = Field2D<float>(params_out.nx, params_out.ny);
-    fields_out.snow_transport_speed_x = Field2D<float>(params_out.nx + 1, params_out.ny, params_out.wind_speed);
-    fields_out.snow_transport_speed_y = Field2D<float>(params_out.nx, params_out.ny + 1, -params_out.settling_speed);
-    fields_out.precipitation_source = Field1D<float>(params_out.nx, params_out.precipitation_rate);
-    fields_out.windborn_horizontal_source_left = Field1D<float>(params_out.ny, 0.0f);
-    fields_out.windborn_horizontal_source_right = Field1D<float>(params_out.ny, 0.0f);
-    fields_out.snow_accumulation_mass = Field1D<float>(params_out.nx);
-    fields_out.snow_accumulation_density = Field1D<float>(params_out.nx,params_out.settaled_snow_density);
+    // a dump carries the surface bookkeeping; otherwise it is derived from the mask and the settled snow
+    derive_surface_indices(fields_out, params_out);
+    for (const char* name : { "terrain_surface_index", "ground_surface_index" })
+    {
+        Field1D<std::size_t> index;
+        const StreamedField found = find_surface_index(fields_node, name, nx, ny, index);
+        if (found == StreamedField::invalid)
+        {
+            std::cerr << "Warning: fields." << name << " needs nx = " << nx << " values, each a row in 0.." << ny << "\n";
+            return false;
+        }
+        if (found != StreamedField::loaded) continue;
+        if (std::strcmp(name, "terrain_surface_index") == 0) fields_out.terrain_surface_index = std::move(index);
+        else fields_out.ground_surface_index = std::move(index);
+    }
+    fields_out.air_mask_dirty.clear();
 
     return true;
 }
 
-void dump_simulation_state_to_example_json(const Params& params,
-                                           const Fields& fields)
+bool dump_simulation_state_to_json(const Params& params,
+                                   const Fields& fields,
+                                   const StateDumpOptions& options)
 {
-    nlohmann::json root;
-
-    nlohmann::json params_node;
-    params_node["wind_speed"] = params.wind_speed;
-    params_node["settling_speed"] = params.settling_speed;
-    params_node["precipitation_rate"] = params.precipitation_rate;
-    params_node["ground_height"] = params.ground_height;
-    params_node["settaled_snow_density"] = params.settaled_snow_density;
-    params_node["Lx"] = params.Lx;
-    params_node["Ly"] = params.Ly;
-    params_node["dx"] = params.dx;
-    params_node["dy"] = params.dy;
-    params_node["nx"] = params.nx;
-    params_node["ny"] = params.ny;
-    params_node["total_sim_time"] = params.total_sim_time;
-    params_node["time_step_duration"] = params.time_step_duration;
-    params_node["total_time_steps"] = params.total_time_steps;
-    params_node["steps_per_frame"] = params.steps_per_frame;
-    params_node["light_direction"] = nlohmann::json::array({ params.light_direction.x,
-                                                             params.light_direction.y,
-                                                             params.light_direction.z });
-    params_node["light_color"] = nlohmann::json::array({ params.light_color.x,
-                                                         params.light_color.y,
-                                                         params.light_color.z });
-    params_node["object_color"] = nlohmann::json::array({ params.object_color.x,
-                                                          params.object_color.y,
-                                                          params.object_color.z });
-    root["params"] = params_node;
-
-    nlohmann::json fields_node;
-    fields_node["air_mask"] = {
-        { "nx", fields.air_mask.nx },
-        { "ny", fields.air_mask.ny },
-        { "data", fields.air_mask.data }
-    };
-    fields_node["snow_density"] = {
-        { "nx", fields.snow_density.nx },
-        { "ny", fields.snow_density.ny },
-        { "data", fields.snow_density.data }
-    };
-    fields_node["next_snow_density"] = {
-        { "nx", fields.next_snow_density.nx },
-        { "ny", fields.next_snow_density.ny },
-        { "data", fields.next_snow_density.data }
-    };
-    fields_node["snow_transport_speed_x"] = {
-        { "nx", fields.snow_transport_speed_x.nx },
-        { "ny", fields.snow_transport_speed_x.ny },
-        { "data", fields.snow_transport_speed_x.data }
-    };
-    fields_node["snow_transport_speed_y"] = {
-        { "nx", fields.snow_transport_speed_y.nx },
-        { "ny", fields.snow_transport_speed_y.ny },
-        { "data", fields.snow_transport_speed_y.data }
-    };
-    fields_node["snow_accumulation_mass"] = {
-        { "nx", fields.snow_accumulation_mass.nx },
-        { "data", fields.snow_accumulation_mass.data }
-    };
-    fields_node["snow_accumulation_density"] = {
-        { "nx", fields.snow_accumulation_density.nx },
-        { "data", fields.snow_accumulation_density.data }
-    };
-    fields_node["precipitation_source"] = {
-        { "nx", fields.precipitation_source.nx },
-        { "data", fields.precipitation_source.data }
+    // Fields in the order they are written; each entry writes nx (ny) and data straight from the field.
+    struct DumpField
+    {
+        const char* name;
+        const Field2D<float>* field2d;
+        const Field2D<uint8_t>* mask;
+        const Field1D<float>* field1d;
     };
-    fields_node["windborn_horizontal_source_left"] = {
-        { "nx", fields.windborn_horizontal_source_left.nx },
-        { "data", fields.windborn_horizontal_source_left.data }
+    const DumpField all_fields[] = {
+        { "air_mask", nullptr, &fields.air_mask, nullptr },
+        { "snow_density", &fields.snow_density, nullptr, nullptr },
+        { "next_snow_density", &fields.next_snow_density, nullptr, nullptr },
+        { "snow_transport_speed_x", &fields.snow_transport_speed_x, nullptr, nullptr },
+        { "snow_transport_speed_y", &fields.snow_transport_speed_y, nullptr, nullptr },
+        { "snow_accumulation_mass", nullptr, nullptr, &fields.snow_accumulation_mass },
+        { "snow_accumulation_density", nullptr, nullptr, &fields.snow_accumulation_density },
+        { "precipitation_source", nullptr, nullptr, &fields.precipitation_source },
+        { "windborn_horizontal_source_left", nullptr, nullptr, &fields.windborn_horizontal_source_left },
+        { "windborn_horizontal_source_right", nullptr, nullptr, &fields.windborn_horizontal_source_right },
     };
-    fields_node["windborn_horizontal_source_right"] = {
-        { "nx", fields.windborn_horizontal_source_right.nx },
-        { "data", fields.windborn_horizontal_source_right.data }
+
+    // next_snow_density is scratch for the step, so it is only written when asked for by name.
+    std::vector<bool> selected(std::size(all_fields), options.fields.empty());
+    selected[2] = false;
+    for (const std::string& name : options.fields)
+    {
+        const auto match = std::find_if(std::begin(all_fields), std::end(all_fields),
+                                        [&name](const DumpField& field) { return name == field.name; });
+        if (match == std::end(all_fields))
+        {
+            std::cerr << "Warning: cannot dump unknown field \"" << name << "\"\n";
+            return false;
+        }
+        selected[static_cast<std::size_t>(match - std::begin(all_fields))] = true;
+    }
+
+    JsonFileWriter writer;
+    if (!writer.open(options.path)) return false;
+
+    const auto write_vec3 = [&writer](const char* name, const glm::vec3& v)
+    {
+        const float values[3] = { v.x, v.y, v.z };
+        writer.key(name);
+        writer.array(values, 3);
     };
-    root["fields"] = fields_node;
 
-    std::ofstream output_stream("resources/configs/example1.json");
-    output_stream << root.dump(2);
+    writer.begin_object();
+    writer.key("params");
+    writer.begin_object();
+    writer.key("wind_speed"); writer.value(params.wind_speed);
+    writer.key("settling_speed"); writer.value(params.settling_speed);
+    writer.key("precipitation_rate"); writer.value(params.precipitation_rate);
+    writer.key("ground_height"); writer.value(params.ground_height);
+    writer.key("settaled_snow_density"); writer.value(params.settaled_snow_density);
+    writer.key("erosion_threshold_friction_velocity"); writer.value(params.erosion_threshold_friction_velocity);
+    writer.key("erosion_rate_coefficient"); writer.value(params.erosion_rate_coefficient);
+    writer.key("surface_roughness_length"); writer.value(params.surface_roughness_length);
+    writer.key("Lx"); writer.value(params.Lx);
+    writer.key("Ly"); writer.value(params.Ly);
+    writer.key("dx"); writer.value(params.dx);
+    writer.key("dy"); writer.value(params.dy);
+    writer.key("nx"); writer.value(params.nx);
+    writer.key("ny"); writer.value(params.ny);
+    writer.key("total_sim_time"); writer.value(params.total_sim_time);
+    writer.key("time_step_duration"); writer.value(params.time_step_duration);
+    writer.key("total_time_steps"); writer.value(params.total_time_steps);
+    writer.key("steps_per_frame"); writer.value(params.steps_per_frame);
+    writer.key("top_inflow_cells"); writer.value(params.top_inflow_cells);
+    writer.key("snow_source_steady_tolerance"); writer.value(params.snow_source_steady_tolerance);
+    writer.key("snow_source_steady_steps"); writer.value(params.snow_source_steady_steps);
+    writer.key("equilibrium_tolerance"); writer.value(params.equilibrium_tolerance);
+    writer.key("equilibrium_sample_interval"); writer.value(params.equilibrium_sample_interval);
+    writer.key("equilibrium_stable_samples"); writer.value(params.equilibrium_stable_samples);
+    writer.key("equilibrium_extrapolate"); writer.value(params.equilibrium_extrapolate);
+    write_vec3("light_direction", params.light_direction);
+    write_vec3("light_color", params.light_color);
+    write_vec3("object_color", params.object_color);
+    writer.key("arrow_plane_z"); writer.value(params.arrow_plane_z);
+    writer.key("arrow_density_max"); writer.value(params.arrow_density_max);
+    writer.key("arrow_reference_wind"); writer.value(params.arrow_reference_wind);
+    writer.key("arrow_min_length"); writer.value(params.arrow_min_length);
+    writer.key("viz_on"); writer.value(params.viz_on);
+    writer.end_object();
+
+    // nx / ny ahead of data, so the loader can size each field before its values arrive.
+    writer.key("fields");
+    writer.begin_object();
+    for (std::size_t k = 0; k < std::size(all_fields); ++k)
+    {
+        if (!selected[k]) continue;
+        const DumpField& field = all_fields[k];
+        writer.key(field.name);
+        writer.begin_object();
+        if (field.field2d && field.field2d->is_uniform())
+        {
+            writer.key("uniform"); writer.value(*field.field2d->uniform_value);
+        }
+        else if (field.field1d && field.field1d->is_uniform())
+        {
+            writer.key("uniform"); writer.value(*field.field1d->uniform_value);
+        }
+        else if (field.field2d)
+        {
+            writer.key("nx"); writer.value(field.field2d->nx);
+            writer.key("ny"); writer.value(field.field2d->ny);
+            writer.key("data"); writer.array(field.field2d->data.data(), field.field2d->data.size());
+        }
+        else if (field.mask)
+        {
+            writer.key("nx"); writer.value(field.mask->nx);
+            writer.key("ny"); writer.value(field.mask->ny);
+            writer.key("data"); writer.array(field.mask->data.data(), field.mask->data.size());
+        }
+        else
+        {
+            writer.key("nx"); writer.value(field.field1d->nx);
+            writer.key("data"); writer.array(field.field1d->data.data(), field.field1d->data.size());
+        }
+        writer.end_object();
+    }
+
+    // the surface bookkeeping goes with the mask: its ground already includes the settled snow, and
+    // the terrain beneath cannot be told apart from it afterwards
+    if (selected[0])
+    {
+        for (const auto& index : { std::make_pair("terrain_surface_index", &fields.terrain_surface_index),
+                                   std::make_pair("ground_surface_index", &fields.ground_surface_index) })
+        {
+            if (index.second->nx != fields.air_mask.nx) continue; // not built yet (no step so far)
+            writer.key(index.first);
+            writer.begin_object();
+            writer.key("nx"); writer.value(index.second->nx);
+            writer.key("data");
+            writer.begin_array();
+            for (const std::size_t row : index.second->data) writer.value(row);
+            writer.end_array();
+            writer.end_object();
+        }
+    }
+    writer.end_object();
+    writer.end_object();
+
+    if (!writer.close())
+    {
+        std::cerr << "Warning: failed to write state dump " << options.path << "\n";
+        return false;
+    }
+    return true;
+}
+
+void dump_simulation_state_to_example_json(const Params& params,
+                                           const Fields& fields)
+{
+    dump_simulation_state_to_json(params, fields, StateDumpOptions{});
 }
 } // namespace snow
@@ -0,0 +1,218 @@
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <ostream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace snow
+{
+
+namespace
+{
+#if defined(__linux__)
+    // Disabled, user-space-only counter on one thread (0: the calling one); threads it starts are not counted.
+    int open_counter(std::uint32_t type, std::uint64_t config, int thread_id, int group_fd)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = group_fd < 0 ? 1 : 0; // members follow their leader
+        attr.exclude_kernel = 1; // what perf_event_paranoid 2 allows
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, thread_id, -1, group_fd, 0));
+    }
+
+    std::string open_error(int error)
+    {
+        if (error == ENOENT || error == EOPNOTSUPP)
+        {
+            return "no hardware counters on this CPU or virtual machine";
+        }
+        if (error == EACCES || error == EPERM)
+        {
+            std::string paranoid = "?";
+            std::ifstream in("/proc/sys/kernel/perf_event_paranoid");
+            in >> paranoid;
+            return "perf events not permitted (kernel.perf_event_paranoid = " + paranoid + ", counting needs 2 or less)";
+        }
+        return std::strerror(error);
+    }
+
+    // Counter value scaled by enabled over running time; flags multiplexing.
+    std::uint64_t read_scaled(int fd, bool& multiplexed)
+    {
+        std::uint64_t values[3] = { 0, 0, 0 }; // value, time enabled, time running
+        if (fd < 0 || ::read(fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) return 0;
+        if (values[2] == 0) return 0;
+        if (values[2] < values[1])
+        {
+            multiplexed = true;
+            return static_cast<std::uint64_t>(static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]));
+        }
+        return values[0];
+    }
+#endif
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+    close();
+}
+
+bool PerfCounterGroup::open(const std::vector<int>& other_threads)
+{
+    close();
+    error_.clear();
+#if defined(__linux__)
+    if (!open_thread(0)) return false;
+    for (const int thread_id : other_threads)
+    {
+        if (!open_thread(thread_id)) return false;
+    }
+    return true;
+#else
+    (void)other_threads;
+    error_ = "perf_event_open is Linux only";
+    return false;
+#endif
+}
+
+bool PerfCounterGroup::open_thread(int thread_id)
+{
+#if defined(__linux__)
+    threads_.emplace_back();
+    ThreadCounters& thread = threads_.back();
+    thread.cycles_fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, thread_id, -1);
+    if (thread.cycles_fd >= 0)
+    {
+        thread.instructions_fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, thread_id, thread.cycles_fd);
+        thread.llc_references_fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES, thread_id, thread.cycles_fd);
+        thread.llc_misses_fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, thread_id, thread.cycles_fd);
+        if (thread.llc_references_fd < 0 || thread.llc_misses_fd < 0) error_ = "no last-level cache counters";
+    }
+    else
+    {
+        error_ = open_error(errno);
+    }
+
+    thread.task_clock_fd = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, thread_id, -1);
+    if (thread.task_clock_fd < 0)
+    {
+        error_ = open_error(errno);
+        close();
+        return false;
+    }
+    return true;
+#else
+    (void)thread_id;
+    return false;
+#endif
+}
+
+void PerfCounterGroup::close()
+{
+#if defined(__linux__)
+    for (ThreadCounters& thread : threads_)
+    {
+        for (const int fd : { thread.llc_misses_fd, thread.llc_references_fd, thread.instructions_fd, thread.cycles_fd, thread.task_clock_fd })
+        {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+#endif
+    threads_.clear();
+}
+
+void PerfCounterGroup::start()
+{
+#if defined(__linux__)
+    for (const ThreadCounters& thread : threads_)
+    {
+        if (thread.cycles_fd >= 0) ioctl(thread.cycles_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        ioctl(thread.task_clock_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void PerfCounterGroup::stop()
+{
+#if defined(__linux__)
+    for (const ThreadCounters& thread : threads_)
+    {
+        if (thread.cycles_fd >= 0) ioctl(thread.cycles_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        ioctl(thread.task_clock_fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+}
+
+PerfCounts PerfCounterGroup::read() const
+{
+    PerfCounts counts;
+#if defined(__linux__)
+    counts.hardware = !threads_.empty();
+    counts.cache = !threads_.empty();
+    for (const ThreadCounters& thread : threads_)
+    {
+        counts.hardware = counts.hardware && thread.cycles_fd >= 0 && thread.instructions_fd >= 0;
+        counts.cache = counts.cache && thread.llc_references_fd >= 0 && thread.llc_misses_fd >= 0;
+        counts.cycles += read_scaled(thread.cycles_fd, counts.multiplexed);
+        counts.instructions += read_scaled(thread.instructions_fd, counts.multiplexed);
+        counts.llc_references += read_scaled(thread.llc_references_fd, counts.multiplexed);
+        counts.llc_misses += read_scaled(thread.llc_misses_fd, counts.multiplexed);
+        counts.task_clock_ns += read_scaled(thread.task_clock_fd, counts.multiplexed);
+    }
+#endif
+    return counts;
+}
+
+PerfMetrics derive_perf_metrics(const PerfCounts& counts, double cell_updates, double step_seconds, double kernel_bytes_per_cell)
+{
+    const std::size_t cache_line_bytes = 64;
+    PerfMetrics metrics;
+    if (counts.cycles > 0) metrics.ipc = static_cast<double>(counts.instructions) / static_cast<double>(counts.cycles);
+    if (counts.llc_references > 0) metrics.llc_miss_rate = static_cast<double>(counts.llc_misses) / static_cast<double>(counts.llc_references);
+    if (cell_updates > 0.0) metrics.llc_bytes_per_cell = static_cast<double>(counts.llc_misses * cache_line_bytes) / cell_updates;
+    if (step_seconds > 0.0)
+    {
+        metrics.busy_threads = static_cast<double>(counts.task_clock_ns) * 1.0e-9 / step_seconds;
+        metrics.kernel_bytes_per_second = cell_updates * kernel_bytes_per_cell / step_seconds;
+        metrics.llc_bytes_per_second = static_cast<double>(counts.llc_misses * cache_line_bytes) / step_seconds;
+    }
+    return metrics;
+}
+
+void print_perf_report(std::ostream& out, const PerfCounts& counts, double cell_updates, double step_seconds,
+                       double kernel_bytes_per_cell)
+{
+    const PerfMetrics metrics = derive_perf_metrics(counts, cell_updates, step_seconds, kernel_bytes_per_cell);
+    out << "[perf] step: " << metrics.busy_threads << " threads busy on average (task clock "
+        << static_cast<double>(counts.task_clock_ns) * 1.0e-9 << " s)"
+        << (counts.multiplexed ? ", counts scaled for multiplexing" : "") << "\n";
+    if (counts.hardware)
+    {
+        out << "[perf] step: " << counts.cycles << " cycles, " << counts.instructions << " instructions, IPC " << metrics.ipc << "\n";
+    }
+    if (counts.cache)
+    {
+        out << "[perf] step: " << counts.llc_references << " LLC references, " << counts.llc_misses << " misses ("
+            << metrics.llc_miss_rate * 100.0 << "%), " << metrics.llc_bytes_per_cell << " bytes/cell from LLC misses\n";
+    }
+    out << "[perf] step: " << metrics.kernel_bytes_per_second / 1.0e9 << " GB/s at the kernel's " << kernel_bytes_per_cell
+        << " bytes/cell";
+    if (counts.cache) out << ", " << metrics.llc_bytes_per_second / 1.0e9 << " GB/s measured from LLC misses";
+    out << "\n";
+}
+
+} // namespace snow
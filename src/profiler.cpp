@@ -0,0 +1,165 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace snow
+{
+namespace profile
+{
+
+namespace
+{
+    // Counters of every thread that ever recorded, kept after the thread exits so its time still counts.
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadCounters>> threads;
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    ThreadCounters* register_thread()
+    {
+        Registry& all = registry();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        all.threads.push_back(std::make_unique<ThreadCounters>());
+        return all.threads.back().get();
+    }
+
+    // smallest duration (ns) that falls past bucket b
+    double bucket_upper_ns(std::size_t bucket)
+    {
+        if (bucket < 16) return static_cast<double>(bucket + 1);
+        const std::size_t octave = 4 + (bucket - 16) / 4;
+        const std::size_t sub = (bucket - 16) % 4;
+        return static_cast<double>(5 + sub) * static_cast<double>(std::uint64_t{ 1 } << (octave - 2));
+    }
+}
+
+const char* phase_name(Phase phase)
+{
+    static const char* const names[] = { "step", "advect", "advect_band", "deposit", "swap", "ground_update", "forcing",
+                                         "boundary", "snow_source", "equilibrium", "checkpoint", "snapshot", "hooks",
+                                         "render", "present", "config_load", "field_print", "dump", "snapshot_write",
+                                         "forcing_read", "forcing_wait" };
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<std::size_t>(Phase::count), "one name per phase");
+    return names[static_cast<std::size_t>(phase)];
+}
+
+ThreadCounters& thread_counters()
+{
+    thread_local ThreadCounters* counters = register_thread();
+    return *counters;
+}
+
+std::size_t histogram_bucket(std::uint64_t ns)
+{
+    if (ns < 16) return static_cast<std::size_t>(ns);
+    std::size_t octave = 0;
+    for (std::uint64_t v = ns; v > 1; v >>= 1) ++octave;
+    const std::size_t sub = static_cast<std::size_t>(ns >> (octave - 2)) & 3u;
+    return std::min<std::size_t>(16 + (octave - 4) * 4 + sub, histogram_buckets - 1);
+}
+
+PhaseSummary summarize(Phase phase)
+{
+    PhaseCounters merged;
+    {
+        Registry& all = registry();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        for (const std::unique_ptr<ThreadCounters>& thread : all.threads)
+        {
+            const PhaseCounters& counters = thread->phases[static_cast<std::size_t>(phase)];
+            merged.calls += counters.calls;
+            merged.total_ns += counters.total_ns;
+            merged.max_ns = std::max(merged.max_ns, counters.max_ns);
+            for (std::size_t b = 0; b < histogram_buckets; ++b) merged.histogram[b] += counters.histogram[b];
+        }
+    }
+
+    PhaseSummary summary;
+    summary.calls = merged.calls;
+    if (merged.calls == 0) return summary;
+    summary.total_seconds = static_cast<double>(merged.total_ns) * 1.0e-9;
+    summary.mean_seconds = summary.total_seconds / static_cast<double>(merged.calls);
+    summary.max_seconds = static_cast<double>(merged.max_ns) * 1.0e-9;
+
+    // first bucket where at least 99% of the calls have been seen
+    const std::uint64_t rank = (merged.calls * 99 + 99) / 100;
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < histogram_buckets; ++b)
+    {
+        seen += merged.histogram[b];
+        if (seen >= rank)
+        {
+            summary.p99_seconds = std::min(bucket_upper_ns(b), static_cast<double>(merged.max_ns)) * 1.0e-9;
+            break;
+        }
+    }
+    return summary;
+}
+
+void reset()
+{
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    for (const std::unique_ptr<ThreadCounters>& thread : all.threads) *thread = ThreadCounters{};
+}
+
+void reset(std::initializer_list<Phase> phases)
+{
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    for (const std::unique_ptr<ThreadCounters>& thread : all.threads)
+    {
+        for (const Phase phase : phases) thread->phases[static_cast<std::size_t>(phase)] = PhaseCounters{};
+    }
+}
+
+void print_report(std::ostream& out, std::size_t cells)
+{
+    if (!SNOWSIM_PROFILE)
+    {
+        out << "[profile] disabled (configure with -DSNOWSIM_ENABLE_PROFILING=ON)\n";
+        return;
+    }
+
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << "[profile] " << std::left << std::setw(14) << "phase" << std::right << std::setw(10) << "calls"
+        << std::setw(12) << "total s" << std::setw(12) << "mean us" << std::setw(12) << "p99 us" << std::setw(12) << "max us" << "\n";
+    out << std::fixed;
+    for (std::size_t p = 0; p < static_cast<std::size_t>(Phase::count); ++p)
+    {
+        const PhaseSummary summary = summarize(static_cast<Phase>(p));
+        if (summary.calls == 0) continue;
+        out << "[profile] " << std::left << std::setw(14) << phase_name(static_cast<Phase>(p)) << std::right
+            << std::setw(10) << summary.calls
+            << std::setw(12) << std::setprecision(4) << summary.total_seconds
+            << std::setw(12) << std::setprecision(1) << summary.mean_seconds * 1.0e6
+            << std::setw(12) << summary.p99_seconds * 1.0e6
+            << std::setw(12) << summary.max_seconds * 1.0e6 << "\n";
+    }
+
+    const PhaseSummary step = summarize(Phase::step);
+    if (step.total_seconds > 0.0)
+    {
+        out << "[profile] " << std::setprecision(2)
+            << static_cast<double>(step.calls) * static_cast<double>(cells) / step.total_seconds / 1.0e6
+            << " Mcell updates/s over the step phase\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace profile
+} // namespace snow
@@ -0,0 +1,38 @@
+#include "render_exchange.hpp"
+
+namespace snow
+{
+
+void RenderExchange::publish(long long step, const Params& params, Fields& fields)
+{
+    // The renderer shows either the previous frame or one it took earlier. If the previous publish found
+    // the frame before it read, the renderer is at least that far: the last two deltas cover the gap.
+    // Otherwise it is no further than when the previous frame was written, which that frame's region covers.
+    RenderFrame& frame = buffer_.back();
+    DirtyRegion dirty = fields.air_mask_dirty;
+    dirty.include(previous_unread_ ? previous_dirty_ : previous_delta_);
+
+    // copy-assigning into the slot reuses its buffers after the first few frames
+    frame.step = step;
+    frame.params = params;
+    frame.fields.snow_density = fields.snow_density;
+    frame.fields.air_mask = fields.air_mask;
+    frame.fields.air_mask_dirty = dirty;
+    frame.fields.snow_transport_speed_x = fields.snow_transport_speed_x;
+    frame.fields.snow_transport_speed_y = fields.snow_transport_speed_y;
+
+    previous_delta_ = fields.air_mask_dirty;
+    previous_dirty_ = dirty;
+    fields.air_mask_dirty.clear();
+    previous_unread_ = buffer_.publish();
+    ++published_;
+}
+
+RenderFrame& RenderExchange::latest(bool* fresh_out)
+{
+    const bool fresh = buffer_.update();
+    if (fresh_out) *fresh_out = fresh;
+    return buffer_.front();
+}
+
+} // namespace snow
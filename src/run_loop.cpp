@@ -0,0 +1,321 @@
+#include "run_loop.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <ostream>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "equilibrium_monitor.hpp"
+#include "field_archive.hpp"
+#include "forcing_stream.hpp"
+#include "my_helper.hpp"
+#include "profiler.hpp"
+#include "snapshot_codec.hpp"
+#include "snapshot_writer.hpp"
+#include "snow_source_boundary.hpp"
+
+namespace snow
+{
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    float max_abs_speed(const Field2D<float>& speed)
+    {
+        if (speed.is_uniform()) return std::fabs(*speed.uniform_value);
+        float max_abs = 0.0f;
+        for (const float v : speed.data)
+        {
+            max_abs = std::max(max_abs, std::fabs(v));
+        }
+        return max_abs;
+    }
+
+    // warn if a single step could advect snow beyond immediate neighbours.
+    // TODO: Refine CFL safety check to capture local variations and per-direction thresholds.
+    void warn_if_cfl_exceeded(const Params& params, const Fields& fields)
+    {
+        const float cfl_x = max_abs_speed(fields.snow_transport_speed_x) * params.time_step_duration / params.dx;
+        const float cfl_y = max_abs_speed(fields.snow_transport_speed_y) * params.time_step_duration / params.dy;
+        if (cfl_x > 1.0f || cfl_y > 1.0f)
+        {
+            std::cerr << "Warning: CFL condition exceeded (CFL_x=" << cfl_x
+                      << ", CFL_y=" << cfl_y << ")\n";
+        }
+    }
+}
+
+bool run_simulation(Simulation& sim,
+                    Params& params,
+                    Fields& fields,
+                    const RunConfig& run_config,
+                    const std::string& restart_path,
+                    const RunHooks& hooks,
+                    RunTimings& timings)
+{
+    const Clock::time_point run_start = Clock::now();
+    timings = RunTimings{};
+    timings.cells = params.nx * params.ny;
+
+    const std::uint64_t config_hash = params_hash(params); // before forcing starts changing the weather params
+
+    // time-varying weather: the first record replaces the constant wind/settling/precipitation params.
+    ForcingStream forcing;
+    ForcingRecord forcing_sample;
+    const bool forcing_on = !run_config.forcing_path.empty();
+    if (forcing_on)
+    {
+        if (!forcing_fits_speed_fields(fields) || !forcing.open(run_config.forcing_path, run_config.forcing_prefetch_records)
+            || !forcing.sample(0.0, forcing_sample))
+        {
+            std::cerr << "[forcing] failed to load forcing series " << run_config.forcing_path << "\n";
+            return false;
+        }
+        apply_forcing(forcing_sample, params, fields, params.top_inflow_cells == 0);
+        std::cout << "[forcing] streaming " << forcing.record_count() << " records from " << run_config.forcing_path << "\n";
+    }
+
+    // boundary source columns: the upwind side gets a column as tall as the grid, the top one is opt-in.
+    // with forcing the wind can turn, so both sides get a column and apply() feeds whichever is upwind.
+    std::vector<SnowSourceBoundary> boundary_sources;
+    if (params.wind_speed > 0.0f || forcing_on) boundary_sources.emplace_back(BoundarySide::left, params, params.ny);
+    if (params.wind_speed < 0.0f || forcing_on) boundary_sources.emplace_back(BoundarySide::right, params, params.ny);
+    if (params.top_inflow_cells > 0) boundary_sources.emplace_back(BoundarySide::top, params, params.top_inflow_cells);
+
+    // equilibrium under changing weather is only temporary, so early termination is off with forcing.
+    Params monitor_params = params;
+    if (forcing_on) monitor_params.equilibrium_tolerance = 0.0f;
+    EquilibriumMonitor equilibrium(monitor_params);
+
+    // resume: fields, boundary columns, monitor history and forcing-driven params come from the checkpoint.
+    long long start_step = 0;
+    if (!restart_path.empty())
+    {
+        if (!read_checkpoint(restart_path, config_hash, start_step, params, fields, boundary_sources, equilibrium))
+        {
+            std::cerr << "[checkpoint] restart from " << restart_path << " failed\n";
+            return false;
+        }
+        std::cout << "[checkpoint] restarting at step " << start_step << " (t=" << static_cast<float>(start_step) * params.time_step_duration << " s)\n";
+    }
+    timings.start_step = start_step;
+    CheckpointWriter checkpoints;
+    const bool checkpoints_on = !run_config.checkpoint_path.empty() && run_config.checkpoint_interval_steps > 0;
+
+    // periodic snapshots are serialized and written on a background thread.
+    SnapshotWriter snapshots;
+    SnapshotStreamWriter snapshot_stream; // "compressed" format: one delta-coded series per (re)start
+    ArchiveWriter snapshot_archive;       // "archive" format: one chunked density archive per (re)start
+    bool snapshots_on = !run_config.snapshot_directory.empty() && run_config.snapshot_interval_steps > 0;
+    if (snapshots_on)
+    {
+        SnapshotWriter::Sink sink = field_file_snapshot_sink(run_config.snapshot_directory);
+        std::error_code error;
+        const std::string series_path = (std::filesystem::path(run_config.snapshot_directory)
+                                         / ("snapshots_" + std::to_string(start_step))).string();
+        if (run_config.snapshot_format == "compressed")
+        {
+            std::filesystem::create_directories(run_config.snapshot_directory, error);
+            FieldCodecOptions codec_options;
+            codec_options.error_bound = run_config.snapshot_error_bound;
+            snapshots_on = snapshot_stream.open(series_path + ".snz", codec_options);
+            sink = [&snapshot_stream](const Snapshot& snapshot) { return snapshot_stream.write(snapshot); };
+        }
+        else if (run_config.snapshot_format == "archive")
+        {
+            std::filesystem::create_directories(run_config.snapshot_directory, error);
+            ArchiveOptions archive_options;
+            archive_options.tile_nx = run_config.snapshot_tile;
+            archive_options.tile_ny = run_config.snapshot_tile;
+            archive_options.time_block = run_config.snapshot_time_block;
+            archive_options.error_bound = run_config.snapshot_error_bound;
+            snapshots_on = snapshot_archive.open(series_path + ".snarc", params.nx, params.ny, archive_options);
+            sink = [&snapshot_archive](const Snapshot& snapshot)
+            {
+                return snapshot_archive.append(snapshot.step, snapshot.time, snapshot.snow_density);
+            };
+        }
+        snapshots_on = snapshots_on && snapshots.start(sink, run_config.snapshot_queue_depth);
+    }
+
+    warn_if_cfl_exceeded(params, fields);
+
+    if (hooks.started) hooks.started(params, fields);
+    timings.setup_seconds = seconds_since(run_start);
+
+    long long t = start_step;
+    for (; t < params.total_time_steps; ++t)
+    {
+        if (hooks.before_step)
+        {
+            const Clock::time_point hook_start = Clock::now();
+            bool keep_going = true;
+            {
+                SNOW_PROFILE_SCOPE(hooks);
+                keep_going = hooks.before_step(t, params, fields);
+            }
+            timings.output_seconds += seconds_since(hook_start);
+            if (!keep_going)
+            {
+                timings.stopped_early = true;
+                break;
+            }
+        }
+
+        Clock::time_point phase_start = Clock::now();
+        if (forcing_on && t > 0)
+        {
+            SNOW_PROFILE_SCOPE(forcing);
+            forcing.sample(static_cast<double>(t) * params.time_step_duration, forcing_sample);
+            apply_forcing(forcing_sample, params, fields, params.top_inflow_cells == 0);
+        }
+        timings.boundary_seconds += seconds_since(phase_start);
+
+        phase_start = Clock::now();
+        {
+            SNOW_PROFILE_SCOPE(step);
+            sim.step(fields, params);
+        }
+        timings.step_seconds += seconds_since(phase_start);
+
+        phase_start = Clock::now();
+        {
+            SNOW_PROFILE_SCOPE(snapshot);
+            snapshots.collect(fields); // a snapshot marked last step leaves with the density this step just retired
+        }
+        timings.output_seconds += seconds_since(phase_start);
+
+        // incrementing/ramping boundry sorces, written straight into the windborn/precipitation sources
+        phase_start = Clock::now();
+        for (SnowSourceBoundary& source : boundary_sources)
+        {
+            SNOW_PROFILE_SCOPE(boundary);
+            if (forcing_on) source.set_forcing(params.settling_speed, params.precipitation_rate, params.wind_speed);
+            if (source.is_frozen()) continue; // steady column: its inflow was written when it froze
+
+            source.advance();
+            source.apply(fields);
+
+            if (source.is_frozen())
+            {
+                static const char* const side_names[] = { "left", "right", "top" };
+                std::cout << "[snow_source] " << side_names[static_cast<int>(source.side())]
+                          << " boundary column reached steady state, frozen at step " << source.frozen_step()
+                          << " (t=" << static_cast<float>(source.frozen_step()) * params.time_step_duration << " s)\n";
+            }
+        }
+
+        // stop once the drift has stopped changing; optionally carry the deposition on to total_sim_time.
+        bool stationary = false;
+        {
+            SNOW_PROFILE_SCOPE(equilibrium);
+            stationary = equilibrium.observe(fields, t + 1);
+        }
+        timings.boundary_seconds += seconds_since(phase_start);
+        if (stationary)
+        {
+            const float remaining_time = static_cast<float>(params.total_time_steps - (t + 1)) * params.time_step_duration;
+            std::cout << "[equilibrium] stationary at step " << t + 1 << " (t=" << static_cast<float>(t + 1) * params.time_step_duration
+                      << " s): density change " << equilibrium.density_change()
+                      << ", deposition change " << equilibrium.deposition_change()
+                      << ", deposition rate " << equilibrium.deposition_rate() << " g/s\n";
+            if (params.equilibrium_extrapolate)
+            {
+                equilibrium.extrapolate_accumulation(fields, params, remaining_time);
+                std::cout << "[equilibrium] extrapolated accumulation over the remaining " << remaining_time << " s\n";
+            }
+            else
+            {
+                std::cout << "[equilibrium] stopping early, skipped " << remaining_time << " s of simulated time\n";
+            }
+            ++t;
+            timings.stopped_early = t < params.total_time_steps;
+            break;
+        }
+
+        phase_start = Clock::now();
+        if (checkpoints_on && (t + 1) % static_cast<long long>(run_config.checkpoint_interval_steps) == 0)
+        {
+            SNOW_PROFILE_SCOPE(checkpoint);
+            if (checkpoints.write(run_config.checkpoint_path, t + 1, config_hash, params, fields, boundary_sources, equilibrium))
+            {
+                std::cout << "[checkpoint] step " << t + 1 << ": " << checkpoints.last_bytes() / 1.0e6 << " MB in "
+                          << checkpoints.last_seconds() << " s\n";
+            }
+        }
+
+        if (snapshots_on && (t + 1) % static_cast<long long>(run_config.snapshot_interval_steps) == 0)
+        {
+            SNOW_PROFILE_SCOPE(snapshot);
+            snapshots.mark(t + 1, static_cast<double>(t + 1) * params.time_step_duration, fields);
+        }
+
+        if (hooks.output && hooks.output_interval_steps > 0 && (t + 1) % hooks.output_interval_steps == 0)
+        {
+            SNOW_PROFILE_SCOPE(hooks);
+            hooks.output(t + 1, params, fields);
+        }
+        timings.output_seconds += seconds_since(phase_start);
+    }
+    timings.steps = t - start_step;
+
+    const Clock::time_point finish_start = Clock::now();
+    if (snapshots_on)
+    {
+        snapshots.finish(fields);
+        std::cout << "[snapshot] wrote " << snapshots.written() << " snapshots to " << run_config.snapshot_directory
+                  << " (" << snapshots.failed() << " failed), output stalls: " << snapshots.stall_seconds() << " s\n";
+        if (run_config.snapshot_format != "fields")
+        {
+            snapshot_stream.close();
+            snapshot_archive.close();
+            const CodecStats codec = run_config.snapshot_format == "compressed" ? snapshot_stream.stats() : snapshot_archive.stats();
+            std::cout << "[snapshot] compression ratio " << codec.ratio() << " (" << codec.raw_bytes << " -> " << codec.encoded_bytes
+                      << " bytes), encode throughput " << codec.encode_mb_per_second() << " MB/s\n";
+        }
+    }
+
+    if (!run_config.dump_path.empty())
+    {
+        SNOW_PROFILE_SCOPE(dump);
+        StateDumpOptions dump_options;
+        dump_options.path = run_config.dump_path;
+        dump_options.fields = run_config.dump_fields;
+        if (dump_simulation_state_to_json(params, fields, dump_options))
+        {
+            std::cout << "[dump] wrote final state to " << run_config.dump_path << "\n";
+        }
+    }
+    timings.output_seconds += seconds_since(finish_start);
+
+    if (forcing_on)
+    {
+        std::cout << "[forcing] reader stalls: " << forcing.stall_seconds() << " s\n";
+    }
+
+    timings.total_seconds = seconds_since(run_start);
+    return true;
+}
+
+void print_run_timings(std::ostream& out, const RunTimings& timings)
+{
+    const double steps_per_second = timings.step_seconds > 0.0 ? static_cast<double>(timings.steps) / timings.step_seconds : 0.0;
+    out << "[timing] " << timings.steps << " steps from step " << timings.start_step << " in " << timings.total_seconds << " s"
+        << (timings.stopped_early ? " (stopped early)" : "") << "\n";
+    out << "[timing] step " << timings.step_seconds << " s (" << steps_per_second << " steps/s, "
+        << steps_per_second * static_cast<double>(timings.cells) / 1.0e6 << " Mcell updates/s), boundaries "
+        << timings.boundary_seconds << " s, output " << timings.output_seconds << " s, setup " << timings.setup_seconds << " s\n";
+}
+
+} // namespace snow
@@ -0,0 +1,416 @@
+#include "snapshot_codec.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace snow
+{
+
+namespace
+{
+    const char frame_magic[4] = { 'S', 'N', 'Z', '1' };
+    const char stream_magic[8] = { 'S', 'N', 'O', 'W', 'S', 'N', 'Z', '1' };
+    const std::uint8_t frame_keyframe = 1;
+    const std::uint8_t frame_quantized = 2;
+
+    // RLE tokens: 0..127 = literal of token + 1 bytes that follow, 128..255 = the next byte repeated
+    // token - 128 + rle_min_run times.
+    const std::size_t rle_min_run = 3;
+    const std::size_t rle_max_run = 127 + rle_min_run;
+    const std::size_t rle_max_literal = 128;
+
+    // quantized values are kept well inside int32 so differences cannot overflow
+    const double quantized_limit = 1073741823.0;
+
+    void put_u32(std::uint8_t* out, std::uint32_t value)
+    {
+        for (int b = 0; b < 4; ++b) out[b] = static_cast<std::uint8_t>(value >> (8 * b));
+    }
+
+    std::uint32_t get_u32(const std::uint8_t* in)
+    {
+        std::uint32_t value = 0;
+        for (int b = 0; b < 4; ++b) value |= static_cast<std::uint32_t>(in[b]) << (8 * b);
+        return value;
+    }
+
+    std::uint32_t float_bits(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bits_float(std::uint32_t bits)
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::uint32_t zigzag(std::uint32_t difference)
+    {
+        const std::int32_t d = static_cast<std::int32_t>(difference);
+        return (static_cast<std::uint32_t>(d) << 1) ^ static_cast<std::uint32_t>(d >> 31);
+    }
+
+    std::uint32_t unzigzag(std::uint32_t z)
+    {
+        return (z >> 1) ^ (0u - (z & 1u));
+    }
+
+    void rle_encode(const std::uint8_t* in, std::size_t size, std::vector<std::uint8_t>& out)
+    {
+        std::size_t i = 0;
+        std::size_t literal_start = 0;
+        auto flush_literal = [&](std::size_t end)
+        {
+            while (literal_start < end)
+            {
+                const std::size_t n = std::min(end - literal_start, rle_max_literal);
+                out.push_back(static_cast<std::uint8_t>(n - 1));
+                out.insert(out.end(), in + literal_start, in + literal_start + n);
+                literal_start += n;
+            }
+        };
+
+        while (i < size)
+        {
+            std::size_t run = 1;
+            while (i + run < size && run < rle_max_run && in[i + run] == in[i]) ++run;
+            if (run >= rle_min_run)
+            {
+                flush_literal(i);
+                out.push_back(static_cast<std::uint8_t>(128 + run - rle_min_run));
+                out.push_back(in[i]);
+                i += run;
+                literal_start = i;
+            }
+            else
+            {
+                i += run;
+            }
+        }
+        flush_literal(size);
+    }
+
+    bool rle_decode(const std::uint8_t* in, std::size_t size, std::uint8_t* out, std::size_t out_size)
+    {
+        std::size_t i = 0;
+        std::size_t o = 0;
+        while (i < size)
+        {
+            const std::uint8_t token = in[i++];
+            if (token < 128)
+            {
+                const std::size_t n = static_cast<std::size_t>(token) + 1;
+                if (i + n > size || o + n > out_size) return false;
+                std::memcpy(out + o, in + i, n);
+                i += n;
+                o += n;
+            }
+            else
+            {
+                const std::size_t n = static_cast<std::size_t>(token) - 128 + rle_min_run;
+                if (i >= size || o + n > out_size) return false;
+                std::memset(out + o, in[i++], n);
+                o += n;
+            }
+        }
+        return o == out_size;
+    }
+}
+
+std::size_t field_frame_bytes(const std::uint8_t* header)
+{
+    if (std::memcmp(header, frame_magic, sizeof(frame_magic)) != 0) return 0;
+    return field_frame_header_bytes + get_u32(header + 20);
+}
+
+bool field_frame_shape(const std::uint8_t* header, std::size_t& nx, std::size_t& ny)
+{
+    if (std::memcmp(header, frame_magic, sizeof(frame_magic)) != 0) return false;
+    nx = get_u32(header + 8);
+    ny = get_u32(header + 12);
+    return true;
+}
+
+FieldEncoder::FieldEncoder(FieldCodecOptions options) :
+    options_(options)
+{}
+
+void FieldEncoder::encode(const float* values, std::size_t nx, std::size_t ny, std::vector<std::uint8_t>& out)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t count = nx * ny;
+
+    // quantize when a bound is set and every value fits; otherwise this frame stays lossless
+    const float step = 2.0f * options_.error_bound;
+    bool quantized = step > 0.0f;
+    next_.resize(count);
+    if (quantized)
+    {
+        for (std::size_t i = 0; i < count && quantized; ++i)
+        {
+            const double k = std::nearbyint(static_cast<double>(values[i]) / step);
+            if (!(std::fabs(k) <= quantized_limit))
+            {
+                quantized = false;
+                break;
+            }
+            next_[i] = static_cast<std::uint32_t>(static_cast<std::int32_t>(k));
+        }
+    }
+    if (!quantized)
+    {
+        for (std::size_t i = 0; i < count; ++i) next_[i] = float_bits(values[i]);
+    }
+
+    const bool keyframe = !has_previous_ || previous_.size() != count || previous_quantized_ != quantized
+                          || (quantized && previous_step_ != step)
+                          || (options_.keyframe_interval > 0 && frames_since_keyframe_ >= options_.keyframe_interval);
+
+    // residuals, split into byte planes as they are formed
+    planes_.resize(4 * count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const std::uint32_t predicted = keyframe ? 0u : previous_[i];
+        const std::uint32_t residual = quantized ? zigzag(next_[i] - predicted) : (next_[i] ^ predicted);
+        planes_[i] = static_cast<std::uint8_t>(residual);
+        planes_[count + i] = static_cast<std::uint8_t>(residual >> 8);
+        planes_[2 * count + i] = static_cast<std::uint8_t>(residual >> 16);
+        planes_[3 * count + i] = static_cast<std::uint8_t>(residual >> 24);
+    }
+
+    const std::size_t frame_start = out.size();
+    out.resize(frame_start + field_frame_header_bytes);
+    rle_encode(planes_.data(), planes_.size(), out);
+
+    std::uint8_t* header = out.data() + frame_start;
+    std::memcpy(header, frame_magic, sizeof(frame_magic));
+    header[4] = static_cast<std::uint8_t>((keyframe ? frame_keyframe : 0) | (quantized ? frame_quantized : 0));
+    header[5] = header[6] = header[7] = 0;
+    put_u32(header + 8, static_cast<std::uint32_t>(nx));
+    put_u32(header + 12, static_cast<std::uint32_t>(ny));
+    put_u32(header + 16, float_bits(quantized ? step : 0.0f));
+    put_u32(header + 20, static_cast<std::uint32_t>(out.size() - frame_start - field_frame_header_bytes));
+
+    std::swap(previous_, next_);
+    has_previous_ = true;
+    previous_quantized_ = quantized;
+    previous_step_ = quantized ? step : 0.0f;
+    frames_since_keyframe_ = keyframe ? 1 : frames_since_keyframe_ + 1;
+
+    stats_.frames += 1;
+    stats_.raw_bytes += count * sizeof(float);
+    stats_.encoded_bytes += out.size() - frame_start;
+    stats_.encode_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FieldEncoder::encode(const Field2D<float>& field, std::vector<std::uint8_t>& out)
+{
+    encode(field.data.data(), field.nx, field.ny, out);
+}
+
+void FieldEncoder::encode(const Field1D<float>& field, std::vector<std::uint8_t>& out)
+{
+    encode(field.data.data(), field.nx, 1, out);
+}
+
+bool FieldDecoder::decode_values(const std::uint8_t* data, std::size_t size, std::size_t& nx, std::size_t& ny)
+{
+    if (size < field_frame_header_bytes || field_frame_bytes(data) != size)
+    {
+        std::cerr << "[snapshot_codec] damaged frame header\n";
+        return false;
+    }
+
+    const std::uint8_t flags = data[4];
+    const bool keyframe = (flags & frame_keyframe) != 0;
+    const bool quantized = (flags & frame_quantized) != 0;
+    nx = get_u32(data + 8);
+    ny = get_u32(data + 12);
+    const float step = bits_float(get_u32(data + 16));
+
+    // bound the size by what the payload can expand to (a 2-byte run token is at most rle_max_run bytes)
+    // before multiplying or allocating, so a damaged nx or ny cannot wrap or ask for gigabytes.
+    const std::size_t max_planes = (size - field_frame_header_bytes) / 2 * rle_max_run;
+    if (nx > 0 && ny > max_planes / 4 / nx)
+    {
+        std::cerr << "[snapshot_codec] frame size " << nx << " x " << ny << " does not fit its payload\n";
+        return false;
+    }
+    const std::size_t count = nx * ny;
+
+    if (!keyframe && (!has_previous_ || previous_.size() != count || previous_quantized_ != quantized
+                      || (quantized && previous_step_ != step)))
+    {
+        std::cerr << "[snapshot_codec] delta frame does not follow a matching frame\n";
+        return false;
+    }
+
+    planes_.resize(4 * count);
+    if (!rle_decode(data + field_frame_header_bytes, size - field_frame_header_bytes, planes_.data(), planes_.size()))
+    {
+        std::cerr << "[snapshot_codec] damaged frame payload\n";
+        return false;
+    }
+
+    previous_.resize(count);
+    values_.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const std::uint32_t residual = static_cast<std::uint32_t>(planes_[i])
+                                       | static_cast<std::uint32_t>(planes_[count + i]) << 8
+                                       | static_cast<std::uint32_t>(planes_[2 * count + i]) << 16
+                                       | static_cast<std::uint32_t>(planes_[3 * count + i]) << 24;
+        const std::uint32_t predicted = keyframe ? 0u : previous_[i];
+        if (quantized)
+        {
+            previous_[i] = predicted + unzigzag(residual);
+            values_[i] = static_cast<float>(static_cast<double>(static_cast<std::int32_t>(previous_[i])) * step);
+        }
+        else
+        {
+            previous_[i] = predicted ^ residual;
+            values_[i] = bits_float(previous_[i]);
+        }
+    }
+    has_previous_ = true;
+    previous_quantized_ = quantized;
+    previous_step_ = quantized ? step : 0.0f;
+    return true;
+}
+
+bool FieldDecoder::decode(const std::uint8_t* data, std::size_t size, Field2D<float>& field)
+{
+    std::size_t nx = 0;
+    std::size_t ny = 0;
+    if (!decode_values(data, size, nx, ny)) return false;
+    field.nx = nx;
+    field.ny = ny;
+    field.data.assign(values_.begin(), values_.end());
+    return true;
+}
+
+bool FieldDecoder::decode(const std::uint8_t* data, std::size_t size, Field1D<float>& field)
+{
+    std::size_t nx = 0;
+    std::size_t ny = 0;
+    if (!decode_values(data, size, nx, ny)) return false;
+    if (ny != 1)
+    {
+        std::cerr << "[snapshot_codec] expected a 1D frame, got " << nx << " x " << ny << "\n";
+        return false;
+    }
+    field.nx = nx;
+    field.data.assign(values_.begin(), values_.end());
+    return true;
+}
+
+bool SnapshotStreamWriter::open(const std::string& path, FieldCodecOptions options)
+{
+    stream_.open(path, std::ios::binary | std::ios::trunc);
+    if (!stream_)
+    {
+        std::cerr << "[snapshot_codec] cannot create " << path << "\n";
+        return false;
+    }
+    density_ = FieldEncoder(options);
+    mass_ = FieldEncoder(options);
+    depth_ = FieldEncoder(options);
+    stream_.write(stream_magic, sizeof(stream_magic));
+    return static_cast<bool>(stream_);
+}
+
+bool SnapshotStreamWriter::write(const Snapshot& snapshot)
+{
+    if (!stream_.is_open()) return false;
+
+    buffer_.resize(16);
+    const std::int64_t step = snapshot.step;
+    std::memcpy(buffer_.data(), &step, sizeof(step));
+    std::memcpy(buffer_.data() + 8, &snapshot.time, sizeof(snapshot.time));
+    density_.encode(snapshot.snow_density, buffer_);
+    mass_.encode(snapshot.snow_accumulation_mass, buffer_);
+    depth_.encode(snapshot.snow_accumulation_depth, buffer_);
+
+    stream_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+    return static_cast<bool>(stream_);
+}
+
+bool SnapshotStreamWriter::close()
+{
+    if (!stream_.is_open()) return true;
+    stream_.close();
+    return !stream_.fail();
+}
+
+CodecStats SnapshotStreamWriter::stats() const
+{
+    CodecStats total;
+    for (const FieldEncoder* encoder : { &density_, &mass_, &depth_ })
+    {
+        total.frames += encoder->stats().frames;
+        total.raw_bytes += encoder->stats().raw_bytes;
+        total.encoded_bytes += encoder->stats().encoded_bytes;
+        total.encode_seconds += encoder->stats().encode_seconds;
+    }
+    return total;
+}
+
+bool SnapshotStreamReader::open(const std::string& path)
+{
+    path_ = path;
+    stream_.open(path, std::ios::binary);
+    char magic[sizeof(stream_magic)] = {};
+    if (!stream_ || !stream_.read(magic, sizeof(magic)) || std::memcmp(magic, stream_magic, sizeof(magic)) != 0)
+    {
+        std::cerr << "[snapshot_codec] " << path << " is not a snapshot stream\n";
+        return false;
+    }
+    stream_.seekg(0, std::ios::end);
+    size_ = static_cast<std::size_t>(stream_.tellg());
+    stream_.seekg(sizeof(stream_magic));
+    density_ = FieldDecoder();
+    mass_ = FieldDecoder();
+    depth_ = FieldDecoder();
+    return true;
+}
+
+bool SnapshotStreamReader::read_frame()
+{
+    frame_.resize(field_frame_header_bytes);
+    if (!stream_.read(reinterpret_cast<char*>(frame_.data()), field_frame_header_bytes)) return false;
+    const std::size_t size = field_frame_bytes(frame_.data());
+    if (size == 0) return false;
+    const std::size_t payload = size - field_frame_header_bytes;
+    const std::streamoff position = stream_.tellg();
+    if (position < 0 || payload > size_ - static_cast<std::size_t>(position)) return false;
+    frame_.resize(size);
+    return static_cast<bool>(stream_.read(reinterpret_cast<char*>(frame_.data()) + field_frame_header_bytes,
+                                           static_cast<std::streamsize>(size - field_frame_header_bytes)));
+}
+
+bool SnapshotStreamReader::next(Snapshot& snapshot)
+{
+    std::int64_t step = 0;
+    if (!stream_.read(reinterpret_cast<char*>(&step), sizeof(step))) return false; // end of the series
+
+    const bool ok = stream_.read(reinterpret_cast<char*>(&snapshot.time), sizeof(snapshot.time))
+                    && read_frame() && density_.decode(frame_.data(), frame_.size(), snapshot.snow_density)
+                    && read_frame() && mass_.decode(frame_.data(), frame_.size(), snapshot.snow_accumulation_mass)
+                    && read_frame() && depth_.decode(frame_.data(), frame_.size(), snapshot.snow_accumulation_depth);
+    if (!ok)
+    {
+        std::cerr << "[snapshot_codec] truncated or damaged snapshot after step " << snapshot.step << " in " << path_ << "\n";
+        return false;
+    }
+    snapshot.step = step;
+    return true;
+}
+
+} // namespace snow
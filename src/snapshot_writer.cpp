@@ -0,0 +1,179 @@
+#include "snapshot_writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+#include "field_file.hpp"
+#include "profiler.hpp"
+
+namespace snow
+{
+
+SnapshotWriter::~SnapshotWriter()
+{
+    if (!thread_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_all();
+    thread_.join();
+}
+
+bool SnapshotWriter::start(Sink sink, std::size_t queue_depth)
+{
+    if (thread_.joinable() || !sink) return false;
+
+    sink_ = std::move(sink);
+    // queue_depth waiting plus the one being written.
+    max_buffers_ = std::max<std::size_t>(queue_depth, 1) + 1;
+    buffer_count_ = 0;
+    stopping_ = false;
+    written_ = 0;
+    failed_ = 0;
+    pending_ = false;
+    stall_seconds_ = 0.0;
+    thread_ = std::thread(&SnapshotWriter::writer_loop, this);
+    return true;
+}
+
+void SnapshotWriter::mark(long long step, double time, const Fields& fields)
+{
+    if (!thread_.joinable()) return;
+
+    pending_snapshot_.step = step;
+    pending_snapshot_.time = time;
+    pending_snapshot_.snow_accumulation_mass = fields.snow_accumulation_mass;
+    pending_snapshot_.snow_accumulation_depth = fields.snow_accumulation_depth;
+    pending_ = true;
+}
+
+void SnapshotWriter::collect(Fields& fields)
+{
+    if (!pending_) return;
+
+    Field2D<float> replacement;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (free_buffers_.empty() && buffer_count_ >= max_buffers_)
+        {
+            // backpressure: every buffer is waiting for the disk.
+            const auto wait_start = std::chrono::steady_clock::now();
+            freed_.wait(lock, [this] { return !free_buffers_.empty(); });
+            stall_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+        }
+        if (!free_buffers_.empty())
+        {
+            replacement = std::move(free_buffers_.back());
+            free_buffers_.pop_back();
+        }
+        else
+        {
+            ++buffer_count_; // allocated below, outside the lock
+        }
+    }
+
+    // the step fully rewrites next_snow_density, so the buffer only needs the right size, not the right contents.
+    if (replacement.nx != fields.next_snow_density.nx || replacement.ny != fields.next_snow_density.ny)
+    {
+        replacement.resize(fields.next_snow_density.nx, fields.next_snow_density.ny);
+    }
+    std::swap(replacement, fields.next_snow_density);
+    pending_snapshot_.snow_density = std::move(replacement);
+    pending_ = false;
+    enqueue(std::move(pending_snapshot_));
+}
+
+void SnapshotWriter::finish(const Fields& fields)
+{
+    if (!thread_.joinable()) return;
+
+    if (pending_)
+    {
+        // no step followed the mark, so the marked state is still the live density.
+        pending_snapshot_.snow_density = fields.snow_density;
+        pending_ = false;
+        enqueue(std::move(pending_snapshot_));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_all();
+    thread_.join();
+}
+
+std::size_t SnapshotWriter::written() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+std::size_t SnapshotWriter::failed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+void SnapshotWriter::enqueue(Snapshot&& snapshot)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(snapshot));
+    }
+    queued_.notify_one();
+}
+
+void SnapshotWriter::writer_loop()
+{
+    SNOW_PROFILE_THREAD("snapshot writer");
+    for (;;)
+    {
+        Snapshot snapshot;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping and drained
+            snapshot = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        // serialization and I/O happen here, off the simulation thread.
+        bool ok = false;
+        {
+            SNOW_PROFILE_SCOPE(snapshot_write);
+            ok = sink_(snapshot);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ok ? ++written_ : ++failed_;
+            free_buffers_.push_back(std::move(snapshot.snow_density));
+        }
+        freed_.notify_one();
+    }
+}
+
+SnapshotWriter::Sink field_file_snapshot_sink(const std::string& directory)
+{
+    return [directory](const Snapshot& snapshot)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        const std::string path = (std::filesystem::path(directory) / ("snapshot_" + std::to_string(snapshot.step) + ".snowfld")).string();
+        if (!write_field_file(path, { field_file_source("snow_density", snapshot.snow_density),
+                                      field_file_source("snow_accumulation_mass", snapshot.snow_accumulation_mass),
+                                      field_file_source("snow_accumulation_depth", snapshot.snow_accumulation_depth) }))
+        {
+            std::cerr << "[snapshot] failed to write " << path << "\n";
+            return false;
+        }
+        return true;
+    };
+}
+
+} // namespace snow
@@ -0,0 +1,265 @@
+#include "snow_source_boundary.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "profiler.hpp"
+
+namespace snow
+{
+
+void advance_snow_column(const float* column_in,
+                         float* column_out,
+                         std::size_t cells,
+                         float settling_speed,
+                         float precipitation_rate,
+                         float dy,
+                         float dt)
+{
+    // Settling drives a constant downward velocity in this one-dimensional column.
+    const float vertical_velocity = -settling_speed;
+    if (vertical_velocity == 0.0f)
+    {
+        // Pure precipitation update with no vertical transport.
+        for (std::size_t j = 0; j < cells; ++j)
+        {
+            float density = column_in[j];
+            if (j + 1 == cells)
+            {
+                density += dt * precipitation_rate;
+            }
+            column_out[j] = std::max(density, 0.0f);
+        }
+        return;
+    }
+
+    // lambda function that Match the face flux behaviour used in the CPU simulation
+    // so the boundary source evolves in lock-step with interior cells.
+    const float flux_threshold = 1e-5f; // TODO: Share this threshold with other face_flux helpers in cpu_backend.cpp.
+    const auto face_flux = [&](std::size_t face_index) -> float
+    {
+        std::ptrdiff_t donor_index = (vertical_velocity > 0.0f)
+            ? static_cast<std::ptrdiff_t>(face_index) - 1
+            : static_cast<std::ptrdiff_t>(face_index);
+
+        if (donor_index < 0 || static_cast<std::size_t>(donor_index) >= cells){
+            return 0.0f;
+        }
+
+        const float flux = vertical_velocity * column_in[static_cast<std::size_t>(donor_index)];
+        return (std::fabs(flux) > flux_threshold) ? flux : 0.0f;
+    };
+
+    for (std::size_t j = 0; j < cells; ++j)
+    {
+        float density = column_in[j];
+
+        // Only the top cell receives direct precipitation.
+        if (j + 1 == cells && precipitation_rate > 0.0f )
+        {
+            density += dt * precipitation_rate;
+        }
+
+        const float flux_bottom = face_flux(j);
+        const float flux_top = face_flux(j + 1);
+
+        density += dt / dy * (flux_bottom - flux_top);
+        column_out[j] = std::max(density, 0.0f);
+    }
+}
+
+SnowSourceBoundary::SnowSourceBoundary(BoundarySide side, const Params& params, std::size_t cells) :
+    side_(side),
+    settling_speed_(params.settling_speed),
+    precipitation_rate_(params.precipitation_rate),
+    wind_speed_(params.wind_speed),
+    dx_(params.dx),
+    dy_(params.dy),
+    dt_(params.time_step_duration),
+    steady_tolerance_(params.snow_source_steady_tolerance),
+    steady_steps_(params.snow_source_steady_steps)
+{
+    columns_[0] = Field1D<float>(cells, 0.0f);
+    columns_[1] = Field1D<float>(cells, 0.0f);
+
+    // validation happens once here instead of on every step; an invalid source stays at zero inflow.
+    if (cells == 0)
+    {
+        std::cerr << "Warning: SnowSourceBoundary received cell number == 0\n";
+        return;
+    }
+
+    if (dy_ <= 0.0f)
+    {
+        std::cerr << "Warning: SnowSourceBoundary received non-positive cell height/dy (" << dy_ << ")\n";
+        return;
+    }
+
+    if (dt_ <= 0.0f)
+    {
+        std::cerr << "Warning: SnowSourceBoundary received non-positive time_step_duration (" << dt_ << ")\n";
+        return;
+    }
+
+    if (precipitation_rate_ < 0.0f)
+    {
+        std::cerr << "Warning: SnowSourceBoundary received non-positive precipitation_rate (" << precipitation_rate_ << ")\n";
+        return;
+    }
+
+    const float cfl_snow_source = std::fabs(settling_speed_) * dt_ / dy_;
+    if (cfl_snow_source > 1.0f)
+    {
+        std::cerr << "Warning: CFL condition exceeded (CFL_snow_source=" << cfl_snow_source << ")\n";
+        return;
+    }
+
+    valid_ = true;
+}
+
+void SnowSourceBoundary::advance()
+{
+    if (!valid_ || is_frozen()) return;
+    SNOW_PROFILE_SCOPE(snow_source);
+
+    const std::size_t next = current_ ^ 1u;
+    const Field1D<float>& column_prev = columns_[current_];
+    const Field1D<float>& column_next = columns_[next];
+    advance_snow_column(column_prev.data.data(),
+                        columns_[next].data.data(),
+                        column_prev.nx,
+                        settling_speed_,
+                        precipitation_rate_,
+                        dy_,
+                        dt_);
+    current_ = next;
+    ++steps_taken_;
+
+    if (steady_tolerance_ <= 0.0f || steady_steps_ == 0) return;
+
+    // convergence check on the (short) column: largest change against the largest density.
+    float max_change = 0.0f;
+    float max_density = 0.0f;
+    for (std::size_t j = 0; j < column_next.nx; ++j)
+    {
+        max_change = std::max(max_change, std::fabs(column_next(j) - column_prev(j)));
+        max_density = std::max(max_density, column_next(j));
+    }
+
+    if (max_density > 0.0f && max_change <= steady_tolerance_ * max_density)
+    {
+        if (++quiet_steps_ >= steady_steps_) frozen_step_ = steps_taken_;
+    }
+    else
+    {
+        quiet_steps_ = 0;
+    }
+}
+
+void SnowSourceBoundary::set_forcing(float settling_speed, float precipitation_rate, float wind_speed)
+{
+    if (!valid_) return;
+
+    precipitation_rate = std::max(precipitation_rate, 0.0f);
+    const float max_settling_speed = dy_ / dt_;
+    if (std::fabs(settling_speed) > max_settling_speed)
+    {
+        if (!cfl_clamp_reported_)
+        {
+            std::cerr << "Warning: SnowSourceBoundary clamping settling speed " << settling_speed
+                      << " to the CFL limit " << max_settling_speed << "\n";
+            cfl_clamp_reported_ = true;
+        }
+        settling_speed = std::copysign(max_settling_speed, settling_speed);
+    }
+
+    if (settling_speed == settling_speed_ && precipitation_rate == precipitation_rate_ && wind_speed == wind_speed_) return;
+
+    settling_speed_ = settling_speed;
+    precipitation_rate_ = precipitation_rate;
+    wind_speed_ = wind_speed;
+
+    // new weather, new steady state: start watching for convergence again.
+    quiet_steps_ = 0;
+    frozen_step_ = -1;
+}
+
+void SnowSourceBoundary::apply(Fields& fields) const
+{
+    const Field1D<float>& column_density = columns_[current_];
+
+    switch (side_)
+    {
+    case BoundarySide::left:
+    case BoundarySide::right:
+    {
+        const bool is_left = side_ == BoundarySide::left;
+        Field1D<float>& source = is_left ? fields.windborn_horizontal_source_left
+                                         : fields.windborn_horizontal_source_right;
+        const std::size_t edge_i = is_left ? 0 : fields.air_mask.nx - 1;
+        // inflow speed is the wind component pointing into the domain; zero when it blows outward.
+        const float inflow_speed = is_left ? wind_speed_ : -wind_speed_;
+        const bool blowing_in = inflow_speed > 0.0f && dx_ > 0.0f;
+        source.materialize(); // written per row below
+
+        for (std::size_t j = 0; j < source.nx; ++j)
+        {
+            // edge cell in row j is under ground, the row is above the column, or the wind blows out.
+            if (!blowing_in || !column_density.in_bounds(j) || !fields.air_mask.in_bounds(edge_i, j) || !fields.air_mask(edge_i, j))
+            {
+                source(j) = 0.0f;
+            }
+            else
+            {
+                source(j) = inflow_speed * column_density(j) / dx_;
+            }
+        }
+        break;
+    }
+    case BoundarySide::top:
+    {
+        // snow settling out of the bottom cell of the column rains into every top-row cell.
+        const float inflow = (valid_ && dy_ > 0.0f && column_density.nx > 0)
+            ? std::fabs(settling_speed_) * column_density(0) / dy_
+            : 0.0f;
+        fields.precipitation_source.fill(inflow);
+        break;
+    }
+    }
+}
+
+SnowSourceBoundary::State SnowSourceBoundary::state() const
+{
+    State state;
+    state.settling_speed = settling_speed_;
+    state.precipitation_rate = precipitation_rate_;
+    state.wind_speed = wind_speed_;
+    state.cfl_clamp_reported = cfl_clamp_reported_;
+    state.quiet_steps = quiet_steps_;
+    state.steps_taken = steps_taken_;
+    state.frozen_step = frozen_step_;
+    state.columns[0] = columns_[0];
+    state.columns[1] = columns_[1];
+    state.current = current_;
+    return state;
+}
+
+bool SnowSourceBoundary::restore(const State& state)
+{
+    if (state.current > 1 || state.columns[0].nx != columns_[0].nx || state.columns[1].nx != columns_[1].nx) return false;
+
+    settling_speed_ = state.settling_speed;
+    precipitation_rate_ = state.precipitation_rate;
+    wind_speed_ = state.wind_speed;
+    cfl_clamp_reported_ = state.cfl_clamp_reported;
+    quiet_steps_ = state.quiet_steps;
+    steps_taken_ = state.steps_taken;
+    frozen_step_ = state.frozen_step;
+    columns_[0] = state.columns[0];
+    columns_[1] = state.columns[1];
+    current_ = state.current;
+    return true;
+}
+
+} // namespace snow
@@ -0,0 +1,286 @@
+#include "terrain_expression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SNOW_TERRAIN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace snow
+{
+
+struct Terrain::Node
+{
+    enum class Kind
+    {
+        flat,
+        slope,
+        parabola,
+        gaussian,
+        profile,
+        min,
+        max,
+        plus,
+        offset
+    };
+
+    Kind kind = Kind::flat;
+    float a = 0.0f; // primitive coefficients, see the factories below
+    float b = 0.0f;
+    float c = 0.0f;
+    std::shared_ptr<const TerrainProfile> samples;
+    std::shared_ptr<const Node> left;
+    std::shared_ptr<const Node> right;
+};
+
+namespace
+{
+    using Node = Terrain::Node;
+
+    float column_center_x(std::size_t i, const Params& params)
+    {
+        return (static_cast<float>(i) + 0.5f) * params.dx;
+    }
+
+    void evaluate_node(const Node& node, const Params& params, std::vector<float>& heights)
+    {
+        const std::size_t nx = params.nx;
+        heights.resize(nx);
+        switch (node.kind)
+        {
+        case Node::Kind::flat:
+            std::fill(heights.begin(), heights.end(), node.a);
+            return;
+        case Node::Kind::slope:
+            for (std::size_t i = 0; i < nx; ++i) heights[i] = node.b + node.c * (column_center_x(i, params) - node.a);
+            return;
+        case Node::Kind::parabola:
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                const float x = column_center_x(i, params);
+                heights[i] = node.c * (x - node.a) * (x - node.a) + node.b;
+            }
+            return;
+        case Node::Kind::gaussian:
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                const float u = (column_center_x(i, params) - node.a) / node.c;
+                heights[i] = node.b * std::exp(-0.5f * u * u);
+            }
+            return;
+        case Node::Kind::profile:
+        {
+            heights = sample_ground_profile(*node.samples, params, node.a);
+            if (heights.empty()) return;
+            const float lowest = *std::min_element(heights.begin(), heights.end());
+            for (float& height : heights) height -= lowest;
+            return;
+        }
+        case Node::Kind::offset:
+            evaluate_node(*node.left, params, heights);
+            for (float& height : heights) height += node.a;
+            return;
+        default:
+            break;
+        }
+
+        // combinators: left into heights, right into scratch
+        evaluate_node(*node.left, params, heights);
+        std::vector<float> other;
+        evaluate_node(*node.right, params, other);
+        for (std::size_t i = 0; i < nx; ++i)
+        {
+            switch (node.kind)
+            {
+            case Node::Kind::min: heights[i] = std::min(heights[i], other[i]); break;
+            case Node::Kind::max: heights[i] = std::max(heights[i], other[i]); break;
+            default: heights[i] += other[i]; break;
+            }
+        }
+    }
+
+    std::shared_ptr<Node> make_node(Node::Kind kind, float a = 0.0f, float b = 0.0f, float c = 0.0f)
+    {
+        auto node = std::make_shared<Node>();
+        node->kind = kind;
+        node->a = a;
+        node->b = b;
+        node->c = c;
+        return node;
+    }
+
+    // One mask row: 1 (air) where cell_center_y is above the surface, 0 (ground) where it is at or below.
+    void fill_row(const float* surface, std::size_t nx, float cell_center_y, uint8_t* row)
+    {
+        std::size_t i = 0;
+#ifdef SNOW_TERRAIN_SSE2
+        const __m128 y = _mm_set1_ps(cell_center_y);
+        const __m128i one = _mm_set1_epi8(1);
+        for (; i + 16 <= nx; i += 16)
+        {
+            // all-ones lanes where ground; packing keeps -1 / 0 down to bytes
+            const __m128i g0 = _mm_castps_si128(_mm_cmple_ps(y, _mm_loadu_ps(surface + i)));
+            const __m128i g1 = _mm_castps_si128(_mm_cmple_ps(y, _mm_loadu_ps(surface + i + 4)));
+            const __m128i g2 = _mm_castps_si128(_mm_cmple_ps(y, _mm_loadu_ps(surface + i + 8)));
+            const __m128i g3 = _mm_castps_si128(_mm_cmple_ps(y, _mm_loadu_ps(surface + i + 12)));
+            const __m128i ground = _mm_packs_epi16(_mm_packs_epi32(g0, g1), _mm_packs_epi32(g2, g3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_andnot_si128(ground, one));
+        }
+#endif
+        for (; i < nx; ++i)
+        {
+            row[i] = cell_center_y <= surface[i] ? 0 : 1;
+        }
+    }
+}
+
+Terrain::Terrain() :
+    node_(make_node(Node::Kind::flat))
+{}
+
+Terrain::Terrain(std::shared_ptr<const Node> node) :
+    node_(std::move(node))
+{}
+
+Terrain Terrain::flat(float height)
+{
+    return Terrain(make_node(Node::Kind::flat, height));
+}
+
+Terrain Terrain::slope(float x0, float height_at_x0, float gradient)
+{
+    return Terrain(make_node(Node::Kind::slope, x0, height_at_x0, gradient));
+}
+
+Terrain Terrain::parabola(float vertex_x, float vertex_height, float curvature)
+{
+    return Terrain(make_node(Node::Kind::parabola, vertex_x, vertex_height, curvature));
+}
+
+Terrain Terrain::gaussian(float center_x, float peak_height, float width)
+{
+    return Terrain(make_node(Node::Kind::gaussian, center_x, peak_height, width > 0.0f ? width : 1e-6f));
+}
+
+Terrain Terrain::profile(const TerrainProfile& profile, float x_offset)
+{
+    auto node = make_node(Node::Kind::profile, x_offset);
+    node->samples = std::make_shared<const TerrainProfile>(profile);
+    return Terrain(node);
+}
+
+Terrain Terrain::min(const Terrain& other) const
+{
+    auto node = make_node(Node::Kind::min);
+    node->left = node_;
+    node->right = other.node_;
+    return Terrain(node);
+}
+
+Terrain Terrain::max(const Terrain& other) const
+{
+    auto node = make_node(Node::Kind::max);
+    node->left = node_;
+    node->right = other.node_;
+    return Terrain(node);
+}
+
+Terrain Terrain::plus(const Terrain& other) const
+{
+    auto node = make_node(Node::Kind::plus);
+    node->left = node_;
+    node->right = other.node_;
+    return Terrain(node);
+}
+
+Terrain Terrain::offset(float height) const
+{
+    auto node = make_node(Node::Kind::offset, height);
+    node->left = node_;
+    return Terrain(node);
+}
+
+void Terrain::evaluate(const Params& params, std::vector<float>& heights) const
+{
+    evaluate_node(*node_, params, heights);
+}
+
+Field1D<float> Terrain::surface(const Params& params) const
+{
+    Field1D<float> surface;
+    surface.nx = params.nx;
+    evaluate(params, surface.data);
+    for (float& height : surface.data)
+    {
+        height = std::clamp(height, 0.0f, params.Ly);
+    }
+    return surface;
+}
+
+Field2D<uint8_t> Terrain::air_mask(const Params& params) const
+{
+    Field2D<uint8_t> mask;
+    fill_air_mask(surface(params), params, mask);
+    return mask;
+}
+
+void fill_air_mask(const Field1D<float>& surface, const Params& params, Field2D<uint8_t>& air_mask, unsigned threads)
+{
+    if (air_mask.nx != params.nx || air_mask.ny != params.ny || air_mask.data.size() != params.nx * params.ny)
+    {
+        air_mask.resize(params.nx, params.ny);
+    }
+    if (params.nx == 0 || params.ny == 0 || surface.data.size() < params.nx) return;
+
+    const auto fill_rows = [&](std::size_t j_begin, std::size_t j_end)
+    {
+        for (std::size_t j = j_begin; j < j_end; ++j)
+        {
+            const float cell_center_y = (static_cast<float>(j) + 0.5f) * params.dy;
+            fill_row(surface.data.data(), params.nx, cell_center_y, air_mask.data.data() + j * params.nx);
+        }
+    };
+
+    // small grids are not worth a thread start
+    const std::size_t min_cells_per_thread = std::size_t{ 1 } << 16;
+    const std::size_t workers = std::min({ static_cast<std::size_t>(std::max(threads, 1u)), params.ny,
+                                           std::max<std::size_t>(1, params.nx * params.ny / min_cells_per_thread) });
+    if (workers <= 1)
+    {
+        fill_rows(0, params.ny);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    const std::size_t band = (params.ny + workers - 1) / workers;
+    for (std::size_t w = 1; w < workers; ++w)
+    {
+        const std::size_t j_begin = std::min(w * band, params.ny);
+        pool.emplace_back(fill_rows, j_begin, std::min(j_begin + band, params.ny));
+    }
+    fill_rows(0, std::min(band, params.ny));
+    for (std::thread& worker : pool) worker.join();
+}
+
+Field1D<std::size_t> surface_index(const Field1D<float>& surface, const Params& params)
+{
+    Field1D<std::size_t> index(params.nx, 0);
+    const auto is_ground = [&](std::size_t j, float height) { return (static_cast<float>(j) + 0.5f) * params.dy <= height; };
+    for (std::size_t i = 0; i < params.nx && i < surface.data.size(); ++i)
+    {
+        const float height = surface.data[i];
+        // estimate, then settle on exactly the comparison fill_air_mask makes
+        const double estimate = std::floor(static_cast<double>(height) / params.dy + 0.5);
+        std::size_t count = estimate <= 0.0 ? 0 : std::min(static_cast<std::size_t>(estimate), params.ny);
+        while (count > 0 && !is_ground(count - 1, height)) --count;
+        while (count < params.ny && is_ground(count, height)) ++count;
+        index(i) = count;
+    }
+    return index;
+}
+
+} // namespace snow
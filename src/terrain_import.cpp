@@ -0,0 +1,394 @@
+#include "terrain_import.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+#include "terrain_expression.hpp"
+
+namespace snow
+{
+
+namespace
+{
+    // Whitespace-separated tokens from a file through a fixed buffer, so arbitrarily large grids are
+    // read without holding more than the buffer. '#' starts a comment to the end of the line when enabled.
+    class TokenReader
+    {
+    public:
+        explicit TokenReader(std::FILE* file, bool comments) :
+            file_(file),
+            buffer_(1 << 16),
+            comments_(comments)
+        {}
+
+        bool next(std::string_view& token)
+        {
+            for (;;)
+            {
+                if (pos_ == end_ && !refill()) return false;
+                const char c = buffer_[pos_];
+                if (is_space(c))
+                {
+                    ++pos_;
+                }
+                else if (comments_ && c == '#')
+                {
+                    while ((pos_ < end_ || refill()) && buffer_[pos_] != '\n') ++pos_;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            std::size_t start = pos_;
+            for (;;)
+            {
+                while (pos_ < end_ && !is_space(buffer_[pos_])) ++pos_;
+                if (pos_ < end_) break;
+                const bool more = read_more(start);
+                start = 0; // read_more moved the partial token to the front
+                if (!more) break;
+            }
+            token = std::string_view(buffer_.data() + start, pos_ - start);
+            return true;
+        }
+
+        bool skip(std::size_t count)
+        {
+            std::string_view token;
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                if (!next(token)) return false;
+            }
+            return true;
+        }
+
+        // File offset just past the last token returned.
+        long long offset() const { return base_ + static_cast<long long>(pos_); }
+
+        // Turns comment skipping on or off (PGM allows comments in the header only).
+        void set_comments(bool comments) { comments_ = comments; }
+
+    private:
+        static bool is_space(char c)
+        {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+        }
+
+        // Replaces the consumed buffer with the next block of the file.
+        bool refill()
+        {
+            base_ += static_cast<long long>(end_);
+            pos_ = 0;
+            end_ = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+            return end_ > 0;
+        }
+
+        // Keeps buffer_[start, end_) at the front and appends more of the file after it.
+        bool read_more(std::size_t start)
+        {
+            std::memmove(buffer_.data(), buffer_.data() + start, end_ - start);
+            base_ += static_cast<long long>(start);
+            pos_ -= start;
+            end_ -= start;
+            if (end_ == buffer_.size()) return false; // token longer than the buffer: cut it here
+            const std::size_t got = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+            end_ += got;
+            return got > 0;
+        }
+
+        std::FILE* file_;
+        std::vector<char> buffer_;
+        std::size_t pos_ = 0;
+        std::size_t end_ = 0;
+        long long base_ = 0; // file offset of buffer_[0]
+        bool comments_;
+    };
+
+    template <typename T>
+    bool parse_number(std::string_view token, T& value)
+    {
+        const char* first = token.data();
+        const char* last = token.data() + token.size();
+        if (first != last && *first == '+') ++first; // from_chars does not take a leading '+'
+        const std::from_chars_result result = std::from_chars(first, last, value);
+        return result.ec == std::errc() && result.ptr == last;
+    }
+
+    bool seek_to(std::FILE* file, long long offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+        return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    std::size_t transect_row(const TerrainImportOptions& options, std::size_t rows)
+    {
+        return options.row < 0 ? rows / 2 : static_cast<std::size_t>(options.row);
+    }
+
+    bool read_pgm_transect(std::FILE* file, const std::string& path, const TerrainImportOptions& options, TerrainProfile& profile)
+    {
+        TokenReader reader(file, true);
+        std::string_view token;
+        std::size_t width = 0;
+        std::size_t height = 0;
+        unsigned maxval = 0;
+        if (!reader.next(token) || (token != "P5" && token != "P2")) return false;
+        const bool binary = token == "P5";
+        if (!reader.next(token) || !parse_number(token, width)
+            || !reader.next(token) || !parse_number(token, height)
+            || !reader.next(token) || !parse_number(token, maxval)
+            || width == 0 || height == 0 || maxval == 0 || maxval > 65535)
+        {
+            std::cerr << "[terrain] " << path << ": bad PGM header\n";
+            return false;
+        }
+        reader.set_comments(false);
+
+        const std::size_t row = transect_row(options, height);
+        if (row >= height)
+        {
+            std::cerr << "[terrain] " << path << ": transect row " << row << " is outside the " << height << " image rows\n";
+            return false;
+        }
+        if (!(options.cell_size > 0.0f))
+        {
+            std::cerr << "[terrain] " << path << ": a PGM needs cell_size (m per pixel)\n";
+            return false;
+        }
+
+        profile.cell_size = options.cell_size;
+        profile.heights.resize(width);
+        if (binary)
+        {
+            // a single whitespace byte follows maxval, then rows of 1- or 2-byte big-endian samples
+            const std::size_t sample_bytes = maxval < 256 ? 1 : 2;
+            const long long data_start = reader.offset() + 1;
+            std::vector<unsigned char> bytes(width * sample_bytes);
+            if (!seek_to(file, data_start + static_cast<long long>(row * width * sample_bytes))
+                || std::fread(bytes.data(), 1, bytes.size(), file) != bytes.size())
+            {
+                std::cerr << "[terrain] " << path << ": image data is truncated\n";
+                return false;
+            }
+            for (std::size_t i = 0; i < width; ++i)
+            {
+                const unsigned sample = sample_bytes == 1 ? bytes[i] : (static_cast<unsigned>(bytes[2 * i]) << 8) | bytes[2 * i + 1];
+                profile.heights[i] = static_cast<float>(sample) * options.height_scale;
+            }
+            return true;
+        }
+
+        if (!reader.skip(row * width))
+        {
+            std::cerr << "[terrain] " << path << ": image data is truncated\n";
+            return false;
+        }
+        for (std::size_t i = 0; i < width; ++i)
+        {
+            unsigned sample = 0;
+            if (!reader.next(token) || !parse_number(token, sample) || sample > maxval)
+            {
+                std::cerr << "[terrain] " << path << ": bad or missing sample " << i << " in row " << row << "\n";
+                return false;
+            }
+            profile.heights[i] = static_cast<float>(sample) * options.height_scale;
+        }
+        return true;
+    }
+
+    bool read_esri_transect(std::FILE* file, const std::string& path, const TerrainImportOptions& options, TerrainProfile& profile)
+    {
+        TokenReader reader(file, false);
+        std::string_view token;
+        std::size_t ncols = 0;
+        std::size_t nrows = 0;
+        double cellsize = 0.0;
+        double nodata = 0.0;
+        bool has_nodata = false;
+
+        // header: "key value" lines until the first numeric token, which is already the first sample
+        bool have_first = false;
+        while (reader.next(token))
+        {
+            if (!std::isalpha(static_cast<unsigned char>(token[0])))
+            {
+                have_first = true;
+                break;
+            }
+            std::string key(token);
+            std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            std::string_view value;
+            bool ok = reader.next(value);
+            if (key == "ncols") ok = ok && parse_number(value, ncols);
+            else if (key == "nrows") ok = ok && parse_number(value, nrows);
+            else if (key == "cellsize") ok = ok && parse_number(value, cellsize);
+            else if (key == "nodata_value") ok = ok && (has_nodata = parse_number(value, nodata));
+            // xllcorner / yllcorner / xllcenter / yllcenter place the grid on a map; the slice does not need them
+            if (!ok)
+            {
+                std::cerr << "[terrain] " << path << ": bad ESRI header entry " << key << "\n";
+                return false;
+            }
+        }
+        if (ncols == 0 || nrows == 0 || (!(cellsize > 0.0) && !(options.cell_size > 0.0f)) || !have_first)
+        {
+            std::cerr << "[terrain] " << path << ": ESRI header needs ncols, nrows and cellsize followed by data\n";
+            return false;
+        }
+
+        const std::size_t row = transect_row(options, nrows);
+        if (row >= nrows)
+        {
+            std::cerr << "[terrain] " << path << ": transect row " << row << " is outside the " << nrows << " grid rows\n";
+            return false;
+        }
+
+        // 'token' holds sample 0 of row 0
+        const std::size_t skip = row * ncols;
+        if (skip > 0 && (!reader.skip(skip - 1) || !reader.next(token)))
+        {
+            std::cerr << "[terrain] " << path << ": grid data is truncated\n";
+            return false;
+        }
+
+        profile.cell_size = options.cell_size > 0.0f ? options.cell_size : static_cast<float>(cellsize);
+        profile.heights.resize(ncols);
+        std::vector<bool> valid(ncols, true);
+        bool any_valid = false;
+        for (std::size_t i = 0; i < ncols; ++i)
+        {
+            double value = 0.0;
+            if ((i > 0 && !reader.next(token)) || !parse_number(token, value))
+            {
+                std::cerr << "[terrain] " << path << ": bad or missing sample " << i << " in row " << row << "\n";
+                return false;
+            }
+            valid[i] = !(has_nodata && value == nodata) && std::isfinite(value);
+            any_valid = any_valid || valid[i];
+            profile.heights[i] = static_cast<float>(value);
+        }
+        if (!any_valid)
+        {
+            std::cerr << "[terrain] " << path << ": transect row " << row << " has no data\n";
+            return false;
+        }
+
+        // NODATA gaps take the nearest valid sample (ties go left)
+        std::size_t last_valid = ncols;
+        for (std::size_t i = 0; i < ncols; ++i)
+        {
+            if (!valid[i]) continue;
+            const std::size_t gap_start = last_valid == ncols ? 0 : last_valid + 1;
+            for (std::size_t k = gap_start; k < i; ++k)
+            {
+                const bool left_closer = last_valid != ncols && k - last_valid <= i - k;
+                profile.heights[k] = left_closer ? profile.heights[last_valid] : profile.heights[i];
+            }
+            last_valid = i;
+        }
+        for (std::size_t k = last_valid + 1; k < ncols; ++k) profile.heights[k] = profile.heights[last_valid];
+        return true;
+    }
+}
+
+bool read_dem_transect(const std::string& path, const TerrainImportOptions& options, TerrainProfile& profile)
+{
+    profile = TerrainProfile{};
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        std::cerr << "[terrain] cannot open " << path << "\n";
+        return false;
+    }
+
+    char magic[2] = {};
+    const bool is_pgm = std::fread(magic, 1, 2, file) == 2 && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '2');
+    std::rewind(file);
+
+    bool ok = false;
+    if (is_pgm)
+    {
+        ok = read_pgm_transect(file, path, options, profile);
+    }
+    else
+    {
+        ok = read_esri_transect(file, path, options, profile);
+    }
+    std::fclose(file);
+    return ok;
+}
+
+std::vector<float> sample_ground_profile(const TerrainProfile& profile, const Params& params, float x_offset)
+{
+    std::vector<float> ground(params.nx, 0.0f);
+    const std::size_t samples = profile.heights.size();
+    if (samples == 0 || !(profile.cell_size > 0.0f)) return ground;
+
+    const auto sample_at = [&](float x)
+    {
+        // sample k is centred at (k + 0.5) * cell_size
+        const float position = std::clamp(x / profile.cell_size - 0.5f, 0.0f, static_cast<float>(samples - 1));
+        const std::size_t k = std::min(static_cast<std::size_t>(position), samples - 1);
+        const std::size_t k_next = std::min(k + 1, samples - 1);
+        const float t = position - static_cast<float>(k);
+        return profile.heights[k] + t * (profile.heights[k_next] - profile.heights[k]);
+    };
+
+    for (std::size_t i = 0; i < params.nx; ++i)
+    {
+        const float x_left = x_offset + static_cast<float>(i) * params.dx;
+        const float x_right = x_left + params.dx;
+        // sample centres inside the footprint: (k + 0.5) * cell_size in [x_left, x_right)
+        const double first = std::ceil(x_left / profile.cell_size - 0.5);
+        const double last = std::ceil(x_right / profile.cell_size - 0.5) - 1.0;
+        if (last - first >= 1.0 && first >= 0.0 && last < static_cast<double>(samples))
+        {
+            double sum = 0.0;
+            for (std::size_t k = static_cast<std::size_t>(first); k <= static_cast<std::size_t>(last); ++k) sum += profile.heights[k];
+            ground[i] = static_cast<float>(sum / (last - first + 1.0));
+        }
+        else
+        {
+            ground[i] = sample_at(x_left + 0.5f * params.dx);
+        }
+    }
+    return ground;
+}
+
+std::vector<float> resample_ground_profile(const TerrainProfile& profile, const Params& params, float x_offset)
+{
+    return Terrain::profile(profile, x_offset).offset(params.ground_height).surface(params).data;
+}
+
+Field2D<uint8_t> rasterize_ground_profile(const std::vector<float>& ground_height, const Params& params, unsigned threads)
+{
+    Field1D<float> surface;
+    surface.nx = ground_height.size();
+    surface.data = ground_height;
+    Field2D<uint8_t> air_mask(params.nx, params.ny, 1);
+    fill_air_mask(surface, params, air_mask, threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    return air_mask;
+}
+
+bool air_mask_from_dem(const std::string& path, const Params& params, const TerrainImportOptions& options, Field2D<uint8_t>& air_mask)
+{
+    TerrainProfile profile;
+    if (!read_dem_transect(path, options, profile)) return false;
+    const unsigned threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    fill_air_mask(Terrain::profile(profile, options.x_offset).offset(params.ground_height).surface(params), params, air_mask, threads);
+    return true;
+}
+
+} // namespace snow
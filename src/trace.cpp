@@ -0,0 +1,233 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "json_writer.hpp"
+#include "profiler.hpp"
+
+namespace snow
+{
+namespace profile
+{
+
+namespace detail
+{
+    std::atomic<bool> tracing{ false };
+}
+
+namespace
+{
+    // One thread's ring. events and written belong to the owning thread; stop_trace reads them after
+    // an acquire load of written, once the thread is idle.
+    struct TraceRing
+    {
+        int tid = 0;
+        std::string name;
+        std::vector<TraceEvent> events;
+        std::atomic<std::uint64_t> written{ 0 };
+    };
+
+    struct TraceRegistry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<TraceRing>> rings; // kept after their threads exit
+        std::string path;
+        std::uint64_t start_ns = 0;
+        std::atomic<std::size_t> capacity{ 0 };
+    };
+
+    TraceRegistry& trace_registry()
+    {
+        static TraceRegistry instance;
+        return instance;
+    }
+
+    TraceRing* register_ring()
+    {
+        TraceRegistry& all = trace_registry();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        all.rings.push_back(std::make_unique<TraceRing>());
+        all.rings.back()->tid = static_cast<int>(all.rings.size());
+        return all.rings.back().get();
+    }
+
+    TraceRing& thread_ring()
+    {
+        thread_local TraceRing* ring = register_ring();
+        return *ring;
+    }
+
+    // Empties every ring; the next trace sizes them again. Caller holds the registry lock.
+    void clear_rings(TraceRegistry& all)
+    {
+        for (const std::unique_ptr<TraceRing>& ring : all.rings)
+        {
+            ring->events.clear();
+            ring->events.shrink_to_fit();
+            ring->written.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t now_ns()
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+bool start_trace(const std::string& path, std::size_t events_per_thread)
+{
+    if (events_per_thread == 0 || tracing())
+    {
+        std::cerr << "[trace] cannot start a trace into " << path << (events_per_thread == 0 ? ": rings need room for events\n" : ": one is already on\n");
+        return false;
+    }
+    TraceRegistry& all = trace_registry();
+    {
+        std::lock_guard<std::mutex> lock(all.mutex);
+        all.path = path;
+        all.start_ns = now_ns();
+        all.capacity.store(events_per_thread, std::memory_order_relaxed);
+    }
+    detail::tracing.store(true, std::memory_order_release);
+    return true;
+}
+
+void trace_event(Phase phase, std::uint64_t begin_ns, std::uint64_t duration_ns)
+{
+    TraceRing& ring = thread_ring();
+    if (ring.events.empty())
+    {
+        ring.events.resize(trace_registry().capacity.load(std::memory_order_relaxed));
+        if (ring.events.empty()) return; // no trace started yet
+    }
+    const std::uint64_t n = ring.written.load(std::memory_order_relaxed);
+    TraceEvent& event = ring.events[n % ring.events.size()];
+    event.begin_ns = begin_ns;
+    event.duration_ns = duration_ns;
+    event.phase = phase;
+    ring.written.store(n + 1, std::memory_order_release);
+}
+
+void name_thread(const std::string& name)
+{
+    TraceRing& ring = thread_ring();
+    std::lock_guard<std::mutex> lock(trace_registry().mutex);
+    ring.name = name;
+}
+
+bool stop_trace()
+{
+    if (!detail::tracing.exchange(false, std::memory_order_acq_rel))
+    {
+        return false;
+    }
+
+    TraceRegistry& all = trace_registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    JsonFileWriter json;
+    if (!json.open(all.path))
+    {
+        std::cerr << "[trace] cannot open " << all.path << "\n";
+        clear_rings(all);
+        return false;
+    }
+
+    // Chrome Trace Event format: one complete ("X") event per scope, timestamps in microseconds.
+    std::uint64_t recorded = 0;
+    std::uint64_t dropped = 0;
+    json.begin_object();
+    json.key("displayTimeUnit");
+    json.value(std::string("ns"));
+    json.key("traceEvents");
+    json.begin_array();
+    json.begin_object();
+    json.key("name");
+    json.value(std::string("process_name"));
+    json.key("ph");
+    json.value(std::string("M"));
+    json.key("pid");
+    json.value(1);
+    json.key("args");
+    json.begin_object();
+    json.key("name");
+    json.value(std::string("snow_sim"));
+    json.end_object();
+    json.end_object();
+    for (const std::unique_ptr<TraceRing>& ring : all.rings)
+    {
+        const std::uint64_t written = ring->written.load(std::memory_order_acquire);
+        if (written == 0) continue;
+
+        json.begin_object();
+        json.key("name");
+        json.value(std::string("thread_name"));
+        json.key("ph");
+        json.value(std::string("M"));
+        json.key("pid");
+        json.value(1);
+        json.key("tid");
+        json.value(ring->tid);
+        json.key("args");
+        json.begin_object();
+        json.key("name");
+        json.value(ring->name.empty() ? "thread " + std::to_string(ring->tid) : ring->name);
+        json.end_object();
+        json.end_object();
+
+        const std::uint64_t capacity = ring->events.size();
+        const std::uint64_t first = written > capacity ? written - capacity : 0;
+        dropped += first;
+        for (std::uint64_t n = first; n < written; ++n)
+        {
+            const TraceEvent& event = ring->events[n % capacity];
+            const double begin_us = (static_cast<double>(event.begin_ns) - static_cast<double>(all.start_ns)) * 1.0e-3;
+            json.begin_object();
+            json.key("name");
+            json.value(std::string(phase_name(event.phase)));
+            json.key("cat");
+            json.value(std::string("snow"));
+            json.key("ph");
+            json.value(std::string("X"));
+            json.key("pid");
+            json.value(1);
+            json.key("tid");
+            json.value(ring->tid);
+            json.key("ts");
+            json.value(begin_us);
+            json.key("dur");
+            json.value(static_cast<double>(event.duration_ns) * 1.0e-3);
+            json.end_object();
+            ++recorded;
+        }
+    }
+    clear_rings(all);
+    json.end_array();
+    json.key("otherData");
+    json.begin_object();
+    json.key("dropped_events");
+    json.value(static_cast<long long>(dropped));
+    json.end_object();
+    json.end_object();
+    if (!json.close())
+    {
+        std::cerr << "[trace] failed writing " << all.path << "\n";
+        return false;
+    }
+
+    std::cout << "[trace] wrote " << recorded << " events to " << all.path;
+    if (dropped > 0)
+    {
+        std::cout << " (" << dropped << " older events overwritten; rings hold " << all.capacity.load(std::memory_order_relaxed)
+                  << " per thread)";
+    }
+    std::cout << "\n";
+    return true;
+}
+
+} // namespace profile
+} // namespace snow
@@ -0,0 +1,114 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "backend_registry.hpp"
+#include "cpu_backend.hpp"
+#include "profiler.hpp"
+#include "test_fixtures.hpp"
+
+namespace {
+    // 8x6 grid, steady wind and settling snow; its constant fields stay uniform
+    snow::test::RunSpec small_run()
+    {
+        snow::test::RunSpec spec;
+        spec.nx = 8;
+        spec.ny = 6;
+        return spec;
+    }
+
+    // counts its steps and otherwise leaves the fields alone
+    class CountingSimulation : public snow::Simulation
+    {
+    public:
+        explicit CountingSimulation(int& steps) : steps_(steps) {}
+        void step(snow::Fields&, const snow::Params&) override { ++steps_; }
+
+    private:
+        int& steps_;
+    };
+}
+
+// tests backends / find_backend / make_backend from backend_registry.cpp
+TEST_CASE("built-in backends are registered with their capabilities", "[backend_registry]")
+{
+    const snow::BackendInfo* scalar = snow::find_backend("cpu");
+    const snow::BackendInfo* threaded = snow::find_backend("cpu-threaded");
+    REQUIRE(scalar != nullptr);
+    REQUIRE(threaded != nullptr);
+    REQUIRE_FALSE(scalar->capabilities.simd);
+    REQUIRE_FALSE(scalar->capabilities.threaded);
+    REQUIRE(threaded->capabilities.threaded);
+    REQUIRE((snow::find_backend("cpu-simd") != nullptr) == snow::cpu::simd_available());
+    REQUIRE(snow::find_backend("auto") == nullptr);
+    REQUIRE(snow::find_backend(snow::default_backend_name()) != nullptr);
+
+    snow::BackendOptions options;
+    options.threads = 3;
+    const std::unique_ptr<snow::Simulation> sim = threaded->create(options);
+    const auto* cpu_sim = dynamic_cast<const snow::cpu::CPUSimulation*>(sim.get());
+    REQUIRE(cpu_sim != nullptr);
+    REQUIRE(cpu_sim->threads() == 3);
+}
+
+TEST_CASE("every backend steps a grid the same way", "[backend_registry]")
+{
+    snow::Params params;
+    snow::Fields start;
+    snow::test::make_run(small_run(), params, start);
+
+    snow::Fields reference = start;
+    snow::cpu::CPUSimulation scalar;
+    for (int step = 0; step < 4; ++step) scalar.step(reference, params);
+
+    for (const snow::BackendInfo& backend : snow::backends())
+    {
+        if (backend.capabilities.gpu || backend.name == "counting") continue; // device rounding differs; the test double does nothing
+        snow::Fields fields = start;
+        const std::unique_ptr<snow::Simulation> sim = snow::make_backend(backend.name, params, fields, snow::BackendOptions{});
+        REQUIRE(sim != nullptr);
+        for (int step = 0; step < 4; ++step) sim->step(fields, params);
+        REQUIRE(fields.snow_density.data == reference.snow_density.data);
+    }
+}
+
+TEST_CASE("registered backends can be picked by name and by calibration", "[backend_registry]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    snow::test::make_run(small_run(), params, fields);
+    const snow::Fields before = fields;
+
+    int counted_steps = 0;
+    snow::BackendInfo counting;
+    counting.name = "counting";
+    counting.description = "test double";
+    counting.create = [&counted_steps](const snow::BackendOptions&) { return std::make_unique<CountingSimulation>(counted_steps); };
+    if (!snow::find_backend("counting")) REQUIRE(snow::register_backend(counting));
+    REQUIRE_FALSE(snow::register_backend(counting)); // name taken
+    counting.name = "auto";
+    REQUIRE_FALSE(snow::register_backend(counting));
+
+    std::string chosen;
+    REQUIRE(snow::make_backend("counting", params, fields, snow::BackendOptions{}, &chosen) != nullptr);
+    REQUIRE(chosen == "counting");
+    REQUIRE(snow::make_backend("no-such-backend", params, fields, snow::BackendOptions{}, &chosen) == nullptr);
+
+    // calibration times every backend on a scratch copy; the do-nothing double is the fastest
+    std::vector<snow::BackendTiming> timings;
+    counted_steps = 0;
+    REQUIRE(snow::calibrate_backends(params, fields, snow::BackendOptions{}, 4, &timings) == "counting");
+    REQUIRE(timings.size() == snow::backends().size());
+    REQUIRE(counted_steps == 5); // warm-up plus 4 timed
+    REQUIRE(fields.snow_density.data == before.snow_density.data);
+    REQUIRE(fields.next_snow_density.is_uniform());
+
+    // calibration steps leave the profile, but what was timed before them stays
+    snow::profile::reset();
+    snow::profile::record(snow::profile::Phase::config_load, 1000);
+    REQUIRE(snow::make_backend("auto", params, fields, snow::BackendOptions{}, &chosen) != nullptr);
+    REQUIRE(chosen == "counting");
+    REQUIRE(snow::profile::summarize(snow::profile::Phase::config_load).calls == 1);
+    snow::profile::reset();
+}
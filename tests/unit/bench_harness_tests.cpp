@@ -0,0 +1,56 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "bench_harness.hpp"
+#include "json.hpp"
+
+// tests median / median_absolute_deviation / run_benchmark / write_results_json from bench_harness.cpp
+TEST_CASE("bench statistics use the median and its absolute deviation", "[bench]")
+{
+    REQUIRE(snow::bench::median({}) == 0.0);
+    REQUIRE(snow::bench::median({ 3.0, 1.0, 2.0 }) == 2.0);
+    REQUIRE(snow::bench::median({ 4.0, 1.0, 3.0, 2.0 }) == 2.5);
+
+    // one outlier moves neither statistic much
+    const std::vector<double> samples = { 1.0, 1.1, 0.9, 1.0, 50.0 };
+    const double center = snow::bench::median(samples);
+    REQUIRE(center == 1.0);
+    REQUIRE(snow::bench::median_absolute_deviation(samples, center) == Catch::Approx(0.1));
+}
+
+TEST_CASE("bench runs batches long enough to time and writes json", "[bench]")
+{
+    snow::bench::BenchOptions options;
+    options.warmup_samples = 1;
+    options.repetitions = 5;
+    options.min_sample_seconds = 1.0e-4;
+
+    long long calls = 0;
+    volatile double sink = 0.0;
+    const snow::bench::BenchResult result = snow::bench::run_benchmark("test", "spin", 1000.0, 4000.0, options, [&]
+    {
+        for (int k = 0; k < 1000; ++k) sink = sink + 1.0;
+        ++calls;
+    });
+    REQUIRE(result.samples.size() == 5);
+    REQUIRE(result.iterations_per_sample >= 1);
+    REQUIRE(calls >= static_cast<long long>(6 * result.iterations_per_sample)); // warm-up plus repetitions
+    REQUIRE(result.min_seconds <= result.median_seconds);
+    REQUIRE(result.median_seconds > 0.0);
+    REQUIRE(result.items_per_second() == Catch::Approx(1000.0 / result.median_seconds));
+    REQUIRE(result.bytes_per_second() == Catch::Approx(4000.0 / result.median_seconds));
+
+    const std::string path = (std::filesystem::temp_directory_path() / "snowsim_bench_results.json").string();
+    REQUIRE(snow::bench::write_results_json(path, { result }, 3, options));
+    std::ifstream in(path);
+    const nlohmann::json json = nlohmann::json::parse(in);
+    REQUIRE(json["schema"] == 1);
+    REQUIRE(json["context"]["pinned_cpu"] == 3);
+    REQUIRE(json["benchmarks"].size() == 1);
+    REQUIRE(json["benchmarks"][0]["name"] == "spin");
+    REQUIRE(json["benchmarks"][0]["samples"].size() == 5);
+    REQUIRE(json["benchmarks"][0]["median_seconds"].get<double>() == Catch::Approx(result.median_seconds));
+}
@@ -0,0 +1,160 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "checkpoint.hpp"
+#include "cpu_backend.hpp"
+#include "test_fixtures.hpp"
+
+namespace {
+    // the 6x5 windy run with every field stored; the uniform-field test makes some of them uniform itself
+    void make_windy_run(snow::Params& params, snow::Fields& fields)
+    {
+        snow::test::RunSpec spec;
+        spec.uniform = false;
+        snow::test::make_run(spec, params, fields);
+        params.snow_source_steady_tolerance = 1e-6f;
+        params.snow_source_steady_steps = 5;
+        params.equilibrium_tolerance = 1e-4f;
+        params.equilibrium_sample_interval = 4;
+        params.equilibrium_stable_samples = 100;
+    }
+
+    // the per-step part of the main loop
+    void run_steps(long long from, long long to, snow::Params& params, snow::Fields& fields,
+                   std::vector<snow::SnowSourceBoundary>& sources, snow::EquilibriumMonitor& monitor)
+    {
+        snow::cpu::CPUSimulation sim;
+        for (long long t = from; t < to; ++t)
+        {
+            sim.step(fields, params);
+            for (snow::SnowSourceBoundary& source : sources)
+            {
+                if (source.is_frozen()) continue;
+                source.advance();
+                source.apply(fields);
+            }
+            monitor.observe(fields, t + 1);
+        }
+    }
+}
+
+// tests CheckpointWriter, read_checkpoint and params_hash from checkpoint.cpp
+TEST_CASE("restart from a checkpoint is bit-exact", "[checkpoint]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+    const std::uint64_t hash = snow::params_hash(params);
+    std::vector<snow::SnowSourceBoundary> sources{ snow::SnowSourceBoundary(snow::BoundarySide::left, params, params.ny) };
+    snow::EquilibriumMonitor monitor(params);
+
+    const std::string path = snow::test::temp_path("checkpoint", "bit_exact.ckp").string();
+    run_steps(0, 30, params, fields, sources, monitor);
+    snow::CheckpointWriter writer;
+    REQUIRE(writer.write(path, 30, hash, params, fields, sources, monitor));
+    REQUIRE(writer.last_bytes() % 4096 == 0);
+    run_steps(30, 60, params, fields, sources, monitor);
+
+    // a fresh run built from the same config, restored and continued
+    snow::Params restart_params;
+    snow::Fields restart_fields;
+    make_windy_run(restart_params, restart_fields);
+    std::vector<snow::SnowSourceBoundary> restart_sources{ snow::SnowSourceBoundary(snow::BoundarySide::left, restart_params, restart_params.ny) };
+    snow::EquilibriumMonitor restart_monitor(restart_params);
+    long long step = 0;
+    REQUIRE(snow::read_checkpoint(path, hash, step, restart_params, restart_fields, restart_sources, restart_monitor));
+    REQUIRE(step == 30);
+    run_steps(step, 60, restart_params, restart_fields, restart_sources, restart_monitor);
+
+    REQUIRE(restart_fields.snow_density.data == fields.snow_density.data);
+    REQUIRE(restart_fields.snow_accumulation_mass.data == fields.snow_accumulation_mass.data);
+    REQUIRE(restart_fields.air_mask.data == fields.air_mask.data);
+    REQUIRE(restart_fields.windborn_horizontal_source_left.data == fields.windborn_horizontal_source_left.data);
+    REQUIRE(restart_sources[0].column().data == sources[0].column().data);
+    REQUIRE(restart_sources[0].frozen_step() == sources[0].frozen_step());
+    REQUIRE(restart_monitor.density_change() == monitor.density_change());
+}
+
+TEST_CASE("checkpoints keep uniform fields uniform", "[checkpoint]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+    fields.snow_transport_speed_x = snow::Field2D<float>::uniform(params.nx + 1, params.ny, params.wind_speed);
+    fields.windborn_horizontal_source_right = snow::Field1D<float>::uniform(params.ny, 0.0f);
+    const std::uint64_t hash = snow::params_hash(params);
+    std::vector<snow::SnowSourceBoundary> sources;
+    snow::EquilibriumMonitor monitor(params);
+    run_steps(0, 10, params, fields, sources, monitor);
+
+    const std::string path = snow::test::temp_path("checkpoint", "uniform.ckp").string();
+    snow::CheckpointWriter writer;
+    REQUIRE(writer.write(path, 10, hash, params, fields, sources, monitor));
+
+    snow::Params restart_params;
+    snow::Fields restart_fields;
+    make_windy_run(restart_params, restart_fields);
+    snow::EquilibriumMonitor restart_monitor(restart_params);
+    long long step = 0;
+    REQUIRE(snow::read_checkpoint(path, hash, step, restart_params, restart_fields, sources, restart_monitor));
+    REQUIRE(restart_fields.snow_transport_speed_x.is_uniform());
+    REQUIRE(restart_fields.snow_transport_speed_x.value(6, 4) == params.wind_speed);
+    REQUIRE(restart_fields.windborn_horizontal_source_right.is_uniform());
+    REQUIRE_FALSE(restart_fields.snow_transport_speed_y.is_uniform());
+    REQUIRE(restart_fields.snow_density.data == fields.snow_density.data);
+
+    run_steps(10, 20, params, fields, sources, monitor);
+    run_steps(10, 20, restart_params, restart_fields, sources, restart_monitor);
+    REQUIRE(restart_fields.snow_density.data == fields.snow_density.data);
+}
+
+TEST_CASE("restart refuses mismatched or damaged checkpoints", "[checkpoint]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+    std::vector<snow::SnowSourceBoundary> sources{ snow::SnowSourceBoundary(snow::BoundarySide::left, params, params.ny) };
+    snow::EquilibriumMonitor monitor(params);
+    const std::uint64_t hash = snow::params_hash(params);
+
+    const std::string path = snow::test::temp_path("checkpoint", "mismatch.ckp").string();
+    snow::CheckpointWriter writer;
+    REQUIRE(writer.write(path, 3, hash, params, fields, sources, monitor));
+
+    long long step = -1;
+    SECTION("different params")
+    {
+        snow::Params other = params;
+        other.dx = 2.0f;
+        REQUIRE(snow::params_hash(other) != hash);
+        REQUIRE_FALSE(snow::read_checkpoint(path, snow::params_hash(other), step, params, fields, sources, monitor));
+    }
+    SECTION("different boundary sources")
+    {
+        std::vector<snow::SnowSourceBoundary> right{ snow::SnowSourceBoundary(snow::BoundarySide::right, params, params.ny) };
+        REQUIRE_FALSE(snow::read_checkpoint(path, hash, step, params, fields, right, monitor));
+    }
+    SECTION("truncated file")
+    {
+        const snow::Field2D<float> before = fields.snow_density;
+        std::filesystem::resize_file(path, 256);
+        REQUIRE_FALSE(snow::read_checkpoint(path, hash, step, params, fields, sources, monitor));
+        REQUIRE(fields.snow_density.data == before.data); // nothing restored
+    }
+    REQUIRE(step == -1);
+}
+
+TEST_CASE("params hash ignores run length and viz settings", "[checkpoint]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+    snow::Params longer = params;
+    longer.total_sim_time = params.total_sim_time + 3600.0f;
+    longer.total_time_steps = params.total_time_steps + 36000;
+    longer.viz_on = !params.viz_on;
+    REQUIRE(snow::params_hash(longer) == snow::params_hash(params));
+}
@@ -0,0 +1,217 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "catch_amalgamated.hpp"
+#include "checkpoint.hpp"
+#include "config_cache.hpp"
+#include "field_file.hpp"
+#include "json.hpp"
+#include "my_helper.hpp"
+#include "test_config.hpp"
+
+namespace {
+    // fresh, empty cache directory per test
+    std::string empty_cache_directory(const std::string& name)
+    {
+        const std::filesystem::path directory = snow::test::temp_path("cache", name);
+        std::filesystem::remove_all(directory);
+        return directory.string();
+    }
+
+    // 4x3 grid over ground 10 m up, with a run object, so the cache has a RunConfig to keep too
+    nlohmann::json make_config()
+    {
+        nlohmann::json root = snow::test::make_config(40.0, 30.0);
+        root["params"]["ground_height"] = 10.0;
+        root["params"]["equilibrium_tolerance"] = 0.01;
+        root["params"]["equilibrium_extrapolate"] = false;
+        root["params"]["light_color"] = { 1.0, 0.5, 0.25 };
+        root["run"] = { { "checkpoint_path", "run.ckpt" }, { "checkpoint_interval_steps", 50 },
+                        { "dump_fields", { "air_mask", "snow_density" } } };
+        return root;
+    }
+
+    std::string write_config(const std::string& name, const nlohmann::json& root)
+    {
+        return snow::test::write_config("cache", name, root.dump());
+    }
+
+    void require_same(const snow::Params& a, const snow::Params& b)
+    {
+        REQUIRE(snow::params_hash(a) == snow::params_hash(b));
+        REQUIRE(a.total_sim_time == b.total_sim_time);
+        REQUIRE(a.viz_on == b.viz_on);
+        REQUIRE(a.light_color.z == b.light_color.z);
+        REQUIRE(a.arrow_min_length == b.arrow_min_length);
+    }
+
+    void require_same(const snow::Fields& a, const snow::Fields& b)
+    {
+        REQUIRE(a.air_mask.data == b.air_mask.data);
+        REQUIRE(a.snow_density.data == b.snow_density.data);
+        REQUIRE(a.next_snow_density.data == b.next_snow_density.data);
+        REQUIRE(a.snow_transport_speed_x.nx == b.snow_transport_speed_x.nx);
+        REQUIRE(a.snow_transport_speed_x.data == b.snow_transport_speed_x.data);
+        REQUIRE(a.snow_transport_speed_x.uniform_value == b.snow_transport_speed_x.uniform_value);
+        REQUIRE(a.snow_transport_speed_y.data == b.snow_transport_speed_y.data);
+        REQUIRE(a.snow_accumulation_density.data == b.snow_accumulation_density.data);
+        REQUIRE(a.precipitation_source.data == b.precipitation_source.data);
+        REQUIRE(a.precipitation_source.uniform_value == b.precipitation_source.uniform_value);
+        REQUIRE(a.windborn_horizontal_source_left.data == b.windborn_horizontal_source_left.data);
+        REQUIRE(a.snow_accumulation_depth.data == b.snow_accumulation_depth.data);
+        REQUIRE(a.terrain_surface_index.data == b.terrain_surface_index.data);
+        REQUIRE(a.ground_surface_index.data == b.ground_surface_index.data);
+    }
+}
+
+// tests load_simulation_config_cached from config_cache.cpp
+TEST_CASE("config cache hits return what the loader returned", "[config_cache]")
+{
+    const std::string cache = empty_cache_directory("hit");
+    const std::string path = write_config("hit.json", make_config());
+
+    snow::Params loaded{};
+    snow::Fields loaded_fields;
+    snow::RunConfig loaded_run;
+    REQUIRE(snow::load_simulation_config(path, loaded, loaded_fields, loaded_run));
+
+    snow::Params params{};
+    snow::Fields fields;
+    snow::RunConfig run;
+    bool hit = true;
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE_FALSE(hit);
+    REQUIRE(std::filesystem::exists(snow::config_cache_path(path, cache)));
+
+    snow::Params cached{};
+    snow::Fields cached_fields;
+    snow::RunConfig cached_run;
+    REQUIRE(snow::load_simulation_config_cached(path, cache, cached, cached_fields, cached_run, &hit));
+    REQUIRE(hit);
+    require_same(cached, loaded);
+    require_same(cached_fields, loaded_fields);
+    REQUIRE(cached_run.checkpoint_path == "run.ckpt");
+    REQUIRE(cached_run.checkpoint_interval_steps == 50);
+    REQUIRE(cached_run.dump_fields == loaded_run.dump_fields);
+    REQUIRE(cached_run.snapshot_format == loaded_run.snapshot_format);
+}
+
+TEST_CASE("config cache hits keep settled snow apart from the terrain", "[config_cache]")
+{
+    const std::string cache = empty_cache_directory("settled");
+    snow::Params params{};
+    snow::Fields fields;
+    snow::RunConfig run;
+    REQUIRE(snow::load_simulation_config(write_config("settled_source.json", make_config()), params, fields, run));
+    for (std::size_t i = 0; i < params.nx; ++i)
+    {
+        fields.snow_accumulation_mass(i) = 1.5f * params.dy * params.settaled_snow_density * params.dx;
+    }
+    snow::update_ground_from_accumulation(fields, params);
+
+    // a dump without the indices, so the loader derives them and the cache has to keep what it derived
+    snow::StateDumpOptions options;
+    options.path = snow::test::temp_path("cache", "settled_dump.json").string();
+    REQUIRE(snow::dump_simulation_state_to_json(params, fields, options));
+    std::ifstream stream(options.path);
+    nlohmann::json dumped = nlohmann::json::parse(stream);
+    dumped["fields"].erase("terrain_surface_index");
+    dumped["fields"].erase("ground_surface_index");
+    const std::string path = write_config("settled.json", dumped);
+
+    bool hit = true;
+    for (const bool expect_hit : { false, true })
+    {
+        snow::Params cached{};
+        snow::Fields cached_fields;
+        snow::RunConfig cached_run;
+        REQUIRE(snow::load_simulation_config_cached(path, cache, cached, cached_fields, cached_run, &hit));
+        REQUIRE(hit == expect_hit);
+        REQUIRE(cached_fields.terrain_surface_index.data == fields.terrain_surface_index.data);
+        REQUIRE(cached_fields.ground_surface_index.data == fields.ground_surface_index.data);
+        REQUIRE(cached_fields.snow_accumulation_depth.data == fields.snow_accumulation_depth.data);
+    }
+}
+
+TEST_CASE("config cache misses when the config changes", "[config_cache]")
+{
+    const std::string cache = empty_cache_directory("edit");
+    nlohmann::json root = make_config();
+    const std::string path = write_config("edit.json", root);
+
+    snow::Params params{};
+    snow::Fields fields;
+    snow::RunConfig run;
+    bool hit = false;
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    const std::string first_entry = snow::config_cache_path(path, cache);
+
+    root["params"]["wind_speed"] = 3.0;
+    write_config("edit.json", root);
+    REQUIRE(snow::config_cache_path(path, cache) != first_entry);
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE_FALSE(hit);
+    REQUIRE(params.wind_speed == 3.0f);
+    REQUIRE(fields.snow_transport_speed_x.value(0, 0) == 3.0f);
+}
+
+TEST_CASE("config cache rechecks referenced field files", "[config_cache]")
+{
+    const std::string cache = empty_cache_directory("inputs");
+    snow::Field2D<float> density(4, 3, 1.0f);
+    const std::filesystem::path field_path = snow::test::temp_path("cache", "inputs.snowfld");
+    REQUIRE(snow::write_field_file(field_path.string(), { snow::field_file_source("snow_density", density) }));
+
+    nlohmann::json root = make_config();
+    root["fields"]["snow_density"] = { { "file", field_path.filename().string() } };
+    const std::string path = write_config("inputs.json", root);
+
+    snow::Params params{};
+    snow::Fields fields;
+    snow::RunConfig run;
+    bool hit = false;
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE(run.input_files == std::vector<std::string>{ std::filesystem::absolute(field_path).lexically_normal().string() });
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE(hit);
+    REQUIRE(fields.snow_density(3, 2) == 1.0f);
+
+    // same config bytes, new field data: the entry is stale
+    density(3, 2) = 5.0f;
+    REQUIRE(snow::write_field_file(field_path.string(), { snow::field_file_source("snow_density", density) }));
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE_FALSE(hit);
+    REQUIRE(fields.snow_density(3, 2) == 5.0f);
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE(hit);
+    REQUIRE(fields.snow_density(3, 2) == 5.0f);
+}
+
+TEST_CASE("config cache treats a damaged entry as a miss", "[config_cache]")
+{
+    const std::string cache = empty_cache_directory("damaged");
+    const std::string path = write_config("damaged.json", make_config());
+
+    snow::Params params{};
+    snow::Fields fields;
+    snow::RunConfig run;
+    bool hit = false;
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    const std::string entry = snow::config_cache_path(path, cache);
+    std::ofstream(entry, std::ios::binary | std::ios::trunc) << "not a cache entry";
+
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE_FALSE(hit);
+    REQUIRE(params.nx == 4);
+    REQUIRE(snow::load_simulation_config_cached(path, cache, params, fields, run, &hit));
+    REQUIRE(hit);
+
+    SECTION("a config that does not load is not cached")
+    {
+        const std::string broken = write_config("damaged_broken.json", nlohmann::json{ { "params", 1 } });
+        REQUIRE_FALSE(snow::load_simulation_config_cached(broken, cache, params, fields, run, &hit));
+        REQUIRE_FALSE(std::filesystem::exists(snow::config_cache_path(broken, cache)));
+        REQUIRE_FALSE(snow::load_simulation_config_cached(snow::test::temp_path("cache", "missing.json").string(), cache, params, fields, run, &hit));
+    }
+}
@@ -1,4 +1,13 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+
 #include "catch_amalgamated.hpp"
+#include "cpu_backend.hpp"
+#include "field_file.hpp"
+#include "json.hpp"
+#include "my_helper.hpp"
+#include "test_config.hpp"
 
 // tests load_simulation_config from my_helper.json
 // tests dump_simulation_state_to_example_json from my_helper.json
@@ -9,21 +18,369 @@ TEST_CASE("config loader placeholder", "[config_loader]")
     REQUIRE(true);
 }
 
-/**
- * tests:
- * 
- * sucesfull load
- * 
- * invalid file path
- * 
- * deformed json
- * 
- * json does not contain params
- * 
- * json does not contain fields
- * 
- * params has a missing param
- * 
- * 
- * 
- */
\ No newline at end of file
+namespace {
+    bool load(const std::string& path, snow::Params& params, snow::Fields& fields)
+    {
+        return snow::load_simulation_config(path, params, fields);
+    }
+}
+
+TEST_CASE("config loader generates default fields when the config leaves them empty", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config();
+    root["fields"]["snow_density"] = { { "nx", nullptr }, { "ny", nullptr }, { "data", nlohmann::json::array() } };
+    const std::string path = snow::test::write_config("config", "defaults.json", root.dump());
+
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(path, params, fields));
+    REQUIRE(params.nx == 3);
+    REQUIRE(params.ny == 2);
+    REQUIRE(fields.snow_density.nx == 3);
+    REQUIRE(fields.snow_density.ny == 2);
+    REQUIRE(fields.snow_transport_speed_x.nx == 4);
+    REQUIRE(fields.snow_transport_speed_x.value(0, 0) == Catch::Approx(2.0f));
+    REQUIRE(fields.snow_transport_speed_y.ny == 3);
+    REQUIRE(fields.snow_transport_speed_y.value(0, 0) == Catch::Approx(-0.5f));
+    REQUIRE(fields.windborn_horizontal_source_left.nx == 2);
+    REQUIRE(fields.precipitation_source.value(1) == Catch::Approx(0.1f));
+    REQUIRE(fields.snow_accumulation_density.value(2) == Catch::Approx(200000.0f));
+
+    // constant defaults stay symbolic until written; fields the step writes are allocated
+    REQUIRE(fields.next_snow_density.is_uniform());
+    REQUIRE(fields.snow_transport_speed_x.is_uniform());
+    REQUIRE(fields.snow_transport_speed_x.data.empty());
+    REQUIRE(fields.windborn_horizontal_source_right.is_uniform());
+    REQUIRE(fields.snow_accumulation_density.is_uniform());
+    REQUIRE_FALSE(fields.snow_density.is_uniform());
+    REQUIRE(fields.snow_accumulation_mass.data.size() == 3);
+}
+
+TEST_CASE("config loader reads uniform fields", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config();
+    root["fields"]["snow_transport_speed_x"] = { { "uniform", -4.0 } };
+    root["fields"]["precipitation_source"] = { { "uniform", 0.0 } };
+    root["fields"]["snow_accumulation_mass"] = { { "uniform", 12.5 } };
+
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(snow::test::write_config("config", "uniform.json", root.dump()), params, fields));
+    REQUIRE(fields.snow_transport_speed_x.is_uniform());
+    REQUIRE(fields.snow_transport_speed_x.nx == 4);
+    REQUIRE(fields.snow_transport_speed_x.ny == 2);
+    REQUIRE(fields.snow_transport_speed_x.value(3, 1) == -4.0f);
+    REQUIRE(fields.precipitation_source.value(2) == 0.0f);
+    REQUIRE(fields.snow_accumulation_mass.value(0) == 12.5f);
+
+    root["fields"]["snow_density"] = { { "uniform", "high" } };
+    REQUIRE_FALSE(load(snow::test::write_config("config", "uniform_bad.json", root.dump()), params, fields));
+}
+
+TEST_CASE("config loader writes out uniform fields the step updates in place", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config();
+    root["fields"]["snow_density"] = { { "uniform", 0.05 } };
+    root["fields"]["snow_accumulation_mass"] = { { "uniform", 1.0 } };
+
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(snow::test::write_config("config", "uniform_step.json", root.dump()), params, fields));
+    REQUIRE_FALSE(fields.snow_density.is_uniform());
+    REQUIRE(fields.snow_density.data.size() == 6);
+    REQUIRE_FALSE(fields.snow_accumulation_mass.is_uniform());
+    REQUIRE(fields.snow_accumulation_mass(2) == 1.0f);
+
+    snow::cpu::CPUSimulation sim;
+    sim.step(fields, params);
+    for (std::size_t i = 0; i < params.nx; ++i) REQUIRE(fields.snow_accumulation_mass(i) >= 1.0f);
+}
+
+TEST_CASE("config loader reads the backend choice from params", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config();
+    snow::Params params{};
+    snow::Fields fields;
+    snow::RunConfig run;
+    REQUIRE(snow::load_simulation_config(snow::test::write_config("config", "backend_default.json", root.dump()), params, fields, run));
+    REQUIRE(run.backend.empty());
+
+    root["params"]["backend"] = "auto";
+    REQUIRE(snow::load_simulation_config(snow::test::write_config("config", "backend.json", root.dump()), params, fields, run));
+    REQUIRE(run.backend == "auto");
+
+    root["params"]["backend"] = 3;
+    REQUIRE_FALSE(snow::load_simulation_config(snow::test::write_config("config", "backend_bad.json", root.dump()), params, fields, run));
+}
+
+TEST_CASE("config loader rejects bad files", "[config_loader]")
+{
+    snow::Params params{};
+    snow::Fields fields;
+
+    SECTION("invalid file path")
+    {
+        REQUIRE_FALSE(load(snow::test::temp_path("config", "does_not_exist.json").string(), params, fields));
+    }
+    SECTION("malformed json")
+    {
+        REQUIRE_FALSE(load(snow::test::write_config("config", "malformed.json", "{ \"params\": { \"wind_speed\": 1.0, "), params, fields));
+    }
+    SECTION("json does not contain params")
+    {
+        nlohmann::json root = snow::test::make_config();
+        root.erase("params");
+        REQUIRE_FALSE(load(snow::test::write_config("config", "no_params.json", root.dump()), params, fields));
+    }
+    SECTION("json does not contain fields")
+    {
+        nlohmann::json root = snow::test::make_config();
+        root.erase("fields");
+        REQUIRE_FALSE(load(snow::test::write_config("config", "no_fields.json", root.dump()), params, fields));
+    }
+    SECTION("params has a missing param")
+    {
+        nlohmann::json root = snow::test::make_config();
+        root["params"].erase("dx");
+        REQUIRE_FALSE(load(snow::test::write_config("config", "missing_param.json", root.dump()), params, fields));
+    }
+}
+
+TEST_CASE("config loader streams field data into the fields", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config();
+    // nlohmann sorts keys, so data arrives before nx/ny here just like in dumped configs.
+    root["fields"]["snow_density"] = { { "nx", 3 }, { "ny", 2 }, { "data", { 1, 2, 3, 4, 5, 6.5 } } };
+    root["fields"]["air_mask"] = { { "nx", 3 }, { "ny", 2 }, { "data", { 0, 0, 0, 1, 1, 1 } } };
+    root["fields"]["snow_transport_speed_x"] = { { "nx", 4 }, { "ny", 2 }, { "data", { 1, 1, 1, 1, 3, 3, 3, 3 } } };
+    root["fields"]["windborn_horizontal_source_left"] = { { "nx", 2 }, { "data", { 0.25, 0.5 } } };
+    const std::string path = snow::test::write_config("config", "streamed.json", root.dump());
+
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(path, params, fields));
+    REQUIRE(fields.snow_density.nx == 3);
+    REQUIRE(fields.snow_density(2, 1) == Catch::Approx(6.5f));
+    REQUIRE(fields.air_mask(1, 0) == 0);
+    REQUIRE(fields.air_mask(1, 1) == 1);
+    REQUIRE(fields.terrain_surface_index(1) == 1);
+    REQUIRE(fields.snow_transport_speed_x(3, 1) == Catch::Approx(3.0f));
+    REQUIRE(fields.windborn_horizontal_source_left(1) == Catch::Approx(0.5f));
+    // fields without data still get their defaults
+    REQUIRE(fields.snow_transport_speed_y.value(0, 0) == Catch::Approx(-0.5f));
+}
+
+TEST_CASE("config loader preallocates when nx and ny come before data", "[config_loader]")
+{
+    const std::string text = snow::test::make_config().dump();
+    const std::string fields_text =
+        "\"fields\":{\"snow_density\":{\"nx\":3,\"ny\":2,\"data\":[1,2,3,4,5,6]}}";
+    const std::string path = snow::test::write_config("config", "ordered.json",
+        text.substr(0, text.find("\"fields\"")) + fields_text + text.substr(text.find(",\"params\"")));
+
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(path, params, fields));
+    REQUIRE(fields.snow_density.data.capacity() == 6);
+    REQUIRE(fields.snow_density(0, 1) == Catch::Approx(4.0f));
+}
+
+TEST_CASE("config loader rejects field data that does not fit the grid", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config();
+    snow::Params params{};
+    snow::Fields fields;
+
+    SECTION("value count differs from nx * ny")
+    {
+        root["fields"]["snow_density"] = { { "nx", 3 }, { "ny", 2 }, { "data", { 1, 2, 3 } } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "short_data.json", root.dump()), params, fields));
+    }
+    SECTION("dimensions differ from the grid")
+    {
+        root["fields"]["snow_density"] = { { "nx", 2 }, { "ny", 3 }, { "data", { 1, 2, 3, 4, 5, 6 } } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "wrong_dims.json", root.dump()), params, fields));
+    }
+    SECTION("nx missing while data is present")
+    {
+        root["fields"]["precipitation_source"] = { { "nx", nullptr }, { "data", { 1, 2, 3 } } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "null_nx.json", root.dump()), params, fields));
+    }
+    SECTION("non-numeric data")
+    {
+        root["fields"]["snow_density"] = { { "nx", 3 }, { "ny", 2 }, { "data", { 1, 2, "three", 4, 5, 6 } } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "string_data.json", root.dump()), params, fields));
+    }
+    SECTION("air_mask value out of range")
+    {
+        root["fields"]["air_mask"] = { { "nx", 3 }, { "ny", 2 }, { "data", { 0, 0, 0, 1, 1, 300 } } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "mask_range.json", root.dump()), params, fields));
+    }
+}
+
+TEST_CASE("config loader reads fields from a referenced field file", "[config_loader]")
+{
+    snow::Field2D<std::uint8_t> mask(3, 2, 1);
+    mask(0, 0) = 0;
+    snow::Field2D<float> speed_x(4, 2, 7.0f);
+    const std::filesystem::path file_path = snow::test::temp_path("config", "terrain.snowfld");
+    REQUIRE(snow::write_field_file(file_path.string(), { snow::field_file_source("air_mask", mask),
+                                                         snow::field_file_source("wind_x", speed_x) }));
+
+    nlohmann::json root = snow::test::make_config();
+    root["fields"]["air_mask"] = { { "file", file_path.filename().string() } }; // relative to the config
+    root["fields"]["snow_transport_speed_x"] = { { "file", file_path.string() }, { "array", "wind_x" } };
+
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(snow::test::write_config("config", "file_fields.json", root.dump()), params, fields));
+    REQUIRE(fields.air_mask(0, 0) == 0);
+    REQUIRE(fields.air_mask(2, 1) == 1);
+    REQUIRE(fields.snow_transport_speed_x.nx == 4);
+    REQUIRE(fields.snow_transport_speed_x(3, 1) == 7.0f);
+
+    SECTION("array with the wrong size or type")
+    {
+        root["fields"]["snow_density"] = { { "file", file_path.string() }, { "array", "wind_x" } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "file_wrong_dims.json", root.dump()), params, fields));
+        root["fields"]["snow_density"] = { { "file", file_path.string() }, { "array", "air_mask" } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "file_wrong_type.json", root.dump()), params, fields));
+    }
+    SECTION("missing file")
+    {
+        root["fields"]["air_mask"] = { { "file", "no_such_file.snowfld" } };
+        REQUIRE_FALSE(load(snow::test::write_config("config", "file_missing.json", root.dump()), params, fields));
+    }
+}
+
+// tests dump_simulation_state_to_json from my_helper.cpp
+TEST_CASE("state dumps load back as configs", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config();
+    root["fields"]["snow_density"] = { { "nx", 3 }, { "ny", 2 }, { "data", { 0.1, 2, 3, 4, 5, 6.5 } } };
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(snow::test::write_config("config", "dump_source.json", root.dump()), params, fields));
+    fields.next_snow_density = snow::Field2D<float>(3, 2, 9.0f);
+    fields.snow_accumulation_mass(1) = 1.0f / 3.0f;
+
+    snow::StateDumpOptions options;
+    options.path = snow::test::temp_path("config", "dump.json").string();
+
+    SECTION("default dump round-trips and leaves out next_snow_density")
+    {
+        REQUIRE(snow::dump_simulation_state_to_json(params, fields, options));
+        std::ifstream stream(options.path);
+        const nlohmann::json dumped = nlohmann::json::parse(stream);
+        REQUIRE_FALSE(dumped["fields"].contains("next_snow_density"));
+
+        snow::Params reloaded_params{};
+        snow::Fields reloaded;
+        REQUIRE(load(options.path, reloaded_params, reloaded));
+        REQUIRE(reloaded_params.nx == params.nx);
+        REQUIRE(reloaded_params.wind_speed == params.wind_speed);
+        REQUIRE(reloaded.snow_density.data == fields.snow_density.data);
+        REQUIRE(reloaded.snow_accumulation_mass.data == fields.snow_accumulation_mass.data);
+        REQUIRE(reloaded.air_mask.data == fields.air_mask.data);
+
+        // uniform fields are dumped as their value and load back uniform
+        REQUIRE(dumped["fields"]["snow_transport_speed_x"] == nlohmann::json{ { "uniform", 2.0 } });
+        REQUIRE(reloaded.snow_transport_speed_x.is_uniform());
+        REQUIRE(reloaded.snow_transport_speed_x.nx == 4);
+        REQUIRE(reloaded.precipitation_source.value(0) == fields.precipitation_source.value(0));
+    }
+    SECTION("selected fields only")
+    {
+        options.fields = { "snow_density", "next_snow_density" };
+        REQUIRE(snow::dump_simulation_state_to_json(params, fields, options));
+        std::ifstream stream(options.path);
+        const nlohmann::json dumped = nlohmann::json::parse(stream);
+        REQUIRE(dumped["fields"].size() == 2);
+        REQUIRE(dumped["fields"]["next_snow_density"]["data"][0] == 9.0);
+    }
+    SECTION("unknown field name")
+    {
+        options.fields = { "snow_depth" };
+        REQUIRE_FALSE(snow::dump_simulation_state_to_json(params, fields, options));
+    }
+}
+
+TEST_CASE("config loader cuts air_mask from a DEM transect", "[config_loader]")
+{
+    // 3 columns of 10 m over a 5 m DEM: 0 m, 10 m and 20 m above the lowest column
+    const std::filesystem::path dem_path = snow::test::temp_path("config", "dem.asc");
+    std::ofstream(dem_path) << "ncols 6\nnrows 1\ncellsize 5\n100 100 110 110 120 120\n";
+
+    nlohmann::json root = snow::test::make_config();
+    root["fields"]["air_mask"] = { { "terrain", dem_path.filename().string() } };
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(snow::test::write_config("config", "dem_config.json", root.dump()), params, fields));
+    REQUIRE(fields.air_mask(0, 0) == 1);
+    REQUIRE(fields.air_mask(1, 0) == 0);
+    REQUIRE(fields.air_mask(1, 1) == 1);
+    REQUIRE(fields.air_mask(2, 1) == 0);
+    REQUIRE(fields.terrain_surface_index(2) == 2);
+
+    root["fields"]["air_mask"] = { { "terrain", "no_such_dem.asc" } };
+    REQUIRE_FALSE(load(snow::test::write_config("config", "dem_missing.json", root.dump()), params, fields));
+}
+
+TEST_CASE("state dumps with settled snow keep the surface where it was", "[config_loader]")
+{
+    nlohmann::json root = snow::test::make_config(30.0, 60.0);
+    root["params"]["precipitation_rate"] = 0.0;
+    snow::Params params{};
+    snow::Fields fields;
+    REQUIRE(load(snow::test::write_config("config", "settled_source.json", root.dump()), params, fields));
+    const snow::Field1D<std::size_t> bare_ground = fields.ground_surface_index;
+
+    // 2.5 cells of settled snow in every column: two of them turn to ground
+    for (std::size_t i = 0; i < params.nx; ++i)
+    {
+        fields.snow_accumulation_mass(i) = 2.5f * params.dy * params.settaled_snow_density * params.dx;
+    }
+    snow::update_ground_from_accumulation(fields, params);
+    for (std::size_t i = 0; i < params.nx; ++i) REQUIRE(fields.ground_surface_index(i) == bare_ground(i) + 2);
+
+    snow::StateDumpOptions options;
+    options.path = snow::test::temp_path("config", "settled_dump.json").string();
+    REQUIRE(snow::dump_simulation_state_to_json(params, fields, options));
+    std::ifstream stream(options.path);
+    nlohmann::json dumped = nlohmann::json::parse(stream);
+
+    const auto require_surface_stays = [&](const std::string& path)
+    {
+        snow::Params reloaded_params{};
+        snow::Fields reloaded;
+        REQUIRE(load(path, reloaded_params, reloaded));
+        REQUIRE(reloaded.terrain_surface_index.data == fields.terrain_surface_index.data);
+        REQUIRE(reloaded.ground_surface_index.data == fields.ground_surface_index.data);
+
+        snow::cpu::CPUSimulation simulation;
+        simulation.step(reloaded, reloaded_params);
+        REQUIRE(reloaded.ground_surface_index.data == fields.ground_surface_index.data);
+        REQUIRE(reloaded.air_mask.data == fields.air_mask.data);
+    };
+
+    SECTION("stored indices")
+    {
+        REQUIRE(dumped["fields"].contains("terrain_surface_index"));
+        REQUIRE(dumped["fields"].contains("ground_surface_index"));
+        require_surface_stays(options.path);
+    }
+    SECTION("indices derived from the mask and the settled depth")
+    {
+        dumped["fields"].erase("terrain_surface_index");
+        dumped["fields"].erase("ground_surface_index");
+        require_surface_stays(snow::test::write_config("config", "settled_derived.json", dumped.dump()));
+    }
+    SECTION("out of range index")
+    {
+        dumped["fields"]["ground_surface_index"]["data"][0] = params.ny + 1;
+        snow::Params reloaded_params{};
+        snow::Fields reloaded;
+        REQUIRE_FALSE(load(snow::test::write_config("config", "settled_bad.json", dumped.dump()), reloaded_params,
+                           reloaded));
+    }
+}
@@ -1,7 +1,340 @@
+#include <cmath>
+#include <vector>
+
 #include "catch_amalgamated.hpp"
 
+#include "cpu_backend.hpp"
+#include "my_helper.hpp"
+
+using snow::Field1D;
+using snow::Field2D;
+
+namespace {
+    // 4x6 grid of 1 m cells with the bottom row as ground and no wind.
+    void make_flat_terrain(snow::Params& params, snow::Fields& fields)
+    {
+        params = snow::Params{};
+        params.nx = 4;
+        params.ny = 6;
+        params.dx = 1.0f;
+        params.dy = 1.0f;
+        params.time_step_duration = 0.1f;
+        params.settaled_snow_density = 100.0f;
+
+        fields.air_mask = Field2D<std::uint8_t>(params.nx, params.ny, 1);
+        for (std::size_t i = 0; i < params.nx; ++i) fields.air_mask(i, 0) = 0;
+        fields.snow_density = Field2D<float>(params.nx, params.ny);
+        fields.next_snow_density = Field2D<float>(params.nx, params.ny);
+        fields.snow_transport_speed_x = Field2D<float>(params.nx + 1, params.ny);
+        fields.snow_transport_speed_y = Field2D<float>(params.nx, params.ny + 1);
+        fields.snow_accumulation_mass = Field1D<float>(params.nx);
+        fields.snow_accumulation_density = Field1D<float>(params.nx, params.settaled_snow_density);
+        fields.precipitation_source = Field1D<float>(params.nx);
+        fields.windborn_horizontal_source_left = Field1D<float>(params.ny);
+        fields.windborn_horizontal_source_right = Field1D<float>(params.ny);
+    }
+}
+
 //test step in cpu_backend.cpp
 TEST_CASE("cpu backend step placeholder", "[cpu_backend]")
 {
     REQUIRE(true);
 }
+
+TEST_CASE("settled snow raises and lowers the ground incrementally", "[cpu_backend][terrain]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_flat_terrain(params, fields);
+
+    fields.snow_density(2, 1) = 3.0f; // airborne snow in the cell that is about to be buried
+    fields.snow_accumulation_mass(2) = 250.0f; // 2.5 m of snow at 100 g/m^2 over a 1 m column
+
+    snow::update_ground_from_accumulation(fields, params);
+
+    REQUIRE(fields.terrain_surface_index(2) == 1);
+    REQUIRE(fields.ground_surface_index(2) == 3);
+    REQUIRE(fields.ground_surface_index(1) == 1);
+    REQUIRE(fields.air_mask(2, 1) == 0);
+    REQUIRE(fields.air_mask(2, 2) == 0);
+    REQUIRE(fields.air_mask(2, 3) == 1);
+    REQUIRE(fields.snow_density(2, 1) == 0.0f);
+    REQUIRE(fields.snow_accumulation_mass(2) == Catch::Approx(253.0f));
+    REQUIRE(fields.snow_accumulation_depth(2) == Catch::Approx(2.5f));
+
+    REQUIRE_FALSE(fields.air_mask_dirty.empty());
+    REQUIRE(fields.air_mask_dirty.x_min == 2);
+    REQUIRE(fields.air_mask_dirty.x_max == 2);
+    REQUIRE(fields.air_mask_dirty.y_min == 1);
+    REQUIRE(fields.air_mask_dirty.y_max == 2);
+
+    fields.air_mask_dirty.clear();
+    fields.snow_accumulation_mass(2) = 150.0f;
+    snow::update_ground_from_accumulation(fields, params);
+
+    REQUIRE(fields.ground_surface_index(2) == 2);
+    REQUIRE(fields.air_mask(2, 2) == 1);
+    REQUIRE(fields.air_mask_dirty.y_min == 2);
+    REQUIRE(fields.air_mask_dirty.y_max == 2);
+}
+
+TEST_CASE("step deposits settling snow into the ground column", "[cpu_backend][terrain]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_flat_terrain(params, fields);
+
+    fields.snow_transport_speed_y = Field2D<float>(params.nx, params.ny + 1, -1.0f);
+    fields.snow_density(1, 1) = 2.0f;
+
+    snow::cpu::CPUSimulation sim;
+    sim.step(fields, params);
+
+    // the lowest air cell loses v*c*dt/dy of density; the column gains that much mass per unit cell area.
+    REQUIRE(fields.snow_density(1, 1) == Catch::Approx(1.8f));
+    REQUIRE(fields.snow_accumulation_mass(1) == Catch::Approx(0.2f));
+    REQUIRE(fields.air_mask_dirty.empty());
+}
+
+TEST_CASE("strong surface wind erodes settled snow into the lowest air cell", "[cpu_backend][erosion]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_flat_terrain(params, fields);
+
+    params.erosion_threshold_friction_velocity = 0.2f;
+    params.erosion_rate_coefficient = 100.0f;
+    params.surface_roughness_length = 1e-4f;
+    fields.snow_transport_speed_x = Field2D<float>(params.nx + 1, params.ny, 20.0f);
+    fields.snow_accumulation_mass(1) = 50.0f;
+    fields.snow_accumulation_mass(2) = 1e-3f; // not enough snow to satisfy the full erosion flux
+
+    snow::cpu::CPUSimulation sim;
+    sim.step(fields, params);
+
+    const float friction_velocity = 20.0f * 0.41f / std::log(0.5f / 1e-4f);
+    const float expected_mass = 100.0f * friction_velocity * (friction_velocity * friction_velocity - 0.04f) * 1.0f * 0.1f;
+
+    // column 1 has plenty of snow; column 2 can only give what it holds. Interior cells see no net advection.
+    REQUIRE(fields.snow_accumulation_mass(1) == Catch::Approx(50.0f - expected_mass));
+    REQUIRE(fields.snow_density(1, 1) == Catch::Approx(expected_mass));
+    REQUIRE(fields.snow_accumulation_mass(2) == Catch::Approx(0.0f).margin(1e-7f));
+    REQUIRE(fields.snow_density(2, 1) == Catch::Approx(1e-3f));
+    REQUIRE(fields.snow_density(1, 2) == 0.0f);
+}
+
+TEST_CASE("advect_snow on pitched views matches step on owned fields", "[cpu_backend][views]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_flat_terrain(params, fields);
+    for (std::size_t k = 0; k < fields.snow_density.data.size(); ++k) fields.snow_density.data[k] = 0.1f * static_cast<float>(k % 7);
+    for (float& u : fields.snow_transport_speed_x.data) u = 1.5f;
+    for (float& v : fields.snow_transport_speed_y.data) v = -0.5f;
+    for (float& p : fields.precipitation_source.data) p = 0.2f;
+    for (float& l : fields.windborn_horizontal_source_left.data) l = 0.3f;
+
+    // copy the density into the interior of a wider, taller buffer so the view has a pitch and an offset.
+    const std::size_t pitch = params.nx + 3;
+    std::vector<float> padded_density(pitch * (params.ny + 2), -1.0f);
+    std::vector<float> padded_next(padded_density.size(), -1.0f);
+    const snow::Field2DView<float> density_window = snow::Field2DView<float>(padded_density.data(), pitch, params.ny + 2, pitch).subview(1, 1, params.nx, params.ny);
+    for (std::size_t j = 0; j < params.ny; ++j)
+        for (std::size_t i = 0; i < params.nx; ++i) density_window(i, j) = fields.snow_density(i, j);
+
+    std::vector<float> deposit(params.nx, 0.0f);
+    snow::cpu::StepViews views = snow::cpu::make_step_views(fields);
+    views.snow_density = density_window;
+    views.next_snow_density = snow::Field2DView<float>(padded_next.data(), pitch, params.ny + 2, pitch).subview(1, 1, params.nx, params.ny);
+    views.column_deposit = snow::Field1DView<float>(deposit.data(), deposit.size());
+    snow::cpu::advect_snow(views, params);
+
+    const float mass_before = fields.snow_accumulation_mass(1);
+    snow::cpu::CPUSimulation sim;
+    sim.step(fields, params);
+
+    for (std::size_t j = 0; j < params.ny; ++j)
+        for (std::size_t i = 0; i < params.nx; ++i) REQUIRE(views.next_snow_density(i, j) == fields.snow_density(i, j));
+    REQUIRE(padded_next[0] == -1.0f); // nothing written outside the window
+    REQUIRE(mass_before + deposit[1] == fields.snow_accumulation_mass(1));
+}
+
+TEST_CASE("uniform speeds and sources step like their materialized fields", "[cpu_backend]")
+{
+    snow::Params params;
+    snow::Fields materialized;
+    make_flat_terrain(params, materialized);
+    params.erosion_rate_coefficient = 100.0f;
+    params.erosion_threshold_friction_velocity = 0.2f;
+    params.surface_roughness_length = 1e-4f;
+    for (std::size_t k = 0; k < materialized.snow_density.data.size(); ++k) materialized.snow_density.data[k] = 0.1f * static_cast<float>(k % 5);
+    for (float& m : materialized.snow_accumulation_mass.data) m = 5.0f;
+
+    snow::Fields uniform = materialized;
+    uniform.next_snow_density = Field2D<float>::uniform(params.nx, params.ny, 0.0f);
+    uniform.snow_transport_speed_x = Field2D<float>::uniform(params.nx + 1, params.ny, 8.0f);
+    uniform.snow_transport_speed_y = Field2D<float>::uniform(params.nx, params.ny + 1, -0.5f);
+    uniform.precipitation_source = Field1D<float>::uniform(params.nx, 0.2f);
+    uniform.windborn_horizontal_source_left = Field1D<float>::uniform(params.ny, 0.3f);
+    uniform.windborn_horizontal_source_right = Field1D<float>::uniform(params.ny, 0.0f);
+    uniform.snow_accumulation_density = Field1D<float>::uniform(params.nx, params.settaled_snow_density);
+
+    materialized.snow_transport_speed_x.fill(8.0f);
+    materialized.snow_transport_speed_y.fill(-0.5f);
+    materialized.precipitation_source.fill(0.2f);
+    materialized.windborn_horizontal_source_left.fill(0.3f);
+
+    snow::cpu::CPUSimulation sim;
+    for (int step = 0; step < 5; ++step)
+    {
+        sim.step(materialized, params);
+        sim.step(uniform, params);
+    }
+
+    REQUIRE(uniform.snow_density.data == materialized.snow_density.data);
+    REQUIRE(uniform.snow_accumulation_mass.data == materialized.snow_accumulation_mass.data);
+    REQUIRE(uniform.snow_accumulation_depth.data == materialized.snow_accumulation_depth.data);
+    // only the scratch buffer had to be allocated
+    REQUIRE_FALSE(uniform.next_snow_density.is_uniform());
+    REQUIRE(uniform.snow_transport_speed_x.is_uniform());
+    REQUIRE(uniform.precipitation_source.is_uniform());
+    REQUIRE(uniform.windborn_horizontal_source_left.is_uniform());
+}
+
+TEST_CASE("uniform density and accumulation are materialized by the first step", "[cpu_backend]")
+{
+    snow::Params params;
+    snow::Fields materialized;
+    make_flat_terrain(params, materialized);
+    materialized.snow_density.fill(0.2f);
+    materialized.snow_accumulation_mass.fill(1.0f);
+
+    snow::Fields uniform = materialized;
+    uniform.snow_density = Field2D<float>::uniform(params.nx, params.ny, 0.2f);
+    uniform.snow_accumulation_mass = Field1D<float>::uniform(params.nx, 1.0f);
+
+    snow::cpu::CPUSimulation sim;
+    for (int step = 0; step < 3; ++step)
+    {
+        sim.step(materialized, params);
+        sim.step(uniform, params);
+    }
+
+    REQUIRE_FALSE(uniform.snow_density.is_uniform());
+    REQUIRE_FALSE(uniform.snow_accumulation_mass.is_uniform());
+    REQUIRE(uniform.snow_density.data == materialized.snow_density.data);
+    REQUIRE(uniform.snow_accumulation_mass.data == materialized.snow_accumulation_mass.data);
+}
+
+TEST_CASE("kernel bytes per cell count only the speed fields that are stored", "[cpu_backend]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_flat_terrain(params, fields);
+    REQUIRE(snow::cpu::kernel_bytes_per_cell(fields) == 21.0);
+
+    fields.snow_transport_speed_x = Field2D<float>::uniform(params.nx + 1, params.ny, 3.0f);
+    REQUIRE(snow::cpu::kernel_bytes_per_cell(fields) == 17.0);
+    fields.snow_transport_speed_y = Field2D<float>::uniform(params.nx, params.ny + 1, 0.0f);
+    REQUIRE(snow::cpu::kernel_bytes_per_cell(fields) == 13.0);
+}
+
+TEST_CASE("threaded backends report their worker threads", "[cpu_backend][threads]")
+{
+    REQUIRE(snow::cpu::CPUSimulation(1).step_thread_ids().empty());
+#if defined(__linux__)
+    const std::vector<int> ids = snow::cpu::CPUSimulation(3).step_thread_ids();
+    REQUIRE(ids.size() == 2);
+    REQUIRE(ids[0] != ids[1]);
+#endif
+}
+
+TEST_CASE("threaded steps match the single-threaded step", "[cpu_backend][threads]")
+{
+    // big enough for four row bands; hilly ground with one surface cell per column
+    snow::Params params;
+    snow::Fields serial;
+    make_flat_terrain(params, serial);
+    params.nx = 512;
+    params.ny = 128;
+    params.erosion_rate_coefficient = 100.0f;
+    params.erosion_threshold_friction_velocity = 0.2f;
+    params.surface_roughness_length = 1e-4f;
+    serial.air_mask = Field2D<std::uint8_t>(params.nx, params.ny, 1);
+    for (std::size_t i = 0; i < params.nx; ++i)
+        for (std::size_t j = 0; j < 1 + (i * 7) % 40; ++j) serial.air_mask(i, j) = 0;
+    serial.snow_density = Field2D<float>(params.nx, params.ny);
+    for (std::size_t k = 0; k < serial.snow_density.data.size(); ++k) serial.snow_density.data[k] = 0.01f * static_cast<float>(k % 11);
+    serial.next_snow_density = Field2D<float>(params.nx, params.ny);
+    serial.snow_transport_speed_x = Field2D<float>(params.nx + 1, params.ny);
+    for (std::size_t k = 0; k < serial.snow_transport_speed_x.data.size(); ++k) serial.snow_transport_speed_x.data[k] = 4.0f + static_cast<float>(k % 5);
+    serial.snow_transport_speed_y = Field2D<float>(params.nx, params.ny + 1, -0.5f);
+    serial.snow_accumulation_mass = Field1D<float>(params.nx, 2.0f);
+    serial.snow_accumulation_density = Field1D<float>(params.nx, params.settaled_snow_density);
+    serial.precipitation_source = Field1D<float>(params.nx, 0.2f);
+    serial.windborn_horizontal_source_left = Field1D<float>(params.ny, 0.3f);
+    serial.windborn_horizontal_source_right = Field1D<float>(params.ny);
+    snow::Fields threaded = serial;
+
+    snow::cpu::CPUSimulation single;
+    snow::cpu::CPUSimulation banded(4);
+    REQUIRE(single.threads() == 1);
+    REQUIRE(banded.threads() == 4);
+    for (int step = 0; step < 5; ++step)
+    {
+        single.step(serial, params);
+        banded.step(threaded, params);
+    }
+
+    REQUIRE(threaded.snow_density.data == serial.snow_density.data);
+    REQUIRE(threaded.snow_accumulation_mass.data == serial.snow_accumulation_mass.data);
+    REQUIRE(threaded.air_mask.data == serial.air_mask.data);
+}
+
+TEST_CASE("simd steps match the scalar step", "[cpu_backend][simd]")
+{
+    // wide enough for several four-cell blocks per row, with ground bumps that force the scalar fallback
+    snow::Params params;
+    snow::Fields scalar;
+    make_flat_terrain(params, scalar);
+    params.nx = 37;
+    params.ny = 9;
+    params.erosion_rate_coefficient = 100.0f;
+    params.erosion_threshold_friction_velocity = 0.2f;
+    params.surface_roughness_length = 1e-4f;
+    scalar.air_mask = Field2D<std::uint8_t>(params.nx, params.ny, 1);
+    for (std::size_t i = 0; i < params.nx; ++i)
+        for (std::size_t j = 0; j < 1 + (i % 9 == 4 ? 3 : 0); ++j) scalar.air_mask(i, j) = 0;
+    scalar.snow_density = Field2D<float>(params.nx, params.ny);
+    for (std::size_t k = 0; k < scalar.snow_density.data.size(); ++k) scalar.snow_density.data[k] = 0.013f * static_cast<float>(k % 13);
+    scalar.snow_density.data[40] = 1e-7f; // flux under the threshold
+    scalar.next_snow_density = Field2D<float>(params.nx, params.ny);
+    scalar.snow_transport_speed_x = Field2D<float>(params.nx + 1, params.ny);
+    for (std::size_t k = 0; k < scalar.snow_transport_speed_x.data.size(); ++k) scalar.snow_transport_speed_x.data[k] = static_cast<float>(k % 7) - 3.0f;
+    scalar.snow_transport_speed_y = Field2D<float>(params.nx, params.ny + 1);
+    for (std::size_t k = 0; k < scalar.snow_transport_speed_y.data.size(); ++k) scalar.snow_transport_speed_y.data[k] = 0.25f * static_cast<float>(k % 5) - 0.6f;
+    scalar.snow_accumulation_mass = Field1D<float>(params.nx, 2.0f);
+    scalar.snow_accumulation_density = Field1D<float>(params.nx, params.settaled_snow_density);
+    scalar.precipitation_source = Field1D<float>(params.nx, 0.2f);
+    scalar.windborn_horizontal_source_left = Field1D<float>(params.ny, 0.3f);
+    scalar.windborn_horizontal_source_right = Field1D<float>(params.ny, 0.1f);
+    snow::Fields simd = scalar;
+    snow::Fields uniform_wind = scalar;
+    uniform_wind.snow_transport_speed_x = Field2D<float>::uniform(params.nx + 1, params.ny, 2.5f);
+    snow::Fields uniform_wind_simd = uniform_wind;
+
+    snow::cpu::CPUSimulation scalar_sim;
+    snow::cpu::CPUSimulation simd_sim(1, true);
+    REQUIRE(simd_sim.simd() == snow::cpu::simd_available());
+    for (int step = 0; step < 6; ++step)
+    {
+        scalar_sim.step(scalar, params);
+        simd_sim.step(simd, params);
+        scalar_sim.step(uniform_wind, params);
+        simd_sim.step(uniform_wind_simd, params);
+    }
+
+    REQUIRE(simd.snow_density.data == scalar.snow_density.data);
+    REQUIRE(simd.snow_accumulation_mass.data == scalar.snow_accumulation_mass.data);
+    REQUIRE(uniform_wind_simd.snow_density.data == uniform_wind.snow_density.data);
+}
@@ -0,0 +1,83 @@
+#include "catch_amalgamated.hpp"
+
+#include "equilibrium_monitor.hpp"
+
+using snow::Field1D;
+using snow::Field2D;
+
+namespace {
+    snow::Params monitor_params()
+    {
+        snow::Params params{};
+        params.nx = 3;
+        params.ny = 4;
+        params.dx = 1.0f;
+        params.dy = 1.0f;
+        params.time_step_duration = 0.5f;
+        params.settaled_snow_density = 1e6f;
+        params.equilibrium_tolerance = 1e-3f;
+        params.equilibrium_sample_interval = 10;
+        params.equilibrium_stable_samples = 2;
+        return params;
+    }
+
+    snow::Fields monitor_fields(const snow::Params& params)
+    {
+        snow::Fields fields;
+        fields.air_mask = Field2D<std::uint8_t>(params.nx, params.ny, 1);
+        fields.snow_density = Field2D<float>(params.nx, params.ny, 2.0f);
+        fields.snow_accumulation_mass = Field1D<float>(params.nx);
+        fields.snow_accumulation_density = Field1D<float>(params.nx, params.settaled_snow_density);
+        return fields;
+    }
+}
+
+// tests EquilibriumMonitor from equilibrium_monitor.cpp
+TEST_CASE("equilibrium monitor detects steady deposition and extrapolates it", "[equilibrium]")
+{
+    const snow::Params params = monitor_params();
+    snow::Fields fields = monitor_fields(params);
+    snow::EquilibriumMonitor monitor(params);
+    REQUIRE(monitor.enabled());
+
+    // constant density, column i gains (i + 1) g per step: stationary from the start.
+    long long steps = 0;
+    bool reached = false;
+    while (!reached && steps < 1000)
+    {
+        ++steps;
+        for (std::size_t i = 0; i < params.nx; ++i) fields.snow_accumulation_mass(i) += static_cast<float>(i + 1);
+        reached = monitor.observe(fields, steps);
+    }
+
+    // samples at 10 (baseline), 20 (first rate), 30 and 40 (two stationary comparisons).
+    REQUIRE(reached);
+    REQUIRE(monitor.equilibrium_step() == 40);
+    REQUIRE(monitor.density_change() == 0.0f);
+    REQUIRE(monitor.deposition_rate() == Catch::Approx((1.0f + 2.0f + 3.0f) / 0.5f));
+
+    monitor.extrapolate_accumulation(fields, params, 5.0f); // 10 more steps' worth
+    REQUIRE(fields.snow_accumulation_mass(0) == Catch::Approx(50.0f));
+    REQUIRE(fields.snow_accumulation_mass(2) == Catch::Approx(150.0f));
+}
+
+TEST_CASE("equilibrium monitor keeps running while the drift changes", "[equilibrium]")
+{
+    const snow::Params params = monitor_params();
+    snow::Fields fields = monitor_fields(params);
+    snow::EquilibriumMonitor monitor(params);
+
+    for (long long step = 1; step <= 200; ++step)
+    {
+        fields.snow_density(1, 1) += 0.1f; // density keeps growing
+        fields.snow_accumulation_mass(0) += 1.0f;
+        REQUIRE_FALSE(monitor.observe(fields, step));
+    }
+    REQUIRE(monitor.density_change() > params.equilibrium_tolerance);
+
+    snow::Params disabled = params;
+    disabled.equilibrium_tolerance = 0.0f;
+    snow::EquilibriumMonitor off(disabled);
+    REQUIRE_FALSE(off.enabled());
+    REQUIRE_FALSE(off.observe(fields, 10));
+}
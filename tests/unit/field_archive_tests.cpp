@@ -0,0 +1,182 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "field_archive.hpp"
+
+namespace {
+    std::string archive_temp_path(const std::string& name)
+    {
+        return (std::filesystem::temp_directory_path() / ("snowsim_archive_" + name)).string();
+    }
+
+    // 37 x 23 grid, so 8 x 8 tiles leave narrow edge tiles; only part of the grid changes per frame.
+    snow::Field2D<float> make_frame(int k)
+    {
+        snow::Field2D<float> field(37, 23, 0.0f);
+        for (std::size_t j = 0; j < field.ny; ++j)
+        {
+            for (std::size_t i = 0; i < field.nx; ++i)
+            {
+                field(i, j) = 0.01f * static_cast<float>(i + 100 * j) + (i < 20 ? 0.5f * std::sin(0.3f * k + i) : 0.0f);
+            }
+        }
+        return field;
+    }
+
+    // ten frames, 0.5 s apart, in blocks of four
+    std::string write_archive(const std::string& name, snow::ArchiveOptions options = { 8, 8, 4, 0.0f })
+    {
+        const std::string path = archive_temp_path(name);
+        snow::ArchiveWriter writer;
+        REQUIRE(writer.open(path, 37, 23, options));
+        for (int k = 0; k < 10; ++k)
+        {
+            REQUIRE(writer.append(10 * k, 0.5 * k, make_frame(k)));
+        }
+        REQUIRE(writer.close());
+        const std::size_t tiles = (36 / options.tile_nx + 1) * (22 / options.tile_ny + 1);
+        REQUIRE(writer.stats().frames == 10 * tiles);
+        return path;
+    }
+}
+
+// tests ArchiveWriter / ArchiveReader from field_archive.cpp
+TEST_CASE("archive reads back every frame of the whole grid", "[field_archive]")
+{
+    snow::ArchiveReader reader;
+    REQUIRE(reader.open(write_archive("full.snarc")));
+    REQUIRE(reader.nx() == 37);
+    REQUIRE(reader.ny() == 23);
+    REQUIRE(reader.frame_count() == 10);
+    REQUIRE(reader.frame_step(9) == 90);
+
+    snow::ArchiveRegion region;
+    REQUIRE(reader.read(0.0, 100.0, 0, 36, 0, 22, region));
+    REQUIRE(region.frames.size() == 10);
+    REQUIRE(reader.last_chunks_read() == 3 * 5 * 3);
+    for (int k = 0; k < 10; ++k)
+    {
+        REQUIRE(region.steps[k] == 10 * k);
+        REQUIRE(region.frames[k].data == make_frame(k).data);
+    }
+}
+
+TEST_CASE("archive region queries decode only the chunks they overlap", "[field_archive]")
+{
+    snow::ArchiveReader reader;
+    REQUIRE(reader.open(write_archive("region.snarc")));
+    snow::ArchiveRegion region;
+
+    SECTION("time window inside one block, box across two tiles")
+    {
+        REQUIRE(reader.read(2.5, 3.0, 10, 17, 3, 5, region)); // frames 5 and 6
+        REQUIRE(reader.last_chunks_read() == 2);
+        REQUIRE(region.steps == std::vector<long long>{ 50, 60 });
+        REQUIRE(region.x_min == 10);
+        REQUIRE(region.y_min == 3);
+        REQUIRE(region.frames[1].nx == 8);
+        REQUIRE(region.frames[1].ny == 3);
+        const snow::Field2D<float> expected = make_frame(6);
+        for (std::size_t y = 3; y <= 5; ++y)
+        {
+            for (std::size_t x = 10; x <= 17; ++x)
+            {
+                REQUIRE(region.frames[1](x - 10, y - 3) == expected(x, y));
+            }
+        }
+    }
+    SECTION("bounds are reordered and clamped like print_field_subregion")
+    {
+        REQUIRE(reader.read(4.5, 4.5, 100, 35, 30, 21, region)); // frame 9, cells 35..36 x 21..22
+        REQUIRE(reader.last_chunks_read() == 1);
+        REQUIRE(region.frames.size() == 1);
+        REQUIRE(region.x_min == 35);
+        REQUIRE(region.frames[0].nx == 2);
+        REQUIRE(region.frames[0].ny == 2);
+        REQUIRE(region.frames[0](1, 1) == make_frame(9)(36, 22));
+    }
+    SECTION("empty time window")
+    {
+        REQUIRE(reader.read(7.0, 9.0, 0, 36, 0, 22, region));
+        REQUIRE(region.frames.empty());
+        REQUIRE(reader.last_chunks_read() == 0);
+    }
+}
+
+TEST_CASE("archive chunks honour the error bound", "[field_archive]")
+{
+    const float bound = 1.0e-3f;
+    snow::ArchiveReader reader;
+    REQUIRE(reader.open(write_archive("lossy.snarc", { 16, 16, 3, bound })));
+    snow::ArchiveRegion region;
+    REQUIRE(reader.read(0.0, 100.0, 0, 36, 0, 22, region));
+    for (int k = 0; k < 10; ++k)
+    {
+        const snow::Field2D<float> expected = make_frame(k);
+        for (std::size_t c = 0; c < expected.data.size(); ++c)
+        {
+            REQUIRE(std::fabs(region.frames[k].data[c] - expected.data[c]) <= bound * 1.001f);
+        }
+    }
+}
+
+TEST_CASE("archive reader rejects damaged files", "[field_archive]")
+{
+    const std::string path = write_archive("damaged.snarc");
+    const std::uintmax_t size = std::filesystem::file_size(path);
+    snow::ArchiveReader reader;
+
+    SECTION("truncated")
+    {
+        std::filesystem::resize_file(path, size - 8);
+        REQUIRE_FALSE(reader.open(path));
+    }
+    SECTION("not an archive")
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << "not an archive at all, but long enough to hold a trailer............";
+        REQUIRE_FALSE(reader.open(path));
+    }
+    SECTION("frame count that wraps around")
+    {
+        // 10 + 2^62 frames: both the frame table and the chunk index sizes wrap back to the real ones
+        const std::uint64_t frame_count = 10 + (std::uint64_t{ 1 } << 62);
+        std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(static_cast<std::streamoff>(size) - 16); // frame_count, then footer_offset, end the trailer
+        stream.write(reinterpret_cast<const char*>(&frame_count), sizeof(frame_count));
+        stream.close();
+        REQUIRE_FALSE(reader.open(path));
+    }
+
+    snow::ArchiveRegion region;
+    SECTION("tile frame with the wrong size")
+    {
+        // chunk 0 starts right after the 8-byte magic; its first frame's nx and ny are at 8 and 12
+        const std::uint32_t shape[2] = { 65536, 65536 };
+        std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(8 + 8);
+        stream.write(reinterpret_cast<const char*>(shape), sizeof(shape));
+        stream.close();
+        REQUIRE(reader.open(path));
+        REQUIRE_FALSE(reader.read(0.0, 0.0, 0, 0, 0, 0, region));
+    }
+    SECTION("frames running past their chunk")
+    {
+        // chunk 0 indexed as empty: its frames are still in the file, but are not the chunk's to read
+        std::uint64_t footer_offset = 0;
+        std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekg(static_cast<std::streamoff>(size) - 8);
+        stream.read(reinterpret_cast<char*>(&footer_offset), sizeof(footer_offset));
+        const std::uint64_t bytes = 0;
+        stream.seekp(static_cast<std::streamoff>(footer_offset + 10 * 16 + 8)); // past the frame table and chunk 0's offset
+        stream.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+        stream.close();
+        REQUIRE(reader.open(path));
+        REQUIRE_FALSE(reader.read(0.0, 0.0, 0, 0, 0, 0, region));
+        REQUIRE(reader.read(0.0, 0.0, 36, 36, 22, 22, region)); // other chunks still read
+    }
+}
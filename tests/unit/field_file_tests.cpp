@@ -0,0 +1,108 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "catch_amalgamated.hpp"
+#include "field_file.hpp"
+
+namespace {
+    std::filesystem::path field_file_temp_path(const std::string& name)
+    {
+        return std::filesystem::temp_directory_path() / ("snowsim_field_" + name);
+    }
+}
+
+// tests write_field_file, MappedFieldFile and copy_mapped_field from field_file.cpp
+TEST_CASE("field file round trips arrays through a mapping", "[field_file]")
+{
+    snow::Field2D<float> speed(5, 3);
+    for (std::size_t k = 0; k < speed.data.size(); ++k) speed.data[k] = static_cast<float>(k) * 0.5f;
+    snow::Field2D<std::uint8_t> mask(3, 2, 1);
+    mask(1, 0) = 0;
+    snow::Field1D<float> source{ 0.25f, 0.5f };
+
+    const std::string path = field_file_temp_path("round_trip.snowfld").string();
+    REQUIRE(snow::write_field_file(path, { snow::field_file_source("speed", speed),
+                                           snow::field_file_source("mask", mask),
+                                           snow::field_file_source("source", source) }));
+
+    snow::MappedFieldFile file;
+    REQUIRE(file.open(path));
+    REQUIRE(file.entries().size() == 3);
+
+    const snow::Field2DView<const float> speed_view = file.view<float>("speed");
+    REQUIRE_FALSE(speed_view.empty());
+    REQUIRE(speed_view.nx == 5);
+    REQUIRE(speed_view.ny == 3);
+    REQUIRE(speed_view.pitch == 16); // 20-byte rows padded to 64 bytes
+    REQUIRE(reinterpret_cast<std::uintptr_t>(speed_view.data) % 64 == 0);
+    REQUIRE(speed_view(4, 2) == speed(4, 2));
+
+    const snow::Field2DView<const std::uint8_t> mask_view = file.view<std::uint8_t>("mask");
+    REQUIRE(mask_view(1, 0) == 0);
+    REQUIRE(mask_view(2, 1) == 1);
+
+    // wrong dtype or name gives an empty view
+    REQUIRE(file.view<std::uint8_t>("speed").empty());
+    REQUIRE(file.view<float>("missing").empty());
+
+    snow::Field2D<float> speed_copy;
+    snow::copy_mapped_field(speed_view, speed_copy);
+    REQUIRE(speed_copy.data == speed.data);
+
+    snow::Field1D<float> source_copy;
+    snow::copy_mapped_field(file.view<float>("source"), source_copy);
+    REQUIRE(source_copy.nx == 2);
+    REQUIRE(source_copy(1) == 0.5f);
+}
+
+TEST_CASE("field file rejects foreign and truncated files", "[field_file]")
+{
+    snow::MappedFieldFile file;
+    REQUIRE_FALSE(file.open(field_file_temp_path("does_not_exist.snowfld").string()));
+
+    const std::string foreign = field_file_temp_path("foreign.snowfld").string();
+    {
+        std::ofstream stream(foreign, std::ios::binary);
+        stream << std::string(256, 'x');
+    }
+    REQUIRE_FALSE(file.open(foreign));
+
+    snow::Field2D<float> field(64, 64, 1.0f);
+    const std::string truncated = field_file_temp_path("truncated.snowfld").string();
+    REQUIRE(snow::write_field_file(truncated, { snow::field_file_source("field", field) }));
+    std::filesystem::resize_file(truncated, std::filesystem::file_size(truncated) - 64);
+    REQUIRE_FALSE(file.open(truncated));
+    REQUIRE_FALSE(file.is_open());
+}
+
+TEST_CASE("field file rejects damaged array offsets and sizes", "[field_file]")
+{
+    // the first table entry starts after the 64-byte header; ny, pitch and offset sit 80, 88 and 96 bytes in
+    const auto patched = [](const std::string& name, std::streamoff position, std::uint64_t value)
+    {
+        snow::Field2D<float> field(8, 4, 1.0f);
+        const std::string path = field_file_temp_path(name).string();
+        REQUIRE(snow::write_field_file(path, { snow::field_file_source("field", field) }));
+        std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+        stream.seekp(64 + position);
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        return path;
+    };
+
+    snow::MappedFieldFile file;
+    REQUIRE_FALSE(file.open(patched("offset_past_end.snowfld", 96, std::uint64_t{ 1 } << 40)));
+    REQUIRE_FALSE(file.is_open());
+    // 2^62 rows of 16 floats is 2^68 bytes, which wraps to 0 in 64 bits
+    REQUIRE_FALSE(file.open(patched("rows_wrap.snowfld", 80, std::uint64_t{ 1 } << 62)));
+    REQUIRE_FALSE(file.open(patched("pitch_wrap.snowfld", 88, (std::uint64_t{ 1 } << 62) + 16)));
+}
+
+TEST_CASE("field file refuses duplicate or oversized names", "[field_file]")
+{
+    snow::Field2D<float> field(2, 2);
+    const std::string path = field_file_temp_path("names.snowfld").string();
+    REQUIRE_FALSE(snow::write_field_file(path, { snow::field_file_source("a", field), snow::field_file_source("a", field) }));
+    REQUIRE_FALSE(snow::write_field_file(path, { snow::field_file_source(std::string(64, 'n'), field) }));
+}
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "types.hpp"
+
+// tests Field1DView / Field2DView from types.hpp
+TEST_CASE("Field2D hands out views that alias its storage", "[field_view]")
+{
+    snow::Field2D<float> field(4, 3);
+    for (std::size_t k = 0; k < field.data.size(); ++k) field.data[k] = static_cast<float>(k);
+
+    const snow::Field2DView<float> view = field.view();
+    REQUIRE(view.nx == 4);
+    REQUIRE(view.ny == 3);
+    REQUIRE(view.pitch == 4);
+    REQUIRE(view(2, 1) == field(2, 1));
+
+    view(3, 2) = 42.0f;
+    REQUIRE(field(3, 2) == 42.0f);
+
+    const snow::Field2DView<const float> read_only = view; // mutable converts to const
+    REQUIRE(read_only(3, 2) == 42.0f);
+    REQUIRE(static_cast<const snow::Field2D<float>&>(field).view().data == field.data.data());
+}
+
+TEST_CASE("subview keeps the parent pitch and offsets the origin", "[field_view]")
+{
+    snow::Field2D<std::uint8_t> mask(5, 4, 0);
+    mask(2, 1) = 7;
+    mask(3, 2) = 9;
+
+    const snow::Field2DView<std::uint8_t> window = mask.view().subview(2, 1, 2, 2);
+    REQUIRE(window.nx == 2);
+    REQUIRE(window.ny == 2);
+    REQUIRE(window.pitch == 5);
+    REQUIRE(window(0, 0) == 7);
+    REQUIRE(window(1, 1) == 9);
+    REQUIRE(window.in_bounds(1, 1));
+    REQUIRE_FALSE(window.in_bounds(2, 0));
+
+    window(1, 0) = 3;
+    REQUIRE(mask(3, 1) == 3);
+}
+
+TEST_CASE("row and column views stride through a 2D view", "[field_view]")
+{
+    std::vector<float> buffer(6 * 3, 0.0f); // external buffer with two padding columns per row
+    const snow::Field2DView<float> grid(buffer.data(), 4, 3, 6);
+    grid(1, 2) = 5.0f;
+    grid(3, 0) = 8.0f;
+
+    const snow::Field1DView<float> column = grid.column_view(1);
+    REQUIRE(column.nx == 3);
+    REQUIRE(column.stride == 6);
+    REQUIRE(column(2) == 5.0f);
+
+    const snow::Field1DView<const float> row = grid.row_view(0);
+    REQUIRE(row.nx == 4);
+    REQUIRE(row(3) == 8.0f);
+
+    snow::Field1D<float> line{ 1.0f, 2.0f };
+    line.view()(1) = 4.0f;
+    REQUIRE(line(1) == 4.0f);
+    REQUIRE(snow::Field1DView<float>().empty());
+}
+
+TEST_CASE("uniform fields read as one value until materialized", "[field_view]")
+{
+    snow::Field2D<float> field = snow::Field2D<float>::uniform(4, 3, 2.5f);
+    REQUIRE(field.is_uniform());
+    REQUIRE(field.data.empty());
+    REQUIRE(field.value(3, 2) == 2.5f);
+    REQUIRE(static_cast<const snow::Field2D<float>&>(field).view().empty());
+
+    field.fill(-1.0f); // stays symbolic
+    REQUIRE(field.is_uniform());
+    REQUIRE(field.value(0, 0) == -1.0f);
+
+    const snow::Field2DView<float> view = field.view(); // a mutable view materializes
+    REQUIRE_FALSE(field.is_uniform());
+    REQUIRE(field.data == std::vector<float>(12, -1.0f));
+    view(1, 1) = 7.0f;
+    REQUIRE(field.value(1, 1) == 7.0f);
+
+    snow::Field1D<float> source = snow::Field1D<float>::uniform(5, 0.5f);
+    const snow::Field1DView<const float> read_only = static_cast<const snow::Field1D<float>&>(source).view();
+    REQUIRE(read_only.stride == 0);
+    REQUIRE(read_only.nx == 5);
+    REQUIRE(read_only(4) == 0.5f);
+    REQUIRE(source.is_uniform());
+
+    source.resize(2, 1.0f);
+    REQUIRE_FALSE(source.is_uniform());
+    REQUIRE(source.data == std::vector<float>{ 1.0f, 1.0f });
+}
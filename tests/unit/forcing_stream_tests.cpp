@@ -0,0 +1,173 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "forcing_stream.hpp"
+
+namespace {
+    std::filesystem::path forcing_temp_path(const std::string& name)
+    {
+        return std::filesystem::temp_directory_path() / ("snowsim_forcing_" + name);
+    }
+}
+
+// tests ForcingStream, convert_forcing_csv_to_binary and apply_forcing from forcing_stream.cpp
+TEST_CASE("forcing csv converts once and interpolates between records", "[forcing]")
+{
+    const std::filesystem::path csv_path = forcing_temp_path("interp.csv");
+    std::filesystem::remove(csv_path.string() + ".bin");
+    {
+        std::ofstream csv(csv_path);
+        csv << "time,precipitation_rate,wind_speed,settling_speed,p0,p1\n";
+        csv << "0,0.1,2,0.5,0.1,0.2\n";
+        csv << "10,0.3,4,0.5,0.3,0.6\n";
+        csv << "20,0.0,-2,1.0,0.0,0.0\n";
+    }
+
+    snow::ForcingStream stream;
+    REQUIRE(stream.open(csv_path.string(), 2));
+    REQUIRE(std::filesystem::exists(csv_path.string() + ".bin"));
+    REQUIRE(stream.record_count() == 3);
+    REQUIRE(stream.profile_cells() == 2);
+
+    snow::ForcingRecord sample;
+    REQUIRE(stream.sample(0.0, sample));
+    REQUIRE(sample.wind_speed == Catch::Approx(2.0f));
+
+    REQUIRE(stream.sample(5.0, sample));
+    REQUIRE(sample.precipitation_rate == Catch::Approx(0.2f));
+    REQUIRE(sample.wind_speed == Catch::Approx(3.0f));
+    REQUIRE(sample.precipitation_profile[1] == Catch::Approx(0.4f));
+
+    REQUIRE(stream.sample(15.0, sample));
+    REQUIRE(sample.wind_speed == Catch::Approx(1.0f));
+    REQUIRE(sample.settling_speed == Catch::Approx(0.75f));
+
+    REQUIRE(stream.sample(100.0, sample)); // past the end holds the last record
+    REQUIRE(sample.wind_speed == Catch::Approx(-2.0f));
+    stream.close();
+}
+
+TEST_CASE("forcing csv is reconverted after it is edited", "[forcing]")
+{
+    const std::filesystem::path csv_path = forcing_temp_path("edited.csv");
+    std::filesystem::remove(csv_path.string() + ".bin");
+    {
+        std::ofstream csv(csv_path);
+        csv << "0,0.1,2,0.5\n";
+    }
+    snow::ForcingRecord sample;
+    {
+        snow::ForcingStream stream;
+        REQUIRE(stream.open(csv_path.string()));
+        REQUIRE(stream.sample(0.0, sample));
+        REQUIRE(sample.wind_speed == Catch::Approx(2.0f));
+    }
+
+    {
+        std::ofstream csv(csv_path, std::ios::trunc);
+        csv << "0,0.1,7,0.5\n";
+    }
+    // newer than the conversion, whatever the file system's timestamp resolution
+    std::filesystem::last_write_time(csv_path, std::filesystem::last_write_time(csv_path.string() + ".bin") + std::chrono::seconds(2));
+    snow::ForcingStream stream;
+    REQUIRE(stream.open(csv_path.string()));
+    REQUIRE(stream.sample(0.0, sample));
+    REQUIRE(sample.wind_speed == Catch::Approx(7.0f));
+}
+
+TEST_CASE("a failed forcing conversion leaves no series behind", "[forcing]")
+{
+    const std::filesystem::path csv_path = forcing_temp_path("broken.csv");
+    const std::string bin_path = csv_path.string() + ".bin";
+    std::filesystem::remove(bin_path);
+    {
+        std::ofstream csv(csv_path);
+        csv << "0,0.1,2,0.5\n";
+        csv << "10,0.1,oops,0.5\n";
+    }
+    snow::ForcingStream stream;
+    REQUIRE_FALSE(stream.open(csv_path.string()));
+    REQUIRE_FALSE(std::filesystem::exists(bin_path));
+    REQUIRE_FALSE(std::filesystem::exists(bin_path + ".tmp"));
+
+    // a failed reconversion keeps the last good series intact
+    {
+        std::ofstream csv(csv_path, std::ios::trunc);
+        csv << "0,0.1,2,0.5\n";
+    }
+    REQUIRE(snow::convert_forcing_csv_to_binary(csv_path.string(), bin_path));
+    const auto good_size = std::filesystem::file_size(bin_path);
+    {
+        std::ofstream csv(csv_path, std::ios::app);
+        csv << "5,0.1\n";
+    }
+    REQUIRE_FALSE(snow::convert_forcing_csv_to_binary(csv_path.string(), bin_path));
+    REQUIRE(std::filesystem::file_size(bin_path) == good_size);
+    REQUIRE_FALSE(std::filesystem::exists(bin_path + ".tmp"));
+}
+
+TEST_CASE("forcing stream keeps a bounded window over a long series", "[forcing]")
+{
+    const std::filesystem::path bin_path = forcing_temp_path("long.bin");
+    std::vector<snow::ForcingRecord> records(5000);
+    for (std::size_t n = 0; n < records.size(); ++n)
+    {
+        records[n].time = 3600.0 * static_cast<double>(n);
+        records[n].wind_speed = static_cast<float>(n % 7);
+        records[n].settling_speed = 0.5f;
+    }
+    REQUIRE(snow::write_forcing_binary(bin_path.string(), records));
+
+    snow::ForcingStream stream;
+    REQUIRE(stream.open(bin_path.string(), 4));
+
+    snow::ForcingRecord sample;
+    for (std::size_t n = 0; n + 1 < records.size(); n += 97)
+    {
+        REQUIRE(stream.sample(3600.0 * static_cast<double>(n) + 1800.0, sample));
+        const float expected = 0.5f * (static_cast<float>(n % 7) + static_cast<float>((n + 1) % 7));
+        REQUIRE(sample.wind_speed == Catch::Approx(expected));
+    }
+}
+
+TEST_CASE("apply_forcing refreshes params and uniform fields", "[forcing]")
+{
+    snow::Params params{};
+    params.wind_speed = 1.0f;
+    params.settling_speed = 0.5f;
+    snow::Fields fields;
+    fields.snow_transport_speed_x = snow::Field2D<float>(3, 2, 1.0f);
+    fields.snow_transport_speed_y = snow::Field2D<float>(2, 3, -0.5f);
+    fields.precipitation_source = snow::Field1D<float>(2, 0.0f);
+
+    snow::ForcingRecord forcing;
+    forcing.wind_speed = -3.0f;
+    forcing.settling_speed = 0.5f;
+    forcing.precipitation_rate = 0.2f;
+    snow::apply_forcing(forcing, params, fields, true);
+
+    REQUIRE(params.wind_speed == -3.0f);
+    REQUIRE(fields.snow_transport_speed_x(2, 1) == -3.0f);
+    REQUIRE(fields.snow_transport_speed_y(1, 2) == -0.5f);
+    REQUIRE(fields.precipitation_source(1) == Catch::Approx(0.2f));
+
+    forcing.precipitation_rate = 0.4f;
+    snow::apply_forcing(forcing, params, fields, false); // a top boundary column owns the top row
+    REQUIRE(params.precipitation_rate == Catch::Approx(0.4f));
+    REQUIRE(fields.precipitation_source(1) == Catch::Approx(0.2f));
+}
+
+TEST_CASE("forcing only drives speed fields with one value", "[forcing]")
+{
+    snow::Fields fields;
+    fields.snow_transport_speed_x = snow::Field2D<float>::uniform(3, 2, 1.0f);
+    fields.snow_transport_speed_y = snow::Field2D<float>(2, 3, -0.5f); // stored, but every cell the same
+    REQUIRE(snow::forcing_fits_speed_fields(fields));
+
+    fields.snow_transport_speed_y(1, 1) = -0.25f;
+    REQUIRE_FALSE(snow::forcing_fits_speed_fields(fields));
+}
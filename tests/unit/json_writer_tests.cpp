@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include "catch_amalgamated.hpp"
+#include "json.hpp"
+#include "json_writer.hpp"
+
+namespace {
+    std::string json_temp_path(const std::string& name)
+    {
+        return (std::filesystem::temp_directory_path() / ("snowsim_json_" + name)).string();
+    }
+
+    nlohmann::json read_json(const std::string& path)
+    {
+        std::ifstream stream(path);
+        return nlohmann::json::parse(stream);
+    }
+}
+
+// tests JsonFileWriter from json_writer.cpp
+TEST_CASE("json writer output parses back to the written document", "[json_writer]")
+{
+    const std::string path = json_temp_path("document.json");
+    snow::JsonFileWriter writer(64); // small buffer so the document is flushed many times
+    REQUIRE(writer.open(path));
+    writer.begin_object();
+    writer.key("name"); writer.value(std::string("quote \" and \\ and \n"));
+    writer.key("count"); writer.value(std::size_t{ 42 });
+    writer.key("negative"); writer.value(-7);
+    writer.key("on"); writer.value(false);
+    writer.key("empty_object"); writer.begin_object(); writer.end_object();
+    writer.key("empty_array"); writer.begin_array(); writer.end_array();
+    writer.key("nested");
+    writer.begin_object();
+    writer.key("values");
+    const float values[4] = { 0.1f, -2.5f, 1.0e-30f, std::numeric_limits<float>::infinity() };
+    writer.array(values, 4);
+    const std::uint8_t mask[3] = { 0, 1, 255 };
+    writer.key("mask");
+    writer.array(mask, 3);
+    writer.end_object();
+    writer.end_object();
+    REQUIRE(writer.close());
+
+    const nlohmann::json root = read_json(path);
+    REQUIRE(root["name"] == "quote \" and \\ and \n");
+    REQUIRE(root["count"] == 42);
+    REQUIRE(root["negative"] == -7);
+    REQUIRE(root["on"] == false);
+    REQUIRE(root["empty_object"].empty());
+    REQUIRE(root["empty_array"].empty());
+    REQUIRE(root["nested"]["values"][1] == -2.5);
+    REQUIRE(root["nested"]["values"][3].is_null());
+    REQUIRE(root["nested"]["mask"] == nlohmann::json::array({ 0, 1, 255 }));
+}
+
+TEST_CASE("json writer floats are the shortest text that reads back exactly", "[json_writer]")
+{
+    const std::string path = json_temp_path("floats.json");
+    const float values[5] = { 0.1f, 1.0f / 3.0f, 16777217.0f, std::numeric_limits<float>::denorm_min(), -123.456f };
+    snow::JsonFileWriter writer;
+    REQUIRE(writer.open(path));
+    writer.array(values, 5);
+    REQUIRE(writer.close());
+
+    std::ifstream stream(path);
+    std::string text;
+    std::getline(stream, text);
+    REQUIRE(text.substr(0, 5) == "[0.1,");
+    const nlohmann::json root = nlohmann::json::parse(text);
+    for (int i = 0; i < 5; ++i)
+    {
+        REQUIRE(root[i].get<float>() == values[i]);
+    }
+}
@@ -0,0 +1,136 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "catch_amalgamated.hpp"
+#include "perf_counters.hpp"
+
+namespace {
+    // Busy work the counters can see.
+    class SpinSimulation : public snow::Simulation
+    {
+    public:
+        void step(snow::Fields&, const snow::Params&) override
+        {
+            for (int k = 0; k < 200000; ++k) sink_ = sink_ * 1.0000001 + 1.0;
+            ++steps;
+        }
+
+        int steps = 0;
+
+    private:
+        volatile double sink_ = 0.0;
+    };
+
+    void spin_for(std::chrono::milliseconds duration)
+    {
+        const auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end) {}
+    }
+}
+
+// tests derive_perf_metrics / print_perf_report / PerfCounterGroup from perf_counters.cpp
+TEST_CASE("perf metrics are derived from the raw counts", "[perf_counters]")
+{
+    snow::PerfCounts counts;
+    counts.hardware = true;
+    counts.cache = true;
+    counts.cycles = 2000;
+    counts.instructions = 3000;
+    counts.llc_references = 100;
+    counts.llc_misses = 25;
+    counts.task_clock_ns = 3000000000ull;
+
+    const snow::PerfMetrics metrics = snow::derive_perf_metrics(counts, 400.0, 2.0, 13.0);
+    REQUIRE(metrics.ipc == Catch::Approx(1.5));
+    REQUIRE(metrics.llc_miss_rate == Catch::Approx(0.25));
+    REQUIRE(metrics.busy_threads == Catch::Approx(1.5));
+    REQUIRE(metrics.kernel_bytes_per_second == Catch::Approx(400.0 * 13.0 / 2.0));
+    REQUIRE(metrics.llc_bytes_per_second == Catch::Approx(25.0 * 64.0 / 2.0));
+    REQUIRE(metrics.llc_bytes_per_cell == Catch::Approx(25.0 * 64.0 / 400.0));
+
+    // nothing counted: no division by zero, and no hardware lines in the report
+    const snow::PerfMetrics empty = snow::derive_perf_metrics(snow::PerfCounts{}, 0.0, 0.0, 13.0);
+    REQUIRE(empty.ipc == 0.0);
+    REQUIRE(empty.kernel_bytes_per_second == 0.0);
+    std::ostringstream report;
+    snow::print_perf_report(report, snow::PerfCounts{}, 0.0, 0.0, 13.0);
+    REQUIRE(report.str().find("IPC") == std::string::npos);
+    REQUIRE(report.str().find("bytes/cell") != std::string::npos);
+}
+
+TEST_CASE("perf counters count wrapped steps or explain why they cannot", "[perf_counters]")
+{
+    snow::PerfCounterGroup counters;
+    if (!counters.open())
+    {
+        REQUIRE_FALSE(counters.error().empty()); // e.g. a container without perf events
+        return;
+    }
+
+    auto spin = std::make_unique<SpinSimulation>();
+    SpinSimulation& inner = *spin;
+    snow::PerfCountedSimulation sim(std::move(spin), counters);
+    snow::Fields fields;
+    snow::Params params{};
+    for (int step = 0; step < 5; ++step) sim.step(fields, params);
+    REQUIRE(inner.steps == 5);
+
+    const snow::PerfCounts counted = counters.read();
+    REQUIRE(counted.task_clock_ns > 0);
+    if (counted.hardware)
+    {
+        REQUIRE(counted.instructions > 5u * 200000u);
+        REQUIRE(counted.cycles > 0);
+    }
+
+    // stopped counters stay put
+    inner.step(fields, params);
+    REQUIRE(counters.read().task_clock_ns == counted.task_clock_ns);
+}
+
+#if defined(__linux__)
+TEST_CASE("perf counters count the threads they are given and no others", "[perf_counters]")
+{
+    // a thread that exists before open() and spins when asked
+    std::atomic<int> given_id{ 0 };
+    std::atomic<bool> go{ false };
+    std::thread given([&]
+    {
+        given_id.store(static_cast<int>(syscall(SYS_gettid)));
+        while (!go.load()) std::this_thread::yield();
+        spin_for(std::chrono::milliseconds(40));
+    });
+    while (given_id.load() == 0) std::this_thread::yield();
+
+    snow::PerfCounterGroup counters;
+    if (!counters.open({ given_id.load() }))
+    {
+        go.store(true);
+        given.join();
+        REQUIRE_FALSE(counters.error().empty());
+        return;
+    }
+
+    counters.start();
+    go.store(true);
+    given.join();
+    // started after open(), like the run loop's snapshot writer: not counted
+    std::thread later([] { spin_for(std::chrono::milliseconds(200)); });
+    later.join();
+    counters.stop();
+
+    const snow::PerfCounts counted = counters.read();
+    REQUIRE(counted.task_clock_ns >= 20000000u);
+    REQUIRE(counted.task_clock_ns < 150000000u);
+}
+#endif
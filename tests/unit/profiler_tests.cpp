@@ -0,0 +1,77 @@
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "catch_amalgamated.hpp"
+#include "profiler.hpp"
+
+// tests histogram_bucket / ScopedTimer / summarize / reset from profiler.cpp
+TEST_CASE("profiler histogram buckets grow by a quarter octave", "[profiler]")
+{
+    REQUIRE(snow::profile::histogram_bucket(0) == 0);
+    REQUIRE(snow::profile::histogram_bucket(15) == 15);
+    REQUIRE(snow::profile::histogram_bucket(16) == 16);
+    REQUIRE(snow::profile::histogram_bucket(19) == 16);
+    REQUIRE(snow::profile::histogram_bucket(20) == 17);
+    REQUIRE(snow::profile::histogram_bucket(32) == 20);
+    REQUIRE(snow::profile::histogram_bucket(~std::uint64_t{ 0 }) == snow::profile::histogram_buckets - 1);
+    for (std::uint64_t ns = 1; ns < 100000; ns = ns * 3 / 2 + 1)
+    {
+        REQUIRE(snow::profile::histogram_bucket(ns) <= snow::profile::histogram_bucket(ns + 1));
+    }
+}
+
+TEST_CASE("profiler merges every thread's counters", "[profiler]")
+{
+    using snow::profile::Phase;
+    snow::profile::reset();
+
+    // 98 fast calls and two slow ones: the p99 lands on the slow ones
+    for (int k = 0; k < 49; ++k) snow::profile::record(Phase::swap, 1000);
+    std::thread other([] { for (int k = 0; k < 49; ++k) snow::profile::record(Phase::swap, 1000); });
+    other.join(); // the finished thread's counters still count
+    snow::profile::record(Phase::swap, 2000000);
+    snow::profile::record(Phase::swap, 2000000);
+
+    const snow::profile::PhaseSummary swap = snow::profile::summarize(Phase::swap);
+    REQUIRE(swap.calls == 100);
+    REQUIRE(swap.total_seconds == Catch::Approx(98 * 1.0e-6 + 2 * 2.0e-3));
+    REQUIRE(swap.mean_seconds == Catch::Approx(swap.total_seconds / 100));
+    REQUIRE(swap.p99_seconds >= 2.0e-3 * 0.8);
+    REQUIRE(swap.p99_seconds <= 2.0e-3);
+    REQUIRE(swap.max_seconds == Catch::Approx(2.0e-3));
+
+    {
+        const snow::profile::ScopedTimer timer(Phase::render);
+    }
+    REQUIRE(snow::profile::summarize(Phase::render).calls == 1);
+
+    std::ostringstream report;
+    snow::profile::print_report(report, 100);
+    if (SNOWSIM_PROFILE)
+    {
+        REQUIRE(report.str().find("swap") != std::string::npos);
+    }
+    else
+    {
+        REQUIRE(report.str().find("disabled") != std::string::npos);
+    }
+
+    snow::profile::reset();
+    REQUIRE(snow::profile::summarize(Phase::swap).calls == 0);
+}
+
+TEST_CASE("profiler can reset some phases and keep the others", "[profiler]")
+{
+    using snow::profile::Phase;
+    snow::profile::reset();
+    snow::profile::record(Phase::config_load, 5000);
+    snow::profile::record(Phase::advect, 1000);
+    std::thread other([] { snow::profile::record(Phase::advect, 1000); });
+    other.join();
+
+    snow::profile::reset({ Phase::advect, Phase::swap });
+    REQUIRE(snow::profile::summarize(Phase::advect).calls == 0);
+    REQUIRE(snow::profile::summarize(Phase::config_load).calls == 1);
+    snow::profile::reset();
+}
@@ -0,0 +1,131 @@
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "cpu_backend.hpp"
+#include "forcing_stream.hpp"
+#include "run_loop.hpp"
+#include "test_fixtures.hpp"
+
+namespace {
+    // the shared 6x5 windy run, 40 steps, with sources that freeze and no early equilibrium stop
+    void make_windy_run(snow::Params& params, snow::Fields& fields)
+    {
+        snow::test::make_run(snow::test::RunSpec{}, params, fields);
+        params.total_time_steps = 40;
+        params.snow_source_steady_tolerance = 1e-6f;
+        params.snow_source_steady_steps = 5;
+        params.equilibrium_tolerance = 0.0f;
+    }
+}
+
+// tests run_simulation from run_loop.cpp
+TEST_CASE("run loop steps to the end and calls its hooks", "[run_loop]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+
+    int started = 0;
+    std::vector<long long> before_steps;
+    std::vector<long long> outputs;
+    snow::RunHooks hooks;
+    hooks.started = [&](const snow::Params&, snow::Fields&) { ++started; };
+    hooks.before_step = [&](long long step, const snow::Params&, snow::Fields&) { before_steps.push_back(step); return true; };
+    hooks.output = [&](long long step, const snow::Params&, const snow::Fields&) { outputs.push_back(step); };
+    hooks.output_interval_steps = 15;
+
+    snow::cpu::CPUSimulation sim;
+    snow::RunTimings timings;
+    REQUIRE(snow::run_simulation(sim, params, fields, snow::RunConfig{}, "", hooks, timings));
+
+    REQUIRE(started == 1);
+    REQUIRE(before_steps.size() == 40);
+    REQUIRE(before_steps.front() == 0);
+    REQUIRE(before_steps.back() == 39);
+    REQUIRE(outputs == std::vector<long long>{ 15, 30 });
+    REQUIRE(timings.steps == 40);
+    REQUIRE(timings.start_step == 0);
+    REQUIRE(timings.cells == 30);
+    REQUIRE_FALSE(timings.stopped_early);
+    REQUIRE(timings.step_seconds <= timings.total_seconds);
+    REQUIRE(fields.snow_accumulation_mass(3) > 0.0f);
+
+    std::ostringstream summary;
+    snow::print_run_timings(summary, timings);
+    REQUIRE(summary.str().find("[timing] 40 steps") == 0);
+}
+
+TEST_CASE("run loop stops when before_step says so", "[run_loop]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+
+    snow::RunHooks hooks;
+    hooks.before_step = [](long long step, const snow::Params&, snow::Fields&) { return step < 12; };
+
+    snow::cpu::CPUSimulation sim;
+    snow::RunTimings timings;
+    REQUIRE(snow::run_simulation(sim, params, fields, snow::RunConfig{}, "", hooks, timings));
+    REQUIRE(timings.steps == 12);
+    REQUIRE(timings.stopped_early);
+}
+
+TEST_CASE("run loop restarts from its own checkpoints bit-exactly", "[run_loop][checkpoint]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+    const snow::Params start_params = params;
+    const snow::Fields start_fields = fields;
+
+    snow::cpu::CPUSimulation sim;
+    snow::RunTimings timings;
+    snow::RunConfig run_config;
+    run_config.checkpoint_path = snow::test::temp_path("run_loop", "restart.ckpt").string();
+    run_config.checkpoint_interval_steps = 25;
+    REQUIRE(snow::run_simulation(sim, params, fields, run_config, "", snow::RunHooks{}, timings));
+
+    snow::Params resumed_params = start_params;
+    snow::Fields resumed = start_fields;
+    run_config.checkpoint_interval_steps = 0;
+    REQUIRE(snow::run_simulation(sim, resumed_params, resumed, run_config, run_config.checkpoint_path, snow::RunHooks{}, timings));
+    REQUIRE(timings.start_step == 25);
+    REQUIRE(timings.steps == 15);
+    REQUIRE(resumed.snow_density.data == fields.snow_density.data);
+    REQUIRE(resumed.snow_accumulation_mass.data == fields.snow_accumulation_mass.data);
+
+    SECTION("a missing checkpoint fails the run")
+    {
+        REQUIRE_FALSE(snow::run_simulation(sim, resumed_params, resumed, run_config, snow::test::temp_path("run_loop", "missing.ckpt").string(),
+                                           snow::RunHooks{}, timings));
+    }
+}
+
+TEST_CASE("run loop refuses forcing over a speed field that varies", "[run_loop][forcing]")
+{
+    snow::ForcingRecord record;
+    record.wind_speed = 3.0f;
+    record.settling_speed = 0.5f;
+    record.precipitation_rate = 0.1f;
+    snow::RunConfig run_config;
+    run_config.forcing_path = snow::test::temp_path("run", "forcing.bin").string();
+    REQUIRE(snow::write_forcing_binary(run_config.forcing_path, { record }));
+
+    snow::Params params;
+    snow::Fields fields;
+    make_windy_run(params, fields);
+    snow::cpu::CPUSimulation sim;
+    snow::RunTimings timings;
+    REQUIRE(snow::run_simulation(sim, params, fields, run_config, "", snow::RunHooks{}, timings));
+    REQUIRE(fields.snow_transport_speed_x.value(0, 0) == 3.0f);
+
+    make_windy_run(params, fields);
+    fields.snow_transport_speed_x.materialize();
+    fields.snow_transport_speed_x(2, 3) = 1.0f; // a terrain-shaped wind that forcing would flatten
+    REQUIRE_FALSE(snow::run_simulation(sim, params, fields, run_config, "", snow::RunHooks{}, timings));
+    REQUIRE(fields.snow_transport_speed_x(2, 3) == 1.0f);
+}
@@ -0,0 +1,228 @@
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "cpu_backend.hpp"
+#include "snapshot_codec.hpp"
+#include "test_fixtures.hpp"
+
+namespace {
+    // 40x20 grid, ground in the bottom two rows, snow blowing in from the left and falling from above.
+    snow::test::RunSpec codec_run()
+    {
+        snow::test::RunSpec spec;
+        spec.nx = 40;
+        spec.ny = 20;
+        spec.ground_rows = 2;
+        spec.wind_speed = 1.0f;
+        spec.precipitation_rate = 0.3f;
+        spec.snow_density = 0.0f;
+        spec.inflow_left = 0.2f;
+        spec.uniform = false;
+        return spec;
+    }
+
+    // density after every fifth step of a 200-step run
+    std::vector<snow::Field2D<float>> simulated_series()
+    {
+        snow::Params params;
+        snow::Fields fields;
+        snow::test::make_run(codec_run(), params, fields);
+        snow::cpu::CPUSimulation sim;
+        std::vector<snow::Field2D<float>> series;
+        for (int t = 1; t <= 200; ++t)
+        {
+            sim.step(fields, params);
+            if (t % 5 == 0) series.push_back(fields.snow_density);
+        }
+        return series;
+    }
+
+    bool same_bits(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+    }
+}
+
+// tests FieldEncoder / FieldDecoder from snapshot_codec.cpp
+TEST_CASE("lossless frames decode bit-exactly and shrink a simulated series", "[snapshot_codec]")
+{
+    const std::vector<snow::Field2D<float>> series = simulated_series();
+
+    snow::FieldEncoder encoder(snow::FieldCodecOptions{ 0.0f, 16 });
+    snow::FieldDecoder decoder;
+    for (const snow::Field2D<float>& frame : series)
+    {
+        std::vector<std::uint8_t> bytes;
+        encoder.encode(frame, bytes);
+        snow::Field2D<float> decoded;
+        REQUIRE(decoder.decode(bytes.data(), bytes.size(), decoded));
+        REQUIRE(decoded.nx == frame.nx);
+        REQUIRE(decoded.ny == frame.ny);
+        REQUIRE(same_bits(decoded.data, frame.data));
+    }
+
+    const snow::CodecStats& stats = encoder.stats();
+    REQUIRE(stats.frames == series.size());
+    REQUIRE(stats.raw_bytes == series.size() * 40 * 20 * sizeof(float));
+    INFO("ratio " << stats.ratio() << ", " << stats.encode_mb_per_second() << " MB/s");
+    REQUIRE(stats.ratio() > 2.0);
+}
+
+TEST_CASE("lossless frames keep special values", "[snapshot_codec]")
+{
+    snow::Field1D<float> values(6);
+    values(0) = -0.0f;
+    values(1) = std::numeric_limits<float>::infinity();
+    values(2) = std::numeric_limits<float>::quiet_NaN();
+    values(3) = std::numeric_limits<float>::denorm_min();
+    values(4) = 1.0e30f;
+    values(5) = -3.25f;
+
+    snow::FieldEncoder encoder(snow::FieldCodecOptions{ 0.01f, 0 }); // unquantizable, so this frame stays lossless
+    std::vector<std::uint8_t> bytes;
+    encoder.encode(values, bytes);
+
+    snow::FieldDecoder decoder;
+    snow::Field1D<float> decoded;
+    REQUIRE(decoder.decode(bytes.data(), bytes.size(), decoded));
+    REQUIRE(same_bits(decoded.data, values.data));
+}
+
+TEST_CASE("error-bounded frames stay within the bound and compress further", "[snapshot_codec]")
+{
+    const std::vector<snow::Field2D<float>> series = simulated_series();
+    const float bound = 1.0e-4f;
+
+    snow::FieldEncoder lossless;
+    snow::FieldEncoder lossy(snow::FieldCodecOptions{ bound, 64 });
+    snow::FieldDecoder decoder;
+    for (const snow::Field2D<float>& frame : series)
+    {
+        std::vector<std::uint8_t> exact_bytes;
+        lossless.encode(frame, exact_bytes);
+
+        std::vector<std::uint8_t> bytes;
+        lossy.encode(frame, bytes);
+        snow::Field2D<float> decoded;
+        REQUIRE(decoder.decode(bytes.data(), bytes.size(), decoded));
+        for (std::size_t i = 0; i < frame.data.size(); ++i)
+        {
+            const float tolerance = bound + std::numeric_limits<float>::epsilon() * std::fabs(frame.data[i]);
+            REQUIRE(std::fabs(decoded.data[i] - frame.data[i]) <= tolerance);
+        }
+    }
+    REQUIRE(lossy.stats().ratio() > lossless.stats().ratio());
+}
+
+TEST_CASE("delta frames need the frame before them", "[snapshot_codec]")
+{
+    snow::FieldEncoder encoder(snow::FieldCodecOptions{ 0.0f, 0 });
+    snow::Field1D<float> values(8, 1.5f);
+    std::vector<std::uint8_t> first;
+    std::vector<std::uint8_t> second;
+    encoder.encode(values, first);
+    values(3) = 2.0f;
+    encoder.encode(values, second);
+
+    snow::FieldDecoder decoder;
+    snow::Field1D<float> decoded;
+    REQUIRE_FALSE(decoder.decode(second.data(), second.size(), decoded));
+    REQUIRE(decoder.decode(first.data(), first.size(), decoded));
+    REQUIRE(decoder.decode(second.data(), second.size(), decoded));
+    REQUIRE(decoded(3) == 2.0f);
+
+    SECTION("damaged payload")
+    {
+        second.resize(second.size() - 1);
+        REQUIRE_FALSE(decoder.decode(second.data(), second.size(), decoded));
+    }
+}
+
+TEST_CASE("frames with a damaged size are refused before allocating", "[snapshot_codec]")
+{
+    snow::FieldEncoder encoder(snow::FieldCodecOptions{ 0.0f, 0 });
+    std::vector<std::uint8_t> frame;
+    encoder.encode(snow::Field2D<float>(4, 4, 0.25f), frame);
+
+    // nx and ny are the little-endian u32s at bytes 8 and 12 of the header
+    const auto set_size = [&frame](std::uint32_t nx, std::uint32_t ny)
+    {
+        for (int b = 0; b < 4; ++b)
+        {
+            frame[8 + b] = static_cast<std::uint8_t>(nx >> (8 * b));
+            frame[12 + b] = static_cast<std::uint8_t>(ny >> (8 * b));
+        }
+    };
+    snow::FieldDecoder decoder;
+    snow::Field2D<float> decoded;
+    SECTION("product overflows")
+    {
+        set_size(0xffffffffu, 0xffffffffu);
+        REQUIRE_FALSE(decoder.decode(frame.data(), frame.size(), decoded));
+    }
+    SECTION("more values than the payload can hold")
+    {
+        set_size(65536, 65536);
+        REQUIRE_FALSE(decoder.decode(frame.data(), frame.size(), decoded));
+    }
+    SECTION("undamaged")
+    {
+        REQUIRE(decoder.decode(frame.data(), frame.size(), decoded));
+        REQUIRE(decoded.nx == 4);
+    }
+}
+
+// tests SnapshotStreamWriter / SnapshotStreamReader from snapshot_codec.cpp
+TEST_CASE("snapshot streams round-trip a run", "[snapshot_codec]")
+{
+    const std::string path = snow::test::temp_path("codec", "series.snz").string();
+    const std::vector<snow::Field2D<float>> series = simulated_series();
+
+    snow::SnapshotStreamWriter writer;
+    REQUIRE(writer.open(path, snow::FieldCodecOptions{ 0.0f, 8 }));
+    for (std::size_t k = 0; k < series.size(); ++k)
+    {
+        snow::Snapshot snapshot;
+        snapshot.step = static_cast<long long>(5 * (k + 1));
+        snapshot.time = 0.5 * (k + 1);
+        snapshot.snow_density = series[k];
+        snapshot.snow_accumulation_mass = snow::Field1D<float>(40, static_cast<float>(k));
+        snapshot.snow_accumulation_depth = snow::Field1D<float>(40, 0.01f * k);
+        REQUIRE(writer.write(snapshot));
+    }
+    REQUIRE(writer.close());
+    REQUIRE(writer.stats().frames == 3 * series.size());
+
+    snow::SnapshotStreamReader reader;
+    REQUIRE(reader.open(path));
+    snow::Snapshot snapshot;
+    std::size_t count = 0;
+    while (reader.next(snapshot))
+    {
+        REQUIRE(snapshot.step == static_cast<long long>(5 * (count + 1)));
+        REQUIRE(snapshot.time == 0.5 * (count + 1));
+        REQUIRE(same_bits(snapshot.snow_density.data, series[count].data));
+        REQUIRE(snapshot.snow_accumulation_mass(39) == static_cast<float>(count));
+        ++count;
+    }
+    REQUIRE(count == series.size());
+
+    SECTION("a frame length past the end of the file")
+    {
+        // the first frame's payload length sits 20 bytes into its header, after the 8-byte magic and
+        // the 16-byte step and time
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(8 + 16 + 20);
+        const char huge[4] = { '\xff', '\xff', '\xff', '\x7f' };
+        file.write(huge, sizeof(huge));
+        file.close();
+        snow::SnapshotStreamReader damaged;
+        REQUIRE(damaged.open(path));
+        REQUIRE_FALSE(damaged.next(snapshot));
+    }
+}
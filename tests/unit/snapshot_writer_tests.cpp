@@ -0,0 +1,91 @@
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "cpu_backend.hpp"
+#include "snapshot_writer.hpp"
+#include "test_fixtures.hpp"
+
+namespace {
+    // 5x4 grid, clean at the start, snow blowing in from the left and falling from above.
+    snow::test::RunSpec writer_run()
+    {
+        snow::test::RunSpec spec;
+        spec.nx = 5;
+        spec.ny = 4;
+        spec.wind_speed = 1.0f;
+        spec.precipitation_rate = 0.3f;
+        spec.snow_density = 0.0f;
+        spec.inflow_left = 0.2f;
+        spec.uniform = false;
+        return spec;
+    }
+}
+
+// tests SnapshotWriter from snapshot_writer.cpp
+TEST_CASE("snapshots capture the marked step without disturbing the run", "[snapshot]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    snow::test::make_run(writer_run(), params, fields);
+    snow::Fields reference = fields;
+
+    std::mutex seen_mutex;
+    std::map<long long, std::vector<float>> seen;
+    snow::SnapshotWriter writer;
+    REQUIRE(writer.start([&](const snow::Snapshot& snapshot)
+    {
+        std::lock_guard<std::mutex> lock(seen_mutex);
+        seen[snapshot.step] = snapshot.snow_density.data;
+        return true;
+    }, 1));
+
+    snow::cpu::CPUSimulation sim;
+    std::map<long long, std::vector<float>> expected;
+    for (long long t = 0; t < 9; ++t)
+    {
+        sim.step(fields, params);
+        writer.collect(fields);
+        sim.step(reference, params);
+        if ((t + 1) % 3 == 0)
+        {
+            writer.mark(t + 1, (t + 1) * 0.1, fields);
+            expected[t + 1] = fields.snow_density.data;
+        }
+    }
+    writer.finish(fields); // step 9 was marked last, with no step after it
+
+    REQUIRE(writer.written() == 3);
+    REQUIRE(writer.failed() == 0);
+    REQUIRE(seen == expected);
+    REQUIRE(fields.snow_density.data == reference.snow_density.data);
+}
+
+TEST_CASE("a slow sink holds the loop back and reports the stall", "[snapshot]")
+{
+    snow::Params params;
+    snow::Fields fields;
+    snow::test::make_run(writer_run(), params, fields);
+
+    snow::SnapshotWriter writer;
+    REQUIRE(writer.start([](const snow::Snapshot&)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return true;
+    }, 1));
+
+    snow::cpu::CPUSimulation sim;
+    for (long long t = 0; t < 6; ++t)
+    {
+        sim.step(fields, params);
+        writer.collect(fields);
+        writer.mark(t + 1, 0.0, fields);
+    }
+    writer.finish(fields);
+
+    REQUIRE(writer.written() == 6);
+    REQUIRE(writer.stall_seconds() > 0.0);
+}
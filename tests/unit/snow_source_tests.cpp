@@ -5,6 +5,7 @@
 
 #include "catch_amalgamated.hpp"
 #include "my_helper.hpp"
+#include "snow_source_boundary.hpp"
 #include "support/my_catch_warning.hpp"
 
 #include "json.hpp"
@@ -114,6 +115,121 @@ TEST_CASE("step_snow_source scenarios", "[snow_source][unit][warning]") {
 }
 
 
+namespace {
+    snow::Params boundary_params(float wind_speed)
+    {
+        snow::Params params{};
+        params.wind_speed = wind_speed;
+        params.settling_speed = 0.5f;
+        params.precipitation_rate = 0.1f;
+        params.dx = 2.0f;
+        params.dy = 10.0f;
+        params.time_step_duration = 0.1f;
+        return params;
+    }
+
+    snow::Fields boundary_fields(std::size_t nx, std::size_t ny)
+    {
+        snow::Fields fields;
+        fields.air_mask = snow::Field2D<std::uint8_t>(nx, ny, 1);
+        fields.air_mask(0, 0) = 0;
+        fields.air_mask(nx - 1, 0) = 0;
+        fields.precipitation_source = Field1D<float>(nx, 0.1f);
+        fields.windborn_horizontal_source_left = Field1D<float>(ny, -1.0f);
+        fields.windborn_horizontal_source_right = Field1D<float>(ny, -1.0f);
+        return fields;
+    }
+}
+
+TEST_CASE("SnowSourceBoundary matches step_snow_source", "[snow_source][boundary][unit]") {
+    const snow::Params params = boundary_params(1.5f);
+    snow::SnowSourceBoundary source(snow::BoundarySide::left, params, 5);
+    REQUIRE(source.is_valid());
+
+    Field1D<float> reference(5, 0.0f);
+    for (int step = 0; step < 250; ++step) {
+        source.advance();
+        reference = snow::step_snow_source(reference, params.settling_speed, params.precipitation_rate, params.dy, params.time_step_duration);
+    }
+    REQUIRE(source.column().data == reference.data);
+}
+
+TEST_CASE("SnowSourceBoundary writes inflow for its side", "[snow_source][boundary][unit]") {
+    snow::Fields fields = boundary_fields(3, 4);
+
+    SECTION("left column feeds air rows while the wind blows in") {
+        snow::SnowSourceBoundary source(snow::BoundarySide::left, boundary_params(1.5f), 4);
+        for (int step = 0; step < 10; ++step) source.advance();
+        source.apply(fields);
+
+        REQUIRE(fields.windborn_horizontal_source_left(0) == 0.0f);
+        REQUIRE(fields.windborn_horizontal_source_left(3) == Catch::Approx(1.5f * source.column()(3) / 2.0f));
+        REQUIRE(fields.windborn_horizontal_source_left(3) > 0.0f);
+        REQUIRE(fields.windborn_horizontal_source_right(3) == -1.0f);
+    }
+    SECTION("right column feeds the right edge only for wind blowing left") {
+        snow::SnowSourceBoundary source(snow::BoundarySide::right, boundary_params(-3.0f), 4);
+        for (int step = 0; step < 10; ++step) source.advance();
+        source.apply(fields);
+
+        REQUIRE(fields.windborn_horizontal_source_right(0) == 0.0f);
+        REQUIRE(fields.windborn_horizontal_source_right(3) == Catch::Approx(3.0f * source.column()(3) / 2.0f));
+
+        snow::SnowSourceBoundary outflow(snow::BoundarySide::right, boundary_params(3.0f), 4);
+        outflow.advance();
+        outflow.apply(fields);
+        REQUIRE(fields.windborn_horizontal_source_right(3) == 0.0f);
+    }
+    SECTION("top column rains its settling flux into the top row") {
+        snow::SnowSourceBoundary source(snow::BoundarySide::top, boundary_params(0.0f), 2);
+        for (int step = 0; step < 300; ++step) source.advance();
+        source.apply(fields);
+
+        REQUIRE(source.column()(0) > 0.0f);
+        REQUIRE(fields.precipitation_source(1) == Catch::Approx(0.5f * source.column()(0) / 10.0f));
+    }
+}
+
+TEST_CASE("SnowSourceBoundary freezes once the column is steady", "[snow_source][boundary][steady]") {
+    snow::Params params = boundary_params(1.5f);
+    params.snow_source_steady_tolerance = 1e-6f;
+    params.snow_source_steady_steps = 50;
+    snow::SnowSourceBoundary source(snow::BoundarySide::left, params, 3);
+
+    int step = 0;
+    while (!source.is_frozen() && step < 200000) {
+        source.advance();
+        ++step;
+    }
+
+    REQUIRE(source.is_frozen());
+    REQUIRE(source.frozen_step() == step);
+
+    // steady profile: settling flux out of each cell balances the precipitation, c = P * dy / v.
+    for (float density : source.column().data) {
+        REQUIRE(density == Catch::Approx(0.1f * 10.0f / 0.5f).epsilon(1e-3));
+    }
+
+    const std::vector<float> frozen_column = source.column().data;
+    source.advance();
+    REQUIRE(source.column().data == frozen_column);
+    REQUIRE(source.frozen_step() == step);
+}
+
+TEST_CASE("SnowSourceBoundary validates once at construction", "[snow_source][boundary][warning]") {
+    snow::Params params = boundary_params(1.5f);
+    params.time_step_duration = 100.0f;
+
+    std::string warning = capture_stderr([&] {
+        snow::SnowSourceBoundary source(snow::BoundarySide::left, params, 4);
+        REQUIRE_FALSE(source.is_valid());
+        source.advance();
+        source.advance();
+        REQUIRE(source.column().data == std::vector<float>(4, 0.0f));
+    });
+    REQUIRE(warning == "Warning: CFL condition exceeded (CFL_snow_source=5)\n");
+}
+
 /**
 we are now planning
 ok so lets start with snow sorce test. here are teh test i can think of so far, with a baseline params of seomthing like this 
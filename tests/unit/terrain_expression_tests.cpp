@@ -0,0 +1,155 @@
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "my_helper.hpp"
+#include "terrain_expression.hpp"
+
+namespace {
+    snow::Params slice_params(std::size_t nx, std::size_t ny, float dx, float dy)
+    {
+        snow::Params params{};
+        params.nx = nx;
+        params.ny = ny;
+        params.dx = dx;
+        params.dy = dy;
+        params.Lx = dx * static_cast<float>(nx);
+        params.Ly = dy * static_cast<float>(ny);
+        return params;
+    }
+
+    // the column-by-column loops the air_mask_* generators used before they were built on Terrain
+    snow::Field2D<std::uint8_t> reference_flat(const snow::Params& params, float bottom)
+    {
+        bottom = std::clamp(bottom, 0.0f, params.Ly);
+        snow::Field2D<std::uint8_t> mask(params.nx, params.ny, 1);
+        const std::size_t cells = static_cast<std::size_t>(bottom / params.dy);
+        for (std::size_t i = 0; i < mask.nx; i++)
+            for (std::size_t j = 0; j < mask.ny; j++)
+                if (j <= cells) mask(i, j) = 0;
+        return mask;
+    }
+
+    snow::Field2D<std::uint8_t> reference_slope(const snow::Params& params, float bottom, float top)
+    {
+        bottom = std::clamp(bottom, 0.0f, params.Ly);
+        top = std::clamp(top, 0.0f, params.Ly);
+        snow::Field2D<std::uint8_t> mask(params.nx, params.ny, 1);
+        const std::size_t cells_from_top = static_cast<std::size_t>(top / params.dy);
+        const std::size_t cells_from_bottom = static_cast<std::size_t>(bottom / params.dy);
+        const float slope = static_cast<float>(params.ny - cells_from_bottom - cells_from_top) / static_cast<float>(params.nx);
+        for (std::size_t i = 0; i < mask.nx; i++)
+            for (std::size_t j = 0; j < mask.ny; j++)
+                if (static_cast<float>(j) <= static_cast<float>(cells_from_bottom) + slope * static_cast<float>(i)) mask(i, j) = 0;
+        return mask;
+    }
+
+    snow::Field2D<std::uint8_t> reference_parabolic(const snow::Params& params, float bottom, float top)
+    {
+        bottom = std::clamp(bottom, 0.0f, params.Ly);
+        top = std::clamp(top, 0.0f, params.Ly);
+        snow::Field2D<std::uint8_t> mask(params.nx, params.ny, 1);
+        const float vertex_x = 0.5f * params.Lx;
+        const float denom = vertex_x * vertex_x;
+        const float a = denom > 0.0f ? (top - bottom) / denom : 0.0f;
+        for (std::size_t i = 0; i < mask.nx; ++i)
+        {
+            const float x_center = (static_cast<float>(i) + 0.5f) * params.dx;
+            const float ground_y = a * (x_center - vertex_x) * (x_center - vertex_x) + bottom;
+            for (std::size_t j = 0; j < mask.ny; ++j)
+                if ((static_cast<float>(j) + 0.5f) * params.dy <= ground_y) mask(i, j) = 0;
+        }
+        return mask;
+    }
+}
+
+// tests air_mask_flat / air_mask_slope_up / air_mask_parabolic from my_helper.cpp
+TEST_CASE("terrain generators keep their masks", "[terrain_expression]")
+{
+    const snow::Params grids[] = { slice_params(60, 40, 1.0f, 1.0f), slice_params(37, 23, 2.5f, 0.5f), slice_params(128, 64, 0.1f, 0.25f) };
+    const float heights[] = { -1.0f, 0.0f, 0.5f, 3.0f, 7.3f, 11.75f, 1000.0f };
+    for (const snow::Params& params : grids)
+    {
+        for (const float bottom : heights)
+        {
+            REQUIRE(snow::air_mask_flat(params, bottom).data == reference_flat(params, bottom).data);
+            for (const float top : heights)
+            {
+                REQUIRE(snow::air_mask_slope_up(params, bottom, top).data == reference_slope(params, bottom, top).data);
+                REQUIRE(snow::air_mask_parabolic(params, bottom, top).data == reference_parabolic(params, bottom, top).data);
+            }
+        }
+    }
+}
+
+// tests Terrain from terrain_expression.cpp
+TEST_CASE("terrain expressions combine primitives per column", "[terrain_expression]")
+{
+    const snow::Params params = slice_params(10, 20, 2.0f, 1.0f); // column centres at 1, 3, ..., 19 m
+
+    const snow::Terrain hill = snow::Terrain::gaussian(9.0f, 8.0f, 2.0f);
+    const snow::Field1D<float> surface = snow::Terrain::flat(2.0f).plus(hill).min(snow::Terrain::flat(8.0f)).surface(params);
+    REQUIRE(surface.nx == 10);
+    REQUIRE(surface(0) == Catch::Approx(2.0f + 8.0f * std::exp(-8.0f)));
+    REQUIRE(surface(4) == Catch::Approx(8.0f)); // 2 + 8 capped at 8
+    REQUIRE(surface(5) == Catch::Approx(2.0f + 8.0f * std::exp(-0.5f)));
+
+    const snow::Field1D<float> ramp = snow::Terrain::slope(1.0f, 0.0f, 0.5f).max(snow::Terrain::flat(3.0f)).offset(-1.0f).surface(params);
+    REQUIRE(ramp(0) == Catch::Approx(2.0f));
+    REQUIRE(ramp(9) == Catch::Approx(8.0f)); // 0 + 0.5 * 18 - 1
+
+    // clamped to [0, Ly]
+    const snow::Field1D<float> bowl = snow::Terrain::parabola(10.0f, -5.0f, 1.0f).surface(params);
+    REQUIRE(bowl(4) == 0.0f);
+    REQUIRE(bowl(0) == 20.0f);
+
+    snow::TerrainProfile profile;
+    profile.cell_size = 2.0f;
+    profile.heights = { 50, 51, 52, 53, 54, 55, 56, 57, 58, 59 };
+    const snow::Field1D<float> imported = snow::Terrain::profile(profile).offset(1.5f).surface(params);
+    REQUIRE(imported(0) == Catch::Approx(1.5f));
+    REQUIRE(imported(9) == Catch::Approx(10.5f));
+}
+
+TEST_CASE("row fill matches the scalar rule and the surface index", "[terrain_expression]")
+{
+    // odd widths exercise the 16-wide blocks and the scalar tail
+    for (const std::size_t nx : { std::size_t{ 1 }, std::size_t{ 15 }, std::size_t{ 16 }, std::size_t{ 37 }, std::size_t{ 300 } })
+    {
+        const snow::Params params = slice_params(nx, 30, 1.0f, 0.5f);
+        snow::Field1D<float> surface(nx);
+        for (std::size_t i = 0; i < nx; ++i)
+        {
+            // includes heights exactly on cell centres and edges
+            surface(i) = 0.25f * static_cast<float>((i * 7) % 64) - 0.5f;
+        }
+        if (nx > 3) surface(3) = std::numeric_limits<float>::quiet_NaN();
+
+        snow::Field2D<std::uint8_t> mask;
+        snow::fill_air_mask(surface, params, mask, 2);
+        REQUIRE(mask.nx == nx);
+        REQUIRE(mask.ny == 30);
+        for (std::size_t j = 0; j < params.ny; ++j)
+        {
+            const float cell_center_y = (static_cast<float>(j) + 0.5f) * params.dy;
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                REQUIRE(mask(i, j) == (cell_center_y <= surface(i) ? 0 : 1));
+            }
+        }
+        REQUIRE(snow::surface_index(surface, params).data == snow::compute_ground_surface_index(mask).data);
+    }
+}
+
+TEST_CASE("refilling a mask of the same size reuses its storage", "[terrain_expression]")
+{
+    const snow::Params params = slice_params(64, 32, 1.0f, 1.0f);
+    snow::Field2D<std::uint8_t> mask = snow::Terrain::flat(4.0f).air_mask(params);
+    const std::uint8_t* storage = mask.data.data();
+
+    snow::fill_air_mask(snow::Terrain::flat(10.0f).surface(params), params, mask);
+    REQUIRE(mask.data.data() == storage);
+    REQUIRE(mask(5, 9) == 0);
+    REQUIRE(mask(5, 10) == 1);
+}
@@ -0,0 +1,141 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "terrain_import.hpp"
+
+namespace {
+    std::string terrain_temp_path(const std::string& name)
+    {
+        return (std::filesystem::temp_directory_path() / ("snowsim_terrain_" + name)).string();
+    }
+
+    std::string write_text(const std::string& name, const std::string& text)
+    {
+        const std::string path = terrain_temp_path(name);
+        std::ofstream(path, std::ios::binary) << text;
+        return path;
+    }
+
+    snow::Params slice_params(std::size_t nx, std::size_t ny, float dx, float dy)
+    {
+        snow::Params params{};
+        params.nx = nx;
+        params.ny = ny;
+        params.dx = dx;
+        params.dy = dy;
+        params.Lx = dx * nx;
+        params.Ly = dy * ny;
+        params.ground_height = 0.0f;
+        return params;
+    }
+}
+
+// tests read_dem_transect from terrain_import.cpp
+TEST_CASE("ESRI grids give the transect row with NODATA filled in", "[terrain]")
+{
+    const std::string path = write_text("grid.asc",
+        "ncols 6\nNROWS 3\nxllcorner 1000.0\nyllcorner 2000.0\ncellsize 5\nNODATA_value -9999\n"
+        "1 1 1 1 1 1\n"
+        "10 -9999 -9999 -9999 20 +21.5\n"
+        "2 2 2 2 2 2\n");
+
+    snow::TerrainImportOptions options; // middle row
+    snow::TerrainProfile profile;
+    REQUIRE(snow::read_dem_transect(path, options, profile));
+    REQUIRE(profile.cell_size == 5.0f);
+    REQUIRE(profile.heights == std::vector<float>{ 10, 10, 10, 20, 20, 21.5f });
+
+    options.row = 2;
+    options.cell_size = 2.0f; // overrides the header
+    REQUIRE(snow::read_dem_transect(path, options, profile));
+    REQUIRE(profile.cell_size == 2.0f);
+    REQUIRE(profile.heights == std::vector<float>(6, 2.0f));
+
+    options.row = 3;
+    REQUIRE_FALSE(snow::read_dem_transect(path, options, profile));
+}
+
+TEST_CASE("PGM images give the transect row scaled to metres", "[terrain]")
+{
+    snow::TerrainImportOptions options;
+    options.row = 1;
+    options.cell_size = 1.0f;
+    options.height_scale = 0.5f;
+    snow::TerrainProfile profile;
+
+    SECTION("binary 8 bit with a header comment")
+    {
+        std::string text = "P5\n# exported heightmap\n4 3\n255\n";
+        const unsigned char pixels[12] = { 0, 0, 0, 0, 10, 20, 30, 255, 9, 9, 9, 9 };
+        text.append(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+        REQUIRE(snow::read_dem_transect(write_text("gray8.pgm", text), options, profile));
+        REQUIRE(profile.heights == std::vector<float>{ 5.0f, 10.0f, 15.0f, 127.5f });
+    }
+    SECTION("binary 16 bit, big endian")
+    {
+        std::string text = "P5 2 2 1000\n";
+        const unsigned char pixels[8] = { 0, 0, 0, 0, 0x03, 0xE8, 0x01, 0x00 };
+        text.append(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+        REQUIRE(snow::read_dem_transect(write_text("gray16.pgm", text), options, profile));
+        REQUIRE(profile.heights == std::vector<float>{ 500.0f, 128.0f });
+    }
+    SECTION("plain text")
+    {
+        REQUIRE(snow::read_dem_transect(write_text("plain.pgm", "P2\n3 2\n15\n1 2 3\n4 5 15\n"), options, profile));
+        REQUIRE(profile.heights == std::vector<float>{ 2.0f, 2.5f, 7.5f });
+    }
+    SECTION("truncated data or no cell size")
+    {
+        REQUIRE_FALSE(snow::read_dem_transect(write_text("short.pgm", "P2\n3 2\n15\n1 2 3\n4 5\n"), options, profile));
+        options.cell_size = 0.0f;
+        REQUIRE_FALSE(snow::read_dem_transect(write_text("nocell.pgm", "P2\n3 2\n15\n1 2 3\n4 5 6\n"), options, profile));
+    }
+}
+
+// tests resample_ground_profile from terrain_import.cpp
+TEST_CASE("transects are resampled to the grid spacing", "[terrain]")
+{
+    snow::TerrainProfile profile;
+    profile.cell_size = 1.0f;
+    profile.heights = { 100, 102, 104, 106, 108, 110, 112, 114 };
+
+    SECTION("coarser grid averages each footprint, lowest column at ground_height")
+    {
+        snow::Params params = slice_params(4, 10, 2.0f, 1.0f);
+        params.ground_height = 1.0f;
+        const std::vector<float> ground = snow::resample_ground_profile(profile, params, 0.0f);
+        REQUIRE(ground == std::vector<float>{ 1.0f, 5.0f, 9.0f, 10.0f }); // 101, 105, 109, 113 shifted, then clamped to Ly
+    }
+    SECTION("finer grid interpolates, offset along the transect")
+    {
+        snow::Params params = slice_params(3, 100, 0.5f, 1.0f);
+        const std::vector<float> ground = snow::resample_ground_profile(profile, params, 2.0f);
+        // centres at 2.25, 2.75, 3.25 m -> samples at positions 1.75, 2.25, 2.75
+        REQUIRE(ground[0] == Catch::Approx(0.0f));
+        REQUIRE(ground[1] == Catch::Approx(1.0f));
+        REQUIRE(ground[2] == Catch::Approx(2.0f));
+    }
+}
+
+// tests rasterize_ground_profile from terrain_import.cpp
+TEST_CASE("threaded rasterization matches a serial column fill", "[terrain]")
+{
+    const snow::Params params = slice_params(512, 600, 1.0f, 0.5f);
+    std::vector<float> ground(params.nx);
+    for (std::size_t i = 0; i < params.nx; ++i) ground[i] = static_cast<float>((i * 37) % 300);
+
+    const snow::Field2D<std::uint8_t> threaded = snow::rasterize_ground_profile(ground, params, 4);
+    const snow::Field2D<std::uint8_t> single = snow::rasterize_ground_profile(ground, params, 1);
+    REQUIRE(threaded.data == single.data);
+    for (std::size_t i = 0; i < params.nx; i += 17)
+    {
+        for (std::size_t j = 0; j < params.ny; ++j)
+        {
+            const float cell_center_y = (static_cast<float>(j) + 0.5f) * params.dy;
+            REQUIRE(threaded(i, j) == (cell_center_y <= ground[i] ? 0 : 1));
+        }
+    }
+}
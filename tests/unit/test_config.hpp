@@ -0,0 +1,42 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+
+#include "json.hpp"
+#include "test_fixtures.hpp"
+
+// Config files for the loader and cache tests.
+namespace snow
+{
+namespace test
+{
+
+// Every param the loader requires, on a grid of 10 m cells Lx by Ly metres (3x2 by default) with the
+// ground at the bottom edge; "fields" is an empty object for the caller to fill in.
+inline nlohmann::json make_config(double Lx = 30.0, double Ly = 20.0)
+{
+    nlohmann::json root;
+    root["params"] = {
+        { "wind_speed", 2.0 }, { "settling_speed", 0.5 }, { "precipitation_rate", 0.1 },
+        { "ground_height", 0.0 }, { "settaled_snow_density", 200000.0 },
+        { "Lx", Lx }, { "Ly", Ly }, { "dx", 10.0 }, { "dy", 10.0 },
+        { "total_sim_time", 10.0 }, { "time_step_duration", 0.1 }, { "steps_per_frame", 1 },
+        { "light_direction", { -0.4, -1.0, -0.6 } }, { "light_color", { 1.0, 1.0, 1.0 } },
+        { "object_color", { 0.8, 0.8, 0.8 } }, { "arrow_plane_z", 0.1 }, { "arrow_density_max", 2.0 },
+        { "arrow_reference_wind", 60.0 }, { "arrow_min_length", 0.1 }, { "viz_on", false }
+    };
+    root["fields"] = nlohmann::json::object();
+    return root;
+}
+
+// Writes text to temp_path(module, name) and returns that path.
+inline std::string write_config(const std::string& module, const std::string& name, const std::string& text)
+{
+    const std::string path = temp_path(module, name).string();
+    std::ofstream(path) << text;
+    return path;
+}
+
+} // namespace test
+} // namespace snow
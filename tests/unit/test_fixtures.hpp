@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "types.hpp"
+
+// Fixtures shared by the unit tests that step, save or stream small runs.
+namespace snow
+{
+namespace test
+{
+
+// <temp dir>/snowsim_<module>_<name>; each test file passes its own module so files never collide.
+inline std::filesystem::path temp_path(const std::string& module, const std::string& name)
+{
+    return std::filesystem::temp_directory_path() / ("snowsim_" + module + "_" + name);
+}
+
+// A small run of 1 m cells and 0.1 s steps: ground in the bottom ground_rows rows, snow blowing to the
+// right and settling. The defaults give the 6x5 windy run most tests use.
+struct RunSpec
+{
+    std::size_t nx = 6;
+    std::size_t ny = 5;
+    std::size_t ground_rows = 1;
+    float wind_speed = 2.0f;         // snow_transport_speed_x everywhere
+    float settling_speed = 0.5f;     // snow_transport_speed_y is -settling_speed
+    float precipitation_rate = 0.2f;
+    float snow_density = 0.05f;      // starting density in every cell
+    float inflow_left = 0.0f;        // windborn_horizontal_source_left
+    bool uniform = true;             // constant fields stay uniform (symbolic) instead of being stored
+};
+
+inline void make_run(const RunSpec& spec, Params& params, Fields& fields)
+{
+    params = Params{};
+    params.nx = spec.nx;
+    params.ny = spec.ny;
+    params.dx = 1.0f;
+    params.dy = 1.0f;
+    params.time_step_duration = 0.1f;
+    params.wind_speed = spec.wind_speed;
+    params.settling_speed = spec.settling_speed;
+    params.precipitation_rate = spec.precipitation_rate;
+    params.settaled_snow_density = 100.0f;
+
+    const auto constant2d = [&spec](std::size_t nx, std::size_t ny, float value)
+    {
+        return spec.uniform ? Field2D<float>::uniform(nx, ny, value) : Field2D<float>(nx, ny, value);
+    };
+    const auto constant1d = [&spec](std::size_t nx, float value)
+    {
+        return spec.uniform ? Field1D<float>::uniform(nx, value) : Field1D<float>(nx, value);
+    };
+
+    fields = Fields{};
+    fields.air_mask = Field2D<std::uint8_t>(spec.nx, spec.ny, 1);
+    for (std::size_t j = 0; j < spec.ground_rows && j < spec.ny; ++j)
+    {
+        for (std::size_t i = 0; i < spec.nx; ++i) fields.air_mask(i, j) = 0;
+    }
+    fields.snow_density = Field2D<float>(spec.nx, spec.ny, spec.snow_density);
+    fields.next_snow_density = constant2d(spec.nx, spec.ny, 0.0f);
+    fields.snow_transport_speed_x = constant2d(spec.nx + 1, spec.ny, spec.wind_speed);
+    fields.snow_transport_speed_y = constant2d(spec.nx, spec.ny + 1, -spec.settling_speed);
+    fields.snow_accumulation_mass = Field1D<float>(spec.nx);
+    fields.snow_accumulation_density = constant1d(spec.nx, params.settaled_snow_density);
+    fields.precipitation_source = constant1d(spec.nx, spec.precipitation_rate);
+    fields.windborn_horizontal_source_left = constant1d(spec.ny, spec.inflow_left);
+    fields.windborn_horizontal_source_right = constant1d(spec.ny, 0.0f);
+}
+
+} // namespace test
+} // namespace snow
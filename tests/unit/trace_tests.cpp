@@ -0,0 +1,146 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "catch_amalgamated.hpp"
+#include "json.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+
+namespace {
+    nlohmann::json read_trace(const std::string& path)
+    {
+        std::ifstream in(path);
+        return nlohmann::json::parse(in);
+    }
+}
+
+// tests start_trace / trace_event / stop_trace / TraceGuard from trace.cpp
+TEST_CASE("trace writes chrome trace events per thread", "[trace]")
+{
+    using snow::profile::Phase;
+    const std::string path = (std::filesystem::temp_directory_path() / "snowsim_trace_threads.json").string();
+
+    REQUIRE(snow::profile::start_trace(path, 16));
+    REQUIRE(snow::profile::tracing());
+    REQUIRE_FALSE(snow::profile::start_trace(path, 16)); // one trace at a time
+
+    snow::profile::name_thread("trace test");
+    snow::profile::trace_event(Phase::step, 5000, 3000);
+    snow::profile::trace_event(Phase::advect, 5500, 2000);
+    std::thread other([]
+    {
+        snow::profile::name_thread("trace test worker");
+        snow::profile::trace_event(Phase::snapshot_write, 6000, 1000);
+    });
+    other.join();
+    REQUIRE(snow::profile::stop_trace());
+    REQUIRE_FALSE(snow::profile::tracing());
+    REQUIRE_FALSE(snow::profile::stop_trace());
+
+    const nlohmann::json trace = read_trace(path);
+    int steps = 0;
+    int writes = 0;
+    int step_tid = -1;
+    int write_tid = -1;
+    bool named_worker = false;
+    for (const nlohmann::json& event : trace["traceEvents"])
+    {
+        if (event["ph"] == "M" && event["name"] == "thread_name" && event["args"]["name"] == "trace test worker") named_worker = true;
+        if (event["ph"] != "X") continue;
+        if (event["name"] == "step")
+        {
+            ++steps;
+            step_tid = event["tid"];
+            REQUIRE(event["dur"].get<double>() == Catch::Approx(3.0));
+        }
+        if (event["name"] == "snapshot_write")
+        {
+            ++writes;
+            write_tid = event["tid"];
+        }
+    }
+    REQUIRE(steps == 1);
+    REQUIRE(writes == 1);
+    REQUIRE(step_tid != write_tid);
+    REQUIRE(named_worker);
+    REQUIRE(trace["otherData"]["dropped_events"] == 0);
+}
+
+TEST_CASE("trace rings keep the newest events when they wrap", "[trace]")
+{
+    using snow::profile::Phase;
+    const std::string path = (std::filesystem::temp_directory_path() / "snowsim_trace_wrap.json").string();
+
+    REQUIRE(snow::profile::start_trace(path, 4));
+    for (std::uint64_t k = 0; k < 10; ++k) snow::profile::trace_event(Phase::swap, k * 1000, 100);
+    REQUIRE(snow::profile::stop_trace());
+
+    const nlohmann::json trace = read_trace(path);
+    REQUIRE(trace["otherData"]["dropped_events"] == 6);
+    int swaps = 0;
+    for (const nlohmann::json& event : trace["traceEvents"])
+    {
+        if (event["ph"] == "X" && event["name"] == "swap") ++swaps;
+    }
+    REQUIRE(swaps == 4);
+}
+
+TEST_CASE("trace records profiler scopes while it is on", "[trace]")
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "snowsim_trace_scopes.json").string();
+
+    REQUIRE(snow::profile::start_trace(path, 8));
+    {
+        const snow::profile::ScopedTimer timer(snow::profile::Phase::dump);
+    }
+    REQUIRE(snow::profile::stop_trace());
+    {
+        const snow::profile::ScopedTimer timer(snow::profile::Phase::dump); // after the trace: not recorded
+    }
+
+    const nlohmann::json trace = read_trace(path);
+    int dumps = 0;
+    for (const nlohmann::json& event : trace["traceEvents"])
+    {
+        if (event["ph"] == "X" && event["name"] == "dump") ++dumps;
+    }
+    REQUIRE(dumps == 1);
+}
+
+TEST_CASE("trace refuses empty rings and unwritable paths", "[trace]")
+{
+    REQUIRE_FALSE(snow::profile::start_trace((std::filesystem::temp_directory_path() / "snowsim_trace_empty.json").string(), 0));
+    REQUIRE(snow::profile::start_trace("/nonexistent_dir/snowsim_trace.json", 4));
+    snow::profile::trace_event(snow::profile::Phase::step, 0, 1);
+    REQUIRE_FALSE(snow::profile::stop_trace());
+    REQUIRE_FALSE(snow::profile::tracing());
+}
+
+TEST_CASE("trace guard writes the trace on every way out of a scope", "[trace]")
+{
+    using snow::profile::Phase;
+    const std::string path = (std::filesystem::temp_directory_path() / "snowsim_trace_guard.json").string();
+    std::filesystem::remove(path);
+
+    const auto traced_run = [&](bool fail)
+    {
+        snow::profile::TraceGuard guard;
+        REQUIRE(snow::profile::start_trace(path, 16));
+        snow::profile::trace_event(Phase::config_load, 1000, 500);
+        if (fail) return false; // an early error return
+        return guard.stop();
+    };
+
+    REQUIRE_FALSE(traced_run(true));
+    REQUIRE_FALSE(snow::profile::tracing());
+    REQUIRE(std::filesystem::exists(path));
+
+    std::filesystem::remove(path);
+    REQUIRE(traced_run(false));
+    REQUIRE(std::filesystem::exists(path));
+
+    snow::profile::TraceGuard idle;
+    REQUIRE(idle.stop()); // nothing to write
+}
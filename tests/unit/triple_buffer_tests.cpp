@@ -0,0 +1,115 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "render_exchange.hpp"
+#include "triple_buffer.hpp"
+
+// tests TripleBuffer from triple_buffer.hpp
+TEST_CASE("triple buffer hands over the newest value", "[triple_buffer]")
+{
+    snow::TripleBuffer<int> buffer;
+    REQUIRE_FALSE(buffer.update());
+
+    buffer.back() = 1;
+    REQUIRE_FALSE(buffer.publish());
+    REQUIRE(buffer.update());
+    REQUIRE(buffer.front() == 1);
+    REQUIRE_FALSE(buffer.update()); // nothing new: front stays
+    REQUIRE(buffer.front() == 1);
+
+    buffer.back() = 2;
+    REQUIRE_FALSE(buffer.publish());
+    buffer.back() = 3;
+    REQUIRE(buffer.publish()); // 2 was never read
+    REQUIRE(buffer.back() == 2);
+    REQUIRE(buffer.update());
+    REQUIRE(buffer.front() == 3);
+}
+
+TEST_CASE("triple buffer never tears or goes back in time across threads", "[triple_buffer]")
+{
+    constexpr int frames = 20000;
+    snow::TripleBuffer<std::vector<int>> buffer;
+    std::atomic<bool> done{ false };
+
+    std::thread producer([&]
+    {
+        for (int frame = 1; frame <= frames; ++frame)
+        {
+            buffer.back().assign(64, frame);
+            buffer.publish();
+        }
+        done.store(true);
+    });
+
+    int last = 0;
+    int updates = 0;
+    bool consistent = true;
+    for (;;)
+    {
+        const bool finished = done.load();
+        if (!buffer.update())
+        {
+            if (finished) break; // nothing published after done
+            continue;
+        }
+        const std::vector<int>& value = buffer.front();
+        for (const int v : value) consistent = consistent && v == value.front();
+        consistent = consistent && value.front() > last;
+        last = value.front();
+        ++updates;
+    }
+    producer.join();
+
+    REQUIRE(consistent);
+    REQUIRE(updates > 0);
+    REQUIRE(last == frames);
+}
+
+// tests RenderExchange from render_exchange.cpp
+TEST_CASE("render exchange carries mask changes over skipped frames", "[triple_buffer][render_exchange]")
+{
+    snow::Params params{};
+    params.nx = 8;
+    params.ny = 4;
+    snow::Fields fields;
+    fields.snow_density = snow::Field2D<float>(params.nx, params.ny, 1.0f);
+    fields.air_mask = snow::Field2D<std::uint8_t>(params.nx, params.ny, 1);
+    fields.snow_transport_speed_x = snow::Field2D<float>::uniform(params.nx + 1, params.ny, 2.0f);
+
+    snow::RenderExchange exchange;
+    bool fresh = true;
+    REQUIRE(exchange.latest(&fresh).step == -1);
+    REQUIRE_FALSE(fresh);
+
+    fields.air_mask_dirty.include(1, 1);
+    exchange.publish(0, params, fields);
+    REQUIRE(fields.air_mask_dirty.empty());
+
+    fields.snow_density(3, 2) = 5.0f;
+    fields.air_mask_dirty.include(6, 3);
+    exchange.publish(10, params, fields); // the renderer never saw step 0
+
+    snow::RenderFrame& frame = exchange.latest(&fresh);
+    REQUIRE(fresh);
+    REQUIRE(frame.step == 10);
+    REQUIRE(frame.fields.snow_density(3, 2) == 5.0f);
+    REQUIRE(frame.fields.snow_transport_speed_x.is_uniform());
+    REQUIRE(frame.fields.air_mask_dirty.x_min == 1);
+    REQUIRE(frame.fields.air_mask_dirty.x_max == 6);
+    REQUIRE(frame.fields.air_mask_dirty.y_min == 1);
+    REQUIRE(frame.fields.air_mask_dirty.y_max == 3);
+    frame.fields.air_mask_dirty.clear(); // uploaded
+
+    exchange.publish(20, params, fields); // no mask change; carries 10's region since 0 went unread
+    fields.air_mask_dirty.include(2, 0);
+    exchange.publish(30, params, fields);
+    snow::RenderFrame& next = exchange.latest(&fresh);
+    REQUIRE(next.step == 30);
+    REQUIRE(next.fields.air_mask_dirty.x_min == 2);
+    REQUIRE(next.fields.air_mask_dirty.x_max == 2);
+    REQUIRE(next.fields.air_mask_dirty.y_max == 0);
+    REQUIRE(exchange.published() == 4);
+}
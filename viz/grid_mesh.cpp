@@ -155,20 +155,45 @@ void GridMesh2D::destroy()
     index_count_ = 0;
 }
 
-/** Uploads the latest air-mask texel data (0 = ground, 255 = air) to the GPU texture. */
-void GridMesh2D::update_mask_texture(const std::vector<std::uint8_t>& mask_values)
+/**
+ * Uploads the latest air-mask texel data (0 = ground, 255 = air) to the GPU texture.
+ * mask_values must cover the whole grid; its pitch becomes the unpack row length, so padded or
+ * externally owned buffers upload without a repack.
+ */
+void GridMesh2D::update_mask_texture(snow::Field2DView<const std::uint8_t> mask_values)
 {
-    if (mask_values.size() != rows_ * cols_ || texture_id_ == 0)
+    if (mask_values.nx != cols_ || mask_values.ny != rows_ || texture_id_ == 0)
     {
         return; // Ignore mismatched uploads.
     }
+    update_mask_texture_region(mask_values, 0, 0);
+}
+
+/**
+ * Uploads a rectangle of air-mask texels whose lower-left corner lands at (col_min, row_min).
+ * mask_values is usually a subview of the full staging grid; the unpack row length is set to its
+ * pitch so GL picks the rectangle out of the parent buffer without a copy.
+ */
+void GridMesh2D::update_mask_texture_region(snow::Field2DView<const std::uint8_t> mask_values,
+                                            std::size_t col_min, std::size_t row_min)
+{
+    if (mask_values.empty() || texture_id_ == 0)
+    {
+        return; // Ignore empty uploads.
+    }
+    if (col_min + mask_values.nx > cols_ || row_min + mask_values.ny > rows_)
+    {
+        return; // Ignore out-of-range rectangles.
+    }
 
-    glBindTexture(GL_TEXTURE_2D, texture_id_); // Select the mask texture to update.
+    glBindTexture(GL_TEXTURE_2D, texture_id_);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(mask_values.pitch)); // Rows in the source buffer are pitch texels apart.
     glTexSubImage2D(GL_TEXTURE_2D, 0,
-                    0, 0,
-                    static_cast<GLsizei>(cols_), static_cast<GLsizei>(rows_),
-                    GL_RED, GL_UNSIGNED_BYTE, mask_values.data());
-    glBindTexture(GL_TEXTURE_2D, 0); // Unbind for cleanliness.
+                    static_cast<GLint>(col_min), static_cast<GLint>(row_min),
+                    static_cast<GLsizei>(mask_values.nx), static_cast<GLsizei>(mask_values.ny),
+                    GL_RED, GL_UNSIGNED_BYTE, mask_values.data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0); // Restore the default so other uploads stay tightly packed.
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 /** Binds the VAO and issues a draw call for the entire grid. */
@@ -5,6 +5,8 @@
 #include <vector>
 #include <glm/glm/glm.hpp>
 
+#include "types.hpp"
+
 namespace snow {
 namespace viz {
 
@@ -20,7 +22,9 @@ public:
     bool initialize(std::size_t rows, std::size_t cols, float width);
     void destroy();
 
-    void update_mask_texture(const std::vector<std::uint8_t>& mask_values);
+    void update_mask_texture(snow::Field2DView<const std::uint8_t> mask_values);
+    void update_mask_texture_region(snow::Field2DView<const std::uint8_t> mask_values,
+                                    std::size_t col_min, std::size_t row_min);
 
     void draw() const;
 
@@ -37,6 +37,7 @@ namespace {
     Camera g_camera;
 
     bool g_air_mask_initialized = false;
+    bool g_air_mask_uploaded = false; // first upload covers the whole grid, later ones only the dirty region
     std::vector<std::uint8_t> g_air_mask_texture_data;
 
     bool g_arrow_initialized = false;
@@ -214,6 +215,7 @@ void initialize_air_mask_resources(const Params& params)
     }
 
     g_air_mask_texture_data.assign(params.ny * params.nx, 0); // Allocate staging buffer (one byte per cell).
+    g_air_mask_uploaded = false;
 
     g_air_mask_shader.bind();
     g_air_mask_shader.set_uniform("uMaskTexture", static_cast<int>(kAirMaskTextureUnit)); // sampler2D ? texture unit mapping.
@@ -282,6 +284,7 @@ void shutdown()
     g_air_mask_texture_data.clear();
     g_air_mask_shader.destroy();
     g_air_mask_initialized = false;
+    g_air_mask_uploaded = false;
 
     g_arrow_layer.destroy();
     g_arrow_instances.clear();
@@ -367,7 +370,7 @@ void render_frame(const Params& params, const Fields& fields)
     }
     if (g_air_mask_initialized)
     {
-        render_air_mask(params, fields.air_mask);
+        render_air_mask(params, fields.air_mask.view(), fields.air_mask_dirty);
     }
 
     if (g_arrow_initialized)
@@ -381,11 +384,16 @@ void render_frame(const Params& params, const Fields& fields)
 }
 
 /**
- * Streams the current air-mask into a texture and renders the grid overlay in one draw call.
+ * Streams the air-mask into a texture and renders the grid overlay in one draw call.
+ * The first call uploads the whole grid; later calls only re-stage and upload air_mask_dirty.
+ * The caller clears air_mask_dirty once the frame has been rendered.
  * @param params Simulation parameters (used for camera matrices).
- * @param air_mask Field containing the per-cell air/ground classification.
+ * @param air_mask View of the per-cell air/ground classification (any pitch).
+ * @param air_mask_dirty Cells flipped since the previous upload.
  */
-void render_air_mask(const Params& params, const Field2D<std::uint8_t>& air_mask)
+void render_air_mask(const Params& params,
+                     Field2DView<const std::uint8_t> air_mask,
+                     const DirtyRegion& air_mask_dirty)
 {
     (void)params; // Camera matrices come from the global camera; params are unused for now.
 
@@ -398,18 +406,38 @@ void render_air_mask(const Params& params, const Field2D<std::uint8_t>& air_mask
     if (g_air_mask_texture_data.size() != cell_count)
     {
         g_air_mask_texture_data.resize(cell_count, 0); // Resize staging buffer if the grid dimensions changed.
+        g_air_mask_uploaded = false;
     }
 
-    for (std::size_t j = 0; j < air_mask.ny; ++j)
+    if (!g_air_mask_uploaded)
     {
-        for (std::size_t i = 0; i < air_mask.nx; ++i)
+        for (std::size_t j = 0; j < air_mask.ny; ++j)
         {
-            const bool is_air_cell = air_mask.in_bounds(i, j) && air_mask(i, j) != 0;
-            g_air_mask_texture_data[j * air_mask.nx + i] = is_air_cell ? 255u : 0u; // 255 = air, 0 = ground.
+            for (std::size_t i = 0; i < air_mask.nx; ++i)
+            {
+                g_air_mask_texture_data[j * air_mask.nx + i] = air_mask(i, j) != 0 ? 255u : 0u; // 255 = air, 0 = ground.
+            }
         }
+        g_air_mask_mesh.update_mask_texture(Field2DView<const std::uint8_t>(g_air_mask_texture_data.data(), air_mask.nx, air_mask.ny, air_mask.nx)); // Upload every texel once.
+        g_air_mask_uploaded = true;
+    }
+    else if (!air_mask_dirty.empty())
+    {
+        const std::size_t x_max = std::min(air_mask_dirty.x_max, air_mask.nx - 1);
+        const std::size_t y_max = std::min(air_mask_dirty.y_max, air_mask.ny - 1);
+        for (std::size_t j = air_mask_dirty.y_min; j <= y_max; ++j)
+        {
+            for (std::size_t i = air_mask_dirty.x_min; i <= x_max; ++i)
+            {
+                g_air_mask_texture_data[j * air_mask.nx + i] = air_mask(i, j) != 0 ? 255u : 0u;
+            }
+        }
+        const Field2DView<const std::uint8_t> staged(g_air_mask_texture_data.data(), air_mask.nx, air_mask.ny, air_mask.nx);
+        g_air_mask_mesh.update_mask_texture_region(staged.subview(air_mask_dirty.x_min, air_mask_dirty.y_min,
+                                                                  x_max + 1 - air_mask_dirty.x_min,
+                                                                  y_max + 1 - air_mask_dirty.y_min),
+                                                   air_mask_dirty.x_min, air_mask_dirty.y_min); // Upload only the flipped cells.
     }
-
-    g_air_mask_mesh.update_mask_texture(g_air_mask_texture_data); // Upload new texel values.
 
     g_air_mask_shader.bind();
     g_air_mask_shader.set_uniform("uModel", glm::mat4(1.0f)); // Keep the grid centered on the origin.
@@ -470,22 +498,22 @@ void render_arrows(const Params& params, const Fields& fields)
             int samples_y = 0;
             if (fields.snow_transport_speed_x.in_bounds(i, field_row))
             {
-                vx += fields.snow_transport_speed_x(i, field_row);
+                vx += fields.snow_transport_speed_x.value(i, field_row);
                 ++samples_x;
             }
             if (fields.snow_transport_speed_x.in_bounds(i + 1, field_row))
             {
-                vx += fields.snow_transport_speed_x(i + 1, field_row);
+                vx += fields.snow_transport_speed_x.value(i + 1, field_row);
                 ++samples_x;
             }
             if (fields.snow_transport_speed_y.in_bounds(i, field_row))
             {
-                vy += fields.snow_transport_speed_y(i, field_row);
+                vy += fields.snow_transport_speed_y.value(i, field_row);
                 ++samples_y;
             }
             if (fields.snow_transport_speed_y.in_bounds(i, field_row + 1))
             {
-                vy += fields.snow_transport_speed_y(i, field_row + 1);
+                vy += fields.snow_transport_speed_y.value(i, field_row + 1);
                 ++samples_y;
             }
             if (samples_x > 0)
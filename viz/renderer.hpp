@@ -23,7 +23,9 @@ void end_frame();
 void initialize_air_mask_resources(const snow::Params& params);
 void initialize_arrow_resources(const snow::Params& params);
 
-void render_air_mask(const snow::Params& params, const snow::Field2D<std::uint8_t>& air_mask);
+void render_air_mask(const snow::Params& params,
+                     snow::Field2DView<const std::uint8_t> air_mask,
+                     const snow::DirtyRegion& air_mask_dirty);
 void render_arrows(const snow::Params& params, const snow::Fields& fields);
 void render_cube(const glm::vec3& light_direction,
                  const glm::vec3& light_color,